@@ -0,0 +1,360 @@
+//============ Copyright  2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: bench_xtga.cpp
+/// purpose : Micro-benchmarks for the codec kernels, across depths, sizes and entropy levels.
+///
+///			  usage : bench_xtga [--filter name] [--max-size edge] [--min-time ms] [--samples n] [--threads n]
+///
+///			  Sizes run from 32x32 up to --max-size (16384 for 16K). Build with optimisations
+///			  (e.g. -DCMAKE_BUILD_TYPE=Release) for meaningful numbers.
+//==============================================================================
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "harness.h"
+
+#include "codecs.h"
+#include "convert.h"
+#include "palette.h"
+#include "resample.h"
+#include "xTGA/xTGA.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+using namespace xtga;
+using namespace xtga::codecs;
+using namespace xtga::pixelformats;
+
+enum class ENTROPY
+{
+	LOW,			// runs of 64 pixels, 16 colors.
+	MEDIUM,			// runs of 4 pixels, 256 colors.
+	HIGH			// every pixel random.
+};
+
+const char* EntropyName(ENTROPY e)
+{
+	return e == ENTROPY::LOW ? "low" : e == ENTROPY::MEDIUM ? "medium" : "high";
+}
+
+PIXELFORMATS FormatOf(uchar depth)
+{
+	return depth == 8 ? PIXELFORMATS::I8 : depth == 16 ? PIXELFORMATS::BGRA5551 : depth == 24 ? PIXELFORMATS::BGR888 : PIXELFORMATS::BGRA8888;
+}
+
+struct Case
+{
+	uint16 Width;
+	uint16 Height;
+	uchar Depth;
+	ENTROPY Entropy;
+	const uchar* Image;
+
+	addressable Length() const { return (addressable)Width * Height; }
+	addressable Bytes() const { return Length() * (Depth / 8); }
+};
+
+uint32 Hash(uint32 x)
+{
+	x ^= x >> 16; x *= 0x7FEB352Du;
+	x ^= x >> 15; x *= 0x846CA68Bu;
+	return x ^ (x >> 16);
+}
+
+// the same seed gives the same image, so runs are repeatable.
+uchar* MakeImage(uint16 width, uint16 height, uchar depth, ENTROPY entropy)
+{
+	const uchar bpp = depth / 8;
+	const addressable length = (addressable)width * height;
+	const addressable run = entropy == ENTROPY::LOW ? 64 : entropy == ENTROPY::MEDIUM ? 4 : 1;
+	const uint32 colors = entropy == ENTROPY::LOW ? 16 : 256;
+
+	// a little slack past the end, some kernels read a whole word for their last pixel.
+	auto image = (uchar*)memory::Allocate(length * bpp + 4);
+
+	for (addressable i = 0; i < length; ++i)
+	{
+		const uint32 r = Hash((uint32)(i / run));
+		const uint32 v = entropy == ENTROPY::HIGH ? r : Hash(r % colors + 1);
+		memcpy(image + i * bpp, &v, bpp);
+	}
+
+	return image;
+}
+
+//==================================================================================================
+// Kernels, each sets up its input untimed and then measures one call.
+//==================================================================================================
+
+void BenchDecodeRLE(const char* name, const Case& c, const bench::Options& o)
+{
+	void* encoded = nullptr;
+	if (!EncodeRLE(c.Image, encoded, c.Width, c.Height, c.Depth))
+		return;
+
+	auto out = memory::Allocate(c.Bytes());
+	auto m = bench::Measure([&] { DecodeRLEInto(encoded, c.Depth, c.Length(), out); }, o);
+	bench::Report(name, c.Depth, c.Width, c.Height, EntropyName(c.Entropy), c.Bytes(), m);
+
+	memory::Free(out);
+	memory::Free(encoded);
+}
+
+void BenchEncodeRLE(const char* name, const Case& c, const bench::Options& o)
+{
+	auto m = bench::Measure([&]
+	{
+		void* encoded = nullptr;
+		EncodeRLE(c.Image, encoded, c.Width, c.Height, c.Depth);
+		memory::Free(encoded);
+	}, o);
+	bench::Report(name, c.Depth, c.Width, c.Height, EntropyName(c.Entropy), c.Bytes(), m);
+}
+
+void BenchDecodeColorMap(const char* name, const Case& c, const bench::Options& o)
+{
+	if (c.Depth == 8)
+		return;
+
+	// the image's bytes double as indices, and its first 256 pixels as the color map.
+	auto indices = MakeImage(c.Width, c.Height, 8, c.Entropy);
+	auto colormap = MakeImage(256, 1, c.Depth, ENTROPY::HIGH);
+
+	auto m = bench::Measure([&] { memory::Free(DecodeColorMap(indices, c.Length(), colormap, c.Depth)); }, o);
+	bench::Report(name, c.Depth, c.Width, c.Height, EntropyName(c.Entropy), c.Bytes(), m);
+
+	memory::Free(colormap);
+	memory::Free(indices);
+}
+
+void BenchGenerateColorMap(const char* name, const Case& c, const bench::Options& o, bool force,
+	flags::QUANTIZER quantizer = flags::QUANTIZER::MEDIAN_CUT, uchar refinement = 0, addressable samples = 0)
+{
+	if (c.Depth == 8)
+		return;
+
+	auto Generate = [&]() -> bool
+	{
+		void* indices = nullptr;
+		void* colormap = nullptr;
+		uint16 size = 0;
+		const bool rval = GenerateColorMap(c.Image, indices, colormap, c.Length(), c.Depth, size, force, quantizer, refinement, samples);
+		memory::Free(indices);
+		memory::Free(colormap);
+		return rval;
+	};
+
+	// an exact color map needs 256 colors or less, timing the bail out would say nothing.
+	if (!force && !Generate())
+		return;
+
+	auto m = bench::Measure(Generate, o);
+	bench::Report(name, c.Depth, c.Width, c.Height, EntropyName(c.Entropy), c.Bytes(), m);
+}
+
+void BenchGenerateColorMapExact(const char* name, const Case& c, const bench::Options& o)
+{
+	BenchGenerateColorMap(name, c, o, false);
+}
+
+void BenchGenerateColorMapForced(const char* name, const Case& c, const bench::Options& o)
+{
+	// median cut holds every distinct color in a std::set, past 2048x2048 noise has too many to fit in memory.
+	if (c.Entropy == ENTROPY::HIGH && c.Length() > (addressable)2048 * 2048)
+		return;
+
+	BenchGenerateColorMap(name, c, o, true);
+}
+
+void BenchQuantizeOctree(const char* name, const Case& c, const bench::Options& o)
+{
+	BenchGenerateColorMap(name, c, o, true, flags::QUANTIZER::OCTREE);
+}
+
+void BenchQuantizeWu(const char* name, const Case& c, const bench::Options& o)
+{
+	BenchGenerateColorMap(name, c, o, true, flags::QUANTIZER::WU);
+}
+
+// 4 rounds of k-means after Wu, the refinement the quantizer tests check the quality of.
+void BenchQuantizeWuRefined(const char* name, const Case& c, const bench::Options& o)
+{
+	BenchGenerateColorMap(name, c, o, true, flags::QUANTIZER::WU, 4);
+}
+
+// the histogram built from a 1 in 16 sample of the pixels.
+void BenchQuantizeWuSampled(const char* name, const Case& c, const bench::Options& o)
+{
+	BenchGenerateColorMap(name, c, o, true, flags::QUANTIZER::WU, 0, std::max<addressable>(c.Length() / 16, 1));
+}
+
+void BenchApplyColorMap(const char* name, const Case& c, const bench::Options& o, bool inverse)
+{
+	if (c.Depth == 8)
+		return;
+
+	void* indices = nullptr;
+	void* colormap = nullptr;
+	uint16 size = 0;
+	// Wu's histogram stays the same size however many colors the image has (median cut's doesn't).
+	if (!GenerateColorMap(c.Image, indices, colormap, c.Length(), c.Depth, size, true, flags::QUANTIZER::WU))
+		return;
+	memory::Free(indices);
+
+	InverseColorMap* lattice = inverse ? new InverseColorMap(colormap, size, c.Depth, PaletteWeights::RGBA()) : nullptr;
+
+	auto m = bench::Measure([&] { memory::Free(ApplyColorMap(c.Image, c.Length(), colormap, size, c.Depth, lattice)); }, o);
+	bench::Report(name, c.Depth, c.Width, c.Height, EntropyName(c.Entropy), c.Bytes(), m);
+
+	delete lattice;
+	memory::Free(colormap);
+}
+
+void BenchApplyColorMapSearch(const char* name, const Case& c, const bench::Options& o)
+{
+	BenchApplyColorMap(name, c, o, false);
+}
+
+void BenchApplyColorMapInverse(const char* name, const Case& c, const bench::Options& o)
+{
+	BenchApplyColorMap(name, c, o, true);
+}
+
+template <void* (*Convert)(void const*, uint16, uint16, uchar, ERRORCODE*)>
+void BenchOrientation(const char* name, const Case& c, const bench::Options& o)
+{
+	auto m = bench::Measure([&] { memory::Free(Convert(c.Image, c.Width, c.Height, c.Depth, nullptr)); }, o);
+	bench::Report(name, c.Depth, c.Width, c.Height, EntropyName(c.Entropy), c.Bytes(), m);
+}
+
+void BenchResizeBicubic(const char* name, const Case& c, const bench::Options& o)
+{
+	const uint16 w = std::max(c.Width / 2, 1), h = std::max(c.Height / 2, 1);
+
+	auto m = bench::Measure([&] { memory::Free(ResizeImageBicubic(c.Image, FormatOf(c.Depth), c.Width, c.Height, w, h)); }, o);
+	bench::Report(name, c.Depth, c.Width, c.Height, EntropyName(c.Entropy), c.Bytes(), m);
+}
+
+template <class T>
+void ToRGBA(const void* in, RGBA8888* out, addressable length, RGBA8888 (*convert)(T))
+{
+	for (addressable i = 0; i < length; ++i)
+		out[i] = convert(((const T*)in)[i]);
+}
+
+void BenchToRGBA(const char* name, const Case& c, const bench::Options& o)
+{
+	auto out = (RGBA8888*)memory::Allocate(c.Length() * sizeof(RGBA8888));
+
+	auto m = bench::Measure([&]
+	{
+		if (c.Depth == 8) ToRGBA<I8>(c.Image, out, c.Length(), I_To_RGBA);
+		else if (c.Depth == 16) ToRGBA<BGRA5551>(c.Image, out, c.Length(), BGRA16_To_RGBA);
+		else if (c.Depth == 24) ToRGBA<BGR888>(c.Image, out, c.Length(), BGR_To_RGBA);
+		else ToRGBA<BGRA8888>(c.Image, out, c.Length(), BGRA_To_RGBA);
+	}, o);
+	bench::Report(name, c.Depth, c.Width, c.Height, EntropyName(c.Entropy), c.Bytes(), m);
+
+	memory::Free(out);
+}
+
+// RGBA8888 input (as handed to TGAFile::Alloc()) converted to the stored format a row at a time.
+void BenchFromRGBA(const char* name, const Case& c, const bench::Options& o)
+{
+	auto transform = GetRowTransform(PIXELFORMATS::RGBA8888, FormatOf(c.Depth));
+	if (!transform)
+		return;
+
+	auto in = MakeImage(c.Width, c.Height, 32, c.Entropy);
+	auto out = (uchar*)memory::Allocate(c.Bytes());
+
+	auto m = bench::Measure([&]
+	{
+		for (uint16 y = 0; y < c.Height; ++y)
+			transform(in + (addressable)y * c.Width * 4, out + (addressable)y * c.Width * (c.Depth / 8), c.Width);
+	}, o);
+	bench::Report(name, c.Depth, c.Width, c.Height, EntropyName(c.Entropy), c.Bytes(), m);
+
+	memory::Free(out);
+	memory::Free(in);
+}
+
+struct Kernel
+{
+	const char* Name;
+	void (*Run)(const char* name, const Case& c, const bench::Options& o);
+};
+
+const Kernel Kernels[] =
+{
+	{ "DecodeRLE", BenchDecodeRLE },
+	{ "EncodeRLE", BenchEncodeRLE },
+	{ "DecodeColorMap", BenchDecodeColorMap },
+	{ "GenerateColorMap/exact", BenchGenerateColorMapExact },
+	{ "GenerateColorMap/forced", BenchGenerateColorMapForced },
+	{ "GenerateColorMap/octree", BenchQuantizeOctree },
+	{ "GenerateColorMap/wu", BenchQuantizeWu },
+	{ "GenerateColorMap/wu+kmeans", BenchQuantizeWuRefined },
+	{ "GenerateColorMap/wu-sample", BenchQuantizeWuSampled },
+	{ "ApplyColorMap/search", BenchApplyColorMapSearch },
+	{ "ApplyColorMap/inverse", BenchApplyColorMapInverse },
+	{ "BottomLeft_To_TopLeft", BenchOrientation<Convert_BottomLeft_To_TopLeft> },
+	{ "BottomRight_To_TopLeft", BenchOrientation<Convert_BottomRight_To_TopLeft> },
+	{ "TopRight_To_TopLeft", BenchOrientation<Convert_TopRight_To_TopLeft> },
+	{ "ResizeImageBicubic/half", BenchResizeBicubic },
+	{ "ToRGBA", BenchToRGBA },
+	{ "FromRGBA", BenchFromRGBA },
+};
+
+int main(int argc, char** argv)
+{
+	bench::Options options;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (arg == "--filter" && value) options.Filter = argv[++i];
+		else if (arg == "--max-size" && value) options.MaxSize = (uint32)atoi(argv[++i]);
+		else if (arg == "--min-time" && value) options.MinTime = atof(argv[++i]) / 1000.0;
+		else if (arg == "--samples" && value) options.Samples = (uint32)atoi(argv[++i]);
+		else if (arg == "--threads" && value) options.Threads = (uint32)atoi(argv[++i]);
+		else
+		{
+			printf("usage : bench_xtga [--filter name] [--max-size edge] [--min-time ms] [--samples n] [--threads n]\n");
+			return 1;
+		}
+	}
+
+	if (options.Threads)
+		threading::SetThreadCount(options.Threads);
+
+	bench::ReportHeader();
+
+	for (uint32 size = 32; size <= options.MaxSize && size <= 16384; size *= 8)
+	{
+		for (auto entropy : { ENTROPY::LOW, ENTROPY::MEDIUM, ENTROPY::HIGH })
+		{
+			for (uchar depth : { 8, 16, 24, 32 })
+			{
+				auto image = MakeImage((uint16)size, (uint16)size, depth, entropy);
+				const Case c = { (uint16)size, (uint16)size, depth, entropy, image };
+
+				for (auto& k : Kernels)
+				{
+					if (options.Filter.empty() || strstr(k.Name, options.Filter.c_str()))
+						k.Run(k.Name, c, options);
+				}
+
+				memory::Free(image);
+			}
+		}
+	}
+
+	return 0;
+}
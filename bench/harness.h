@@ -0,0 +1,108 @@
+//============ Copyright  2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: harness.h
+/// purpose : Times benchmark kernels (with warm-up and repeated samples) and reports their throughput.
+//==============================================================================
+
+#ifndef XTGA_BENCH_HARNESS_H__
+#define XTGA_BENCH_HARNESS_H__
+
+#include "xTGA/types.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+	struct Options
+	{
+		std::string Filter;				// only kernels whose name contains this run.
+		uint32 MaxSize = 2048;			// the largest edge benchmarked.
+		double MinTime = 0.02;			// the shortest a sample may run (in seconds).
+		uint32 Samples = 5;				// the number of timed samples.
+		uint32 Threads = 0;				// the worker threads (0 leaves the library's default).
+	};
+
+	struct Measurement
+	{
+		double Median;					// seconds per call.
+		double Min;
+		double Max;
+	};
+
+	template <class F>
+	double Time(const F& fn, uint32 calls)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		for (uint32 i = 0; i < calls; ++i)
+			fn();
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	//----------------------------------------------------------------------------------------------------
+	/// Times 'fn'. Calls are batched so a sample runs for at least MinTime, warm-up batches run until two in
+	/// a row agree within 5% (so caches, the heap and the thread pool have settled), and the median of the
+	/// samples is reported alongside their spread.
+	//----------------------------------------------------------------------------------------------------
+	template <class F>
+	Measurement Measure(const F& fn, const Options& options)
+	{
+		uint32 batch = 1;
+		double per = Time(fn, 1);
+		double warm = per;
+
+		while (per * batch < options.MinTime && batch < (1u << 24))
+		{
+			const double want = options.MinTime / std::max(per, 1e-9);
+			batch = std::max(batch * 2, (uint32)std::min(want + 1, (double)(1u << 24)));
+			per = Time(fn, batch) / batch;
+			warm += per * batch;
+		}
+
+		for (int i = 0; i < 8 && warm < options.MinTime * 20; ++i)
+		{
+			const double t = Time(fn, batch) / batch;
+			const bool stable = std::fabs(t - per) <= per * 0.05;
+			per = t;
+			warm += t * batch;
+			if (stable)
+				break;
+		}
+
+		std::vector<double> samples;
+		for (uint32 i = 0; i < std::max(options.Samples, 1u); ++i)
+			samples.push_back(Time(fn, batch) / batch);
+
+		std::sort(samples.begin(), samples.end());
+		return { samples[samples.size() / 2], samples.front(), samples.back() };
+	}
+
+	inline void ReportHeader()
+	{
+		printf("%-26s %5s %11s %8s %12s %12s %8s\n", "kernel", "depth", "size", "entropy", "Mpx/s", "MB/s", "spread");
+	}
+
+	//----------------------------------------------------------------------------------------------------
+	/// Prints a result, 'bytes' being the uncompressed pixels the kernel handles per call.
+	//----------------------------------------------------------------------------------------------------
+	inline void Report(const char* kernel, uchar depth, uint16 width, uint16 height, const char* entropy, addressable bytes,
+		const Measurement& m)
+	{
+		char size[16];
+		snprintf(size, sizeof(size), "%ux%u", width, height);
+
+		const double pixels = (double)width * height;
+		printf("%-26s %5u %11s %8s %12.2f %12.1f %7.1f%%\n", kernel, depth, size, entropy, pixels / m.Median / 1e6,
+			(double)bytes / m.Median / (1 << 20), (m.Max - m.Min) / m.Median * 100.0);
+		fflush(stdout);
+	}
+}
+
+#endif // !XTGA_BENCH_HARNESS_H__
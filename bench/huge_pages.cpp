@@ -0,0 +1,136 @@
+//============ Copyright  2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: huge_pages.cpp
+/// purpose : Measures the time and page faults of decoding a large image with and without huge pages.
+///
+///			  usage : bench_huge_pages [width] [height] [iterations]
+//==============================================================================
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "xTGA/xTGA.h"
+
+#include <chrono>
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#	include <sys/resource.h>
+#endif
+
+using namespace xtga;
+using namespace xtga::memory;
+using namespace xtga::pixelformats;
+
+// minor (no I/O) page faults taken by the process so far.
+uint64 minor_faults()
+{
+#ifndef _WIN32
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return (uint64)usage.ru_minflt;
+#else
+	return 0;
+#endif
+}
+
+std::string thp_mode()
+{
+	std::ifstream in("/sys/kernel/mm/transparent_hugepage/enabled");
+	std::string rval;
+	std::getline(in, rval);
+	return rval.empty() ? "unavailable" : rval;
+}
+
+struct Result
+{
+	double Milliseconds;
+	double Faults;
+	uint64 HugePageAllocations;
+};
+
+// each decode allocates its output and scratch, as a pipeline that hands images on would.
+Result run(TGAFile* tga, int iterations)
+{
+	ResetStats();
+	const uint64 faults = minor_faults();
+	const auto start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < iterations; ++i)
+	{
+		auto rgba = tga->GetImageRGBA();
+		ManagedArray<RGBA8888>::Free(rgba);
+	}
+
+	const auto end = std::chrono::steady_clock::now();
+
+	Result rval;
+	rval.Milliseconds = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+	rval.Faults = (double)(minor_faults() - faults) / iterations;
+	rval.HugePageAllocations = GetStats().HugePageAllocations;
+	return rval;
+}
+
+int main(int argc, char** argv)
+{
+	const uint16 width = (uint16)(argc > 1 ? atoi(argv[1]) : 4096);
+	const uint16 height = (uint16)(argc > 2 ? atoi(argv[2]) : 4096);
+	const int iterations = argc > 3 ? atoi(argv[3]) : 8;
+
+	if (width == 0 || height == 0 || iterations <= 0)
+	{
+		printf("usage : bench_huge_pages [width] [height] [iterations]\n");
+		return 1;
+	}
+
+	// runs long enough for RLE to do real work, short enough to keep it from being trivial.
+	std::vector<BGRA8888> image((addressable)width * height);
+	for (addressable i = 0; i < image.size(); ++i)
+	{
+		const uint32 v = (uint32)(i / 7) * 2654435761u;
+		image[i].B = (uchar)(v >> 24);
+		image[i].G = (uchar)(v >> 16);
+		image[i].R = (uchar)(v >> 8);
+		image[i].A = 0xFF;
+	}
+
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto params = Parameters::BGRA32_RLE_STRAIGHT_ALPHA();
+	params.InputFormat = PIXELFORMATS::BGRA8888;
+	auto tga = TGAFile::Alloc(image.data(), width, height, params, &terr);
+	if (terr != ERRORCODE::NONE)
+	{
+		printf("failed to create the image (%u)\n", (uint32)terr);
+		return 1;
+	}
+
+	std::vector<BGRA8888>().swap(image);
+
+	const double megabytes = (double)width * height * sizeof(RGBA8888) / (1 << 20);
+	printf("image          : %ux%u RGBA (%.1f MB decoded), %d iterations\n", width, height, megabytes, iterations);
+	printf("transparent hp : %s\n\n", thp_mode().c_str());
+	printf("%-12s %12s %12s %16s %12s\n", "mode", "ms/decode", "MB/s", "faults/decode", "huge bufs");
+
+	const HugePageOptions options = { 2 << 20, (addressable)2 * width * height * sizeof(RGBA8888) + (8 << 20) };
+	for (int mode = 0; mode < 2; ++mode)
+	{
+		SetHugePageOptions(mode ? &options : nullptr);
+
+		// one untimed decode, so both modes start with the heap (or mapping cache) warm.
+		run(tga, 1);
+		auto r = run(tga, iterations);
+
+		printf("%-12s %12.2f %12.1f %16.0f %12llu\n", mode ? "huge pages" : "default", r.Milliseconds,
+			megabytes / (r.Milliseconds / 1000.0), r.Faults, (unsigned long long)r.HugePageAllocations);
+	}
+
+	SetHugePageOptions(nullptr);
+	TGAFile::Free(tga);
+	return 0;
+}
@@ -0,0 +1,355 @@
+//============ Copyright  2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: allocator.cpp
+/// purpose : Tests that buffers come from the allocator in effect and that hot paths don't allocate.
+//==============================================================================
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "assert_equal.h"
+#include "library_error.h"
+#include "xTGA/xTGA.h"
+
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+using namespace xtga;
+using namespace xtga::memory;
+using namespace xtga::pixelformats;
+using namespace xtga::flags;
+
+const uint16 W = 256, H = 192;
+
+// counts the blocks it hands out, which come from the allocator that was in effect when it was made.
+struct Counter
+{
+	Allocator Base;
+	std::atomic<uint64> Allocations;
+	std::atomic<uint64> Frees;
+};
+
+Allocator counting_allocator(Counter& counter)
+{
+	auto CountAllocate = [](addressable size, addressable alignment, void* userdata) -> void*
+	{
+		auto c = (Counter*)userdata;
+		++c->Allocations;
+		return c->Base.Allocate(size, alignment, c->Base.UserData);
+	};
+	auto CountFree = [](void* ptr, void* userdata)
+	{
+		auto c = (Counter*)userdata;
+		++c->Frees;
+		c->Base.Free(ptr, c->Base.UserData);
+	};
+
+	counter.Base = GetAllocator();
+	counter.Allocations = 0;
+	counter.Frees = 0;
+	return { CountAllocate, CountFree, &counter };
+}
+
+std::vector<BGRA8888> make_image()
+{
+	std::vector<BGRA8888> image((addressable)W * H);
+
+	for (uint16 y = 0; y < H; ++y)
+	{
+		for (uint16 x = 0; x < W; ++x)
+		{
+			auto& p = image[(addressable)y * W + x];
+			p.B = (uchar)(x / 16 * 16);
+			p.G = (uchar)(y / 12 * 16);
+			p.R = (uchar)((x ^ y) & 0xF0);
+			p.A = 0xFF;
+		}
+	}
+
+	return image;
+}
+
+int test_basics()
+{
+	auto before = GetStats();
+
+	for (addressable alignment : { 1, 16, 64, 256, 4096 })
+	{
+		auto p = Allocate(1000, alignment);
+		const bool allocated = p != nullptr;
+		const addressable misalignment = (addressable)p % (alignment < 16 ? 16 : alignment);
+		ASSERT_EQUAL(allocated, true);
+		ASSERT_EQUAL(misalignment, 0);
+		Free(p);
+	}
+
+	auto z = (uchar*)AllocateZeroed(333);
+	for (addressable i = 0; i < 333; ++i)
+		ASSERT_EQUAL(z[i], 0);
+
+	// growing keeps the contents.
+	for (addressable i = 0; i < 333; ++i)
+		z[i] = (uchar)i;
+	z = (uchar*)Reallocate(z, 5000);
+	for (addressable i = 0; i < 333; ++i)
+		ASSERT_EQUAL(z[i], (uchar)i);
+	Free(z);
+
+	auto after = GetStats();
+	const uint64 allocations = after.Allocations - before.Allocations;
+	const uint64 frees = after.Frees - before.Frees;
+	const bool peaked = after.PeakBytesInUse >= 5000;
+	ASSERT_EQUAL(allocations, frees);
+	ASSERT_EQUAL(after.BytesInUse, before.BytesInUse);
+	ASSERT_EQUAL(peaked, true);
+
+	return 0;
+}
+
+int test_managed_array()
+{
+	auto before = GetStats();
+
+	// an array from malloc() is freed with free().
+	auto foreign = (uchar*)malloc(100);
+	if (!foreign) { UNKNOWN_ERROR; }
+	auto arr = ManagedArray<uchar>::Alloc(foreign, 100);
+	ManagedArray<uchar>::Free(arr);
+
+	// released, it is moved to a buffer the caller frees with memory::Free().
+	foreign = (uchar*)malloc(100);
+	if (!foreign) { UNKNOWN_ERROR; }
+	for (uchar i = 0; i < 100; ++i)
+		foreign[i] = i;
+	arr = ManagedArray<uchar>::Alloc(foreign, 100);
+	auto released = ManagedArray<uchar>::Release(arr);
+	for (uchar i = 0; i < 100; ++i)
+		ASSERT_EQUAL(released[i], i);
+	Free(released);
+
+	// one from memory::Allocate() goes back through memory::Free().
+	auto owned = (uchar*)Allocate(100);
+	arr = ManagedArray<uchar>::Adopt(owned, 100);
+	const bool same = arr->data() == owned;
+	ASSERT_EQUAL(same, true);
+	ManagedArray<uchar>::Free(arr);
+
+	auto after = GetStats();
+	ASSERT_EQUAL(after.BytesInUse, before.BytesInUse);
+	return 0;
+}
+
+int test_custom_allocator()
+{
+	Counter global, local;
+	auto image = make_image();
+	ERRORCODE terr = ERRORCODE::NONE;
+
+	auto GlobalAllocator = counting_allocator(global);
+	auto LocalAllocator = counting_allocator(local);
+	SetAllocator(&GlobalAllocator);
+	auto before = GetStats();
+
+	auto tga = TGAFile::Alloc(image.data(), W, H, Parameters::BGR24_RLE_COLORMAPPED(), &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	auto rgba = tga->GetImageRGBA(nullptr, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	const uint64 counted = global.Allocations;
+	const uint64 allocations = GetStats().Allocations - before.Allocations;
+	const bool globalUsed = counted > 0;
+	ASSERT_EQUAL(globalUsed, true);
+	ASSERT_EQUAL(counted, allocations);
+
+	// a thread allocator takes over for this thread (and the work it hands to the pool), buffers from
+	// the global one are still freed through it.
+	{
+		ScopedAllocator scope(LocalAllocator);
+		threading::SetThreadCount(4);
+
+		auto mips = tga->GenerateMipChain(MIPFILTER::BOX, PIXELFORMATS::BGRA8888, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+		const bool localUsed = local.Allocations > 0;
+		ASSERT_EQUAL(localUsed, true);
+		MipChain::Free(mips);
+
+		ManagedArray<RGBA8888>::Free(rgba);
+		TGAFile::Free(tga);
+		threading::SetThreadCount(0);
+	}
+
+	ASSERT_EQUAL(global.Allocations, global.Frees);
+	ASSERT_EQUAL(local.Allocations, local.Frees);
+	ASSERT_EQUAL(GetStats().BytesInUse, before.BytesInUse);
+
+	SetAllocator(nullptr);
+	return 0;
+}
+
+int test_no_hot_path_allocations()
+{
+	auto image = make_image();
+	ERRORCODE terr = ERRORCODE::NONE;
+
+	// once a writer is open, rows are converted and encoded in buffers it already holds.
+	std::stringstream out;
+	auto params = Parameters::BGR24_RLE();
+	params.InputFormat = PIXELFORMATS::BGRA8888;
+	params.TGA2File = true;
+
+	auto writer = TGAWriter::Open(out, W, H, params, IMAGEORIGIN::TOP_LEFT, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	auto before = GetStats();
+	for (uint16 y = 0; y < H; ++y)
+	{
+		ASSERT_EQUAL(writer->WriteRows(&image[(addressable)y * W], 1, &terr), true);
+		ASSERT_ERRORCODE_NONE(terr);
+	}
+	ASSERT_EQUAL(GetStats().Allocations, before.Allocations);
+
+	ASSERT_EQUAL(writer->Close(&terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+	TGAWriter::Free(writer);
+
+	// edits to an uncompressed image happen in place.
+	params = Parameters::BGRA32_STRAIGHT_ALPHA();
+	params.InputFormat = PIXELFORMATS::BGRA8888;
+	auto tga = TGAFile::Alloc(image.data(), W, H, params, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	before = GetStats();
+	auto Invert = [](RGBA8888& p, void*) { p.R = 255 - p.R; };
+	ASSERT_EQUAL(tga->TransformColors(Invert, nullptr, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(GetStats().Allocations, before.Allocations);
+
+	TGAFile::Free(tga);
+	return 0;
+}
+
+int test_arena()
+{
+	auto image = make_image();
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto arena = Arena::Alloc(64 * 1024);
+
+	addressable reserved = 0;
+	for (int frame = 0; frame < 3; ++frame)
+	{
+		{
+			ScopedAllocator scope(arena->GetAllocator());
+
+			auto tga = TGAFile::Alloc(image.data(), W, H, Parameters::BGR16_RLE(), &terr);
+			ASSERT_ERRORCODE_NONE(terr);
+			auto thumb = tga->GetImageRGBA(nullptr, &terr);
+			ASSERT_ERRORCODE_NONE(terr);
+
+			ManagedArray<RGBA8888>::Free(thumb);
+			TGAFile::Free(tga);
+		}
+
+		const bool used = arena->GetUsed() > 0;
+		const bool reserves = arena->GetReserved() >= arena->GetUsed();
+		ASSERT_EQUAL(used, true);
+		ASSERT_EQUAL(reserves, true);
+
+		// once warm the same work fits in the blocks the arena already holds.
+		if (frame > 0)
+			ASSERT_EQUAL(arena->GetReserved(), reserved);
+		reserved = arena->GetReserved();
+
+		arena->Reset();
+		ASSERT_EQUAL(arena->GetUsed(), 0);
+	}
+
+	Arena::Free(arena);
+	ASSERT_EQUAL(arena, (Arena*)nullptr);
+	return 0;
+}
+
+#ifdef __linux__
+// true if 'address' lies in one of the process's mappings.
+bool is_mapped(addressable address)
+{
+	std::ifstream maps("/proc/self/maps");
+	std::string line;
+
+	while (std::getline(maps, line))
+	{
+		unsigned long long lo = 0, hi = 0;
+		if (sscanf(line.c_str(), "%llx-%llx", &lo, &hi) == 2 && address >= lo && address < hi)
+			return true;
+	}
+
+	return false;
+}
+#endif
+
+int test_huge_pages()
+{
+#ifdef __linux__
+	const HugePageOptions options = { 1 << 20, 16 << 20 };
+	SetHugePageOptions(&options);
+	auto before = GetStats();
+
+	// large buffers are mapped, small ones and ones from an application allocator are not.
+	const addressable size = 3 << 20;
+	auto p = (uchar*)Allocate(size);
+	const bool allocated = p != nullptr;
+	const addressable misalignment = (addressable)p % DefaultAlignment;
+	ASSERT_EQUAL(allocated, true);
+	ASSERT_EQUAL(misalignment, 0);
+	ASSERT_EQUAL(GetStats().HugePageAllocations - before.HugePageAllocations, 1);
+	memset(p, 0xAB, size);
+
+	auto q = Allocate(4096);
+	ASSERT_EQUAL(GetStats().HugePageAllocations - before.HugePageAllocations, 1);
+	Free(q);
+
+	{
+		Counter counter;
+		ScopedAllocator scope(counting_allocator(counter));
+		q = Allocate(size);
+		ASSERT_EQUAL(GetStats().HugePageAllocations - before.HugePageAllocations, 1);
+		ASSERT_EQUAL(counter.Allocations, 1);
+		Free(q);
+	}
+
+	// a released mapping is reused, its pages were given back so it reads as zeroes.
+	Free(p);
+	auto r = (uchar*)Allocate(size);
+	ASSERT_EQUAL(r, p);
+	ASSERT_EQUAL(r[0], 0);
+	ASSERT_EQUAL(r[size - 1], 0);
+	Free(r);
+
+	// a smaller buffer can reuse a larger mapping, all of it must go back when it is released.
+	auto big = (uchar*)Allocate(6 << 20);
+	const addressable start = (addressable)big & ~(addressable)((2 << 20) - 1);
+	Free(big);
+
+	auto small = (uchar*)Allocate(4 << 20);
+	const addressable reused = (addressable)small & ~(addressable)((2 << 20) - 1);
+	ASSERT_EQUAL(reused, start);
+	Free(small);
+
+	ASSERT_EQUAL(GetStats().BytesInUse, before.BytesInUse);
+	SetHugePageOptions(nullptr);
+
+	for (addressable offset = 0; offset < (8 << 20); offset += 1 << 20)
+		ASSERT_EQUAL(is_mapped(start + offset), false);
+#endif
+	return 0;
+}
+
+int main()
+{
+	return test_basics() | test_managed_array() | test_custom_allocator() | test_no_hot_path_allocations() | test_arena() | test_huge_pages();
+}
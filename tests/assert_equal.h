@@ -18,13 +18,13 @@
 #include "xTGA/types.h"
 
 #define ASSERT_EQUAL( LHS, RHS ) \
-if (LHS != RHS) \
+if ((LHS) != (RHS)) \
 { \
 	printf("\n   \033[1;31mASSERT_EQUAL failed!\033[0m\n"); \
 	printf("\033[0;35m   FILE : \033[0;33m"); printf("%s", __FILE__); printf("\033[0m\n"); \
 	printf("\033[0;35m   LINE : \033[0;33m"); printf("%u", __LINE__); printf("\033[0m\n"); \
-	printf("\033[0;35m   LHS  : \033[0;33m"); printf( #LHS ); printf("\033[0m\n"); \
-	printf("\033[0;35m   RHS  : \033[0;33m"); printf( #RHS ); printf("\033[0m\n\n"); \
+	printf("\033[0;35m   LHS  : \033[0;33m"); printf("%s", #LHS); printf("\033[0m\n"); \
+	printf("\033[0;35m   RHS  : \033[0;33m"); printf("%s", #RHS); printf("\033[0m\n\n"); \
 	return -1; \
 }
 
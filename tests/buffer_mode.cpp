@@ -0,0 +1,162 @@
+//============ Copyright  2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: buffer_mode.cpp
+/// purpose : Tests that adopted and borrowed buffers are used without being copied.
+//==============================================================================
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "assert_equal.h"
+#include "library_error.h"
+#include "xTGA/xTGA.h"
+
+#include <string.h>
+
+using namespace xtga;
+using namespace xtga::pixelformats;
+using namespace xtga::flags;
+
+const char* SaveName = "test_buffer_mode.tga";
+const uint16 Width = 120, Height = 80;
+
+BGRA8888* make_pixels()
+{
+	BGRA8888* pixels = (BGRA8888*)malloc(sizeof(BGRA8888) * Width * Height);
+
+	for (uint16 y = 0; y < Height; ++y)
+	{
+		for (uint16 x = 0; x < Width; ++x)
+		{
+			auto& p = pixels[(addressable)y * Width + x];
+			p.B = (uchar)(x * 2);
+			p.G = (uchar)(y * 3);
+			p.R = (uchar)(x ^ y);
+			p.A = 0xFF;
+		}
+	}
+
+	return pixels;
+}
+
+Parameters make_params(BUFFERMODE mode, bool rle)
+{
+	auto params = rle ? Parameters::BGRA32_RLE_STRAIGHT_ALPHA() : Parameters::BGRA32_STRAIGHT_ALPHA();
+	params.InputFormat = PIXELFORMATS::BGRA8888;
+	params.BufferMode = mode;
+	return params;
+}
+
+// the image must decode to the same pixels as a copied one, in memory and once saved.
+int compare_to_copy(TGAFile* tga, const BGRA8888* pixels)
+{
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto copy = TGAFile::Alloc(pixels, Width, Height, make_params(BUFFERMODE::COPY, false), &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	ASSERT_EQUAL(tga->SaveFile(SaveName, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+	auto loaded = TGAFile::Alloc(SaveName, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	auto a = copy->GetImageRGBA(nullptr, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	auto b = tga->GetImageRGBA(nullptr, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	auto c = loaded->GetImageRGBA(nullptr, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(memcmp(a->rawat(0), b->rawat(0), a->size() * sizeof(RGBA8888)), 0);
+	ASSERT_EQUAL(memcmp(a->rawat(0), c->rawat(0), a->size() * sizeof(RGBA8888)), 0);
+
+	ManagedArray<RGBA8888>::Free(a);
+	ManagedArray<RGBA8888>::Free(b);
+	ManagedArray<RGBA8888>::Free(c);
+	TGAFile::Free(loaded);
+	TGAFile::Free(copy);
+	return 0;
+}
+
+void invert_red(RGBA8888& color, void*)
+{
+	color.R = 255 - color.R;
+}
+
+int test_borrow()
+{
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto pixels = make_pixels();
+	auto original = make_pixels();
+
+	auto tga = TGAFile::Alloc(pixels, Width, Height, make_params(BUFFERMODE::BORROW, false), &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(tga->GetImageData(), (void*)pixels);
+	ASSERT_EQUAL(tga->GetHeader()->IMAGE_DESCRIPTOR.IMAGE_ORIGIN, IMAGEORIGIN::TOP_LEFT);
+
+	if (compare_to_copy(tga, pixels))
+		return 1;
+
+	// edits go to a copy, the caller's buffer is left alone.
+	ASSERT_EQUAL(tga->TransformColors(invert_red, nullptr, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(tga->GetImageData() != (void*)pixels, true);
+	ASSERT_EQUAL(memcmp(pixels, original, sizeof(BGRA8888) * Width * Height), 0);
+	ASSERT_EQUAL(((BGRA8888*)tga->GetImageData())[1].R, 255 - pixels[1].R);
+
+	TGAFile::Free(tga);
+
+	// anything that has to be converted is copied as usual.
+	tga = TGAFile::Alloc(pixels, Width, Height, make_params(BUFFERMODE::BORROW, true), &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(tga->GetImageData() != (void*)pixels, true);
+	ASSERT_EQUAL(tga->GetHeader()->IMAGE_DESCRIPTOR.IMAGE_ORIGIN, IMAGEORIGIN::BOTTOM_LEFT);
+
+	TGAFile::Free(tga);
+	free(original);
+	free(pixels);
+	return 0;
+}
+
+int test_adopt()
+{
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto pixels = make_pixels();
+	auto original = make_pixels();
+
+	// the file frees the buffer it adopted.
+	auto tga = TGAFile::Alloc(pixels, Width, Height, make_params(BUFFERMODE::ADOPT, false), &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(tga->GetImageData(), (void*)pixels);
+
+	if (compare_to_copy(tga, original))
+		return 1;
+
+	TGAFile::Free(tga);
+
+	// converted buffers are freed once they've been converted.
+	pixels = make_pixels();
+	tga = TGAFile::Alloc(pixels, Width, Height, make_params(BUFFERMODE::ADOPT, true), &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(tga->GetImageData() != (void*)pixels, true);
+	TGAFile::Free(tga);
+
+	// a failed Alloc leaves the buffer with the caller.
+	pixels = make_pixels();
+	auto params = make_params(BUFFERMODE::ADOPT, false);
+	params.InputFormat = (PIXELFORMATS)0x20;
+	tga = TGAFile::Alloc(pixels, Width, Height, params, &terr);
+	ASSERT_EQUAL(tga, (TGAFile*)nullptr);
+	ASSERT_EQUAL(memcmp(pixels, original, sizeof(BGRA8888) * Width * Height), 0);
+
+	free(pixels);
+	free(original);
+	return 0;
+}
+
+int main()
+{
+	int r = test_borrow() | test_adopt();
+	remove(SaveName);
+	return r;
+}
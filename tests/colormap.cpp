@@ -0,0 +1,567 @@
+//============ Copyright  2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: colormap.cpp
+/// purpose : Tests that forced color maps map every pixel to its closest entry.
+//==============================================================================
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "assert_equal.h"
+#include "library_error.h"
+#include "xTGA/xTGA.h"
+
+#include "codecs.h"
+#include "palette.h"
+
+#include <climits>
+#include <cmath>
+#include <string.h>
+#include <vector>
+
+using namespace xtga;
+using namespace xtga::pixelformats;
+using namespace xtga::flags;
+
+static int Distance(int r1, int g1, int b1, int a1, int r2, int g2, int b2, int a2, int wa)
+{
+	return 9 * (r1 - r2) * (r1 - r2) + 36 * (g1 - g2) * (g1 - g2) + (b1 - b2) * (b1 - b2) + wa * (a1 - a2) * (a1 - a2);
+}
+
+int test_24bit_forced()
+{
+	const uint16 w = 64, h = 64;
+	BGR888* ibuffer = (BGR888*)malloc(sizeof(BGR888) * w * h);
+	if (!ibuffer) { UNKNOWN_ERROR; }
+
+	for (uint16 y = 0; y < h; ++y)
+	{
+		for (uint16 x = 0; x < w; ++x)
+		{
+			ibuffer[y * w + x].R = (uchar)(x * 4);
+			ibuffer[y * w + x].G = (uchar)(y * 4);
+			ibuffer[y * w + x].B = (uchar)(x + y);
+		}
+	}
+
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto tga = TGAFile::Alloc(ibuffer, w, h, Parameters::BGR24(), &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	ASSERT_EQUAL(tga->GenerateColorMap(false, &terr), false);
+	ASSERT_ENUM_VALUE(terr, ERRORCODE::COLORMAP_TOO_LARGE);
+
+	ASSERT_EQUAL(tga->GenerateColorMap(true, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(tga->GetHeader()->IMAGE_DEPTH, 8);
+
+	auto CMap = (BGR888*)tga->GetColorMap();
+	uint16 CLength = tga->GetHeader()->COLOR_MAP_LENGTH;
+	if (CLength == 0 || CLength > 256) { UNKNOWN_ERROR; }
+
+	PIXELFORMATS pf = PIXELFORMATS::DEFAULT;
+	auto ImageData = (ManagedArray<BGR888>*)tga->GetImage(&pf, nullptr, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_ENUM_VALUE(pf, PIXELFORMATS::BGR888);
+
+	for (uint32 i = 0; i < (uint32)w * h; ++i)
+	{
+		auto& o = ibuffer[i];
+		auto& d = ImageData->at(i);
+
+		int best = INT_MAX;
+		for (uint16 j = 0; j < CLength; ++j)
+		{
+			int dist = Distance(o.R, o.G, o.B, 0, CMap[j].R, CMap[j].G, CMap[j].B, 0, 0);
+			if (dist < best) best = dist;
+		}
+
+		ASSERT_EQUAL(Distance(o.R, o.G, o.B, 0, d.R, d.G, d.B, 0, 0), best);
+	}
+
+	free(ibuffer);
+	ManagedArray<BGR888>::Free(ImageData);
+	TGAFile::Free(tga);
+
+	return 0;
+}
+
+int test_32bit_forced()
+{
+	const uint16 w = 64, h = 64;
+	BGRA8888* ibuffer = (BGRA8888*)malloc(sizeof(BGRA8888) * w * h);
+	if (!ibuffer) { UNKNOWN_ERROR; }
+
+	for (uint16 y = 0; y < h; ++y)
+	{
+		for (uint16 x = 0; x < w; ++x)
+		{
+			ibuffer[y * w + x].R = (uchar)(x * 4);
+			ibuffer[y * w + x].G = (uchar)(y * 4);
+			ibuffer[y * w + x].B = (uchar)(x + y);
+			ibuffer[y * w + x].A = (uchar)(0x40 + ((x * 3) & 0xBF));
+		}
+	}
+
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto tga = TGAFile::Alloc(ibuffer, w, h, Parameters::BGRA32_STRAIGHT_ALPHA(), &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	ASSERT_EQUAL(tga->GenerateColorMap(true, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	auto CMap = (BGRA8888*)tga->GetColorMap();
+	uint16 CLength = tga->GetHeader()->COLOR_MAP_LENGTH;
+	if (CLength == 0 || CLength > 256) { UNKNOWN_ERROR; }
+
+	PIXELFORMATS pf = PIXELFORMATS::DEFAULT;
+	auto ImageData = (ManagedArray<BGRA8888>*)tga->GetImage(&pf, nullptr, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_ENUM_VALUE(pf, PIXELFORMATS::BGRA8888);
+
+	for (uint32 i = 0; i < (uint32)w * h; ++i)
+	{
+		auto& o = ibuffer[i];
+		auto& d = ImageData->at(i);
+
+		int best = INT_MAX;
+		for (uint16 j = 0; j < CLength; ++j)
+		{
+			int dist = Distance(o.R, o.G, o.B, o.A, CMap[j].R, CMap[j].G, CMap[j].B, CMap[j].A, 100);
+			if (dist < best) best = dist;
+		}
+
+		ASSERT_EQUAL(Distance(o.R, o.G, o.B, o.A, d.R, d.G, d.B, d.A, 100), best);
+	}
+
+	free(ibuffer);
+	ManagedArray<BGRA8888>::Free(ImageData);
+	TGAFile::Free(tga);
+
+	return 0;
+}
+
+int test_colormapped_thumbnail()
+{
+	const uint16 w = 128, h = 96;
+	BGR888* ibuffer = (BGR888*)malloc(sizeof(BGR888) * w * h);
+	if (!ibuffer) { UNKNOWN_ERROR; }
+
+	for (uint16 y = 0; y < h; ++y)
+	{
+		for (uint16 x = 0; x < w; ++x)
+		{
+			ibuffer[y * w + x].R = (uchar)(x * 2);
+			ibuffer[y * w + x].G = (uchar)(y * 2);
+			ibuffer[y * w + x].B = (uchar)(x ^ y);
+		}
+	}
+
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto tga = TGAFile::Alloc(ibuffer, w, h, Parameters::BGR24(), &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	ASSERT_EQUAL(tga->GenerateColorMap(true, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	// the second thumbnail reuses the inverse color map built by the first.
+	for (uchar pass = 0; pass < 2; ++pass)
+	{
+		ASSERT_EQUAL(tga->GenerateThumbnail(32, &terr), true);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		PIXELFORMATS pf = PIXELFORMATS::DEFAULT;
+		auto Thumbnail = tga->GetThumbnail(&pf, nullptr, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+		ASSERT_ENUM_VALUE(pf, PIXELFORMATS::BGR888);
+		ASSERT_EQUAL(Thumbnail->size(), 32 * 24);
+		ManagedArray<IPixel>::Free(Thumbnail);
+	}
+
+	free(ibuffer);
+	TGAFile::Free(tga);
+
+	return 0;
+}
+
+// weighted distance from each pixel to the entry the lattice picked and to the closest entry.
+static void LatticeDistances(const std::vector<uchar>& pixels, const std::vector<uchar>& cmap, uchar depth, const codecs::InverseColorMap& inverse,
+	std::vector<int>& picked, std::vector<int>& closest)
+{
+	using namespace xtga::codecs;
+
+	const uchar stride = depth / 8;
+	const uint16 clength = (uint16)(cmap.size() / stride);
+	const addressable count = pixels.size() / stride;
+	const PaletteMatcher matcher(cmap.data(), clength, depth, PaletteWeights::RGB(), false);
+
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto indices = (uchar*)ApplyColorMap(pixels.data(), count, cmap.data(), clength, depth, &inverse, &terr);
+
+	picked.resize(count);
+	closest.resize(count);
+	for (addressable i = 0; i < count; ++i)
+	{
+		int16_t p[4], e[4], n[4];
+		PaletteMatcher::Unpack(&pixels[i * stride], depth, p);
+		PaletteMatcher::Unpack(&cmap[(addressable)indices[i] * stride], depth, e);
+		PaletteMatcher::Unpack(&cmap[(addressable)matcher.Nearest(p[0], p[1], p[2], p[3]) * stride], depth, n);
+
+		picked[i] = Distance(p[0], p[1], p[2], 0, e[0], e[1], e[2], 0, 0);
+		closest[i] = Distance(p[0], p[1], p[2], 0, n[0], n[1], n[2], 0, 0);
+	}
+
+	memory::Free(indices);
+}
+
+int test_inverse_lattice()
+{
+	using namespace xtga::codecs;
+
+	uint32 seed = 7;
+	auto Random = [&seed]() -> uchar { seed = seed * 1664525 + 1013904223; return (uchar)(seed >> 24); };
+
+	// 24-bit: random colors, and the corners of every cell of the 5-bit lattice, where a pixel is
+	// furthest from the cell center the lattice was built for.
+	std::vector<uchar> pixels;
+	for (uint32 i = 0; i < 4096 * 3; ++i)
+		pixels.push_back(Random());
+	for (uint32 r = 0; r < 64; ++r)
+		for (uint32 g = 0; g < 64; ++g)
+			for (uint32 b = 0; b < 64; ++b)
+			{
+				pixels.push_back((uchar)(b / 2 * 8 + b % 2 * 7));
+				pixels.push_back((uchar)(g / 2 * 8 + g % 2 * 7));
+				pixels.push_back((uchar)(r / 2 * 8 + r % 2 * 7));
+			}
+
+	std::vector<uchar> cmap;
+	for (uint32 i = 0; i < 200 * 3; ++i)
+		cmap.push_back(Random());
+
+	// the entry closest to the cell center is at most twice the center's distance (half a cell, 4 per
+	// axis) further from the pixel than the closest entry. Refining never does worse than that entry.
+	const double Slack = 2.0 * std::sqrt((9 + 36 + 1) * 4.0 * 4.0);
+
+	std::vector<int> plain, refined, closest;
+	LatticeDistances(pixels, cmap, 24, InverseColorMap(cmap.data(), 200, 24, PaletteWeights::RGB(), 5, false), plain, closest);
+	LatticeDistances(pixels, cmap, 24, InverseColorMap(cmap.data(), 200, 24, PaletteWeights::RGB(), 5, true), refined, closest);
+
+	addressable exact = 0;
+	for (addressable i = 0; i < closest.size(); ++i)
+	{
+		const bool bounded = std::sqrt((double)plain[i]) <= std::sqrt((double)closest[i]) + Slack;
+		const bool improved = refined[i] <= plain[i];
+		ASSERT_EQUAL(bounded, true);
+		ASSERT_EQUAL(improved, true);
+		exact += refined[i] == closest[i];
+	}
+
+	// refinement finds the closest entry for nearly all pixels.
+	const bool mostlyExact = exact * 100 >= closest.size() * 99;
+	ASSERT_EQUAL(mostlyExact, true);
+
+	// with no more entries than a cell keeps, every entry is a candidate and refining is exact.
+	cmap.resize(4 * 3);
+	LatticeDistances(pixels, cmap, 24, InverseColorMap(cmap.data(), 4, 24, PaletteWeights::RGB(), 5, true), refined, closest);
+	for (addressable i = 0; i < closest.size(); ++i)
+		ASSERT_EQUAL(refined[i], closest[i]);
+
+	// 16-bit: a cell per color, every color (both alpha values) maps exactly with or without refinement.
+	std::vector<uchar> pixels16;
+	for (uint32 v = 0; v < 65536; ++v)
+	{
+		pixels16.push_back((uchar)v);
+		pixels16.push_back((uchar)(v >> 8));
+	}
+
+	std::vector<uchar> cmap16;
+	for (uint32 i = 0; i < 200 * 2; ++i)
+		cmap16.push_back(Random());
+
+	for (uchar refine = 0; refine < 2; ++refine)
+	{
+		LatticeDistances(pixels16, cmap16, 16, InverseColorMap(cmap16.data(), 200, 16, PaletteWeights::RGB(), 5, refine != 0), plain, closest);
+		for (addressable i = 0; i < closest.size(); ++i)
+			ASSERT_EQUAL(plain[i], closest[i]);
+	}
+
+	return 0;
+}
+
+int test_colormapped_decode()
+{
+	// 225 colors, so the color map is exact.
+	const uint16 w = 40, h = 30;
+	BGR888* ibuffer = (BGR888*)malloc(sizeof(BGR888) * w * h);
+	if (!ibuffer) { UNKNOWN_ERROR; }
+
+	for (uint16 y = 0; y < h; ++y)
+	{
+		for (uint16 x = 0; x < w; ++x)
+		{
+			ibuffer[y * w + x].R = (uchar)((x % 15) * 17);
+			ibuffer[y * w + x].G = (uchar)((y % 15) * 17);
+			ibuffer[y * w + x].B = (uchar)(((x % 15) ^ (y % 15)) * 16);
+		}
+	}
+
+	const IMAGEORIGIN Origins[] = { IMAGEORIGIN::BOTTOM_LEFT, IMAGEORIGIN::BOTTOM_RIGHT, IMAGEORIGIN::TOP_LEFT, IMAGEORIGIN::TOP_RIGHT };
+
+	for (uchar rle = 0; rle < 2; ++rle)
+	{
+		auto params = Parameters::BGR24();
+		params.InputFormat = PIXELFORMATS::BGR888;
+		params.RunLengthEncode = false;
+
+		ERRORCODE terr = ERRORCODE::NONE;
+		auto tga = TGAFile::Alloc(ibuffer, w, h, params, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+		ASSERT_EQUAL(tga->GenerateColorMap(false, &terr), true);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		// the stored indices, before they are run-length encoded.
+		uchar* Stored = (uchar*)malloc((addressable)w * h);
+		if (!Stored) { UNKNOWN_ERROR; }
+		memcpy(Stored, tga->GetImageData(), (addressable)w * h);
+		auto ColorMap = (const BGR888*)tga->GetColorMap();
+
+		if (rle)
+		{
+			ASSERT_EQUAL(tga->CompressWithRLE(&terr), true);
+			ASSERT_ERRORCODE_NONE(terr);
+		}
+
+		// the RGBA and native decodes must both undo every origin on their own.
+		for (auto Origin : Origins)
+		{
+			tga->GetHeader()->IMAGE_DESCRIPTOR.IMAGE_ORIGIN = Origin;
+
+			auto rgba = tga->GetImageRGBA(nullptr, &terr);
+			ASSERT_ERRORCODE_NONE(terr);
+			auto native = tga->GetImage(nullptr, nullptr, &terr);
+			ASSERT_ERRORCODE_NONE(terr);
+
+			ManagedArray<IPixel>* Palette = nullptr;
+			PIXELFORMATS PaletteType = PIXELFORMATS::DEFAULT;
+			auto indexed = tga->GetIndexedImage(&Palette, &PaletteType, nullptr, &terr);
+			ASSERT_ERRORCODE_NONE(terr);
+			if (!indexed || !Palette) { UNKNOWN_ERROR; }
+			ASSERT_ENUM_VALUE(PaletteType, PIXELFORMATS::BGR888);
+			ASSERT_EQUAL(indexed->size(), (addressable)w * h);
+			ASSERT_EQUAL(Palette->size(), tga->GetHeader()->COLOR_MAP_LENGTH);
+			ASSERT_EQUAL(memcmp(Palette->rawat(0), ColorMap, Palette->size() * sizeof(BGR888)), 0);
+
+			for (uint16 y = 0; y < h; ++y)
+			{
+				for (uint16 x = 0; x < w; ++x)
+				{
+					uint16 sy = (Origin == IMAGEORIGIN::BOTTOM_LEFT || Origin == IMAGEORIGIN::BOTTOM_RIGHT) ? h - 1 - y : y;
+					uint16 sx = (Origin == IMAGEORIGIN::BOTTOM_RIGHT || Origin == IMAGEORIGIN::TOP_RIGHT) ? w - 1 - x : x;
+					const BGR888& e = ColorMap[Stored[sy * w + sx]];
+
+					auto& p = rgba->at(y * w + x);
+					ASSERT_EQUAL(p.R, e.R);
+					ASSERT_EQUAL(p.G, e.G);
+					ASSERT_EQUAL(p.B, e.B);
+					ASSERT_EQUAL(p.A, 0xFF);
+
+					auto& n = ((BGR888*)native->rawat(0))[y * w + x];
+					ASSERT_EQUAL(n == e, true);
+
+					ASSERT_EQUAL(indexed->at(y * w + x), Stored[sy * w + sx]);
+				}
+			}
+
+			ManagedArray<RGBA8888>::Free(rgba);
+			ManagedArray<IPixel>::Free(native);
+			ManagedArray<uchar>::Free(indexed);
+			ManagedArray<IPixel>::Free(Palette);
+		}
+
+		free(Stored);
+		TGAFile::Free(tga);
+	}
+
+	// true color images have no indices to return.
+	{
+		auto params = Parameters::BGR24();
+		params.InputFormat = PIXELFORMATS::BGR888;
+
+		ERRORCODE terr = ERRORCODE::NONE;
+		auto tga = TGAFile::Alloc(ibuffer, w, h, params, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+		ASSERT_EQUAL(tga->GetIndexedImage(nullptr, nullptr, nullptr, &terr), nullptr);
+		ASSERT_ENUM_VALUE(terr, ERRORCODE::INVALID_OPERATION);
+		TGAFile::Free(tga);
+	}
+
+	free(ibuffer);
+	return 0;
+}
+
+static void SwapRB(RGBA8888& c, void* userdata)
+{
+	uchar t = c.R;
+	c.R = c.B;
+	c.B = t;
+	++*(addressable*)userdata;
+}
+
+int test_transform_colors()
+{
+	const uint16 w = 40, h = 30;
+	BGR888* ibuffer = (BGR888*)malloc(sizeof(BGR888) * w * h);
+	if (!ibuffer) { UNKNOWN_ERROR; }
+
+	for (uint16 y = 0; y < h; ++y)
+	{
+		for (uint16 x = 0; x < w; ++x)
+		{
+			ibuffer[y * w + x].R = (uchar)((x % 15) * 17);
+			ibuffer[y * w + x].G = (uchar)((y % 15) * 17);
+			ibuffer[y * w + x].B = (uchar)(((x % 15) ^ (y % 15)) * 16);
+		}
+	}
+
+	uchar Invert[256];
+	for (uint16 i = 0; i < 256; ++i)
+		Invert[i] = (uchar)(255 - i);
+
+	for (uchar mapped = 0; mapped < 2; ++mapped)
+	{
+		auto params = Parameters::BGR24_RLE();
+		params.InputFormat = PIXELFORMATS::BGR888;
+		params.RunLengthEncode = !mapped;
+
+		ERRORCODE terr = ERRORCODE::NONE;
+		auto tga = TGAFile::Alloc(ibuffer, w, h, params, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+		if (mapped)
+		{
+			ASSERT_EQUAL(tga->GenerateColorMap(false, &terr), true);
+			ASSERT_ERRORCODE_NONE(terr);
+			ASSERT_EQUAL(tga->CompressWithRLE(&terr), true);
+			ASSERT_ERRORCODE_NONE(terr);
+		}
+
+		auto Size = tga->GetImageDataSize(&terr);
+		ASSERT_ERRORCODE_NONE(terr);
+		uchar* Data = (uchar*)malloc(Size);
+		if (!Data) { UNKNOWN_ERROR; }
+		memcpy(Data, tga->GetImageData(), Size);
+
+		auto before = tga->GetImageRGBA(nullptr, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		// a color mapped image only has its entries transformed.
+		addressable Calls = 0;
+		ASSERT_EQUAL(tga->TransformColors(SwapRB, &Calls, &terr), true);
+		ASSERT_ERRORCODE_NONE(terr);
+		if (mapped)
+			ASSERT_EQUAL(Calls, tga->GetHeader()->COLOR_MAP_LENGTH);
+
+		ASSERT_EQUAL(tga->TransformChannels(Invert, nullptr, nullptr, nullptr, &terr), true);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		// the packets are walked in place, so their size never changes.
+		ASSERT_EQUAL(tga->GetImageDataSize(&terr), Size);
+		if (mapped)
+			ASSERT_EQUAL(memcmp(tga->GetImageData(), Data, Size), 0);
+
+		auto after = tga->GetImageRGBA(nullptr, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		for (addressable i = 0; i < (addressable)w * h; ++i)
+		{
+			ASSERT_EQUAL(after->at(i).R, 255 - before->at(i).B);
+			ASSERT_EQUAL(after->at(i).G, before->at(i).G);
+			ASSERT_EQUAL(after->at(i).B, before->at(i).R);
+		}
+
+		ManagedArray<RGBA8888>::Free(before);
+		ManagedArray<RGBA8888>::Free(after);
+		free(Data);
+		TGAFile::Free(tga);
+	}
+
+	// thumbnails are stored raw even for run-length encoded images, so both transform the same.
+	{
+		ManagedArray<RGBA8888>* Thumbnails[2] = { nullptr, nullptr };
+		for (uchar rle = 0; rle < 2; ++rle)
+		{
+			auto params = Parameters::BGR24();
+			params.InputFormat = PIXELFORMATS::BGR888;
+			params.RunLengthEncode = rle != 0;
+
+			ERRORCODE terr = ERRORCODE::NONE;
+			auto tga = TGAFile::Alloc(ibuffer, w, h, params, &terr);
+			ASSERT_ERRORCODE_NONE(terr);
+			ASSERT_EQUAL(tga->GenerateThumbnail(16, &terr), true);
+			ASSERT_ERRORCODE_NONE(terr);
+
+			addressable Calls = 0;
+			ASSERT_EQUAL(tga->TransformColors(SwapRB, &Calls, &terr), true);
+			ASSERT_ERRORCODE_NONE(terr);
+
+			Thumbnails[rle] = tga->GetThumbnailRGBA(nullptr, &terr);
+			ASSERT_ERRORCODE_NONE(terr);
+			TGAFile::Free(tga);
+		}
+
+		ASSERT_EQUAL(Thumbnails[0]->size(), Thumbnails[1]->size());
+		ASSERT_EQUAL(memcmp(Thumbnails[0]->data(), Thumbnails[1]->data(), Thumbnails[0]->size() * sizeof(RGBA8888)), 0);
+
+		ManagedArray<RGBA8888>::Free(Thumbnails[0]);
+		ManagedArray<RGBA8888>::Free(Thumbnails[1]);
+	}
+
+	// the color correction table is baked in and reset.
+	{
+		auto params = Parameters::BGR24_COLORMAPPED();
+		params.InputFormat = PIXELFORMATS::BGR888;
+
+		ERRORCODE terr = ERRORCODE::NONE;
+		auto tga = TGAFile::Alloc(ibuffer, w, h, params, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+		ASSERT_EQUAL(tga->ApplyColorCorrectionTable(&terr), false);
+		ASSERT_ENUM_VALUE(terr, ERRORCODE::INVALID_OPERATION);
+
+		auto before = tga->GetImageRGBA(nullptr, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		tga->GenerateColorCorrectionTable();
+		auto Table = tga->GetColorCorrectionTable();
+		if (!Table) { UNKNOWN_ERROR; }
+		for (uint16 i = 0; i < 256; ++i)
+			Table[i].G = (uint16)(Invert[i] * 256);
+
+		ASSERT_EQUAL(tga->ApplyColorCorrectionTable(&terr), true);
+		ASSERT_ERRORCODE_NONE(terr);
+		ASSERT_EQUAL(Table[7].G, 7 * 256);
+
+		auto after = tga->GetImageRGBA(nullptr, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		for (addressable i = 0; i < (addressable)w * h; ++i)
+		{
+			ASSERT_EQUAL(after->at(i).R, before->at(i).R);
+			ASSERT_EQUAL(after->at(i).G, 255 - before->at(i).G);
+			ASSERT_EQUAL(after->at(i).B, before->at(i).B);
+		}
+
+		ManagedArray<RGBA8888>::Free(before);
+		ManagedArray<RGBA8888>::Free(after);
+		TGAFile::Free(tga);
+	}
+
+	free(ibuffer);
+	return 0;
+}
+
+int main()
+{
+	return test_24bit_forced() | test_32bit_forced() | test_colormapped_thumbnail() | test_inverse_lattice() | test_colormapped_decode() | test_transform_colors();
+}
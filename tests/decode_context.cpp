@@ -0,0 +1,201 @@
+//============ Copyright  2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: decode_context.cpp
+/// purpose : Tests decoding into caller buffers with a DecodeContext kept between calls.
+//==============================================================================
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "assert_equal.h"
+#include "library_error.h"
+#include "xTGA/xTGA.h"
+
+#include <string.h>
+#include <vector>
+
+using namespace xtga;
+using namespace xtga::memory;
+using namespace xtga::pixelformats;
+using namespace xtga::flags;
+
+const uint16 W = 160, H = 96;
+
+// at most 256 colors, so that color mapped files are lossless.
+std::vector<BGRA8888> make_image()
+{
+	std::vector<BGRA8888> image((addressable)W * H);
+
+	for (uint16 y = 0; y < H; ++y)
+	{
+		for (uint16 x = 0; x < W; ++x)
+		{
+			auto& p = image[(addressable)y * W + x];
+			p.B = (uchar)(x / 20 * 32);
+			p.G = (uchar)(y / 12 * 32);
+			p.R = (uchar)((x ^ y) & 0xC0);
+			p.A = (uchar)(x + y);
+		}
+	}
+
+	return image;
+}
+
+bool same_pixel(const RGBA8888& a, const RGBA8888& b)
+{
+	return a.R == b.R && a.G == b.G && a.B == b.B && a.A == b.A;
+}
+
+// decodes 'params' both ways and compares them, and against the source when the format is lossless.
+int test_format(const std::vector<BGRA8888>& image, Parameters params, bool map, bool lossless, bool alpha, DecodeContext* context)
+{
+	ERRORCODE terr = ERRORCODE::NONE;
+	params.InputFormat = PIXELFORMATS::BGRA8888;
+
+	for (auto origin : { IMAGEORIGIN::BOTTOM_LEFT, IMAGEORIGIN::TOP_LEFT })
+	{
+		params.Origin = origin;
+		auto tga = TGAFile::Alloc(image.data(), W, H, params, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		if (map)
+		{
+			ASSERT_EQUAL(tga->GenerateColorMap(false, &terr), true);
+			ASSERT_ERRORCODE_NONE(terr);
+			ASSERT_EQUAL(tga->GetHeader()->COLOR_MAP_TYPE, 1);
+		}
+
+		auto rgba = tga->GetImageRGBA(nullptr, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		std::vector<RGBA8888> out((addressable)W * H);
+		ASSERT_EQUAL(tga->DecodeImageRGBA(out.data(), context, nullptr, &terr), true);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		for (addressable i = 0; i < out.size(); ++i)
+		{
+			ASSERT_EQUAL(same_pixel(out[i], (*rgba)[i]), true);
+
+			if (lossless)
+			{
+				ASSERT_EQUAL(out[i].R, image[i].R);
+				ASSERT_EQUAL(out[i].G, image[i].G);
+				ASSERT_EQUAL(out[i].B, image[i].B);
+				ASSERT_EQUAL(out[i].A, (alpha ? image[i].A : 0xFF));
+			}
+		}
+
+		ManagedArray<RGBA8888>::Free(rgba);
+		TGAFile::Free(tga);
+	}
+
+	return 0;
+}
+
+int test_formats()
+{
+	auto image = make_image();
+	auto context = DecodeContext::Alloc();
+
+	int rval = test_format(image, Parameters::BGR24(), false, true, false, context)
+		| test_format(image, Parameters::BGR24_RLE(), false, true, false, context)
+		| test_format(image, Parameters::BGR24_RLE(), true, true, false, context)
+		| test_format(image, Parameters::BGRA32_STRAIGHT_ALPHA(), false, true, true, context)
+		| test_format(image, Parameters::BGRA32_RLE_STRAIGHT_ALPHA(), false, true, true, context)
+		| test_format(image, Parameters::BGR16(), false, false, false, context)
+		| test_format(image, Parameters::I8_RLE(), false, false, false, nullptr)
+		| test_format(image, Parameters::IA16_STRAIGHT_ALPHA(), false, false, true, nullptr);
+
+	DecodeContext::Free(context);
+	ASSERT_EQUAL(context, (DecodeContext*)nullptr);
+	return rval;
+}
+
+int test_right_origin()
+{
+	auto image = make_image();
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto params = Parameters::BGR24_RLE();
+	params.InputFormat = PIXELFORMATS::BGRA8888;
+
+	// relabelling the origin as a right one mirrors every row.
+	for (auto origin : { IMAGEORIGIN::BOTTOM_LEFT, IMAGEORIGIN::TOP_LEFT })
+	{
+		params.Origin = origin;
+		auto tga = TGAFile::Alloc(image.data(), W, H, params, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		tga->GetHeader()->IMAGE_DESCRIPTOR.IMAGE_ORIGIN = origin == IMAGEORIGIN::TOP_LEFT ? IMAGEORIGIN::TOP_RIGHT : IMAGEORIGIN::BOTTOM_RIGHT;
+
+		std::vector<RGBA8888> out((addressable)W * H);
+		ASSERT_EQUAL(tga->DecodeImageRGBA(out.data(), nullptr, nullptr, &terr), true);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		for (uint16 y = 0; y < H; ++y)
+		{
+			for (uint16 x = 0; x < W; ++x)
+			{
+				auto& o = out[(addressable)y * W + x];
+				auto& i = image[(addressable)y * W + (W - 1 - x)];
+				ASSERT_EQUAL(o.R, i.R);
+				ASSERT_EQUAL(o.G, i.G);
+				ASSERT_EQUAL(o.B, i.B);
+			}
+		}
+
+		TGAFile::Free(tga);
+	}
+
+	return 0;
+}
+
+int test_warm_context()
+{
+	auto image = make_image();
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto params = Parameters::BGR24_RLE();
+	params.InputFormat = PIXELFORMATS::BGRA8888;
+
+	auto tga = TGAFile::Alloc(image.data(), W, H, params, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(tga->GenerateColorMap(false, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	auto context = DecodeContext::Alloc();
+	ASSERT_EQUAL(context->GetReserved(), 0);
+
+	std::vector<RGBA8888> out((addressable)W * H);
+	ASSERT_EQUAL(tga->DecodeImageRGBA(out.data(), context, nullptr, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	const addressable reserved = context->GetReserved();
+	ASSERT_EQUAL(reserved >= (addressable)W * H, true);
+
+	// once warm, decoding works in the buffers the context already holds.
+	auto before = GetStats();
+	for (int i = 0; i < 4; ++i)
+	{
+		ASSERT_EQUAL(tga->DecodeImageRGBA(out.data(), context, nullptr, &terr), true);
+		ASSERT_ERRORCODE_NONE(terr);
+	}
+	ASSERT_EQUAL(GetStats().Allocations, before.Allocations);
+	ASSERT_EQUAL(context->GetReserved(), reserved);
+
+	context->Trim();
+	ASSERT_EQUAL(context->GetReserved(), 0);
+
+	// no output buffer.
+	ASSERT_EQUAL(tga->DecodeImageRGBA(nullptr, context, nullptr, &terr), false);
+	ASSERT_EQUAL(terr, ERRORCODE::INVALID_OPERATION);
+
+	DecodeContext::Free(context);
+	TGAFile::Free(tga);
+	return 0;
+}
+
+int main()
+{
+	return test_formats() | test_right_origin() | test_warm_context();
+}
@@ -0,0 +1,295 @@
+//============ Copyright  2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: mip_chain.cpp
+/// purpose : Tests that mip chains have the right levels and that each is averaged from the last.
+//==============================================================================
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "assert_equal.h"
+#include "library_error.h"
+#include "xTGA/xTGA.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+using namespace xtga;
+using namespace xtga::pixelformats;
+using namespace xtga::flags;
+
+BGRA8888* RandomImage(uint16 w, uint16 h, unsigned seed)
+{
+	BGRA8888* buffer = (BGRA8888*)malloc(sizeof(BGRA8888) * w * h);
+	srand(seed);
+	for (addressable i = 0; i < (addressable)w * h; ++i)
+	{
+		buffer[i].B = (uchar)(rand() % 256);
+		buffer[i].G = (uchar)(rand() % 256);
+		buffer[i].R = (uchar)(rand() % 256);
+		buffer[i].A = (uchar)(rand() % 256);
+	}
+	return buffer;
+}
+
+TGAFile* AllocBGRA(const BGRA8888* buffer, uint16 w, uint16 h, Parameters params, ERRORCODE* error)
+{
+	params.InputFormat = PIXELFORMATS::BGRA8888;
+	return TGAFile::Alloc(buffer, w, h, params, error);
+}
+
+int test_levels()
+{
+	const uint16 w = 300, h = 20;
+	BGRA8888* ibuffer = RandomImage(w, h, 1);
+
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto tga = AllocBGRA(ibuffer, w, h, Parameters::BGRA32_STRAIGHT_ALPHA(), &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	auto chain = tga->GenerateMipChain(MIPFILTER::BOX, PIXELFORMATS::BGR888, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(chain->GetFormat(), PIXELFORMATS::BGR888);
+
+	const uint16 Widths[] = { 300, 150, 75, 37, 18, 9, 4, 2, 1 };
+	const uint16 Heights[] = { 20, 10, 5, 2, 1, 1, 1, 1, 1 };
+	ASSERT_EQUAL(chain->GetLevelCount(), 9);
+
+	addressable end = 0;
+	for (uint16 l = 0; l < 9; ++l)
+	{
+		auto level = chain->GetLevel(l, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+		ASSERT_EQUAL(level->Width, Widths[l]);
+		ASSERT_EQUAL(level->Height, Heights[l]);
+		ASSERT_EQUAL(level->Size, (addressable)Widths[l] * Heights[l] * 3);
+		ASSERT_EQUAL(level->Offset % 16, 0);
+		ASSERT_EQUAL(level->Offset >= end, true);
+		ASSERT_EQUAL(chain->GetLevelData(l), (const uchar*)chain->GetData() + level->Offset);
+		end = level->Offset + level->Size;
+	}
+	ASSERT_EQUAL(chain->GetSize(), end);
+
+	ASSERT_EQUAL(chain->GetLevel(9, &terr), nullptr);
+	ASSERT_EQUAL(terr, ERRORCODE::INDEX_OUT_OF_RANGE);
+
+	// level 0 is the image itself.
+	auto level0 = (const BGR888*)chain->GetLevelData(0);
+	for (addressable i = 0; i < (addressable)w * h; ++i)
+	{
+		ASSERT_EQUAL(level0[i].B, ibuffer[i].B);
+		ASSERT_EQUAL(level0[i].G, ibuffer[i].G);
+		ASSERT_EQUAL(level0[i].R, ibuffer[i].R);
+	}
+
+	ASSERT_EQUAL(tga->GenerateMipChain(MIPFILTER::BOX, PIXELFORMATS::BGRA5551, &terr), nullptr);
+	ASSERT_EQUAL(terr, ERRORCODE::INVALID_DEPTH);
+
+	MipChain::Free(chain);
+	TGAFile::Free(tga);
+	free(ibuffer);
+	return 0;
+}
+
+int test_box()
+{
+	const uint16 w = 123, h = 77;
+	BGRA8888* ibuffer = RandomImage(w, h, 2);
+
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto tga = AllocBGRA(ibuffer, w, h, Parameters::BGRA32_STRAIGHT_ALPHA(), &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	const PIXELFORMATS Formats[] = { PIXELFORMATS::RGBA8888, PIXELFORMATS::BGRA8888, PIXELFORMATS::RGB888, PIXELFORMATS::BGR888, PIXELFORMATS::IA88, PIXELFORMATS::I8 };
+	const uchar Channels[] = { 4, 4, 3, 3, 2, 1 };
+
+	for (uchar f = 0; f < 6; ++f)
+	{
+		auto chain = tga->GenerateMipChain(MIPFILTER::BOX, Formats[f], &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		const uchar C = Channels[f];
+		for (uint16 l = 1; l < chain->GetLevelCount(); ++l)
+		{
+			auto src = chain->GetLevel(l - 1);
+			auto dst = chain->GetLevel(l);
+			auto s = (const uchar*)chain->GetLevelData(l - 1);
+			auto d = (const uchar*)chain->GetLevelData(l);
+
+			// every pixel is the rounded mean of its 2x2 block, edges clamp.
+			for (uint16 y = 0; y < dst->Height; ++y)
+			{
+				for (uint16 x = 0; x < dst->Width; ++x)
+				{
+					const addressable x0 = (addressable)x * 2, x1 = src->Width > 1 ? x0 + 1 : x0;
+					const addressable y0 = (addressable)y * 2, y1 = src->Height > 1 ? y0 + 1 : y0;
+					for (uchar c = 0; c < C; ++c)
+					{
+						const uint32 sum = s[(y0 * src->Width + x0) * C + c] + s[(y0 * src->Width + x1) * C + c] +
+							s[(y1 * src->Width + x0) * C + c] + s[(y1 * src->Width + x1) * C + c];
+						ASSERT_EQUAL(d[((addressable)y * dst->Width + x) * C + c], (uchar)((sum + 2) / 4));
+					}
+				}
+			}
+		}
+
+		MipChain::Free(chain);
+	}
+
+	TGAFile::Free(tga);
+	free(ibuffer);
+	return 0;
+}
+
+int test_gamma()
+{
+	const uint16 w = 64, h = 64;
+	BGRA8888* ibuffer = (BGRA8888*)malloc(sizeof(BGRA8888) * w * h);
+	if (!ibuffer) { UNKNOWN_ERROR; }
+
+	// a flat color survives the trip to linear light and back.
+	for (uint32 v = 0; v < 256; ++v)
+	{
+		for (addressable i = 0; i < (addressable)w * h; ++i)
+		{
+			ibuffer[i].B = (uchar)v;
+			ibuffer[i].G = (uchar)(255 - v);
+			ibuffer[i].R = (uchar)(v / 2);
+			ibuffer[i].A = 0xFF;
+		}
+
+		ERRORCODE terr = ERRORCODE::NONE;
+		auto tga = AllocBGRA(ibuffer, w, h, Parameters::BGRA32_STRAIGHT_ALPHA(), &terr);
+		auto chain = tga->GenerateMipChain(MIPFILTER::GAMMA, PIXELFORMATS::BGRA8888, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		auto last = (const BGRA8888*)chain->GetLevelData(chain->GetLevelCount() - 1);
+		ASSERT_EQUAL(last->B, v);
+		ASSERT_EQUAL(last->G, 255 - v);
+		ASSERT_EQUAL(last->R, v / 2);
+
+		MipChain::Free(chain);
+		TGAFile::Free(tga);
+	}
+
+	// black and white stripes average to half the light, not half the sRGB value.
+	for (addressable i = 0; i < (addressable)w * h; ++i)
+	{
+		const uchar v = (i % 2) ? 0xFF : 0x00;
+		ibuffer[i].B = ibuffer[i].G = ibuffer[i].R = v;
+		ibuffer[i].A = 0xFF;
+	}
+
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto tga = AllocBGRA(ibuffer, w, h, Parameters::BGRA32_STRAIGHT_ALPHA(), &terr);
+
+	auto chain = tga->GenerateMipChain(MIPFILTER::BOX, PIXELFORMATS::BGRA8888, &terr);
+	ASSERT_EQUAL(((const BGRA8888*)chain->GetLevelData(1))->G, 128);
+	MipChain::Free(chain);
+
+	chain = tga->GenerateMipChain(MIPFILTER::GAMMA, PIXELFORMATS::BGRA8888, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	for (uint16 l = 1; l < chain->GetLevelCount(); ++l)
+	{
+		auto p = (const BGRA8888*)chain->GetLevelData(l);
+		ASSERT_EQUAL(p->G, 188);
+		ASSERT_EQUAL(p->A, 0xFF);
+	}
+	MipChain::Free(chain);
+
+	TGAFile::Free(tga);
+	free(ibuffer);
+	return 0;
+}
+
+int test_premultiplied()
+{
+	const uint16 w = 2, h = 2;
+	BGRA8888 ibuffer[4];
+
+	// opaque red next to fully transparent green.
+	for (uchar i = 0; i < 4; ++i)
+	{
+		ibuffer[i].B = 0;
+		ibuffer[i].G = (i % 2) ? 0xFF : 0x00;
+		ibuffer[i].R = (i % 2) ? 0x00 : 0xFF;
+		ibuffer[i].A = (i % 2) ? 0x00 : 0xFF;
+	}
+
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto tga = AllocBGRA(ibuffer, w, h, Parameters::BGRA32_STRAIGHT_ALPHA(), &terr);
+
+	auto chain = tga->GenerateMipChain(MIPFILTER::PREMULTIPLIED, PIXELFORMATS::RGBA8888, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	auto p = (const RGBA8888*)chain->GetLevelData(1);
+	ASSERT_EQUAL(p->R, 0xFF);
+	ASSERT_EQUAL(p->G, 0x00);
+	ASSERT_EQUAL(p->A, 0x80);
+	MipChain::Free(chain);
+
+	chain = tga->GenerateMipChain(MIPFILTER::BOX, PIXELFORMATS::RGBA8888, &terr);
+	p = (const RGBA8888*)chain->GetLevelData(1);
+	ASSERT_EQUAL(p->R, 0x80);
+	ASSERT_EQUAL(p->G, 0x80);
+	MipChain::Free(chain);
+	TGAFile::Free(tga);
+
+	// colors that are already premultiplied are averaged as they are.
+	tga = AllocBGRA(ibuffer, w, h, Parameters::BGRA32_PREMULTIPLIED_ALPHA(), &terr);
+	chain = tga->GenerateMipChain(MIPFILTER::PREMULTIPLIED, PIXELFORMATS::RGBA8888, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	p = (const RGBA8888*)chain->GetLevelData(1);
+	ASSERT_EQUAL(p->R, 0x80);
+	ASSERT_EQUAL(p->G, 0x80);
+	MipChain::Free(chain);
+	TGAFile::Free(tga);
+
+	return 0;
+}
+
+int test_threaded()
+{
+	const uint16 w = 1000, h = 700;
+	BGRA8888* ibuffer = RandomImage(w, h, 3);
+
+	const MIPFILTER Filters[] = { MIPFILTER::BOX, MIPFILTER::GAMMA_PREMULTIPLIED };
+
+	for (auto filter : Filters)
+	{
+		ERRORCODE terr = ERRORCODE::NONE;
+		auto tga = AllocBGRA(ibuffer, w, h, Parameters::BGRA32_STRAIGHT_ALPHA(), &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		threading::SetThreadCount(1);
+		auto serial = tga->GenerateMipChain(filter, PIXELFORMATS::RGBA8888, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		threading::SetThreadCount(4);
+		threading::SetParallelThreshold(threading::WORKLOAD::RESAMPLE, 1);
+		auto threaded = tga->GenerateMipChain(filter, PIXELFORMATS::RGBA8888, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+		threading::SetParallelThreshold(threading::WORKLOAD::RESAMPLE, 0);
+		threading::SetThreadCount(0);
+
+		ASSERT_EQUAL(serial->GetSize(), threaded->GetSize());
+		for (uint16 l = 0; l < serial->GetLevelCount(); ++l)
+		{
+			auto level = serial->GetLevel(l);
+			ASSERT_EQUAL(memcmp(serial->GetLevelData(l), threaded->GetLevelData(l), level->Size), 0);
+		}
+
+		MipChain::Free(serial);
+		MipChain::Free(threaded);
+		TGAFile::Free(tga);
+	}
+
+	free(ibuffer);
+	return 0;
+}
+
+int main()
+{
+	return test_levels() | test_box() | test_gamma() | test_premultiplied() | test_threaded();
+}
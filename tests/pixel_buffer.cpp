@@ -0,0 +1,146 @@
+//============ Copyright  2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: pixel_buffer.cpp
+/// purpose : Tests the PixelBuffer container and handing buffers over without copies.
+//==============================================================================
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "assert_equal.h"
+#include "library_error.h"
+#include "xTGA/xTGA.h"
+
+#include <numeric>
+#include <utility>
+#include <vector>
+
+using namespace xtga;
+using namespace xtga::memory;
+using namespace xtga::pixelformats;
+using namespace xtga::flags;
+
+const uint16 W = 96, H = 64;
+
+std::vector<BGR888> make_image()
+{
+	std::vector<BGR888> image((addressable)W * H);
+
+	for (uint16 y = 0; y < H; ++y)
+	{
+		for (uint16 x = 0; x < W; ++x)
+		{
+			auto& p = image[(addressable)y * W + x];
+			p.B = (uchar)(x * 2);
+			p.G = (uchar)(y * 3);
+			p.R = (uchar)(x ^ y);
+		}
+	}
+
+	return image;
+}
+
+int test_container()
+{
+	auto before = GetStats();
+	{
+		PixelBuffer<uint32> empty;
+		ASSERT_EQUAL(empty.empty(), true);
+		ASSERT_EQUAL(empty.begin() == empty.end(), true);
+
+		PixelBuffer<uint32> buff(1000);
+		ASSERT_EQUAL(buff.size(), 1000);
+		ASSERT_EQUAL(buff.bytes(), 4000);
+		ASSERT_EQUAL((addressable)buff.data() % DefaultAlignment, 0);
+		ASSERT_EQUAL(buff.end() - buff.begin(), 1000);
+
+		std::iota(buff.begin(), buff.end(), 0);
+		ASSERT_EQUAL(buff[999], 999);
+
+		ERRORCODE terr = ERRORCODE::NONE;
+		ASSERT_EQUAL(buff.at(10, &terr), 10);
+		ASSERT_ERRORCODE_NONE(terr);
+		ASSERT_EQUAL(buff.at(1000, &terr), 0);
+		ASSERT_EQUAL(terr, ERRORCODE::INDEX_OUT_OF_RANGE);
+
+		// moving hands the buffer over.
+		auto data = buff.data();
+		PixelBuffer<uint32> moved(std::move(buff));
+		ASSERT_EQUAL(moved.data(), data);
+		ASSERT_EQUAL(buff.empty(), true);
+
+		// resizing to the same size keeps the buffer.
+		auto allocations = GetStats().Allocations;
+		ASSERT_EQUAL(moved.resize(1000), true);
+		ASSERT_EQUAL(moved.data(), data);
+		ASSERT_EQUAL(GetStats().Allocations, allocations);
+
+		// release() leaves the buffer to the caller.
+		auto raw = moved.release();
+		ASSERT_EQUAL(raw, data);
+		ASSERT_EQUAL(moved.empty(), true);
+		Free(raw);
+	}
+
+	auto after = GetStats();
+	ASSERT_EQUAL(after.BytesInUse, before.BytesInUse);
+	return 0;
+}
+
+int test_adopt()
+{
+	auto image = make_image();
+	ERRORCODE terr = ERRORCODE::NONE;
+
+	auto tga = TGAFile::Alloc(image.data(), W, H, Parameters::BGR24_RLE(), &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	// GetImage() hands back an IPixel array, adopting it gives typed access without a copy.
+	PIXELFORMATS format;
+	auto arr = tga->GetImage(&format, nullptr, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(format, PIXELFORMATS::BGR888);
+
+	auto data = arr->data();
+	auto allocations = GetStats().Allocations;
+	auto pixels = PixelBuffer<BGR888>::Adopt(arr);
+	ASSERT_EQUAL(arr, (ManagedArray<IPixel>*)nullptr);
+	ASSERT_EQUAL((void*)pixels.data(), (void*)data);
+	ASSERT_EQUAL(pixels.size(), (addressable)W * H);
+	ASSERT_EQUAL(GetStats().Allocations, allocations);
+
+	for (addressable i = 0; i < pixels.size(); ++i)
+	{
+		ASSERT_EQUAL(pixels[i].B, image[i].B);
+		ASSERT_EQUAL(pixels[i].G, image[i].G);
+		ASSERT_EQUAL(pixels[i].R, image[i].R);
+	}
+
+	// decoding into a buffer of the right size reuses it.
+	auto context = DecodeContext::Alloc();
+	PixelBuffer<RGBA8888> rgba;
+	ASSERT_EQUAL(tga->DecodeImageRGBA(rgba, context, nullptr, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(rgba.size(), (addressable)W * H);
+
+	allocations = GetStats().Allocations;
+	ASSERT_EQUAL(tga->DecodeImageRGBA(rgba, context, nullptr, &terr), true);
+	ASSERT_EQUAL(GetStats().Allocations, allocations);
+
+	for (addressable i = 0; i < rgba.size(); ++i)
+	{
+		ASSERT_EQUAL(rgba[i].R, image[i].R);
+		ASSERT_EQUAL(rgba[i].A, 0xFF);
+	}
+
+	DecodeContext::Free(context);
+	TGAFile::Free(tga);
+	return 0;
+}
+
+int main()
+{
+	return test_container() | test_adopt();
+}
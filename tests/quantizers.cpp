@@ -0,0 +1,243 @@
+//============ Copyright  2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: quantizers.cpp
+/// purpose : Tests the forced color map quantizers and checks their quality
+///			  (PSNR), bench_xtga times them.
+//==============================================================================
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "assert_equal.h"
+#include "library_error.h"
+#include "xTGA/xTGA.h"
+
+#include <cmath>
+#include <stdio.h>
+#include <string.h>
+
+using namespace xtga;
+using namespace xtga::pixelformats;
+using namespace xtga::flags;
+
+// smooth gradients with some ripples, far more than 256 colors like a photo.
+static BGRA8888* MakeImage(uint16 w, uint16 h)
+{
+	BGRA8888* buffer = (BGRA8888*)malloc(sizeof(BGRA8888) * w * h);
+	if (!buffer)
+		return nullptr;
+
+	for (uint16 y = 0; y < h; ++y)
+	{
+		for (uint16 x = 0; x < w; ++x)
+		{
+			double fx = (double)x / w, fy = (double)y / h;
+			auto& p = buffer[y * w + x];
+			p.R = (uchar)(255.0 * fx);
+			p.G = (uchar)(127.5 + 127.5 * sin(fx * 9.0 + fy * 4.0));
+			p.B = (uchar)(255.0 * fy * (1.0 - fx * 0.5));
+			p.A = (uchar)(x < w / 2 ? 0xFF : 0x80 + (y & 0x7F));
+		}
+	}
+
+	return buffer;
+}
+
+static double PSNR(const BGRA8888* original, TGAFile* tga, addressable length, bool alpha)
+{
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto decoded = tga->GetImageRGBA(nullptr, &terr);
+	if (!decoded || terr != ERRORCODE::NONE)
+		return 0.0;
+
+	double sse = 0.0;
+	for (addressable i = 0; i < length; ++i)
+	{
+		auto& o = original[i];
+		auto& d = decoded->at(i);
+		sse += (double)(o.R - d.R) * (o.R - d.R) + (double)(o.G - d.G) * (o.G - d.G) + (double)(o.B - d.B) * (o.B - d.B);
+		if (alpha)
+			sse += (double)(o.A - d.A) * (o.A - d.A);
+	}
+
+	ManagedArray<RGBA8888>::Free(decoded);
+
+	double mse = sse / ((double)length * (alpha ? 4 : 3));
+	return mse == 0.0 ? INFINITY : 10.0 * log10(255.0 * 255.0 / mse);
+}
+
+static TGAFile* MakeFile(const BGRA8888* buffer, uint16 w, uint16 h, Parameters params)
+{
+	params.InputFormat = PIXELFORMATS::BGRA8888;
+	params.RunLengthEncode = false;
+
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto tga = TGAFile::Alloc(buffer, w, h, params, &terr);
+	if (terr != ERRORCODE::NONE)
+	{
+		TGAFile::Free(tga);
+		return nullptr;
+	}
+
+	return tga;
+}
+
+int test_quantizers()
+{
+	const uint16 w = 256, h = 256;
+	auto ibuffer = MakeImage(w, h);
+	if (!ibuffer) { UNKNOWN_ERROR; }
+
+	const QUANTIZER Quantizers[] = { QUANTIZER::MEDIAN_CUT, QUANTIZER::OCTREE, QUANTIZER::WU };
+	const uchar Refinements[] = { 0, 4 };
+
+	for (uchar depth : { 24, 32 })
+	{
+		for (auto q : Quantizers)
+		{
+			for (auto r : Refinements)
+			{
+				auto tga = MakeFile(ibuffer, w, h, depth == 24 ? Parameters::BGR24() : Parameters::BGRA32_STRAIGHT_ALPHA());
+				if (!tga) { UNKNOWN_ERROR; }
+
+				ERRORCODE terr = ERRORCODE::NONE;
+				bool generated = tga->GenerateColorMap(q, r, &terr);
+
+				ASSERT_EQUAL(generated, true);
+				ASSERT_ERRORCODE_NONE(terr);
+				ASSERT_EQUAL(tga->GetHeader()->IMAGE_DEPTH, 8);
+
+				uint16 CLength = tga->GetHeader()->COLOR_MAP_LENGTH;
+				if (CLength == 0 || CLength > 256) { UNKNOWN_ERROR; }
+
+				double psnr = PSNR(ibuffer, tga, (addressable)w * h, depth == 32);
+				if (psnr < 25.0) { UNKNOWN_ERROR; }
+
+				TGAFile::Free(tga);
+			}
+		}
+	}
+
+	free(ibuffer);
+	return 0;
+}
+
+int test_exact()
+{
+	// 200 colors, every quantizer must give a lossless color map.
+	const uint16 w = 40, h = 20;
+	BGRA8888* ibuffer = (BGRA8888*)malloc(sizeof(BGRA8888) * w * h);
+	if (!ibuffer) { UNKNOWN_ERROR; }
+
+	for (uint16 i = 0; i < w * h; ++i)
+	{
+		ibuffer[i].R = (uchar)((i % 200) * 7);
+		ibuffer[i].G = (uchar)((i % 200) * 13);
+		ibuffer[i].B = (uchar)(i % 200);
+		ibuffer[i].A = 0xFF;
+	}
+
+	for (auto q : { QUANTIZER::OCTREE, QUANTIZER::WU })
+	{
+		auto tga = MakeFile(ibuffer, w, h, Parameters::BGR24());
+		if (!tga) { UNKNOWN_ERROR; }
+
+		ERRORCODE terr = ERRORCODE::NONE;
+		ASSERT_EQUAL(tga->GenerateColorMap(q, 2, &terr), true);
+		ASSERT_ERRORCODE_NONE(terr);
+		ASSERT_EQUAL(tga->GetHeader()->COLOR_MAP_LENGTH, 200);
+
+		if (!std::isinf(PSNR(ibuffer, tga, (addressable)w * h, false))) { UNKNOWN_ERROR; }
+
+		TGAFile::Free(tga);
+	}
+
+	free(ibuffer);
+	return 0;
+}
+
+int test_parameters()
+{
+	// the quantizer given in Parameters is the one GenerateColorMap(true) uses.
+	const uint16 w = 128, h = 96;
+	auto ibuffer = MakeImage(w, h);
+	if (!ibuffer) { UNKNOWN_ERROR; }
+
+	auto params = Parameters::BGR16();
+	params.Quantizer = QUANTIZER::OCTREE;
+	params.QuantizerRefinement = 1;
+
+	auto implicit = MakeFile(ibuffer, w, h, params);
+	auto explicit_ = MakeFile(ibuffer, w, h, Parameters::BGR16());
+	if (!implicit || !explicit_) { UNKNOWN_ERROR; }
+
+	ERRORCODE terr = ERRORCODE::NONE;
+	ASSERT_EQUAL(implicit->GenerateColorMap(true, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(explicit_->GenerateColorMap(QUANTIZER::OCTREE, 1, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	uint16 CLength = implicit->GetHeader()->COLOR_MAP_LENGTH;
+	ASSERT_EQUAL(explicit_->GetHeader()->COLOR_MAP_LENGTH, CLength);
+	ASSERT_EQUAL(memcmp(implicit->GetColorMap(), explicit_->GetColorMap(), CLength * sizeof(BGRA5551)), 0);
+	ASSERT_EQUAL(memcmp(implicit->GetImageData(), explicit_->GetImageData(), (addressable)w * h), 0);
+
+	free(ibuffer);
+	TGAFile::Free(implicit);
+	TGAFile::Free(explicit_);
+
+	return 0;
+}
+
+int test_sampled()
+{
+	const uint16 w = 512, h = 512;
+	const uint32 Samples = 16384;
+	auto ibuffer = MakeImage(w, h);
+	if (!ibuffer) { UNKNOWN_ERROR; }
+
+	auto full = MakeFile(ibuffer, w, h, Parameters::BGR24());
+	auto sampled = MakeFile(ibuffer, w, h, Parameters::BGR24());
+	if (!full || !sampled) { UNKNOWN_ERROR; }
+
+	ASSERT_EQUAL(full->GetColorMapStats(), nullptr);
+
+	ERRORCODE terr = ERRORCODE::NONE;
+	ASSERT_EQUAL(full->GenerateColorMap(QUANTIZER::WU, 0, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(sampled->GenerateColorMap(QUANTIZER::WU, 0, Samples, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	auto fs = full->GetColorMapStats();
+	auto ss = sampled->GetColorMapStats();
+	if (!fs || !ss) { UNKNOWN_ERROR; }
+
+	ASSERT_EQUAL(fs->Pixels, (uint64)w * h);
+	ASSERT_EQUAL(fs->Samples, (uint64)w * h);
+	ASSERT_EQUAL(fs->SamplingError, 0.0);
+	ASSERT_EQUAL(ss->Pixels, (uint64)w * h);
+	ASSERT_EQUAL(ss->Samples, (uint64)Samples);
+
+	// the reported image error is the one actually measured on the decoded image.
+	double fullPSNR = PSNR(ibuffer, full, (addressable)w * h, false);
+	double sampledPSNR = PSNR(ibuffer, sampled, (addressable)w * h, false);
+	if (fabs(10.0 * log10(255.0 * 255.0 / fs->ImageError) - fullPSNR) > 0.01) { UNKNOWN_ERROR; }
+	if (fabs(10.0 * log10(255.0 * 255.0 / ss->ImageError) - sampledPSNR) > 0.01) { UNKNOWN_ERROR; }
+	if (fabs(ss->ImageError - ss->SampleError - ss->SamplingError) > 1e-9) { UNKNOWN_ERROR; }
+
+	// a 6% sample costs little quality.
+	if (sampledPSNR < fullPSNR - 1.0) { UNKNOWN_ERROR; }
+
+	free(ibuffer);
+	TGAFile::Free(full);
+	TGAFile::Free(sampled);
+
+	return 0;
+}
+
+int main()
+{
+	return test_quantizers() | test_exact() | test_parameters() | test_sampled();
+}
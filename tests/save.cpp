@@ -0,0 +1,196 @@
+//============ Copyright  2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: save.cpp
+/// purpose : Tests that files saved to memory and to disk match and load back.
+//==============================================================================
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "assert_equal.h"
+#include "library_error.h"
+#include "xTGA/xTGA.h"
+
+#include <string.h>
+#include <vector>
+
+using namespace xtga;
+using namespace xtga::pixelformats;
+using namespace xtga::flags;
+
+const char* SaveName = "test_save.tga";
+const char DevData[] = "developer entry";
+
+TGAFile* make_file(bool rle, ERRORCODE* error, IMAGEORIGIN origin = IMAGEORIGIN::BOTTOM_LEFT)
+{
+	const uint16 w = 300, h = 200;
+	BGRA8888* ibuffer = (BGRA8888*)malloc(sizeof(BGRA8888) * w * h);
+
+	for (uint16 y = 0; y < h; ++y)
+	{
+		for (uint16 x = 0; x < w; ++x)
+		{
+			auto& p = ibuffer[(addressable)y * w + x];
+			p.B = (uchar)(x / 10 * 8);
+			p.G = (uchar)(y / 10 * 12);
+			p.R = 0x40;
+			p.A = 0xFF;
+		}
+	}
+
+	auto params = rle ? Parameters::BGRA32_RLE_STRAIGHT_ALPHA() : Parameters::BGRA32_STRAIGHT_ALPHA();
+	params.InputFormat = PIXELFORMATS::BGRA8888;
+	params.Origin = origin;
+
+	auto tga = TGAFile::Alloc(ibuffer, w, h, params, error);
+	free(ibuffer);
+
+	if (tga)
+	{
+		tga->SetImageID("saved", 6);
+		tga->AddDeveloperEntry(1234, DevData, sizeof(DevData), nullptr, error);
+	}
+
+	return tga;
+}
+
+// the save date is the only part of a file that changes between two saves.
+void clear_save_date(std::vector<uchar>& file)
+{
+	uint32 ext = 0;
+	memcpy(&ext, file.data() + file.size() - 26, sizeof(uint32));
+	if (ext)
+		memset(file.data() + ext + 2 + 41 + 81 * 4, 0, 6 * sizeof(uint16));
+}
+
+int test_matches_file(bool rle)
+{
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto tga = make_file(rle, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	ASSERT_EQUAL(tga->GenerateThumbnail(32, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	std::vector<uchar> memory;
+	ASSERT_EQUAL(tga->SaveToMemory(memory, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	ASSERT_EQUAL(tga->SaveFile(SaveName, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	auto f = fopen(SaveName, "rb");
+	if (!f) { UNKNOWN_ERROR; }
+	fseek(f, 0, SEEK_END);
+	std::vector<uchar> disk((size_t)ftell(f));
+	fseek(f, 0, SEEK_SET);
+	ASSERT_EQUAL(fread(disk.data(), 1, disk.size(), f), disk.size());
+	fclose(f);
+
+	ASSERT_EQUAL(memory.size(), disk.size());
+	clear_save_date(memory);
+	clear_save_date(disk);
+	ASSERT_EQUAL(memcmp(memory.data(), disk.data(), memory.size()), 0);
+
+	TGAFile::Free(tga);
+	return 0;
+}
+
+int test_round_trip(bool rle)
+{
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto tga = make_file(rle, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	ASSERT_EQUAL(tga->GenerateThumbnail(32, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	ASSERT_EQUAL(tga->SaveFile(SaveName, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	auto loaded = TGAFile::Alloc(SaveName, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	ASSERT_EQUAL(memcmp(loaded->GetImageID(), "saved", 6), 0);
+
+	// every offset in the footer, extension area and developer directory has to point at the right data.
+	uint32 size = 0;
+	uint16 tag = 0;
+	auto entry = loaded->GetDeveloperEntry(0, &tag, &size, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(tag, 1234);
+	ASSERT_EQUAL(size, sizeof(DevData));
+	ASSERT_EQUAL(memcmp(entry, DevData, sizeof(DevData)), 0);
+
+	auto a = tga->GetImageRGBA(nullptr, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	auto b = loaded->GetImageRGBA(nullptr, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(a->size(), b->size());
+	ASSERT_EQUAL(memcmp(a->rawat(0), b->rawat(0), a->size() * sizeof(RGBA8888)), 0);
+
+	// thumbnails are written with their width and height in front of them.
+	auto thumb = (const uchar*)loaded->GetThumbnailData();
+	ASSERT_EQUAL(thumb[-2], 32);
+	ASSERT_EQUAL(memcmp(tga->GetThumbnailData(), thumb, (addressable)thumb[-2] * thumb[-1] * 4), 0);
+
+	ManagedArray<RGBA8888>::Free(a);
+	ManagedArray<RGBA8888>::Free(b);
+	TGAFile::Free(loaded);
+	TGAFile::Free(tga);
+	return 0;
+}
+
+// top left files store the rows in the order they were given and decode to the same image.
+int test_top_left(bool rle)
+{
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto bottom = make_file(rle, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	auto top = make_file(rle, &terr, IMAGEORIGIN::TOP_LEFT);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(top->GetHeader()->IMAGE_DESCRIPTOR.IMAGE_ORIGIN, IMAGEORIGIN::TOP_LEFT);
+
+	if (!rle)
+	{
+		// the first stored row is the top row.
+		auto p = (const BGRA8888*)top->GetImageData();
+		ASSERT_EQUAL(p[0].G, 0);
+		ASSERT_EQUAL(p[(addressable)199 * 300].G, (uchar)(19 * 12));
+	}
+
+	ASSERT_EQUAL(top->SaveFile(SaveName, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+	auto loaded = TGAFile::Alloc(SaveName, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(loaded->GetHeader()->IMAGE_DESCRIPTOR.IMAGE_ORIGIN, IMAGEORIGIN::TOP_LEFT);
+
+	auto a = bottom->GetImageRGBA(nullptr, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	auto b = loaded->GetImageRGBA(nullptr, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(a->size(), b->size());
+	ASSERT_EQUAL(memcmp(a->rawat(0), b->rawat(0), a->size() * sizeof(RGBA8888)), 0);
+
+	ManagedArray<RGBA8888>::Free(a);
+	ManagedArray<RGBA8888>::Free(b);
+	TGAFile::Free(loaded);
+	TGAFile::Free(top);
+	TGAFile::Free(bottom);
+
+	// only flipping rows is supported.
+	auto bad = make_file(rle, &terr, IMAGEORIGIN::TOP_RIGHT);
+	ASSERT_EQUAL(bad, (TGAFile*)nullptr);
+	ASSERT_EQUAL(terr, ERRORCODE::INVALID_OPERATION);
+	return 0;
+}
+
+int main()
+{
+	int r = test_matches_file(false) | test_matches_file(true) | test_round_trip(false) | test_round_trip(true);
+	r |= test_top_left(false) | test_top_left(true);
+	remove(SaveName);
+	return r;
+}
@@ -0,0 +1,218 @@
+//============ Copyright  2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: shared_palette.cpp
+/// purpose : Tests building a palette once and applying it to a sequence of
+///			  frames, and updating it when a frame drifts.
+//==============================================================================
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "assert_equal.h"
+#include "library_error.h"
+#include "xTGA/xTGA.h"
+
+#include <cmath>
+#include <stdio.h>
+#include <string.h>
+
+using namespace xtga;
+using namespace xtga::pixelformats;
+using namespace xtga::flags;
+
+// a slowly panning gradient, every frame has far more than 256 colors but they're all alike.
+static BGR888* MakeFrame(uint16 w, uint16 h, uint16 frame)
+{
+	BGR888* buffer = (BGR888*)malloc(sizeof(BGR888) * w * h);
+	if (!buffer)
+		return nullptr;
+
+	for (uint16 y = 0; y < h; ++y)
+	{
+		for (uint16 x = 0; x < w; ++x)
+		{
+			double fx = (double)((x + frame * 4) % w) / w, fy = (double)y / h;
+			auto& p = buffer[y * w + x];
+			p.R = (uchar)(255.0 * fx);
+			p.G = (uchar)(127.5 + 127.5 * sin(fx * 6.0 + fy * 3.0));
+			p.B = (uchar)(255.0 * fy);
+		}
+	}
+
+	return buffer;
+}
+
+static double PSNR(const BGR888* original, TGAFile* tga, addressable length)
+{
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto decoded = tga->GetImageRGBA(nullptr, &terr);
+	if (!decoded || terr != ERRORCODE::NONE)
+		return 0.0;
+
+	double sse = 0.0;
+	for (addressable i = 0; i < length; ++i)
+	{
+		auto& o = original[i];
+		auto& d = decoded->at(i);
+		sse += (double)(o.R - d.R) * (o.R - d.R) + (double)(o.G - d.G) * (o.G - d.G) + (double)(o.B - d.B) * (o.B - d.B);
+	}
+
+	ManagedArray<RGBA8888>::Free(decoded);
+
+	double mse = sse / ((double)length * 3);
+	return mse == 0.0 ? INFINITY : 10.0 * log10(255.0 * 255.0 / mse);
+}
+
+int test_sequence()
+{
+	const uint16 w = 128, h = 64, Frames = 6;
+	BGR888* frames[Frames];
+	const void* buffers[Frames];
+	addressable lengths[Frames];
+
+	for (uint16 f = 0; f < Frames; ++f)
+	{
+		frames[f] = MakeFrame(w, h, f);
+		if (!frames[f]) { UNKNOWN_ERROR; }
+		buffers[f] = frames[f];
+		lengths[f] = (addressable)w * h;
+	}
+
+	// built over the first half, applied to every frame.
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto palette = SharedPalette::Build(buffers, lengths, Frames / 2, 24, QUANTIZER::WU, 2, 0, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	if (!palette) { UNKNOWN_ERROR; }
+	ASSERT_EQUAL(palette->GetDepth(), 24);
+	ASSERT_EQUAL(palette->GetRevision(), 0);
+
+	uint16 CLength = palette->GetLength();
+	if (CLength == 0 || CLength > 256) { UNKNOWN_ERROR; }
+
+	auto params = Parameters::BGR24_COLORMAPPED();
+	params.InputFormat = PIXELFORMATS::BGR888;
+	params.RunLengthEncode = false;
+	params.Palette = palette;
+
+	for (uint16 f = 0; f < Frames; ++f)
+	{
+		auto tga = TGAFile::Alloc(frames[f], w, h, params, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+		if (!tga) { UNKNOWN_ERROR; }
+
+		ASSERT_EQUAL(tga->GetHeader()->IMAGE_DEPTH, 8);
+		ASSERT_EQUAL(tga->GetHeader()->COLOR_MAP_LENGTH, CLength);
+		ASSERT_EQUAL(memcmp(tga->GetColorMap(), palette->GetColorMap(), CLength * sizeof(BGR888)), 0);
+
+		auto stats = tga->GetColorMapStats();
+		if (!stats) { UNKNOWN_ERROR; }
+
+		double psnr = PSNR(frames[f], tga, (addressable)w * h);
+		if (fabs(10.0 * log10(255.0 * 255.0 / stats->ImageError) - psnr) > 0.01) { UNKNOWN_ERROR; }
+		if (psnr < 25.0) { UNKNOWN_ERROR; }
+
+		// applying to an existing file gives the same indices.
+		auto plain = TGAFile::Alloc(frames[f], w, h, [&]() { auto p = Parameters::BGR24(); p.InputFormat = PIXELFORMATS::BGR888; p.RunLengthEncode = false; return p; }(), &terr);
+		if (!plain) { UNKNOWN_ERROR; }
+		ASSERT_EQUAL(plain->ApplyPalette(palette, &terr), true);
+		ASSERT_ERRORCODE_NONE(terr);
+		ASSERT_EQUAL(memcmp(plain->GetImageData(), tga->GetImageData(), (addressable)w * h), 0);
+
+		TGAFile::Free(plain);
+		TGAFile::Free(tga);
+	}
+
+	// no threshold, no updates.
+	ASSERT_EQUAL(palette->GetRevision(), 0);
+
+	// a palette of the wrong depth is refused.
+	auto bgra = TGAFile::Alloc(frames[0], w, h, [&]() { auto p = Parameters::BGRA32_STRAIGHT_ALPHA(); p.InputFormat = PIXELFORMATS::BGR888; p.RunLengthEncode = false; return p; }(), &terr);
+	if (!bgra) { UNKNOWN_ERROR; }
+	ASSERT_EQUAL(bgra->ApplyPalette(palette, &terr), false);
+	ASSERT_ENUM_VALUE(terr, ERRORCODE::INVALID_DEPTH);
+	TGAFile::Free(bgra);
+
+	SharedPalette::Free(palette);
+	ASSERT_EQUAL(palette, nullptr);
+
+	for (uint16 f = 0; f < Frames; ++f)
+		free(frames[f]);
+
+	return 0;
+}
+
+int test_update()
+{
+	// a caller's black and white palette, then a frame that is all red.
+	const uint16 w = 64, h = 32;
+	BGRA5551 Colors[2];
+	Colors[0].R = Colors[0].G = Colors[0].B = 0; Colors[0].A = 1;
+	Colors[1].R = Colors[1].G = Colors[1].B = 31; Colors[1].A = 1;
+
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto palette = SharedPalette::Alloc(Colors, 2, 16, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	if (!palette) { UNKNOWN_ERROR; }
+	ASSERT_EQUAL(palette->GetLength(), 2);
+
+	BGRA5551* gray = (BGRA5551*)malloc(sizeof(BGRA5551) * w * h);
+	BGRA5551* red = (BGRA5551*)malloc(sizeof(BGRA5551) * w * h);
+	if (!gray || !red) { UNKNOWN_ERROR; }
+
+	for (uint16 i = 0; i < w * h; ++i)
+	{
+		gray[i].R = gray[i].G = gray[i].B = (i & 1) ? 30 : 1; gray[i].A = 1;
+		red[i].R = 31; red[i].G = red[i].B = 0; red[i].A = 1;
+	}
+
+	auto params = Parameters::BGR16();
+	params.InputFormat = PIXELFORMATS::BGRA5551;
+	params.RunLengthEncode = false;
+
+	palette->SetUpdateThreshold(100.0);
+
+	// close enough, the palette stays as it is.
+	auto g = TGAFile::Alloc(gray, w, h, params, &terr);
+	if (!g) { UNKNOWN_ERROR; }
+	ASSERT_EQUAL(g->ApplyPalette(palette, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(palette->GetRevision(), 0);
+	for (uint16 i = 0; i < w * h; ++i)
+		ASSERT_EQUAL(((uchar*)g->GetImageData())[i], (i & 1) ? 1 : 0);
+
+	// red drifts past the threshold and updates the palette before it is applied.
+	auto r = TGAFile::Alloc(red, w, h, params, &terr);
+	if (!r) { UNKNOWN_ERROR; }
+	ASSERT_EQUAL(r->ApplyPalette(palette, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(palette->GetRevision(), 1);
+
+	// a copy of the color map carries the revision it was taken at.
+	uchar Snapshot[256 * 4];
+	uint32 Revision = 0;
+	ASSERT_EQUAL(palette->CopyColorMap(Snapshot, &Revision), palette->GetLength());
+	ASSERT_EQUAL(Revision, 1);
+	ASSERT_EQUAL(memcmp(Snapshot, palette->GetColorMap(), (addressable)palette->GetLength() * (palette->GetDepth() / 8)), 0);
+
+	auto stats = r->GetColorMapStats();
+	if (!stats || stats->ImageError > 100.0) { UNKNOWN_ERROR; }
+
+	// the earlier file kept its own copy of the old color map.
+	ASSERT_EQUAL(g->GetHeader()->COLOR_MAP_LENGTH, 2);
+	ASSERT_EQUAL(memcmp(g->GetColorMap(), Colors, sizeof(Colors)), 0);
+
+	TGAFile::Free(g);
+	TGAFile::Free(r);
+	SharedPalette::Free(palette);
+	free(gray);
+	free(red);
+
+	return 0;
+}
+
+int main()
+{
+	return test_sequence() | test_update();
+}
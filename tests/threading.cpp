@@ -0,0 +1,217 @@
+//============ Copyright  2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: threading.cpp
+/// purpose : Tests that the thread settings are respected and that results
+///			  do not depend on them.
+//==============================================================================
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "assert_equal.h"
+#include "library_error.h"
+#include "xTGA/xTGA.h"
+
+#include <atomic>
+#include <string.h>
+#include <thread>
+
+using namespace xtga;
+using namespace xtga::pixelformats;
+
+static void SerialExecutor(threading::TaskFunc func, void* task, uint32 count, void* userdata)
+{
+	++*(uint32*)userdata;
+	for (uint32 i = 0; i < count; ++i)
+		func(task, i);
+}
+
+static TGAFile* MakeColorMapped(const BGR888* ibuffer, uint16 w, uint16 h, flags::QUANTIZER quantizer = flags::QUANTIZER::MEDIAN_CUT)
+{
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto tga = TGAFile::Alloc(ibuffer, w, h, Parameters::BGR24(), &terr);
+	if (terr != ERRORCODE::NONE)
+		return nullptr;
+
+	const bool generated = quantizer == flags::QUANTIZER::MEDIAN_CUT ? tga->GenerateColorMap(true, &terr) : tga->GenerateColorMap(quantizer, 0, &terr);
+	if (!generated)
+	{
+		TGAFile::Free(tga);
+		return nullptr;
+	}
+
+	return tga;
+}
+
+int test_thread_count()
+{
+	threading::SetThreadCount(3);
+	ASSERT_EQUAL(threading::GetThreadCount(), 3);
+
+	threading::SetThreadCount(1);
+	ASSERT_EQUAL(threading::GetThreadCount(), 1);
+
+	threading::SetThreadCount(0);
+	if (threading::GetThreadCount() == 0) { UNKNOWN_ERROR; }
+
+	return 0;
+}
+
+int test_cost_model()
+{
+	using threading::WORKLOAD;
+	using threading::EXECUTION;
+
+	threading::SetThreadCount(4);
+
+	threading::SetParallelThreshold(WORKLOAD::COLORMAP_SEARCH, 1000);
+	ASSERT_EQUAL(threading::GetParallelThreshold(WORKLOAD::COLORMAP_SEARCH), 1000);
+	ASSERT_ENUM_VALUE(threading::ChooseExecution(WORKLOAD::COLORMAP_SEARCH, 1000, 24), EXECUTION::THREADED);
+	if (threading::ChooseExecution(WORKLOAD::COLORMAP_SEARCH, 999, 24) == EXECUTION::THREADED) { UNKNOWN_ERROR; }
+
+	// back to the model, tiny work is never worth threading.
+	threading::SetParallelThreshold(WORKLOAD::COLORMAP_SEARCH, 0);
+	if (threading::GetParallelThreshold(WORKLOAD::COLORMAP_SEARCH) < 1000) { UNKNOWN_ERROR; }
+	ASSERT_ENUM_VALUE(threading::ChooseExecution(WORKLOAD::COLORMAP_LOOKUP, 16, 24), EXECUTION::SERIAL);
+	ASSERT_ENUM_VALUE(threading::ChooseExecution(WORKLOAD::COLORMAP_SEARCH, 16, 24, 4), EXECUTION::SERIAL);
+
+	// a bigger color map makes each pixel dearer, so threading starts sooner.
+	if (threading::GetParallelThreshold(WORKLOAD::COLORMAP_SEARCH, 24, 16) < threading::GetParallelThreshold(WORKLOAD::COLORMAP_SEARCH, 24, 256)) { UNKNOWN_ERROR; }
+
+	threading::CalibrateCostModel();
+	for (uchar w = 0; w < 4; ++w)
+	{
+		if (threading::GetParallelThreshold((WORKLOAD)w) == 0) { UNKNOWN_ERROR; }
+	}
+
+	threading::SetThreadCount(1);
+	ASSERT_EQUAL(threading::GetParallelThreshold(WORKLOAD::COLORMAP_BUILD), 0);
+	if (threading::ChooseExecution(WORKLOAD::COLORMAP_BUILD, 1 << 30, 32) == EXECUTION::THREADED) { UNKNOWN_ERROR; }
+
+	threading::SetThreadCount(0);
+	return 0;
+}
+
+int test_results_match()
+{
+	const uint16 w = 96, h = 80;
+	BGR888* ibuffer = (BGR888*)malloc(sizeof(BGR888) * w * h);
+	if (!ibuffer) { UNKNOWN_ERROR; }
+
+	for (uint16 y = 0; y < h; ++y)
+	{
+		for (uint16 x = 0; x < w; ++x)
+		{
+			ibuffer[y * w + x].R = (uchar)(x * 5 + y);
+			ibuffer[y * w + x].G = (uchar)(y * 3);
+			ibuffer[y * w + x].B = (uchar)(x * y);
+		}
+	}
+
+	threading::SetThreadCount(1);
+	auto serial = MakeColorMapped(ibuffer, w, h);
+	if (!serial) { UNKNOWN_ERROR; }
+
+	// small enough that the cost model would keep it serial.
+	threading::SetParallelThreshold(threading::WORKLOAD::COLORMAP_BUILD, 1);
+	threading::SetParallelThreshold(threading::WORKLOAD::COLORMAP_SEARCH, 1);
+
+	threading::SetThreadCount(4);
+	auto pooled = MakeColorMapped(ibuffer, w, h);
+	if (!pooled) { UNKNOWN_ERROR; }
+
+	uint32 calls = 0;
+	threading::SetExecutor(SerialExecutor, &calls, 4);
+	auto executed = MakeColorMapped(ibuffer, w, h);
+	threading::SetExecutor(nullptr);
+	threading::SetThreadCount(0);
+	threading::SetParallelThreshold(threading::WORKLOAD::COLORMAP_BUILD, 0);
+	threading::SetParallelThreshold(threading::WORKLOAD::COLORMAP_SEARCH, 0);
+	if (!executed) { UNKNOWN_ERROR; }
+
+	if (calls == 0) { UNKNOWN_ERROR; }
+
+	uint16 CLength = serial->GetHeader()->COLOR_MAP_LENGTH;
+	ASSERT_EQUAL(pooled->GetHeader()->COLOR_MAP_LENGTH, CLength);
+	ASSERT_EQUAL(executed->GetHeader()->COLOR_MAP_LENGTH, CLength);
+
+	ASSERT_EQUAL(memcmp(serial->GetColorMap(), pooled->GetColorMap(), CLength * sizeof(BGR888)), 0);
+	ASSERT_EQUAL(memcmp(serial->GetColorMap(), executed->GetColorMap(), CLength * sizeof(BGR888)), 0);
+	ASSERT_EQUAL(memcmp(serial->GetImageData(), pooled->GetImageData(), (addressable)w * h), 0);
+	ASSERT_EQUAL(memcmp(serial->GetImageData(), executed->GetImageData(), (addressable)w * h), 0);
+
+	free(ibuffer);
+	TGAFile::Free(serial);
+	TGAFile::Free(pooled);
+	TGAFile::Free(executed);
+
+	return 0;
+}
+
+int test_resize_while_running()
+{
+	const uint16 w = 96, h = 80;
+	BGR888* ibuffer = (BGR888*)malloc(sizeof(BGR888) * w * h);
+	if (!ibuffer) { UNKNOWN_ERROR; }
+
+	for (addressable i = 0; i < (addressable)w * h; ++i)
+	{
+		ibuffer[i].R = (uchar)(i * 5);
+		ibuffer[i].G = (uchar)(i / 3);
+		ibuffer[i].B = (uchar)(i * 11);
+	}
+
+	threading::SetThreadCount(1);
+	auto serial = MakeColorMapped(ibuffer, w, h, flags::QUANTIZER::WU);
+	if (!serial) { UNKNOWN_ERROR; }
+
+	threading::SetParallelThreshold(threading::WORKLOAD::COLORMAP_BUILD, 1);
+	threading::SetParallelThreshold(threading::WORKLOAD::COLORMAP_SEARCH, 1);
+	threading::SetThreadCount(4);
+
+	// the pool is replaced while another thread has work running on it, that work still completes on
+	// the old pool and gives the same result.
+	std::atomic<bool> done(false);
+	std::atomic<uint32> mismatches(0);
+	std::thread worker([&]()
+	{
+		for (uint32 i = 0; i < 50; ++i)
+		{
+			auto tga = MakeColorMapped(ibuffer, w, h, flags::QUANTIZER::WU);
+			if (!tga)
+			{
+				++mismatches;
+				continue;
+			}
+
+			if (memcmp(tga->GetImageData(), serial->GetImageData(), (addressable)w * h) != 0)
+				++mismatches;
+			TGAFile::Free(tga);
+		}
+		done = true;
+	});
+
+	for (uint32 count = 2; !done; count = count == 2 ? 3 : 2)
+		threading::SetThreadCount(count);
+
+	worker.join();
+
+	threading::SetThreadCount(0);
+	threading::SetParallelThreshold(threading::WORKLOAD::COLORMAP_BUILD, 0);
+	threading::SetParallelThreshold(threading::WORKLOAD::COLORMAP_SEARCH, 0);
+
+	const uint32 failed = mismatches;
+	ASSERT_EQUAL(failed, 0);
+
+	free(ibuffer);
+	TGAFile::Free(serial);
+
+	return 0;
+}
+
+int main()
+{
+	return test_thread_count() | test_cost_model() | test_results_match() | test_resize_while_running();
+}
@@ -0,0 +1,332 @@
+//============ Copyright  2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: thumbnail.cpp
+/// purpose : Tests that thumbnails are resampled to the right size and colors.
+//==============================================================================
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "assert_equal.h"
+#include "library_error.h"
+#include "xTGA/xTGA.h"
+
+#include <string.h>
+
+using namespace xtga;
+using namespace xtga::pixelformats;
+using namespace xtga::flags;
+
+int test_flat_colors()
+{
+	const uint16 w = 300, h = 200;
+	BGRA8888* ibuffer = (BGRA8888*)malloc(sizeof(BGRA8888) * w * h);
+	if (!ibuffer) { UNKNOWN_ERROR; }
+
+	for (addressable i = 0; i < (addressable)w * h; ++i)
+	{
+		ibuffer[i].B = 0x20;
+		ibuffer[i].G = 0x80;
+		ibuffer[i].R = 0xF0;
+		ibuffer[i].A = 0xFF;
+	}
+
+	// the filter weights sum to exactly one, so a flat image stays flat in every format.
+	const Parameters Formats[] = { Parameters::BGR24(), Parameters::BGRA32_STRAIGHT_ALPHA(), Parameters::BGR16(), Parameters::I8(), Parameters::IA16_STRAIGHT_ALPHA() };
+
+	for (auto params : Formats)
+	{
+		params.InputFormat = PIXELFORMATS::BGRA8888;
+		params.RunLengthEncode = false;
+
+		ERRORCODE terr = ERRORCODE::NONE;
+		auto tga = TGAFile::Alloc(ibuffer, w, h, params, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		auto source = tga->GetImageRGBA(nullptr, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		ASSERT_EQUAL(tga->GenerateThumbnail(64, &terr), true);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		auto thumb = tga->GetThumbnailRGBA(nullptr, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+		ASSERT_EQUAL(thumb->size(), 64 * 42);
+
+		for (addressable i = 0; i < thumb->size(); ++i)
+		{
+			ASSERT_EQUAL(thumb->at(i).R, source->at(0).R);
+			ASSERT_EQUAL(thumb->at(i).G, source->at(0).G);
+			ASSERT_EQUAL(thumb->at(i).B, source->at(0).B);
+			ASSERT_EQUAL(thumb->at(i).A, source->at(0).A);
+		}
+
+		ManagedArray<RGBA8888>::Free(source);
+		ManagedArray<RGBA8888>::Free(thumb);
+		TGAFile::Free(tga);
+	}
+
+	free(ibuffer);
+	return 0;
+}
+
+int test_gradient()
+{
+	const uint16 w = 512, h = 37;
+	BGR888* ibuffer = (BGR888*)malloc(sizeof(BGR888) * w * h);
+	if (!ibuffer) { UNKNOWN_ERROR; }
+
+	for (uint16 y = 0; y < h; ++y)
+	{
+		for (uint16 x = 0; x < w; ++x)
+		{
+			ibuffer[y * w + x].R = (uchar)(x / 2);
+			ibuffer[y * w + x].G = (uchar)(255 - x / 2);
+			ibuffer[y * w + x].B = 0x40;
+		}
+	}
+
+	auto params = Parameters::BGR24();
+	params.InputFormat = PIXELFORMATS::BGR888;
+
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto tga = TGAFile::Alloc(ibuffer, w, h, params, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(tga->GenerateThumbnail(128, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	auto thumb = tga->GetThumbnailRGBA(nullptr, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(thumb->size(), 128 * 9);
+
+	// each thumbnail pixel covers 4 source columns, so it lands on their mean.
+	for (uint16 y = 0; y < 9; ++y)
+	{
+		for (uint16 x = 0; x < 128; ++x)
+		{
+			auto& p = thumb->at(y * 128 + x);
+			int r = p.R - (x * 2 + 1);
+			int g = p.G - (254 - x * 2);
+			if (x > 1 && x < 126 && (r < -1 || r > 1 || g < -1 || g > 1)) { UNKNOWN_ERROR; }
+			ASSERT_EQUAL(p.B, 0x40);
+		}
+	}
+
+	ManagedArray<RGBA8888>::Free(thumb);
+	TGAFile::Free(tga);
+	free(ibuffer);
+	return 0;
+}
+
+int test_area_average()
+{
+	const uint16 w = 4096, h = 2048;
+	BGR888* ibuffer = (BGR888*)malloc(sizeof(BGR888) * w * h);
+	if (!ibuffer) { UNKNOWN_ERROR; }
+
+	for (uint16 y = 0; y < h; ++y)
+	{
+		for (uint16 x = 0; x < w; ++x)
+		{
+			ibuffer[(addressable)y * w + x].R = (uchar)((x % 4) * 40 + (y % 4) * 10);
+			ibuffer[(addressable)y * w + x].G = (uchar)(255 - (x % 4) * 40 - (y % 4) * 10);
+			ibuffer[(addressable)y * w + x].B = (uchar)(x / 64 * 4);
+		}
+	}
+
+	auto params = Parameters::BGR24();
+	params.InputFormat = PIXELFORMATS::BGR888;
+
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto tga = TGAFile::Alloc(ibuffer, w, h, params, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(tga->GenerateThumbnail(64, &terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	auto thumb = tga->GetThumbnailRGBA(nullptr, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(thumb->size(), 64 * 32);
+
+	// each thumbnail pixel is the exact mean of its 64x64 block.
+	for (uint16 y = 0; y < 32; ++y)
+	{
+		for (uint16 x = 0; x < 64; ++x)
+		{
+			auto& p = thumb->at(y * 64 + x);
+			ASSERT_EQUAL(p.R, 75);
+			ASSERT_EQUAL(p.G, 180);
+			ASSERT_EQUAL(p.B, x * 4);
+		}
+	}
+
+	ManagedArray<RGBA8888>::Free(thumb);
+	TGAFile::Free(tga);
+	free(ibuffer);
+	return 0;
+}
+
+int test_rle()
+{
+	// not a whole multiple of the thumbnail, so output pixels partly cover source pixels on their edges.
+	const uint16 w = 997, h = 301;
+	BGRA8888* ibuffer = (BGRA8888*)malloc(sizeof(BGRA8888) * w * h);
+	if (!ibuffer) { UNKNOWN_ERROR; }
+
+	// gradients with noise on top, every source pixel has to be counted for both paths to agree.
+	uint32 seed = 12345;
+	for (uint16 y = 0; y < h; ++y)
+	{
+		for (uint16 x = 0; x < w; ++x)
+		{
+			seed = seed * 1664525 + 1013904223;
+			auto& p = ibuffer[(addressable)y * w + x];
+			p.B = (uchar)(x / 4 + (seed >> 24) % 32);
+			p.G = (uchar)(y / 2 + (seed >> 16) % 64);
+			p.R = (uchar)(seed >> 8);
+			p.A = (uchar)(seed >> 24 | 0x80);
+		}
+	}
+
+	// the color mapped case keeps the top 2 bits of each channel, so the map holds every color.
+	BGRA8888* reduced = (BGRA8888*)malloc(sizeof(BGRA8888) * w * h);
+	if (!reduced) { UNKNOWN_ERROR; }
+	for (addressable i = 0; i < (addressable)w * h; ++i)
+	{
+		reduced[i].B = ibuffer[i].B & 0xC0;
+		reduced[i].G = ibuffer[i].G & 0xC0;
+		reduced[i].R = ibuffer[i].R & 0xC0;
+		reduced[i].A = ibuffer[i].A & 0xC0;
+	}
+
+	const Parameters Formats[] = { Parameters::BGR24(), Parameters::BGRA32_STRAIGHT_ALPHA(), Parameters::BGR16(),
+		Parameters::I8(), Parameters::IA16_STRAIGHT_ALPHA(), Parameters::BGRA32_STRAIGHT_ALPHA() };
+	const uchar Bytes[] = { 3, 4, 2, 1, 2, 1 };
+
+	for (uchar f = 0; f < 6; ++f)
+	{
+		auto params = Formats[f];
+		params.InputFormat = PIXELFORMATS::BGRA8888;
+
+		ERRORCODE terr = ERRORCODE::NONE;
+		const BGRA8888* source = f == 5 ? reduced : ibuffer;
+		auto rle = TGAFile::Alloc(source, w, h, params, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+		auto plain = TGAFile::Alloc(source, w, h, params, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		// the last one is color mapped, its thumbnail averages the color map entries.
+		if (f == 5)
+		{
+			ASSERT_EQUAL(rle->GenerateColorMap(false, &terr), true);
+			ASSERT_EQUAL(plain->GenerateColorMap(false, &terr), true);
+		}
+
+		ASSERT_EQUAL(rle->CompressWithRLE(&terr), true);
+
+		ASSERT_EQUAL(rle->GenerateThumbnail(50, &terr), true);
+		ASSERT_ERRORCODE_NONE(terr);
+		ASSERT_EQUAL(plain->GenerateThumbnail(50, &terr), true);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		// streamed from the packets or decoded first, the area average is the same.
+		ASSERT_EQUAL(memcmp(rle->GetThumbnailData(), plain->GetThumbnailData(), 50 * 15 * Bytes[f]), 0);
+
+		TGAFile::Free(rle);
+		TGAFile::Free(plain);
+	}
+
+	free(reduced);
+	free(ibuffer);
+	return 0;
+}
+
+int test_shapes()
+{
+	// the short edge keeps at least one pixel, small images are scaled up.
+	struct { uint16 w, h; uchar edge; uint16 tw, th; } Cases[] = { { 10, 1000, 64, 1, 64 }, { 1000, 3, 100, 100, 1 }, { 12, 8, 48, 48, 32 }, { 1, 1, 16, 16, 16 } };
+
+	for (auto& c : Cases)
+	{
+		BGR888* ibuffer = (BGR888*)malloc(sizeof(BGR888) * c.w * c.h);
+		if (!ibuffer) { UNKNOWN_ERROR; }
+		for (addressable i = 0; i < (addressable)c.w * c.h; ++i)
+		{
+			ibuffer[i].R = (uchar)i;
+			ibuffer[i].G = (uchar)(i * 7);
+			ibuffer[i].B = (uchar)(i * 13);
+		}
+
+		auto params = Parameters::BGR24();
+		params.InputFormat = PIXELFORMATS::BGR888;
+
+		ERRORCODE terr = ERRORCODE::NONE;
+		auto tga = TGAFile::Alloc(ibuffer, c.w, c.h, params, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+		ASSERT_EQUAL(tga->GenerateThumbnail(c.edge, &terr), true);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		auto thumb = tga->GetThumbnailRGBA(nullptr, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+		ASSERT_EQUAL(thumb->size(), (addressable)c.tw * c.th);
+
+		ManagedArray<RGBA8888>::Free(thumb);
+		TGAFile::Free(tga);
+		free(ibuffer);
+	}
+
+	return 0;
+}
+
+int test_threaded()
+{
+	const uint16 w = 640, h = 480;
+	BGRA8888* ibuffer = (BGRA8888*)malloc(sizeof(BGRA8888) * w * h);
+	if (!ibuffer) { UNKNOWN_ERROR; }
+
+	uint32 seed = 0x2545F491;
+	for (addressable i = 0; i < (addressable)w * h; ++i)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		memcpy(&ibuffer[i], &seed, sizeof(BGRA8888));
+	}
+
+	auto params = Parameters::BGRA32_STRAIGHT_ALPHA();
+	params.InputFormat = PIXELFORMATS::BGRA8888;
+
+	// 200 pixels goes through the bicubic filter, 64 through area averaging.
+	const uchar Edges[] = { 200, 64 };
+
+	for (auto Edge : Edges)
+	{
+		ERRORCODE terr = ERRORCODE::NONE;
+		TGAFile* Files[2] = { nullptr, nullptr };
+
+		threading::SetThreadCount(1);
+		Files[0] = TGAFile::Alloc(ibuffer, w, h, params, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+		ASSERT_EQUAL(Files[0]->GenerateThumbnail(Edge, &terr), true);
+
+		threading::SetThreadCount(4);
+		threading::SetParallelThreshold(threading::WORKLOAD::RESAMPLE, 1);
+		Files[1] = TGAFile::Alloc(ibuffer, w, h, params, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+		ASSERT_EQUAL(Files[1]->GenerateThumbnail(Edge, &terr), true);
+		threading::SetParallelThreshold(threading::WORKLOAD::RESAMPLE, 0);
+		threading::SetThreadCount(0);
+
+		ASSERT_EQUAL(memcmp(Files[0]->GetThumbnailData(), Files[1]->GetThumbnailData(), (addressable)Edge * (Edge * 3 / 4) * sizeof(BGRA8888)), 0);
+
+		TGAFile::Free(Files[0]);
+		TGAFile::Free(Files[1]);
+	}
+
+	free(ibuffer);
+	return 0;
+}
+
+int main()
+{
+	return test_flat_colors() | test_gradient() | test_area_average() | test_rle() | test_shapes() | test_threaded();
+}
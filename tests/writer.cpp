@@ -0,0 +1,231 @@
+//============ Copyright  2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: writer.cpp
+/// purpose : Tests that images streamed through a TGAWriter match ones saved whole.
+//==============================================================================
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "assert_equal.h"
+#include "library_error.h"
+#include "xTGA/xTGA.h"
+
+#include <sstream>
+#include <string.h>
+#include <vector>
+
+using namespace xtga;
+using namespace xtga::pixelformats;
+using namespace xtga::flags;
+
+const char* WriterName = "test_writer.tga";
+const uint16 W = 300, H = 200;
+
+// flat blocks with a noisy band, so run-length encoded rows get both kinds of packet.
+std::vector<BGRA8888> make_image()
+{
+	std::vector<BGRA8888> image((addressable)W * H);
+	uint32 seed = 1;
+
+	for (uint16 y = 0; y < H; ++y)
+	{
+		for (uint16 x = 0; x < W; ++x)
+		{
+			auto& p = image[(addressable)y * W + x];
+			seed = seed * 1103515245 + 12345;
+			p.B = (uchar)(x / 20 * 16);
+			p.G = (x > 100 && x < 140) ? (uchar)(seed >> 16) : (uchar)(y / 20 * 24);
+			p.R = 0x40;
+			p.A = (uchar)(x < 150 ? 0xFF : 0x80);
+		}
+	}
+
+	return image;
+}
+
+std::vector<uchar> read_file(const char* filename)
+{
+	std::vector<uchar> r;
+	auto f = fopen(filename, "rb");
+	if (!f)
+		return r;
+
+	fseek(f, 0, SEEK_END);
+	r.resize((size_t)ftell(f));
+	fseek(f, 0, SEEK_SET);
+	if (fread(r.data(), 1, r.size(), f) != r.size())
+		r.clear();
+	fclose(f);
+	return r;
+}
+
+int test_matches_alloc()
+{
+	auto image = make_image();
+
+	const Parameters Formats[] = { Parameters::BGR24(), Parameters::BGR24_RLE(), Parameters::BGRA32_RLE_STRAIGHT_ALPHA(),
+		Parameters::BGR16_RLE(), Parameters::I8_RLE(), Parameters::IA16_STRAIGHT_ALPHA() };
+
+	for (auto params : Formats)
+	{
+		params.InputFormat = PIXELFORMATS::BGRA8888;
+		params.TGA2File = false;
+
+		ERRORCODE terr = ERRORCODE::NONE;
+		auto tga = TGAFile::Alloc(image.data(), W, H, params, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		std::vector<uchar> expected;
+		ASSERT_EQUAL(tga->SaveToMemory(expected, &terr), true);
+		ASSERT_ERRORCODE_NONE(terr);
+		TGAFile::Free(tga);
+
+		// TGAFile stores images bottom row first, so feed the rows in that order.
+		auto writer = TGAWriter::Open(WriterName, W, H, params, IMAGEORIGIN::BOTTOM_LEFT, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		for (uint16 y = H; y > 0; --y)
+		{
+			ASSERT_EQUAL(writer->WriteRows(&image[(addressable)(y - 1) * W], 1, &terr), true);
+			ASSERT_ERRORCODE_NONE(terr);
+		}
+
+		ASSERT_EQUAL(writer->Close(&terr), true);
+		ASSERT_ERRORCODE_NONE(terr);
+		TGAWriter::Free(writer);
+
+		auto written = read_file(WriterName);
+		ASSERT_EQUAL(written.size(), expected.size());
+		ASSERT_EQUAL(memcmp(written.data(), expected.data(), expected.size()), 0);
+	}
+
+	return 0;
+}
+
+int test_top_left()
+{
+	auto image = make_image();
+	const Parameters Formats[] = { Parameters::BGRA32_STRAIGHT_ALPHA(), Parameters::BGR24_RLE() };
+
+	for (auto params : Formats)
+	{
+		params.InputFormat = PIXELFORMATS::BGRA8888;
+
+		ERRORCODE terr = ERRORCODE::NONE;
+		auto writer = TGAWriter::Open(WriterName, W, H, params, IMAGEORIGIN::TOP_LEFT, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		// uneven batches, the last one short.
+		for (uint16 y = 0; y < H; y += 7)
+		{
+			uint16 count = (uint16)(H - y < 7 ? H - y : 7);
+			ASSERT_EQUAL(writer->WriteRows(&image[(addressable)y * W], count, &terr), true);
+			ASSERT_ERRORCODE_NONE(terr);
+		}
+		ASSERT_EQUAL(writer->GetRowsWritten(), H);
+
+		ASSERT_EQUAL(writer->Close(&terr), true);
+		ASSERT_ERRORCODE_NONE(terr);
+		TGAWriter::Free(writer);
+
+		auto tga = TGAFile::Alloc(image.data(), W, H, params, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+		auto loaded = TGAFile::Alloc(WriterName, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+
+		ASSERT_EQUAL(loaded->GetHeader()->IMAGE_DESCRIPTOR.IMAGE_ORIGIN, IMAGEORIGIN::TOP_LEFT);
+
+		auto a = tga->GetImageRGBA(nullptr, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+		auto b = loaded->GetImageRGBA(nullptr, &terr);
+		ASSERT_ERRORCODE_NONE(terr);
+		ASSERT_EQUAL(a->size(), b->size());
+		ASSERT_EQUAL(memcmp(a->rawat(0), b->rawat(0), a->size() * sizeof(RGBA8888)), 0);
+
+		// every row starts where the scan line table says it does.
+		auto table = loaded->GetScanLineTable();
+		if (!table) { UNKNOWN_ERROR; }
+		ASSERT_EQUAL(table[0], sizeof(structs::Header));
+		if (!params.RunLengthEncode)
+			ASSERT_EQUAL(table[H - 1], sizeof(structs::Header) + (uint32)(H - 1) * W * 4);
+
+		ManagedArray<RGBA8888>::Free(a);
+		ManagedArray<RGBA8888>::Free(b);
+		TGAFile::Free(loaded);
+		TGAFile::Free(tga);
+	}
+
+	return 0;
+}
+
+int test_stream()
+{
+	auto image = make_image();
+	auto params = Parameters::BGRA32_RLE_STRAIGHT_ALPHA();
+	params.InputFormat = PIXELFORMATS::BGRA8888;
+	params.TGA2File = false;
+
+	ERRORCODE terr = ERRORCODE::NONE;
+	std::ostringstream stream(std::ios::binary);
+	auto writer = TGAWriter::Open(stream, W, H, params, IMAGEORIGIN::TOP_LEFT, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(writer->WriteRows(image.data(), H, &terr), true);
+	ASSERT_EQUAL(writer->Close(&terr), true);
+	ASSERT_ERRORCODE_NONE(terr);
+	TGAWriter::Free(writer);
+
+	writer = TGAWriter::Open(WriterName, W, H, params, IMAGEORIGIN::TOP_LEFT, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+	ASSERT_EQUAL(writer->WriteRows(image.data(), H, &terr), true);
+	ASSERT_EQUAL(writer->Close(&terr), true);
+	TGAWriter::Free(writer);
+
+	auto file = read_file(WriterName);
+	auto str = stream.str();
+	ASSERT_EQUAL(str.size(), file.size());
+	ASSERT_EQUAL(memcmp(str.data(), file.data(), file.size()), 0);
+
+	return 0;
+}
+
+int test_errors()
+{
+	auto image = make_image();
+	auto params = Parameters::BGR24_RLE();
+	params.InputFormat = PIXELFORMATS::BGRA8888;
+
+	ERRORCODE terr = ERRORCODE::NONE;
+	ASSERT_EQUAL(TGAWriter::Open(WriterName, W, H, params, IMAGEORIGIN::TOP_RIGHT, &terr), nullptr);
+	ASSERT_EQUAL(terr, ERRORCODE::INVALID_OPERATION);
+	ASSERT_EQUAL(TGAWriter::Open(WriterName, 3, H, params, IMAGEORIGIN::TOP_LEFT, &terr), nullptr);
+	ASSERT_EQUAL(terr, ERRORCODE::INDEX_OUT_OF_RANGE);
+
+	auto writer = TGAWriter::Open(WriterName, W, H, params, IMAGEORIGIN::TOP_LEFT, &terr);
+	ASSERT_ERRORCODE_NONE(terr);
+
+	ASSERT_EQUAL(writer->WriteRows(image.data(), H - 1, &terr), true);
+	ASSERT_EQUAL(writer->Close(&terr), false);
+	ASSERT_EQUAL(terr, ERRORCODE::INVALID_OPERATION);
+
+	ASSERT_EQUAL(writer->WriteRows(image.data(), 2, &terr), false);
+	ASSERT_EQUAL(terr, ERRORCODE::INDEX_OUT_OF_RANGE);
+	ASSERT_EQUAL(writer->GetRowsWritten(), H - 1);
+
+	ASSERT_EQUAL(writer->WriteRows(image.data(), 1, &terr), true);
+	ASSERT_EQUAL(writer->Close(&terr), true);
+	ASSERT_EQUAL(writer->Close(&terr), false);
+	ASSERT_EQUAL(terr, ERRORCODE::REDUNDANT_OPERATION);
+	TGAWriter::Free(writer);
+
+	return 0;
+}
+
+int main()
+{
+	int r = test_matches_alloc() | test_top_left() | test_stream() | test_errors();
+	remove(WriterName);
+	return r;
+}
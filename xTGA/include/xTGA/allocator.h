@@ -0,0 +1,225 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// @file allocator.h
+/// @brief Controls where the library allocates its buffers from.
+//==============================================================================
+
+#ifndef XTGA_ALLOCATOR_H__
+#define XTGA_ALLOCATOR_H__
+
+#include "xTGA/api.h"
+#include "xTGA/types.h"
+
+namespace xtga
+{
+	namespace memory
+	{
+		constexpr addressable DefaultAlignment = 64;		// the alignment of every buffer unless asked otherwise.
+
+		/**
+		* @struct Allocator
+		* @brief an application provided allocator. Every buffer the library hands out or works in (image data,
+		* color maps, scratch space, ...) is allocated from the allocator in effect on the calling thread,
+		* small bookkeeping objects are not. A buffer remembers the allocator it came from, so it can be freed
+		* after the allocator in effect has changed (the allocator itself must outlive it).
+		*/
+		struct Allocator
+		{
+			void* (*Allocate)(addressable size, addressable alignment, void* userdata);	/*!< Returns 'size' bytes aligned to 'alignment' (a power of two), or nullptr. */
+			void (*Free)(void* ptr, void* userdata);										/*!< Frees a block returned by Allocate. */
+			void* UserData;																	/*!< Passed back to Allocate and Free. */
+		};
+
+		/**
+		* @struct AllocationStats
+		* @brief counts the buffers the library allocated, across every allocator and thread.
+		*/
+		struct AllocationStats
+		{
+			uint64 Allocations;				/*!< The number of buffers allocated. */
+			uint64 Frees;					/*!< The number of buffers freed. */
+			uint64 BytesAllocated;			/*!< The bytes requested across every allocation. */
+			uint64 BytesInUse;				/*!< The bytes held by buffers that were not freed yet. */
+			uint64 PeakBytesInUse;			/*!< The most bytes in use at once since the last ResetStats(). */
+			uint64 HugePageAllocations;		/*!< The number of buffers mapped with huge pages (see SetHugePageOptions()). */
+		};
+
+		/**
+		* @struct HugePageOptions
+		* @brief lets large buffers (e.g. a decoded 16K texture) be mapped directly, 2MB aligned and advised as
+		* transparent huge pages, which takes a fault (and a TLB entry) per 2MB rather than per 4KB. Freed
+		* mappings are released to the OS with MADV_DONTNEED but kept, up to 'CacheBytes', so the next large
+		* buffer reuses the mapping instead of mapping a new one. Linux only, ignored elsewhere.
+		*/
+		struct HugePageOptions
+		{
+			addressable Threshold;		/*!< Buffers of at least this many bytes are mapped with huge pages, 0 disables it. */
+			addressable CacheBytes;		/*!< The most bytes of released mappings kept for reuse. */
+		};
+
+		//----------------------------------------------------------------------------------------------------
+		/// Sets the allocator used by every thread that has no allocator of its own. Must not be called while
+		/// another thread is inside the library.
+		/// @param[in] allocator			The allocator (copied), or nullptr to go back to the default (aligned malloc).
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI void SetAllocator(const Allocator* allocator);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Sets the allocator used by calls made on the calling thread, including the parallel work those
+		/// calls hand to other threads.
+		/// @param[in] allocator			The allocator (copied), or nullptr to go back to the global one.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI void SetThreadAllocator(const Allocator* allocator);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Sets how large buffers are allocated while the default allocator is in effect, buffers from an
+		/// application allocator are never huge page mapped. Must not be called while another thread is
+		/// inside the library.
+		/// @param[in] options				The options (copied), or nullptr to disable huge pages and unmap
+		///									every cached mapping.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI void SetHugePageOptions(const HugePageOptions* options);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the allocator in effect on the calling thread.
+		/// @return Allocator				The thread's allocator if it has one, the global one otherwise.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI Allocator GetAllocator();
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the calling thread's own allocator.
+		/// @param[out] allocator			Receives the allocator (can be nullptr).
+		/// @return bool					False if the thread uses the global allocator.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI bool GetThreadAllocator(Allocator* allocator);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Allocates a buffer from the allocator in effect on the calling thread. Buffers handed to the
+		/// library to own (e.g. with ManagedArray::Adopt()) must come from here.
+		/// @param[in] size					The size of the buffer (in bytes).
+		/// @param[in] alignment			The alignment of the buffer (a power of two).
+		/// @return void*					The buffer (or nullptr if the allocator failed).
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI void* Allocate(addressable size, addressable alignment = DefaultAlignment);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Allocates a zeroed buffer, as Allocate().
+		/// @param[in] size					The size of the buffer (in bytes).
+		/// @param[in] alignment			The alignment of the buffer (a power of two).
+		/// @return void*					The buffer (or nullptr if the allocator failed).
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI void* AllocateZeroed(addressable size, addressable alignment = DefaultAlignment);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Resizes a buffer, keeping its contents up to the smaller of the two sizes. The new buffer comes from
+		/// the allocator in effect on the calling thread.
+		/// @param[in] ptr					The buffer (or nullptr to allocate a new one).
+		/// @param[in] size					The new size of the buffer (in bytes).
+		/// @return void*					The resized buffer (or nullptr if the allocator failed, 'ptr' is kept).
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI void* Reallocate(void* ptr, addressable size);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Frees a buffer allocated by the library or with Allocate(), through the allocator it came from.
+		/// @param[in] ptr					The buffer (can be nullptr).
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI void Free(void* ptr);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the allocation counters.
+		/// @return AllocationStats			The counters.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI AllocationStats GetStats();
+
+		//----------------------------------------------------------------------------------------------------
+		/// Zeroes the allocation counters, BytesInUse is kept and becomes the new peak.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI void ResetStats();
+
+		/**
+		* @brief sets the calling thread's allocator for the lifetime of the object, and restores the previous
+		* one when it goes out of scope.
+		*/
+		class ScopedAllocator
+		{
+		public:
+			XTGAAPI ScopedAllocator(const Allocator& allocator);
+			XTGAAPI ~ScopedAllocator();
+
+		private:
+			ScopedAllocator(const ScopedAllocator&) = delete;
+			ScopedAllocator& operator=(const ScopedAllocator&) = delete;
+
+			Allocator _Previous;
+			bool _HadPrevious;
+		};
+
+		/**
+		* @brief a bump allocator for short lived buffers. Memory is carved out of large blocks (taken from
+		* a parent allocator) and only given back all at once, by Reset() or when the arena is freed, so
+		* allocating is a pointer increment and freeing does nothing. Thread safe.
+		*/
+		class Arena
+		{
+		public:
+			//----------------------------------------------------------------------------------------------------
+			/// Allocates a new Arena.
+			/// @param[in] blockSize			The size of the blocks taken from the parent (in bytes), larger
+			///									requests get a block of their own.
+			/// @param[in] parent				The allocator blocks come from, nullptr for the default (aligned malloc).
+			/// @return Arena*					The created arena.
+			//----------------------------------------------------------------------------------------------------
+			XTGAAPI static Arena* Alloc(addressable blockSize = 1 << 20, const Allocator* parent = nullptr);
+
+			//----------------------------------------------------------------------------------------------------
+			/// Frees the supplied Arena object, and every block it holds, and sets its pointer to nullptr.
+			/// @param[in] obj					The Arena object to free.
+			//----------------------------------------------------------------------------------------------------
+			XTGAAPI static void Free(Arena*& obj);
+
+			//----------------------------------------------------------------------------------------------------
+			/// Returns an allocator that allocates from the arena, e.g. for SetThreadAllocator().
+			/// @return Allocator				The allocator, valid for the lifetime of the arena.
+			//----------------------------------------------------------------------------------------------------
+			XTGAAPI Allocator GetAllocator();
+
+			//----------------------------------------------------------------------------------------------------
+			/// Makes every block available again. Buffers allocated from the arena must no longer be in use.
+			/// The blocks are kept, so an arena reset between frames stops allocating once it is warm.
+			//----------------------------------------------------------------------------------------------------
+			XTGAAPI void Reset();
+
+			//----------------------------------------------------------------------------------------------------
+			/// Returns the number of bytes handed out since the last Reset().
+			/// @return addressable				The number of bytes (alignment padding included).
+			//----------------------------------------------------------------------------------------------------
+			XTGAAPI addressable GetUsed() const;
+
+			//----------------------------------------------------------------------------------------------------
+			/// Returns the number of bytes held in blocks.
+			/// @return addressable				The number of bytes.
+			//----------------------------------------------------------------------------------------------------
+			XTGAAPI addressable GetReserved() const;
+
+			//==================================================================================================
+			/// INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL
+			//==================================================================================================
+
+		private:
+			Arena();
+			virtual ~Arena() = default;
+			Arena(const Arena&) = delete;
+			Arena(const Arena&&) = delete;
+			Arena& operator=(const Arena&) = delete;
+			Arena& operator=(const Arena&&) = delete;
+
+			class __ArenaImpl;
+			__ArenaImpl* _impl;
+		};
+	}
+}
+
+#endif // !XTGA_ALLOCATOR_H__
@@ -0,0 +1,75 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// @file decode_context.h
+/// @brief Defines the DecodeContext class, scratch memory kept between decodes.
+//==============================================================================
+
+#ifndef XTGA_DECODE_CONTEXT_H__
+#define XTGA_DECODE_CONTEXT_H__
+
+#include "xTGA/api.h"
+#include "xTGA/types.h"
+
+namespace xtga
+{
+	class TGAFile;
+
+	/**
+	* @brief the intermediate buffers a decode needs (e.g. the run-length decoded pixels), kept between calls
+	* to TGAFile::DecodeImageRGBA(). Buffers only ever grow, to the largest image decoded, so once a context
+	* is warm decoding doesn't allocate and touches no new pages. A context must only be used by one thread
+	* at a time, keep one per worker thread.
+	*/
+	class DecodeContext
+	{
+	public:
+		//----------------------------------------------------------------------------------------------------
+		/// Allocates a new, empty, DecodeContext.
+		/// @return DecodeContext*			The created context.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI static DecodeContext* Alloc();
+
+		//----------------------------------------------------------------------------------------------------
+		/// Frees the supplied DecodeContext object, and its buffers, and sets its pointer to nullptr.
+		/// @param[in] obj					The DecodeContext object to free.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI static void Free(DecodeContext*& obj);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the number of bytes the context holds on to.
+		/// @return addressable				The number of bytes.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI addressable GetReserved() const;
+
+		//----------------------------------------------------------------------------------------------------
+		/// Frees the buffers the context holds, e.g. after decoding an unusually large image. They are
+		/// allocated again by the next decode that needs them.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI void Trim();
+
+		//==================================================================================================
+		/// INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL
+		//==================================================================================================
+
+	private:
+		friend class TGAFile;
+
+		DecodeContext();
+		virtual ~DecodeContext() = default;
+		DecodeContext(const DecodeContext&) = delete;
+		DecodeContext(const DecodeContext&&) = delete;
+		DecodeContext& operator=(const DecodeContext&) = delete;
+		DecodeContext& operator=(const DecodeContext&&) = delete;
+
+		// returns the scratch buffer, grown to at least 'size' bytes (its contents are not kept).
+		void* Reserve(addressable size);
+
+		class __DecodeContextImpl;
+		__DecodeContextImpl* _impl;
+	};
+}
+
+#endif // !XTGA_DECODE_CONTEXT_H__
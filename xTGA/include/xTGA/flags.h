@@ -55,6 +55,42 @@ namespace xtga
 			STRAIGHT								= 0x03,			/*!< The data in the alpha channel is a valid straight alpha. */
 			PREMULTIPLIED						= 0x04			/*!< The data in the alpha channel is a valid premultiplied alpha. */
 		};
+
+		/**
+		* @enum QUANTIZER
+		* @brief a strongly typed enum describing the algorithm used to build a forced color map.
+		*/
+		enum class QUANTIZER : uchar
+		{
+			MEDIAN_CUT	= 0x00,			/*!< Weighted median cut over the unique colors. */
+			OCTREE			= 0x01,			/*!< Octree reduction, a single streaming pass over the image (fastest). */
+			WU					= 0x02			/*!< Wu's variance minimising cuts (best quality). */
+		};
+
+		/**
+		* @enum MIPFILTER
+		* @brief a strongly typed enum describing how each level of a mip chain is averaged from the one above it.
+		*/
+		enum class MIPFILTER : uchar
+		{
+			BOX										= 0x00,			/*!< The plain average of each 2x2 block (fastest). */
+			GAMMA									= 0x01,			/*!< Colors are averaged in linear light, decoded from and encoded back to sRGB. */
+			PREMULTIPLIED					= 0x02,			/*!< Colors are weighted by their alpha, so transparent pixels don't bleed into opaque ones. */
+			GAMMA_PREMULTIPLIED		= 0x03			/*!< Both GAMMA and PREMULTIPLIED. */
+		};
+
+		/**
+		* @enum BUFFERMODE
+		* @brief a strongly typed enum describing what TGAFile::Alloc() does with the buffer it is given. ADOPT and
+		* BORROW only skip the conversion when the input format is the output format and the image is neither
+		* color mapped nor run-length encoded, the rows are then stored as given with a top left origin.
+		*/
+		enum class BUFFERMODE : uchar
+		{
+			COPY		= 0x00,			/*!< The pixels are converted into a buffer of the file's own, the caller keeps theirs. */
+			ADOPT		= 0x01,			/*!< The file takes ownership of the buffer (allocated with malloc) and frees it, once Alloc() succeeds. */
+			BORROW	= 0x02			/*!< The file references the buffer, which must outlive it. It is never written to, edits work on a copy. */
+		};
 	}
 }
 
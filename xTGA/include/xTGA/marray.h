@@ -32,12 +32,23 @@ namespace xtga
 		//----------------------------------------------------------------------------------------------------
 		/// Allocates a new ManagedArray of type 'T' with 'size' elements while taking ownership of an exiting array.
 		/// @tparam T					The type of data the array contains.
-		/// @param[in] data				The exiting array, the new object takes ownership of it and will handle deallocation.
+		/// @param[in] data				The exiting array (allocated with malloc()), the new object takes ownership of it and will
+		///								handle deallocation.
 		/// @param[in] size				The number of elements the array contains.
 		/// @return ManagedArray<T>*	The created managed array.
 		//----------------------------------------------------------------------------------------------------
 		XTGAAPI static ManagedArray* Alloc(T* data, addressable size);
 
+		//----------------------------------------------------------------------------------------------------
+		/// Allocates a new ManagedArray of type 'T' with 'size' elements while taking ownership of an array
+		/// allocated with memory::Allocate(), which is later released with memory::Free().
+		/// @tparam T					The type of data the array contains.
+		/// @param[in] data				The exiting array, the new object takes ownership of it and will handle deallocation.
+		/// @param[in] size				The number of elements the array contains.
+		/// @return ManagedArray<T>*	The created managed array.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI static ManagedArray* Adopt(T* data, addressable size);
+
 		//----------------------------------------------------------------------------------------------------
 		/// Frees the given object.
 		/// @tparam T					The type of data the array contains.
@@ -45,6 +56,15 @@ namespace xtga
 		//----------------------------------------------------------------------------------------------------
 		XTGAAPI static void Free(ManagedArray*& obj);
 
+		//----------------------------------------------------------------------------------------------------
+		/// Frees the given object but not its data, which is handed over to the caller.
+		/// @tparam T					The type of data the array contains.
+		/// @param[in,out] obj			The object to free, set to nullptr.
+		/// @return T*					The data, free it with memory::Free() (or adopt it, see PixelBuffer::Adopt()). An array
+		///								given to Alloc(data, size) is first copied to a buffer from memory::Allocate().
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI static T* Release(ManagedArray*& obj);
+
 		//----------------------------------------------------------------------------------------------------
 		/// Returns the element at 'index' [editable].
 		/// @tparam T					The type of data the array contains.
@@ -71,6 +91,13 @@ namespace xtga
 		//----------------------------------------------------------------------------------------------------
 		XTGAAPI void* rawat(addressable index, ERRORCODE* error = nullptr);
 
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the first element, the elements are contiguous.
+		/// @tparam T					The type of data the array contains.
+		/// @return T*					The first element [editable].
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI T* data();
+
 		//----------------------------------------------------------------------------------------------------
 		/// Returns the size of the array.
 		/// @return addressable			The size of the array.
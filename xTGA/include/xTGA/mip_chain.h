@@ -0,0 +1,112 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// @file mip_chain.h
+/// @brief Defines the MipChain class, every mip level of an image in one buffer.
+//==============================================================================
+
+#ifndef XTGA_MIP_CHAIN_H__
+#define XTGA_MIP_CHAIN_H__
+
+#include "xTGA/api.h"
+#include "xTGA/error.h"
+#include "xTGA/flags.h"
+#include "xTGA/pixelformats.h"
+#include "xTGA/types.h"
+
+namespace xtga
+{
+	class TGAFile;
+
+	/**
+	* @struct MipLevel
+	* @brief describes where one level of a MipChain lives in its buffer. Rows are tightly packed, top left
+	* pixel first.
+	*/
+	struct MipLevel
+	{
+		addressable Offset;				/*!< The offset of the level from the start of the buffer (in bytes, a multiple of 16). */
+		addressable Size;					/*!< The size of the level (in bytes). */
+		uint16 Width;							/*!< The width of the level (in pixels). */
+		uint16 Height;						/*!< The height of the level (in pixels). */
+	};
+
+	/**
+	* @brief every mip level of an image, from the full size image down to 1x1, stored one after the other in
+	* a single buffer so that the whole chain can be uploaded in one go. Created with TGAFile::GenerateMipChain().
+	*/
+	class MipChain
+	{
+	public:
+		//----------------------------------------------------------------------------------------------------
+		/// Frees the supplied MipChain object and sets its pointer to nullptr.
+		/// @param[in] obj					The MipChain object to free.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI static void Free(MipChain*& obj);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the buffer holding every level.
+		/// @return const void*				The buffer, GetSize() bytes long.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI const void* GetData() const;
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the size of the buffer holding every level.
+		/// @return addressable				The size of the buffer (in bytes).
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI addressable GetSize() const;
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the pixel format of every level.
+		/// @return PIXELFORMATS			The pixel format.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI pixelformats::PIXELFORMATS GetFormat() const;
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the number of levels, level 0 being the full size image and the last one 1x1.
+		/// @return uint16					The number of levels.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI uint16 GetLevelCount() const;
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the position and size of a level.
+		/// @param[in] index				The index of the level.
+		/// @param[out] error				Holds the error/status code (can be nullptr).
+		/// @return const MipLevel*			The level (or nullptr if the index is out of range).
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI const MipLevel* GetLevel(uint16 index, ERRORCODE* error = nullptr) const;
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the pixels of a level, GetData() + GetLevel(index)->Offset.
+		/// @param[in] index				The index of the level.
+		/// @param[out] error				Holds the error/status code (can be nullptr).
+		/// @return const void*				The pixels (or nullptr if the index is out of range).
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI const void* GetLevelData(uint16 index, ERRORCODE* error = nullptr) const;
+
+		//==================================================================================================
+		/// INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL
+		//==================================================================================================
+
+	private:
+		friend class TGAFile;
+
+		MipChain();
+		virtual ~MipChain() = default;
+		MipChain(const MipChain&) = delete;
+		MipChain(const MipChain&&) = delete;
+		MipChain& operator=(const MipChain&) = delete;
+		MipChain& operator=(const MipChain&&) = delete;
+
+		// builds the chain from an RGBA image, top left pixel first. 'weighted' weights colors by their alpha.
+		static MipChain* Build(const pixelformats::RGBA8888* image, uint16 width, uint16 height, pixelformats::PIXELFORMATS format,
+			bool gamma, bool weighted, ERRORCODE* error);
+
+		class __MipChainImpl;
+		__MipChainImpl* _impl;
+	};
+}
+
+#endif // !XTGA_MIP_CHAIN_H__
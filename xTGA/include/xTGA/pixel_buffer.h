@@ -0,0 +1,171 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// @file pixel_buffer.h
+/// @brief Defines the PixelBuffer class, a typed and aligned pixel container.
+//==============================================================================
+
+#ifndef XTGA_PIXEL_BUFFER_H__
+#define XTGA_PIXEL_BUFFER_H__
+
+#include "xTGA/allocator.h"
+#include "xTGA/error.h"
+#include "xTGA/marray.h"
+#include "xTGA/types.h"
+
+namespace xtga
+{
+	/**
+	* @brief a contiguous array of 'T' that owns its buffer. Unlike ManagedArray it lives on the stack (so it
+	* costs a single allocation), is always typed, and every accessor is inline, so loops over data() or
+	* begin()/end() can be vectorised. Buffers come from memory::Allocate() and are aligned to
+	* memory::DefaultAlignment, release() hands one over to be freed with memory::Free().
+	* @tparam T						The type of pixel the buffer contains.
+	*/
+	template <class T>
+	class PixelBuffer
+	{
+	public:
+		typedef T value_type;
+		typedef T* iterator;
+		typedef const T* const_iterator;
+
+		//----------------------------------------------------------------------------------------------------
+		/// Constructs an empty buffer, it doesn't allocate.
+		//----------------------------------------------------------------------------------------------------
+		PixelBuffer() : _Data(nullptr), _Size(0) {}
+
+		//----------------------------------------------------------------------------------------------------
+		/// Constructs a buffer of 'size' uninitialised elements.
+		/// @param[in] size				The number of elements.
+		//----------------------------------------------------------------------------------------------------
+		explicit PixelBuffer(addressable size) : _Data(nullptr), _Size(0)
+		{
+			resize(size);
+		}
+
+		//----------------------------------------------------------------------------------------------------
+		/// Constructs a buffer that takes ownership of an existing array.
+		/// @param[in] data				The array (allocated with memory::Allocate()).
+		/// @param[in] size				The number of elements the array contains.
+		//----------------------------------------------------------------------------------------------------
+		PixelBuffer(T* data, addressable size) : _Data(data), _Size(data ? size : 0) {}
+
+		PixelBuffer(PixelBuffer&& other) : _Data(other._Data), _Size(other._Size)
+		{
+			other._Data = nullptr;
+			other._Size = 0;
+		}
+
+		PixelBuffer& operator=(PixelBuffer&& other)
+		{
+			if (this != &other)
+			{
+				memory::Free(_Data);
+				_Data = other._Data;
+				_Size = other._Size;
+				other._Data = nullptr;
+				other._Size = 0;
+			}
+			return *this;
+		}
+
+		~PixelBuffer()
+		{
+			memory::Free(_Data);
+		}
+
+		//----------------------------------------------------------------------------------------------------
+		/// Takes the buffer of a ManagedArray and frees the array object, so nothing is copied. Arrays of
+		/// IPixel (e.g. from TGAFile::GetImage()) are adopted as the type their PIXELFORMATS names.
+		/// @tparam U					The type of data the array contains.
+		/// @param[in,out] arr			The array, set to nullptr.
+		/// @return PixelBuffer<T>		The buffer, empty if 'arr' was nullptr.
+		//----------------------------------------------------------------------------------------------------
+		template <class U>
+		static PixelBuffer Adopt(ManagedArray<U>*& arr)
+		{
+			if (!arr)
+				return PixelBuffer();
+
+			const addressable size = arr->size();
+			return PixelBuffer((T*)ManagedArray<U>::Release(arr), size);
+		}
+
+		//----------------------------------------------------------------------------------------------------
+		/// Changes the number of elements, the contents are not kept. The buffer is only reallocated when the
+		/// size changes, so refilling a buffer of the same size doesn't allocate.
+		/// @param[in] size				The new number of elements.
+		/// @return bool				False if the allocation failed (the buffer is then empty).
+		//----------------------------------------------------------------------------------------------------
+		bool resize(addressable size)
+		{
+			if (size == _Size)
+				return true;
+
+			memory::Free(_Data);
+			_Data = size ? (T*)memory::Allocate(sizeof(T) * size) : nullptr;
+			_Size = _Data ? size : 0;
+			return _Size == size;
+		}
+
+		//----------------------------------------------------------------------------------------------------
+		/// Hands the buffer over to the caller, who must free it with memory::Free(). The buffer is left empty.
+		/// @return T*					The buffer (can be nullptr).
+		//----------------------------------------------------------------------------------------------------
+		T* release()
+		{
+			T* rval = _Data;
+			_Data = nullptr;
+			_Size = 0;
+			return rval;
+		}
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the element at 'index' [editable].
+		/// @param[in] index			The index of the element.
+		/// @param[out] error			The error/status code. Can be nullptr.
+		/// @return T&					The returned element [editable]. If index is out of range the first item is returned.
+		//----------------------------------------------------------------------------------------------------
+		T& at(addressable index, ERRORCODE* error = nullptr)
+		{
+			if (index >= _Size)
+			{
+				if (error) *error = ERRORCODE::INDEX_OUT_OF_RANGE;
+				return *_Data;
+			}
+
+			if (error) *error = ERRORCODE::NONE;
+			return _Data[index];
+		}
+
+		T& operator[](addressable index) { return _Data[index]; }					/*!< Unchecked access. */
+		const T& operator[](addressable index) const { return _Data[index]; }		/*!< Unchecked access. */
+
+		T* data() { return _Data; }													/*!< The first element. */
+		const T* data() const { return _Data; }										/*!< The first element. */
+		addressable size() const { return _Size; }									/*!< The number of elements. */
+		addressable bytes() const { return _Size * sizeof(T); }						/*!< The size of the buffer (in bytes). */
+		bool empty() const { return _Size == 0; }									/*!< True if there are no elements. */
+
+		iterator begin() { return _Data; }
+		iterator end() { return _Data + _Size; }
+		const_iterator begin() const { return _Data; }
+		const_iterator end() const { return _Data + _Size; }
+
+		//==================================================================================================
+		/// INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL
+		//==================================================================================================
+
+	private:
+		PixelBuffer(const PixelBuffer&) = delete;
+		PixelBuffer& operator=(const PixelBuffer&) = delete;
+
+		T* _Data;
+		addressable _Size;
+	};
+}
+
+#endif // !XTGA_PIXEL_BUFFER_H__
@@ -0,0 +1,144 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// @file shared_palette.h
+/// @brief Defines the SharedPalette class, one color map applied to many images.
+//==============================================================================
+
+#ifndef XTGA_SHARED_PALETTE_H__
+#define XTGA_SHARED_PALETTE_H__
+
+#include "xTGA/api.h"
+#include "xTGA/error.h"
+#include "xTGA/flags.h"
+#include "xTGA/tga_file.h"
+#include "xTGA/types.h"
+
+namespace xtga
+{
+	/**
+	* @brief a color map that is built once (over a set of images, or supplied by the caller) and then applied
+	* to any number of images with TGAFile::ApplyPalette() or Parameters::Palette, e.g. the frames of an
+	* animation or a batch of sprites. Mapping goes through a lookup table that is built once per palette,
+	* so applying it costs O(pixels) per image. If an update threshold is set, an image that the palette
+	* represents worse than the threshold updates the palette before it is applied. Every method but
+	* GetColorMap() is thread safe, images applied concurrently are mapped one after the other.
+	*/
+	class SharedPalette
+	{
+	public:
+		//----------------------------------------------------------------------------------------------------
+		/// Allocates a new SharedPalette built over a set of images.
+		/// @param[in] buffers				The image buffers (BGRA5551/BGR888/BGRA8888, matching 'depth').
+		/// @param[in] lengths				The number of pixels in each image.
+		/// @param[in] count				The number of images.
+		/// @param[in] depth				The bits per pixel of the images (must be 16/24/32).
+		/// @param[in] quantizer			The quantizer to use, OCTREE and WU work on a histogram of every image,
+		///									MEDIAN_CUT on every (or every sampled) pixel at once.
+		/// @param[in] refinement			The number of k-means iterations run on the palette, 0 for none.
+		/// @param[in] samples				The number of pixels (across every image) MEDIAN_CUT and refinement
+		///									work on, 0 or >= the pixel count uses every pixel.
+		/// @param[out] error				Holds the error/status code (can be nullptr).
+		/// @return SharedPalette*			The created palette (or nullptr if an error occured).
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI static SharedPalette* Build(const void* const* buffers, const addressable* lengths, uint32 count, uchar depth,
+			flags::QUANTIZER quantizer = flags::QUANTIZER::WU, uchar refinement = 0, uint32 samples = 0, ERRORCODE* error = nullptr);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Allocates a new SharedPalette from an existing color map.
+		/// @param[in] colormap				The color map (BGRA5551/BGR888/BGRA8888, matching 'depth'), it is copied.
+		/// @param[in] length				The number of entries in the color map (1-256).
+		/// @param[in] depth				The bits per pixel of the color map (must be 16/24/32).
+		/// @param[out] error				Holds the error/status code (can be nullptr).
+		/// @return SharedPalette*			The created palette (or nullptr if an error occured).
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI static SharedPalette* Alloc(const void* colormap, uint16 length, uchar depth, ERRORCODE* error = nullptr);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Frees the supplied SharedPalette object and sets its pointer to nullptr.
+		/// @param[in] obj					The SharedPalette object to free.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI static void Free(SharedPalette*& obj);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the current color map. It is rewritten in place when the palette is updated, so it can only
+		/// be read while no other thread updates the palette or applies it to an image (use CopyColorMap()).
+		/// @return const void*				The color map (of GetDepth() bits per entry).
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI const void* GetColorMap() const;
+
+		//----------------------------------------------------------------------------------------------------
+		/// Copies the current color map, the copy is consistent even while other threads update the palette.
+		/// @param[out] out					Receives the color map, room for 256 entries of GetDepth() bits.
+		/// @param[out] revision			Receives the revision the copy was taken at (can be nullptr).
+		/// @return uint16					The number of entries copied (1-256).
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI uint16 CopyColorMap(void* out, uint32* revision = nullptr) const;
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the number of entries in the current color map.
+		/// @return uint16					The number of entries (1-256).
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI uint16 GetLength() const;
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the bits per pixel of the palette, images must be of the same depth to use it.
+		/// @return uchar					16, 24 or 32.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI uchar GetDepth() const;
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the number of times the palette has been updated, images applied with different
+		/// revisions don't share the same color map.
+		/// @return uint32					The revision, 0 until the first update.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI uint32 GetRevision() const;
+
+		//----------------------------------------------------------------------------------------------------
+		/// Sets the error past which applying an image updates the palette first (see ColorMapStats for the
+		/// unit, 0 disables updates, which is the default).
+		/// @param[in] threshold			The error threshold.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI void SetUpdateThreshold(double threshold);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the error past which applying an image updates the palette first, 0 if disabled.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI double GetUpdateThreshold() const;
+
+		//----------------------------------------------------------------------------------------------------
+		/// Updates the palette to also cover an image. The histogram of the image is added to the histogram
+		/// the palette was built from and the palette is rebuilt from it (with WU if it was built with
+		/// MEDIAN_CUT or supplied by the caller, in which case the histogram starts out empty).
+		/// @param[in] buffer				The image buffer (of the palette's depth).
+		/// @param[in] length				The number of pixels in the image.
+		/// @param[out] error				Holds the error/status code (can be nullptr).
+		/// @return bool					True if the palette was updated.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI bool Update(const void* buffer, addressable length, ERRORCODE* error = nullptr);
+
+		//==================================================================================================
+		/// INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL
+		//==================================================================================================
+
+	private:
+		friend class TGAFile;
+
+		SharedPalette();
+		virtual ~SharedPalette() = default;
+		SharedPalette(const SharedPalette&) = delete;
+		SharedPalette(const SharedPalette&&) = delete;
+		SharedPalette& operator=(const SharedPalette&) = delete;
+		SharedPalette& operator=(const SharedPalette&&) = delete;
+
+		// maps an image to the palette (updating it first if needed), returns a copy of the color map used.
+		bool Apply(const void* buffer, addressable length, uchar*& indices, void*& ColorMap, uint16& Size, ColorMapStats& stats, ERRORCODE* error);
+
+		class __SharedPaletteImpl;
+		__SharedPaletteImpl* _impl;
+	};
+}
+
+#endif // !XTGA_SHARED_PALETTE_H__
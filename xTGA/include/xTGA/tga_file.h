@@ -12,13 +12,21 @@
 
 #include "xTGA/api.h"
 #include "xTGA/error.h"
+#include "xTGA/flags.h"
 #include "xTGA/marray.h"
+#include "xTGA/pixel_buffer.h"
 #include "xTGA/pixelformats.h"
 #include "xTGA/structures.h"
 #include "xTGA/types.h"
 
+#include <vector>
+
 namespace xtga
 {
+	class DecodeContext;
+	class MipChain;
+	class SharedPalette;
+
 	/**
 	* @brief essentially a settings object, the static functions create a basic Parameters object with the described
 	* output pixel format, from there you can simply modify the InputFormat + any additional options.
@@ -54,6 +62,12 @@ namespace xtga
 		bool TGA2File														= true;																		/*!< The file should be TGA 2.0 */
 		bool UseThumbnailImage									= false;																	/*!< Whether or not to generate a thumbnail image. REQUIRES TGA 2.0 */
 		bool RunLengthEncode										= true;																		/*!< Whether or not to use run-length encoding to save space. */
+		flags::QUANTIZER Quantizer							= flags::QUANTIZER::MEDIAN_CUT;						/*!< The quantizer used when a color map is forced (see TGAFile::GenerateColorMap). */
+		uchar QuantizerRefinement								= 0;																			/*!< The number of k-means iterations run on a forced color map, 0 for none. */
+		uint32 QuantizerSampleSize							= 0;																			/*!< Build forced color maps from this many sampled pixels rather than every pixel, 0 for none. */
+		SharedPalette* Palette									= nullptr;																/*!< If set (and UseColorMap is true) the image is mapped to this palette instead of getting its own color map, see TGAFile::ApplyPalette(). */
+		flags::IMAGEORIGIN Origin								= flags::IMAGEORIGIN::BOTTOM_LEFT;				/*!< The order rows are stored in, BOTTOM_LEFT or TOP_LEFT. TOP_LEFT keeps the order of the input so rows aren't flipped when encoding or decoding. */
+		flags::BUFFERMODE BufferMode						= flags::BUFFERMODE::COPY;								/*!< What TGAFile::Alloc() does with the input buffer, adopting or borrowing it skips the conversion when the input is already in the output format. */
 
 		XTGAAPI pixelformats::PIXELFORMATS GetOutputFormat() const;												/*!< Returns the target output format. */
 
@@ -63,6 +77,27 @@ namespace xtga
 		Parameters() = default;
 	};
 
+	/**
+	* @struct ColorMapStats
+	* @brief describes how closely a forced color map represents its image. Errors are the mean squared error
+	* per channel on an 8-bit scale, over R, G, B and for 32-bit images A.
+	*/
+	struct ColorMapStats
+	{
+		uint64 Pixels;						/*!< The number of pixels in the image. */
+		uint64 Samples;						/*!< The number of pixels the color map was built from (Pixels if it wasn't sampled). */
+		double ImageError;				/*!< The error over every pixel of the image. */
+		double SampleError;				/*!< The error over the sampled pixels only, mapped the same way as the image. */
+		double SamplingError;			/*!< ImageError - SampleError, the error added by the sample not representing the whole image. */
+	};
+
+	//----------------------------------------------------------------------------------------------------
+	/// A per-color function for TGAFile::TransformColors(), it edits the color in place.
+	/// @param[in,out] color			The color to transform.
+	/// @param[in] userdata				The userdata given to TransformColors().
+	//----------------------------------------------------------------------------------------------------
+	typedef void (*ColorTransformFunc)(pixelformats::RGBA8888& color, void* userdata);
+
 	class TGAFile
 	{
 	public:
@@ -77,7 +112,8 @@ namespace xtga
 		//----------------------------------------------------------------------------------------------------
 		/// Allocates a new TGAFile from an existing image buffer. You can edit further details that the config
 		/// doesn't supply from the generated file if needed. Keep in mind you can create illegal combos doing
-		/// this, so be sure to follow the TGA specifications.
+		/// this, so be sure to follow the TGA specifications. See Parameters::BufferMode to adopt or borrow the
+		/// buffer rather than copy it.
 		/// @param[in] buffer				The image buffer to use. First pixel must be the top-left pixel.
 		/// @param[in] width				The width of the image (in pixels).
 		/// @param[in] height				The height of the image (in pixels).
@@ -94,13 +130,22 @@ namespace xtga
 		XTGAAPI static void Free(TGAFile*& obj);
 
 		//----------------------------------------------------------------------------------------------------
-		/// Saves the current file to disk.
+		/// Saves the current file to disk, serialised with SaveToMemory() and written in a single call.
 		/// @param[in] filename				The filename/path to save the image to (suffix not added automatically).
 		/// @param[out] error				Holds the error/status code (can be nullptr).
 		/// @return bool					True if the file was successfully saved.
 		//----------------------------------------------------------------------------------------------------
 		XTGAAPI bool SaveFile(const char* filename, ERRORCODE* error = nullptr);
 
+		//----------------------------------------------------------------------------------------------------
+		/// Serialises the current file into memory, byte for byte what SaveFile() writes to disk. The layout
+		/// of the whole file is worked out first and every section is copied into 'buffer' once.
+		/// @param[out] buffer				Receives the file, resized to fit it.
+		/// @param[out] error				Holds the error/status code (can be nullptr).
+		/// @return bool					True if the file was successfully serialised.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI bool SaveToMemory(std::vector<uchar>& buffer, ERRORCODE* error = nullptr);
+
 		//----------------------------------------------------------------------------------------------------
 		/// Returns the Image ID (or nullptr if it does not exist).
 		/// @return uchar const *			The Image ID or nullptr.
@@ -125,15 +170,54 @@ namespace xtga
 		/// Generates a color map for the image (if the required space for a color map exceeds the space that
 		/// not including it uses, or if the image already contains a color map, the color map will not be generated).
 		/// @param[in] force			If true a color map will be generated even if it won't perfectly represent
-		///								the input data, this is done using the "median cut" algorithm (weighted).
+		///								the input data, this is done using the quantizer the file was created
+		///								with (Parameters::Quantizer), "median cut" (weighted) by default.
 		/// @param[out] error			Holds the error/status code (can be nullptr).
 		/// @return bool				True if the color map was generated.
 		//----------------------------------------------------------------------------------------------------
 		XTGAAPI bool GenerateColorMap(bool force = false, ERRORCODE* error = nullptr);
 
+		//----------------------------------------------------------------------------------------------------
+		/// Generates a color map for the image with the given quantizer (always forced, images with 256 or
+		/// fewer colors still get an exact color map).
+		/// @param[in] quantizer		The quantizer to use, OCTREE is the fastest, WU gives the best quality.
+		/// @param[in] refinement		The number of k-means iterations run on the color map, 0 for none.
+		/// @param[out] error			Holds the error/status code (can be nullptr).
+		/// @return bool				True if the color map was generated.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI bool GenerateColorMap(flags::QUANTIZER quantizer, uchar refinement = 0, ERRORCODE* error = nullptr);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Generates a color map for the image from a sample of its pixels, then maps every pixel to it. For
+		/// very large images this makes building the color map cost O(samples) rather than O(pixels).
+		/// @param[in] quantizer		The quantizer to use, OCTREE is the fastest, WU gives the best quality.
+		/// @param[in] refinement		The number of k-means iterations run on the color map (over the sample), 0 for none.
+		/// @param[in] samples			The number of pixels to sample, 0 or >= the pixel count uses every pixel.
+		/// @param[out] error			Holds the error/status code (can be nullptr).
+		/// @return bool				True if the color map was generated, see GetColorMapStats() for its error.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI bool GenerateColorMap(flags::QUANTIZER quantizer, uchar refinement, uint32 samples, ERRORCODE* error = nullptr);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns how closely the color map generated by GenerateColorMap() represents the image.
+		/// @return const ColorMapStats*	The stats, or nullptr if this object never generated a color map.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI const ColorMapStats* GetColorMapStats();
+
+		//----------------------------------------------------------------------------------------------------
+		/// Gives the image a color map from a shared palette, mapping every pixel to its closest entry. The
+		/// palette may update first if its update threshold is set (see SharedPalette), the file keeps a copy
+		/// of the color map it was given.
+		/// @param[in] palette			The palette to use, must be of the same depth as the image.
+		/// @param[out] error			Holds the error/status code (can be nullptr).
+		/// @return bool				True if the color map was applied, see GetColorMapStats() for its error.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI bool ApplyPalette(SharedPalette* palette, ERRORCODE* error = nullptr);
+
 		//----------------------------------------------------------------------------------------------------
 		/// Returns the raw image data. Only edit this if you know exactly what you're doing!!!
 		/// Use GetImage to return the decoded image data, and GetImageRGBA to get the image in RGBA8888 format.
+		/// For a borrowed buffer (see Parameters::BufferMode) this is the caller's buffer.
 		/// @return void*				The image data.
 		//----------------------------------------------------------------------------------------------------
 		XTGAAPI void* GetImageData();
@@ -260,7 +344,9 @@ namespace xtga
 		XTGAAPI const void* GetThumbnailData();
 
 		//----------------------------------------------------------------------------------------------------
-		/// Generates a thumbnail using bicubic interpolation.
+		/// Generates a thumbnail using bicubic interpolation (area averaging for reductions of 4x or more).
+		/// Run-length encoded images are averaged a row at a time straight from their packets for such
+		/// reductions, so the full size image is never held in memory.
 		/// NOTE: Will convert the image to TGA 2.0 if it is not already.
 		/// @param[in] LongEdgeLength		The length in pixels of the longest edge of the image (recommended <=64).
 		/// @param[out] error				The status/error code of the image, will indicate clipping (can be nullptr).
@@ -298,6 +384,39 @@ namespace xtga
 		//----------------------------------------------------------------------------------------------------
 		XTGAAPI void GenerateColorCorrectionTable();
 
+		//----------------------------------------------------------------------------------------------------
+		/// Runs a function on every color of the image (e.g. to swap channels or tint). Color mapped images only
+		/// have their color map entries transformed, at O(entries) cost, the indices (and their RLE packets) are
+		/// left untouched. Other images are transformed pixel by pixel in place, RLE images packet by packet,
+		/// so their size never changes. The thumbnail is transformed along with the image.
+		/// @param[in] func					The function to run, it is called from the calling thread only.
+		/// @param[in] userdata				Passed back to func on every call (can be nullptr).
+		/// @param[out] error				Holds the error/status code (can be nullptr).
+		/// @return bool					True if the image was transformed.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI bool TransformColors(ColorTransformFunc func, void* userdata = nullptr, ERRORCODE* error = nullptr);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Remaps each channel of every color through a lookup table (e.g. gamma, levels or a tint), as
+		/// TransformColors() but large true color images are split across threads.
+		/// @param[in] R					256 entries mapping old red values to new ones (nullptr leaves red as is).
+		/// @param[in] G					256 entries mapping old green values to new ones (nullptr leaves green as is).
+		/// @param[in] B					256 entries mapping old blue values to new ones (nullptr leaves blue as is).
+		/// @param[in] A					256 entries mapping old alpha values to new ones (nullptr leaves alpha as is).
+		/// @param[out] error				Holds the error/status code (can be nullptr).
+		/// @return bool					True if the image was transformed.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI bool TransformChannels(const uchar* R, const uchar* G, const uchar* B, const uchar* A, ERRORCODE* error = nullptr);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Bakes the color correction table into the colors of the image (see TransformChannels()) and then
+		/// resets the table so that each value maps to its original value.
+		/// @param[out] error				Holds the error/status code (can be nullptr), INVALID_OPERATION if the
+		///									file has no color correction table.
+		/// @return bool					True if the table was applied.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI bool ApplyColorCorrectionTable(ERRORCODE* error = nullptr);
+
 		//----------------------------------------------------------------------------------------------------
 		/// Returns the image in its original pixel format (reordered for top left to be first pixel).
 		/// @param[out] PixelType			The type of pixel that was grabbed (can be nullptr).
@@ -315,6 +434,60 @@ namespace xtga
 		//----------------------------------------------------------------------------------------------------
 		XTGAAPI ManagedArray<pixelformats::RGBA8888>* GetImageRGBA(flags::ALPHATYPE* AlphaType = nullptr, ERRORCODE* error = nullptr);
 
+		//----------------------------------------------------------------------------------------------------
+		/// Decodes the image in RGBA8888 format, top left pixel first, into a caller provided buffer. Reordering
+		/// and conversion happen in a single pass, the only intermediate is the run-length decoded image which
+		/// is kept in 'context'. Decoding with a warm context (and a reused 'out') doesn't allocate.
+		/// @param[out] out					Receives the image, GetWidth() x GetHeight() pixels.
+		/// @param[in,out] context			The scratch memory to use, nullptr allocates it for this call only.
+		/// @param[out] AlphaType			The type of alpha in the image (can be nullptr).
+		/// @param[out] error				Contains the error/status code (can be nullptr).
+		/// @return bool					True if the image was decoded.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI bool DecodeImageRGBA(pixelformats::RGBA8888* out, DecodeContext* context = nullptr, flags::ALPHATYPE* AlphaType = nullptr,
+			ERRORCODE* error = nullptr);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Decodes the image in RGBA8888 format, top left pixel first, into 'out'. 'out' is only resized when
+		/// its size differs from the image's, so a buffer (and context) reused across images of the same size
+		/// doesn't allocate.
+		/// @param[in,out] out				Receives the image.
+		/// @param[in,out] context			The scratch memory to use, nullptr allocates it for this call only.
+		/// @param[out] AlphaType			The type of alpha in the image (can be nullptr).
+		/// @param[out] error				Contains the error/status code (can be nullptr).
+		/// @return bool					True if the image was decoded.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI bool DecodeImageRGBA(PixelBuffer<pixelformats::RGBA8888>& out, DecodeContext* context = nullptr, flags::ALPHATYPE* AlphaType = nullptr,
+			ERRORCODE* error = nullptr);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the color map indices of a color mapped image (reordered for top left to be first pixel,
+		/// RLE decoded) without expanding them, along with a copy of its color map.
+		/// @param[out] Palette				Receives the color map, COLOR_MAP_LENGTH entries (can be nullptr). Use Free() when done.
+		/// @param[out] PaletteType			The pixel format of the color map entries (can be nullptr).
+		/// @param[out] AlphaType			The type of alpha in the image (can be nullptr).
+		/// @param[out] error				Contains the error/status code (can be nullptr), INVALID_OPERATION if the
+		///									image isn't color mapped.
+		/// @return ManagedArray<uchar>*	One index per pixel (or nullptr if an error occured). Use Free() when done.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI ManagedArray<uchar>* GetIndexedImage(ManagedArray<pixelformats::IPixel>** Palette = nullptr, pixelformats::PIXELFORMATS* PaletteType = nullptr,
+			flags::ALPHATYPE* AlphaType = nullptr, ERRORCODE* error = nullptr);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Builds every mip level of the image, from the full size image down to 1x1, into one buffer. Each
+		/// level halves the size of the one before it (rounding down) and is averaged from its 2x2 blocks
+		/// (SSE2/NEON where available). Levels are built a few at a time in tiles, so most of them are
+		/// reduced from cache, and the tiles are split across threads when the image is large enough.
+		/// @param[in] filter				How the 2x2 blocks are averaged. PREMULTIPLIED has no effect on images
+		///									with no alpha or whose alpha is already premultiplied.
+		/// @param[in] outFormat			The pixel format of the levels, one of RGBA8888, BGRA8888, RGB888,
+		///									BGR888, IA88 or I8.
+		/// @param[out] error				Contains the error/status code (can be nullptr).
+		/// @return MipChain*				The mip chain (or nullptr if an error occured). Use MipChain::Free() when done.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI MipChain* GenerateMipChain(flags::MIPFILTER filter = flags::MIPFILTER::BOX,
+			pixelformats::PIXELFORMATS outFormat = pixelformats::PIXELFORMATS::RGBA8888, ERRORCODE* error = nullptr);
+
 		//----------------------------------------------------------------------------------------------------
 		/// Converts the current image to TGA 2.0 file format.
 		/// Will simply do nothing if the file is already of TGA 2.0 format.
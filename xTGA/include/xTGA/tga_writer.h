@@ -0,0 +1,105 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// @file tga_writer.h
+/// @brief Defines the TGAWriter class, writes a TGA file one row at a time.
+//==============================================================================
+
+#ifndef XTGA_TGA_WRITER_H__
+#define XTGA_TGA_WRITER_H__
+
+#include "xTGA/api.h"
+#include "xTGA/error.h"
+#include "xTGA/flags.h"
+#include "xTGA/tga_file.h"
+#include "xTGA/types.h"
+
+#include <iosfwd>
+
+namespace xtga
+{
+	/**
+	* @brief writes a TGA file as its rows arrive. Each row is converted to the output format, run-length
+	* encoded if asked for, and written straight away, so only one row of the image is ever held in memory.
+	* The footer, extension area, and scan line table of a TGA 2.0 file are written by Close(). Color maps and
+	* thumbnails need the whole image, Parameters::UseColorMap and Parameters::UseThumbnailImage are ignored.
+	*/
+	class TGAWriter
+	{
+	public:
+		//----------------------------------------------------------------------------------------------------
+		/// Creates a file and writes its header.
+		/// @param[in] filename				The filename/path to save the image to (suffix not added automatically).
+		/// @param[in] width				The width of the image (in pixels).
+		/// @param[in] height				The height of the image (in pixels).
+		/// @param[in] config				The output format and options, InputFormat is the format of the rows.
+		/// @param[in] origin				BOTTOM_LEFT if the rows are written bottom to top, TOP_LEFT if top to bottom.
+		/// @param[out] error				Holds the error/status code (can be nullptr).
+		/// @return TGAWriter*				The created TGAWriter (or nullptr if an error occured).
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI static TGAWriter* Open(const char* filename, uint16 width, uint16 height, const Parameters& config,
+			flags::IMAGEORIGIN origin = flags::IMAGEORIGIN::BOTTOM_LEFT, ERRORCODE* error = nullptr);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Writes the header to a stream, the image follows it from the stream's current position. The
+		/// stream must outlive the TGAWriter.
+		/// @param[in,out] stream			The binary stream to write the image to.
+		/// @param[in] width				The width of the image (in pixels).
+		/// @param[in] height				The height of the image (in pixels).
+		/// @param[in] config				The output format and options, InputFormat is the format of the rows.
+		/// @param[in] origin				BOTTOM_LEFT if the rows are written bottom to top, TOP_LEFT if top to bottom.
+		/// @param[out] error				Holds the error/status code (can be nullptr).
+		/// @return TGAWriter*				The created TGAWriter (or nullptr if an error occured).
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI static TGAWriter* Open(std::ostream& stream, uint16 width, uint16 height, const Parameters& config,
+			flags::IMAGEORIGIN origin = flags::IMAGEORIGIN::BOTTOM_LEFT, ERRORCODE* error = nullptr);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Frees the supplied TGAWriter object and sets its pointer to nullptr. A writer that wasn't closed
+		/// leaves an incomplete image behind.
+		/// @param[in] obj					The TGAWriter object to free.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI static void Free(TGAWriter*& obj);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Converts, encodes, and writes the next rows of the image.
+		/// @param[in] rows					'count' tightly packed rows of InputFormat pixels, in the order set by 'origin'.
+		/// @param[in] count				The number of rows.
+		/// @param[out] error				Holds the error/status code (can be nullptr).
+		/// @return bool					True if the rows were written.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI bool WriteRows(const void* rows, uint16 count, ERRORCODE* error = nullptr);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the number of rows written so far.
+		/// @return uint16					The number of rows.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI uint16 GetRowsWritten() const;
+
+		//----------------------------------------------------------------------------------------------------
+		/// Finishes the file once every row has been written, adding the TGA 2.0 sections if asked for.
+		/// @param[out] error				Holds the error/status code (can be nullptr).
+		/// @return bool					True if the file was completed.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI bool Close(ERRORCODE* error = nullptr);
+
+		//==================================================================================================
+		/// INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL - INTERNAL
+		//==================================================================================================
+
+	private:
+		TGAWriter();
+		virtual ~TGAWriter() = default;
+		TGAWriter(const TGAWriter&) = delete;
+		TGAWriter(const TGAWriter&&) = delete;
+		TGAWriter& operator=(const TGAWriter&) = delete;
+		TGAWriter& operator=(const TGAWriter&&) = delete;
+
+		class __TGAWriterImpl;
+		__TGAWriterImpl* _impl;
+	};
+}
+
+#endif // !XTGA_TGA_WRITER_H__
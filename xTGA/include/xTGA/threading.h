@@ -0,0 +1,120 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// @file threading.h
+/// @brief Controls how the library runs its parallel work.
+//==============================================================================
+
+#ifndef XTGA_THREADING_H__
+#define XTGA_THREADING_H__
+
+#include "xTGA/api.h"
+#include "xTGA/types.h"
+
+namespace xtga
+{
+	namespace threading
+	{
+		/**
+		* @enum WORKLOAD
+		* @brief a strongly typed enum describing the kinds of work the cost model makes decisions for.
+		*/
+		enum class WORKLOAD : uchar
+		{
+			COLORMAP_BUILD		= 0x00,			/*!< Collecting the unique colors of an image. */
+			COLORMAP_SEARCH		= 0x01,			/*!< Matching pixels to a color map by searching every entry. */
+			COLORMAP_LOOKUP		= 0x02,			/*!< Matching pixels to a color map through a precomputed lattice. */
+			RESAMPLE			= 0x03			/*!< Filtering an image while resizing it, counted in filter taps rather than pixels. */
+		};
+
+		/**
+		* @enum EXECUTION
+		* @brief a strongly typed enum describing how a piece of work is run.
+		*/
+		enum class EXECUTION : uchar
+		{
+			SERIAL		= 0x00,			/*!< On the calling thread with scalar code. */
+			SIMD			= 0x01,			/*!< On the calling thread with vector code. */
+			THREADED	= 0x02			/*!< Split across the thread pool (with vector code where available). */
+		};
+
+		//----------------------------------------------------------------------------------------------------
+		/// A unit of work handed to an executor, call it once for every index in [0, count).
+		/// @param[in] task					The opaque task, pass it back unchanged.
+		/// @param[in] index				The index of the part to run.
+		//----------------------------------------------------------------------------------------------------
+		typedef void (*TaskFunc)(void* task, uint32 index);
+
+		//----------------------------------------------------------------------------------------------------
+		/// An application provided executor. It must call func(task, i) for every i in [0, count), in any
+		/// order and on any threads, and only return once every call has returned.
+		/// @param[in] func					The function to run.
+		/// @param[in] task					The opaque task to pass to func.
+		/// @param[in] count				The number of parts.
+		/// @param[in] userdata				The userdata given to SetExecutor().
+		//----------------------------------------------------------------------------------------------------
+		typedef void (*ExecutorFunc)(TaskFunc func, void* task, uint32 count, void* userdata);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Sets the number of threads the library's pool uses (the calling thread included). The pool is
+		/// persistent and its threads are only created once, on first use. Must not be called while
+		/// another thread is inside the library.
+		/// @param[in] count				The number of threads, 0 uses every hardware thread, 1 disables threading.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI void SetThreadCount(uint32 count);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the number of threads parallel work is split across.
+		/// @return uint32					The number of threads, 1 if threading is disabled.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI uint32 GetThreadCount();
+
+		//----------------------------------------------------------------------------------------------------
+		/// Routes all parallel work through an application provided executor instead of the library's pool.
+		/// Must not be called while another thread is inside the library.
+		/// @param[in] executor				The executor, or nullptr to go back to the library's pool.
+		/// @param[in] userdata				Passed back to the executor on every call.
+		/// @param[in] concurrency			How many parts the executor can run at once, work is split to match.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI void SetExecutor(ExecutorFunc executor, void* userdata = nullptr, uint32 concurrency = 0);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Picks how a piece of work is run from its size. The estimated serial time is compared to the cost
+		/// of handing work to other threads, both of which come from CalibrateCostModel() (or built-in
+		/// defaults if it was never called) unless a threshold was set with SetParallelThreshold().
+		/// @param[in] workload				The kind of work.
+		/// @param[in] pixels				The number of pixels to process.
+		/// @param[in] depth				The bits per pixel of the data (8/15/16/24/32).
+		/// @param[in] entries				The number of color map entries searched per pixel (COLORMAP_SEARCH only).
+		/// @return EXECUTION				How the work should be run.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI EXECUTION ChooseExecution(WORKLOAD workload, addressable pixels, uchar depth, uint16 entries = 256);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Overrides the cost model, work of the given kind is threaded once it reaches 'pixels' pixels.
+		/// @param[in] workload				The kind of work.
+		/// @param[in] pixels				The number of pixels from which work is threaded, 0 goes back to the cost model.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI void SetParallelThreshold(WORKLOAD workload, uint64 pixels);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the number of pixels from which work of the given kind is threaded.
+		/// @param[in] workload				The kind of work.
+		/// @param[in] depth				The bits per pixel of the data (8/15/16/24/32).
+		/// @param[in] entries				The number of color map entries searched per pixel (COLORMAP_SEARCH only).
+		/// @return uint64					The threshold, set or modelled, 0 if work is never threaded (1 thread).
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI uint64 GetParallelThreshold(WORKLOAD workload, uchar depth = 32, uint16 entries = 256);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Times each kind of work and the thread pool's dispatch overhead on this machine with a short
+		/// (a few milliseconds) micro-benchmark, and feeds the results to the cost model. Thresholds set
+		/// through SetParallelThreshold() are kept. Must not be called while another thread is inside the library.
+		//----------------------------------------------------------------------------------------------------
+		XTGAAPI void CalibrateCostModel();
+	}
+}
+
+#endif // !XTGA_THREADING_H__
@@ -10,12 +10,19 @@
 #ifndef XTGA_H__
 #define XTGA_H__
 
+#include "xTGA/allocator.h"
 #include "xTGA/api.h"
+#include "xTGA/decode_context.h"
 #include "xTGA/error.h"
 #include "xTGA/flags.h"
+#include "xTGA/mip_chain.h"
+#include "xTGA/pixel_buffer.h"
 #include "xTGA/pixelformats.h"
+#include "xTGA/shared_palette.h"
 #include "xTGA/structures.h"
 #include "xTGA/tga_file.h"
+#include "xTGA/tga_writer.h"
+#include "xTGA/threading.h"
 #include "xTGA/types.h"
 
 #ifndef XTGA_STATIC
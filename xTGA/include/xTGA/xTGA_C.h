@@ -29,6 +29,11 @@ extern "C" {
 typedef struct xtga_TGAFile xtga_TGAFile;
 typedef struct xtga_Parameters xtga_Parameters;
 typedef struct xtga_ManagedArray xtga_ManagedArray;
+typedef struct xtga_SharedPalette xtga_SharedPalette;
+typedef struct xtga_MipChain xtga_MipChain;
+typedef struct xtga_TGAWriter xtga_TGAWriter;
+typedef struct xtga_Arena xtga_Arena;
+typedef struct xtga_DecodeContext xtga_DecodeContext;
 
 /**
 * @enum xtga_PIXELFORMATS_e
@@ -98,6 +103,75 @@ typedef enum
 	xtga_IMAGETYPE_GRAYSCALE_RLE		= 0x0B			/*!< Run-length encoded Grayscale. */
 } xtga_IMAGETYPE_e;
 
+/**
+* @enum xtga_IMAGEORIGIN_e
+* @brief C-Interface: describes the location of the first pixel in an image.
+*/
+typedef enum
+{
+	xtga_IMAGEORIGIN_BOTTOM_LEFT		= 0x00,			/*!< First pixel goes in the bottom left. */
+	xtga_IMAGEORIGIN_BOTTOM_RIGHT		= 0x01,			/*!< First pixel goes in the bottom right. */
+	xtga_IMAGEORIGIN_TOP_LEFT				= 0x02,			/*!< First pixel goes in the top left. */
+	xtga_IMAGEORIGIN_TOP_RIGHT			= 0x03			/*!< First pixel goes in the top right. */
+} xtga_IMAGEORIGIN_e;
+
+/**
+* @enum xtga_QUANTIZER_e
+* @brief C-Interface: describes the algorithm used to build a forced color map.
+*/
+typedef enum
+{
+	xtga_QUANTIZER_MEDIAN_CUT	= 0x00,			/*!< Weighted median cut over the unique colors. */
+	xtga_QUANTIZER_OCTREE			= 0x01,			/*!< Octree reduction, a single streaming pass over the image (fastest). */
+	xtga_QUANTIZER_WU					= 0x02			/*!< Wu's variance minimising cuts (best quality). */
+} xtga_QUANTIZER_e;
+
+/**
+* @enum xtga_MIPFILTER_e
+* @brief C-Interface: describes how each level of a mip chain is averaged from the one above it.
+*/
+typedef enum
+{
+	xtga_MIPFILTER_BOX										= 0x00,			/*!< The plain average of each 2x2 block (fastest). */
+	xtga_MIPFILTER_GAMMA									= 0x01,			/*!< Colors are averaged in linear light, decoded from and encoded back to sRGB. */
+	xtga_MIPFILTER_PREMULTIPLIED					= 0x02,			/*!< Colors are weighted by their alpha, so transparent pixels don't bleed into opaque ones. */
+	xtga_MIPFILTER_GAMMA_PREMULTIPLIED		= 0x03			/*!< Both GAMMA and PREMULTIPLIED. */
+} xtga_MIPFILTER_e;
+
+/**
+* @enum xtga_BUFFERMODE_e
+* @brief C-Interface: describes what xtga_TGAFile_Alloc_FromBuffer() does with the buffer it is given.
+*/
+typedef enum
+{
+	xtga_BUFFERMODE_COPY		= 0x00,			/*!< The pixels are converted into a buffer of the file's own, the caller keeps theirs. */
+	xtga_BUFFERMODE_ADOPT		= 0x01,			/*!< The file takes ownership of the buffer (allocated with malloc) and frees it, once Alloc succeeds. */
+	xtga_BUFFERMODE_BORROW	= 0x02			/*!< The file references the buffer, which must outlive it. It is never written to, edits work on a copy. */
+} xtga_BUFFERMODE_e;
+
+/**
+* @enum xtga_WORKLOAD_e
+* @brief C-Interface: describes the kinds of work the cost model makes decisions for.
+*/
+typedef enum
+{
+	xtga_WORKLOAD_COLORMAP_BUILD		= 0x00,			/*!< Collecting the unique colors of an image. */
+	xtga_WORKLOAD_COLORMAP_SEARCH		= 0x01,			/*!< Matching pixels to a color map by searching every entry. */
+	xtga_WORKLOAD_COLORMAP_LOOKUP		= 0x02,			/*!< Matching pixels to a color map through a precomputed lattice. */
+	xtga_WORKLOAD_RESAMPLE				= 0x03			/*!< Filtering an image while resizing it, counted in filter taps rather than pixels. */
+} xtga_WORKLOAD_e;
+
+/**
+* @enum xtga_EXECUTION_e
+* @brief C-Interface: describes how a piece of work is run.
+*/
+typedef enum
+{
+	xtga_EXECUTION_SERIAL			= 0x00,			/*!< On the calling thread with scalar code. */
+	xtga_EXECUTION_SIMD				= 0x01,			/*!< On the calling thread with vector code. */
+	xtga_EXECUTION_THREADED		= 0x02			/*!< Split across the thread pool (with vector code where available). */
+} xtga_EXECUTION_e;
+
 /**
 * @struct xtga_ColorCorrectionEntry_t
 * @brief C-Interface: describes the format of a TGA File color correction entry.
@@ -112,6 +186,33 @@ typedef struct
 	uint16 A;
 } xtga_ColorCorrectionEntry_t;
 
+/**
+* @struct xtga_ColorMapStats_t
+* @brief C-Interface: describes how closely a forced color map represents its image. Errors are the mean squared
+* error per channel on an 8-bit scale, over R, G, B and for 32-bit images A.
+*/
+typedef struct
+{
+	uint64	Pixels;						/*!< The number of pixels in the image. */
+	uint64	Samples;					/*!< The number of pixels the color map was built from (Pixels if it wasn't sampled). */
+	double	ImageError;				/*!< The error over every pixel of the image. */
+	double	SampleError;			/*!< The error over the sampled pixels only, mapped the same way as the image. */
+	double	SamplingError;		/*!< ImageError - SampleError, the error added by the sample not representing the whole image. */
+} xtga_ColorMapStats_t;
+
+/**
+* @struct xtga_MipLevel_t
+* @brief C-Interface: describes where one level of a mip chain lives in its buffer. Rows are tightly packed,
+* top left pixel first.
+*/
+typedef struct
+{
+	addressable	Offset;				/*!< The offset of the level from the start of the buffer (in bytes, a multiple of 16). */
+	addressable	Size;					/*!< The size of the level (in bytes). */
+	uint16			Width;				/*!< The width of the level (in pixels). */
+	uint16			Height;				/*!< The height of the level (in pixels). */
+} xtga_MipLevel_t;
+
 /**
 * @struct xtga_ExtensionArea_t
 * @brief C-Interface: provides metadata extensions the the TGA format.
@@ -148,6 +249,41 @@ typedef struct
 	xtga_ALPHATYPE_e	ALPHATYPE;							/*!< Details the type of alpha the image contains. */
 } xtga_ExtensionArea_t;
 
+/**
+* @struct xtga_Allocator_t
+* @brief C-Interface: an application provided allocator, every buffer the library allocates comes from it.
+*/
+typedef struct
+{
+	void* (*Allocate)(addressable size, addressable alignment, void* userdata);	/*!< Returns 'size' bytes aligned to 'alignment' (a power of two), or NULL. */
+	void (*Free)(void* ptr, void* userdata);										/*!< Frees a block returned by Allocate. */
+	void* UserData;																	/*!< Passed back to Allocate and Free. */
+} xtga_Allocator_t;
+
+/**
+* @struct xtga_AllocationStats_t
+* @brief C-Interface: counts the buffers the library allocated, across every allocator and thread.
+*/
+typedef struct
+{
+	uint64 Allocations;				/*!< The number of buffers allocated. */
+	uint64 Frees;					/*!< The number of buffers freed. */
+	uint64 BytesAllocated;			/*!< The bytes requested across every allocation. */
+	uint64 BytesInUse;				/*!< The bytes held by buffers that were not freed yet. */
+	uint64 PeakBytesInUse;			/*!< The most bytes in use at once since the last xtga_ResetAllocationStats(). */
+	uint64 HugePageAllocations;		/*!< The number of buffers mapped with huge pages (see xtga_SetHugePageOptions()). */
+} xtga_AllocationStats_t;
+
+/**
+* @struct xtga_HugePageOptions_t
+* @brief C-Interface: maps large buffers with transparent huge pages, see xtga::memory::HugePageOptions.
+*/
+typedef struct
+{
+	addressable Threshold;		/*!< Buffers of at least this many bytes are mapped with huge pages, 0 disables it. */
+	addressable CacheBytes;		/*!< The most bytes of released mappings kept for reuse. */
+} xtga_HugePageOptions_t;
+
 /**
 * @struct xtga_ImageDescriptor_t
 * @brief C-Interface: describes various aspects of the pixel format.
@@ -193,11 +329,173 @@ typedef struct
 XTGAAPI extern uint16 xtga_WhatVersion();
 
 //----------------------------------------------------------------------------------------------------
-/// Frees the given memory array.
+/// Frees the given memory array, allocated by the library or with xtga_Allocate().
 /// @param[in,out] mem				The memory to free.
 //----------------------------------------------------------------------------------------------------
 XTGAAPI void xtga_FreeMem(void** mem);
 
+//----------------------------------------------------------------------------------------------------
+/// A unit of work handed to an executor, call it once for every index in [0, count).
+/// @param[in] task					The opaque task, pass it back unchanged.
+/// @param[in] index				The index of the part to run.
+//----------------------------------------------------------------------------------------------------
+typedef void (*xtga_TaskFunc)(void* task, uint32 index);
+
+//----------------------------------------------------------------------------------------------------
+/// An application provided executor. It must call func(task, i) for every i in [0, count), in any
+/// order and on any threads, and only return once every call has returned.
+/// @param[in] func					The function to run.
+/// @param[in] task					The opaque task to pass to func.
+/// @param[in] count				The number of parts.
+/// @param[in] userdata				The userdata given to xtga_SetExecutor().
+//----------------------------------------------------------------------------------------------------
+typedef void (*xtga_ExecutorFunc)(xtga_TaskFunc func, void* task, uint32 count, void* userdata);
+
+//----------------------------------------------------------------------------------------------------
+/// Sets the number of threads the library's pool uses (the calling thread included).
+/// Must not be called while another thread is inside the library.
+/// @param[in] count				The number of threads, 0 uses every hardware thread, 1 disables threading.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_SetThreadCount(uint32 count);
+
+//----------------------------------------------------------------------------------------------------
+/// Returns the number of threads parallel work is split across.
+/// @return uint32					The number of threads, 1 if threading is disabled.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI uint32 xtga_GetThreadCount();
+
+//----------------------------------------------------------------------------------------------------
+/// Routes all parallel work through an application provided executor instead of the library's pool.
+/// Must not be called while another thread is inside the library.
+/// @param[in] executor				The executor, or NULL to go back to the library's pool.
+/// @param[in] userdata				Passed back to the executor on every call.
+/// @param[in] concurrency			How many parts the executor can run at once (0 for every hardware thread).
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_SetExecutor(xtga_ExecutorFunc executor, void* userdata, uint32 concurrency);
+
+//----------------------------------------------------------------------------------------------------
+/// Picks how a piece of work is run from its size, see xtga_CalibrateCostModel().
+/// @param[in] workload				The kind of work.
+/// @param[in] pixels				The number of pixels to process.
+/// @param[in] depth				The bits per pixel of the data (8/15/16/24/32).
+/// @param[in] entries				The number of color map entries searched per pixel (COLORMAP_SEARCH only).
+/// @return xtga_EXECUTION_e		How the work should be run.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI xtga_EXECUTION_e xtga_ChooseExecution(xtga_WORKLOAD_e workload, addressable pixels, uchar depth, uint16 entries);
+
+//----------------------------------------------------------------------------------------------------
+/// Overrides the cost model, work of the given kind is threaded once it reaches 'pixels' pixels.
+/// @param[in] workload				The kind of work.
+/// @param[in] pixels				The number of pixels from which work is threaded, 0 goes back to the cost model.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_SetParallelThreshold(xtga_WORKLOAD_e workload, uint64 pixels);
+
+//----------------------------------------------------------------------------------------------------
+/// Returns the number of pixels from which work of the given kind is threaded.
+/// @param[in] workload				The kind of work.
+/// @param[in] depth				The bits per pixel of the data (8/15/16/24/32).
+/// @param[in] entries				The number of color map entries searched per pixel (COLORMAP_SEARCH only).
+/// @return uint64					The threshold, set or modelled, 0 if work is never threaded (1 thread).
+//----------------------------------------------------------------------------------------------------
+XTGAAPI uint64 xtga_GetParallelThreshold(xtga_WORKLOAD_e workload, uchar depth, uint16 entries);
+
+//----------------------------------------------------------------------------------------------------
+/// Times each kind of work and the thread pool's dispatch overhead on this machine and feeds the
+/// results to the cost model. Thresholds set through xtga_SetParallelThreshold() are kept.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_CalibrateCostModel();
+
+//----------------------------------------------------------------------------------------------------
+/// Sets the allocator used by every thread that has no allocator of its own.
+/// Must not be called while another thread is inside the library.
+/// @param[in] allocator			The allocator (copied), or NULL to go back to the default (aligned malloc).
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_SetAllocator(const xtga_Allocator_t* allocator);
+
+//----------------------------------------------------------------------------------------------------
+/// Sets the allocator used by calls made on the calling thread, including the parallel work those
+/// calls hand to other threads.
+/// @param[in] allocator			The allocator (copied), or NULL to go back to the global one.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_SetThreadAllocator(const xtga_Allocator_t* allocator);
+
+//----------------------------------------------------------------------------------------------------
+/// Sets how large buffers are allocated while the default allocator is in effect (Linux only).
+/// @param[in] options				The options (copied), or NULL to disable huge pages.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_SetHugePageOptions(const xtga_HugePageOptions_t* options);
+
+//----------------------------------------------------------------------------------------------------
+/// Allocates a buffer from the allocator in effect on the calling thread, free it with xtga_FreeMem().
+/// @param[in] size					The size of the buffer (in bytes).
+/// @param[in] alignment			The alignment of the buffer (a power of two, 0 for the default of 64).
+/// @return void*					The buffer (or NULL if the allocator failed).
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void* xtga_Allocate(addressable size, addressable alignment);
+
+//----------------------------------------------------------------------------------------------------
+/// Returns the allocation counters.
+/// @param[out] stats				Receives the counters.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_GetAllocationStats(xtga_AllocationStats_t* stats);
+
+//----------------------------------------------------------------------------------------------------
+/// Zeroes the allocation counters, BytesInUse is kept and becomes the new peak.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_ResetAllocationStats();
+
+//----------------------------------------------------------------------------------------------------
+/// Allocates a new bump allocator, see xtga::memory::Arena.
+/// @param[in] blockSize			The size of the blocks taken from the parent (in bytes).
+/// @param[in] parent				The allocator blocks come from, NULL for the default (aligned malloc).
+/// @return xtga_Arena*				The created arena.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI xtga_Arena* xtga_Arena_Alloc(addressable blockSize, const xtga_Allocator_t* parent);
+
+//----------------------------------------------------------------------------------------------------
+/// Frees the supplied Arena object, and every block it holds, and sets its pointer to nullptr.
+/// @param[in,out] obj				The Arena object to free.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_Arena_Free(xtga_Arena** obj);
+
+//----------------------------------------------------------------------------------------------------
+/// Returns an allocator that allocates from the arena, valid for the lifetime of the arena.
+/// @param[in] arena				The arena.
+/// @param[out] allocator			Receives the allocator.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_Arena_GetAllocator(xtga_Arena* arena, xtga_Allocator_t* allocator);
+
+//----------------------------------------------------------------------------------------------------
+/// Makes every block of the arena available again, buffers allocated from it must no longer be in use.
+/// @param[in,out] arena			The arena.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_Arena_Reset(xtga_Arena* arena);
+
+//----------------------------------------------------------------------------------------------------
+/// Allocates a new, empty, decode context, see xtga::DecodeContext.
+/// @return xtga_DecodeContext*		The created context.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI xtga_DecodeContext* xtga_DecodeContext_Alloc();
+
+//----------------------------------------------------------------------------------------------------
+/// Frees the supplied DecodeContext object, and its buffers, and sets its pointer to nullptr.
+/// @param[in,out] obj				The DecodeContext object to free.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_DecodeContext_Free(xtga_DecodeContext** obj);
+
+//----------------------------------------------------------------------------------------------------
+/// Returns the number of bytes the context holds on to.
+/// @param[in] context				The context.
+/// @return addressable				The number of bytes.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI addressable xtga_DecodeContext_GetReserved(xtga_DecodeContext* context);
+
+//----------------------------------------------------------------------------------------------------
+/// Frees the buffers the context holds, they are allocated again by the next decode that needs them.
+/// @param[in,out] context			The context.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_DecodeContext_Trim(xtga_DecodeContext* context);
+
 XTGAAPI xtga_Parameters* xtga_Parameters_BGR24();																				/*!< BGR with 8-bits per primary. */
 XTGAAPI xtga_Parameters* xtga_Parameters_BGR24_RLE();																		/*!< BGR with 8-bits per primary and Run-length encoding. */
 XTGAAPI xtga_Parameters* xtga_Parameters_BGR24_COLORMAPPED();														/*!< BGR with 8-bits per primary and indexed color. */
@@ -263,6 +561,42 @@ XTGAAPI void xtga_Parameters_set_thumbnail(xtga_Parameters* Parameters, bool use
 //----------------------------------------------------------------------------------------------------
 XTGAAPI void xtga_Parameters_set_rle(xtga_Parameters* Parameters, bool userle);
 
+//----------------------------------------------------------------------------------------------------
+/// Sets the quantizer used when a color map is forced.
+/// @param[in,out] Parameters			The object to set the property for.
+/// @param[in] quantizer					The quantizer to use.
+/// @param[in] refinement					The number of k-means iterations run on the color map, 0 for none.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_Parameters_set_quantizer(xtga_Parameters* Parameters, xtga_QUANTIZER_e quantizer, uchar refinement);
+
+//----------------------------------------------------------------------------------------------------
+/// Sets the number of sampled pixels forced color maps are built from.
+/// @param[in,out] Parameters			The object to set the property for.
+/// @param[in] samples						The number of pixels to sample, 0 uses every pixel.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_Parameters_set_quantizer_samples(xtga_Parameters* Parameters, uint32 samples);
+
+//----------------------------------------------------------------------------------------------------
+/// Sets the shared palette images are mapped to when a color map is used.
+/// @param[in,out] Parameters			The object to set the property for.
+/// @param[in] palette						The palette to use, NULL to generate a color map per image.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_Parameters_set_palette(xtga_Parameters* Parameters, xtga_SharedPalette* palette);
+
+//----------------------------------------------------------------------------------------------------
+/// Sets the order rows are stored in.
+/// @param[in,out] Parameters			The object to set the property for.
+/// @param[in] origin							BOTTOM_LEFT, or TOP_LEFT to store rows in the order of the input.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_Parameters_set_origin(xtga_Parameters* Parameters, xtga_IMAGEORIGIN_e origin);
+
+//----------------------------------------------------------------------------------------------------
+/// Sets what xtga_TGAFile_Alloc_FromBuffer() does with the buffer it is given.
+/// @param[in,out] Parameters			The object to set the property for.
+/// @param[in] mode								Copy, adopt, or borrow the buffer.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_Parameters_set_buffer_mode(xtga_Parameters* Parameters, xtga_BUFFERMODE_e mode);
+
 //----------------------------------------------------------------------------------------------------
 /// Allocates a new TGAFile object from the path to a valid TGA file.
 /// @param[in] filename				The filename to load.
@@ -291,7 +625,7 @@ XTGAAPI xtga_TGAFile* xtga_TGAFile_Alloc_FromBuffer(const void* buffer, uint16 w
 XTGAAPI void xtga_TGAFile_Free(xtga_TGAFile** obj);
 
 //----------------------------------------------------------------------------------------------------
-/// Saves the current file to disk.
+/// Saves the current file to disk, serialised in memory first and written in a single call.
 /// @param[in,out] TGAFile			The TGAFile to save.
 /// @param[in] filename				The filename/path to save the image to (suffix not added automatically).
 /// @param[out] error				Holds the error/status code (can be nullptr).
@@ -299,6 +633,14 @@ XTGAAPI void xtga_TGAFile_Free(xtga_TGAFile** obj);
 //----------------------------------------------------------------------------------------------------
 XTGAAPI bool xtga_TGAFile_SaveFile(xtga_TGAFile* TGAFile, const char* filename, xtga_ERRORCODE_e* error);
 
+//----------------------------------------------------------------------------------------------------
+/// Serialises the current file into memory, byte for byte what xtga_TGAFile_SaveFile() writes to disk.
+/// @param[in,out] TGAFile			The TGAFile to serialise.
+/// @param[out] error				Holds the error/status code (can be nullptr).
+/// @return xtga_ManagedArray*		The file's bytes (or nullptr if an error occured). Use xtga_ManagedArray_Free() when done.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI xtga_ManagedArray* xtga_TGAFile_SaveToMemory(xtga_TGAFile* TGAFile, xtga_ERRORCODE_e* error);
+
 //----------------------------------------------------------------------------------------------------
 /// Returns the Image ID (or nullptr if it does not exist).
 /// @param[in,out] TGAFile			The TGAFile to get the image id from.
@@ -333,6 +675,44 @@ XTGAAPI void* xtga_TGAFile_GetColorMap(xtga_TGAFile* TGAFile);
 //----------------------------------------------------------------------------------------------------
 XTGAAPI bool xtga_TGAFile_GenerateColorMap(xtga_TGAFile* TGAFile, bool force, xtga_ERRORCODE_e* error);
 
+//----------------------------------------------------------------------------------------------------
+/// Generates a color map for the image with the given quantizer (always forced, images with 256 or
+/// fewer colors still get an exact color map).
+/// @param[in,out] TGAFile		The TGAFile to generate the color map for.
+/// @param[in] quantizer		The quantizer to use, OCTREE is the fastest, WU gives the best quality.
+/// @param[in] refinement		The number of k-means iterations run on the color map, 0 for none.
+/// @param[out] error			Holds the error/status code (can be nullptr).
+/// @return bool				True if the color map was generated.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI bool xtga_TGAFile_GenerateColorMapQuantized(xtga_TGAFile* TGAFile, xtga_QUANTIZER_e quantizer, uchar refinement, xtga_ERRORCODE_e* error);
+
+//----------------------------------------------------------------------------------------------------
+/// Generates a color map for the image from a sample of its pixels, then maps every pixel to it.
+/// @param[in,out] TGAFile		The TGAFile to generate the color map for.
+/// @param[in] quantizer		The quantizer to use, OCTREE is the fastest, WU gives the best quality.
+/// @param[in] refinement		The number of k-means iterations run on the color map (over the sample), 0 for none.
+/// @param[in] samples			The number of pixels to sample, 0 or >= the pixel count uses every pixel.
+/// @param[out] error			Holds the error/status code (can be nullptr).
+/// @return bool				True if the color map was generated, see xtga_TGAFile_GetColorMapStats() for its error.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI bool xtga_TGAFile_GenerateColorMapSampled(xtga_TGAFile* TGAFile, xtga_QUANTIZER_e quantizer, uchar refinement, uint32 samples, xtga_ERRORCODE_e* error);
+
+//----------------------------------------------------------------------------------------------------
+/// Returns how closely the generated color map represents the image.
+/// @param[in] TGAFile						The TGAFile.
+/// @return const xtga_ColorMapStats_t*		The stats, or NULL if the file never generated a color map.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI const xtga_ColorMapStats_t* xtga_TGAFile_GetColorMapStats(xtga_TGAFile* TGAFile);
+
+//----------------------------------------------------------------------------------------------------
+/// Gives the image a color map from a shared palette, mapping every pixel to its closest entry.
+/// @param[in,out] TGAFile		The TGAFile to apply the palette to.
+/// @param[in] palette			The palette to use, must be of the same depth as the image.
+/// @param[out] error			Holds the error/status code (can be nullptr).
+/// @return bool				True if the color map was applied, see xtga_TGAFile_GetColorMapStats() for its error.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI bool xtga_TGAFile_ApplyPalette(xtga_TGAFile* TGAFile, xtga_SharedPalette* palette, xtga_ERRORCODE_e* error);
+
 //----------------------------------------------------------------------------------------------------
 /// Returns the raw image data. Only edit this if you know exactly what you're doing!!!
 /// @param[in,out] TGAFile		The TGAFile to get the image data from.
@@ -479,7 +859,9 @@ XTGAAPI const uint32* xtga_TGAFile_GetScanLineTable(xtga_TGAFile* TGAFile);
 XTGAAPI const void* xtga_TGAFile_GetThumbnailData(xtga_TGAFile* TGAFile);
 
 //----------------------------------------------------------------------------------------------------
-/// Generates a thumbnail using bicubic interpolation.
+/// Generates a thumbnail using bicubic interpolation (area averaging for reductions of 4x or more).
+/// Run-length encoded images are sampled straight from their packets for such reductions, so the full
+/// size image is never decoded.
 /// NOTE: Will convert the image to TGA 2.0 if it is not already.
 /// @param[in,out] TGAFile			The TGAFile to perform the function on.
 /// @param[in] LongEdgeLength		The length in pixels of the longest edge of the image (recommended <=64).
@@ -522,6 +904,47 @@ XTGAAPI	xtga_ColorCorrectionEntry_t* xtga_TGAFile_GetColorCorrectionTable(xtga_T
 //----------------------------------------------------------------------------------------------------
 XTGAAPI void xtga_TGAFile_GenerateColorCorrectionTable(xtga_TGAFile* TGAFile);
 
+//----------------------------------------------------------------------------------------------------
+/// A per-color function for xtga_TGAFile_TransformColors(), it edits the color in place.
+/// @param[in,out] rgba				The color to transform, 4 bytes in R, G, B, A order.
+/// @param[in] userdata				The userdata given to xtga_TGAFile_TransformColors().
+//----------------------------------------------------------------------------------------------------
+typedef void (*xtga_ColorTransformFunc)(uchar* rgba, void* userdata);
+
+//----------------------------------------------------------------------------------------------------
+/// Runs a function on every color of the image. Color mapped images only have their color map entries
+/// transformed, the indices (and their RLE packets) are left untouched. Other images are transformed
+/// pixel by pixel in place. The thumbnail is transformed along with the image.
+/// @param[in,out] TGAFile			The TGAFile to perform the function on.
+/// @param[in] func					The function to run, it is called from the calling thread only.
+/// @param[in] userdata				Passed back to func on every call (can be nullptr).
+/// @param[out] error				Holds the error/status code (can be nullptr).
+/// @return bool					True if the image was transformed.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI bool xtga_TGAFile_TransformColors(xtga_TGAFile* TGAFile, xtga_ColorTransformFunc func, void* userdata, xtga_ERRORCODE_e* error);
+
+//----------------------------------------------------------------------------------------------------
+/// Remaps each channel of every color through a lookup table (e.g. gamma, levels or a tint), as
+/// xtga_TGAFile_TransformColors() but large true color images are split across threads.
+/// @param[in,out] TGAFile			The TGAFile to perform the function on.
+/// @param[in] R					256 entries mapping old red values to new ones (nullptr leaves red as is).
+/// @param[in] G					256 entries mapping old green values to new ones (nullptr leaves green as is).
+/// @param[in] B					256 entries mapping old blue values to new ones (nullptr leaves blue as is).
+/// @param[in] A					256 entries mapping old alpha values to new ones (nullptr leaves alpha as is).
+/// @param[out] error				Holds the error/status code (can be nullptr).
+/// @return bool					True if the image was transformed.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI bool xtga_TGAFile_TransformChannels(xtga_TGAFile* TGAFile, const uchar* R, const uchar* G, const uchar* B, const uchar* A, xtga_ERRORCODE_e* error);
+
+//----------------------------------------------------------------------------------------------------
+/// Bakes the color correction table into the colors of the image and then resets the table so that each
+/// value maps to its original value.
+/// @param[in,out] TGAFile			The TGAFile to perform the function on.
+/// @param[out] error				Holds the error/status code (can be nullptr).
+/// @return bool					True if the table was applied.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI bool xtga_TGAFile_ApplyColorCorrectionTable(xtga_TGAFile* TGAFile, xtga_ERRORCODE_e* error);
+
 //----------------------------------------------------------------------------------------------------
 /// Returns the image in its original pixel format (reordered for top left to be first pixel).
 /// @param[in,out] TGAFile			The TGAFile to perform the function on.
@@ -532,6 +955,18 @@ XTGAAPI void xtga_TGAFile_GenerateColorCorrectionTable(xtga_TGAFile* TGAFile);
 //----------------------------------------------------------------------------------------------------
 XTGAAPI xtga_ManagedArray* xtga_TGAFile_GetImage(xtga_TGAFile* TGAFile, xtga_PIXELFORMATS_e* PixelType, xtga_ALPHATYPE_e* AlphaType, xtga_ERRORCODE_e* error);
 
+//----------------------------------------------------------------------------------------------------
+/// Returns the color map indices of a color mapped image (reordered for top left to be first pixel,
+/// RLE decoded) without expanding them, along with a copy of its color map.
+/// @param[in,out] TGAFile			The TGAFile to perform the function on.
+/// @param[out] Palette				Receives the color map (can be nullptr). Use xtga_ManagedArray_Free() when done.
+/// @param[out] PaletteType			The pixel format of the color map entries (can be nullptr).
+/// @param[out] AlphaType			The type of alpha in the image (can be nullptr).
+/// @param[out] error				Contains the error/status code (can be nullptr).
+/// @return xtga_ManagedArray*		One uchar index per pixel (or nullptr if an error occured). Use xtga_ManagedArray_Free() when done.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI xtga_ManagedArray* xtga_TGAFile_GetIndexedImage(xtga_TGAFile* TGAFile, xtga_ManagedArray** Palette, xtga_PIXELFORMATS_e* PaletteType, xtga_ALPHATYPE_e* AlphaType, xtga_ERRORCODE_e* error);
+
 //----------------------------------------------------------------------------------------------------
 /// Returns the image in RGBA8888 format with the top left pixel being the first pixel.
 /// @param[in,out] TGAFile			The TGAFile to perform the function on.
@@ -541,6 +976,30 @@ XTGAAPI xtga_ManagedArray* xtga_TGAFile_GetImage(xtga_TGAFile* TGAFile, xtga_PIX
 //----------------------------------------------------------------------------------------------------
 XTGAAPI xtga_ManagedArray* xtga_TGAFile_GetImageRGBA(xtga_TGAFile* TGAFile, xtga_ALPHATYPE_e* AlphaType, xtga_ERRORCODE_e* error);
 
+//----------------------------------------------------------------------------------------------------
+/// Decodes the image in RGBA8888 format, top left pixel first, into a caller provided buffer. Decoding
+/// with a warm context doesn't allocate.
+/// @param[in,out] TGAFile			The TGAFile to perform the function on.
+/// @param[out] out					Receives the image, width x height RGBA8888 pixels.
+/// @param[in,out] context			The scratch memory to use, NULL allocates it for this call only.
+/// @param[out] AlphaType			The type of alpha in the image (can be nullptr).
+/// @param[out] error				Contains the error/status code (can be nullptr).
+/// @return bool					True if the image was decoded.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI bool xtga_TGAFile_DecodeImageRGBA(xtga_TGAFile* TGAFile, void* out, xtga_DecodeContext* context, xtga_ALPHATYPE_e* AlphaType,
+	xtga_ERRORCODE_e* error);
+
+//----------------------------------------------------------------------------------------------------
+/// Builds every mip level of the image, from the full size image down to 1x1, into one buffer. Each
+/// level halves the size of the one before it (rounding down) and is averaged from its 2x2 blocks.
+/// @param[in,out] TGAFile			The TGAFile to perform the function on.
+/// @param[in] filter				How the 2x2 blocks are averaged.
+/// @param[in] outFormat			The pixel format of the levels, one of RGBA8888, BGRA8888, RGB888, BGR888, IA88 or I8.
+/// @param[out] error				Contains the error/status code (can be nullptr).
+/// @return xtga_MipChain*			The mip chain (or nullptr if an error occured). Use xtga_MipChain_Free() when done.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI xtga_MipChain* xtga_TGAFile_GenerateMipChain(xtga_TGAFile* TGAFile, xtga_MIPFILTER_e filter, xtga_PIXELFORMATS_e outFormat, xtga_ERRORCODE_e* error);
+
 //----------------------------------------------------------------------------------------------------
 /// Converts the current image to TGA 2.0 file format.
 /// Will simply do nothing if the file is already of TGA 2.0 format.
@@ -555,6 +1014,13 @@ XTGAAPI void xtga_TGAFile_UpgradeToTGATwo(xtga_TGAFile* TGAFile, xtga_ERRORCODE_
 //----------------------------------------------------------------------------------------------------
 XTGAAPI void xtga_ManagedArray_Free(xtga_ManagedArray** obj);
 
+//----------------------------------------------------------------------------------------------------
+/// Frees the given object but not its data, which is handed over to the caller.
+/// @param[in,out] obj			The object to free, set to nullptr.
+/// @return void*				The data, 64-byte aligned (unless adopted). Use xtga_FreeMem() when done.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void* xtga_ManagedArray_Release(xtga_ManagedArray** obj);
+
 //----------------------------------------------------------------------------------------------------
 /// Returns the element at 'index' [editable].
 /// @param[in,out] marray		The ManagedArray to perform the function on.
@@ -571,6 +1037,168 @@ XTGAAPI void* xtga_ManagedArray_at(xtga_ManagedArray* marray, addressable index,
 //----------------------------------------------------------------------------------------------------
 XTGAAPI addressable xtga_ManagedArray_size(xtga_ManagedArray* marray);
 
+//----------------------------------------------------------------------------------------------------
+/// Allocates a new SharedPalette built over a set of images.
+/// @param[in] buffers				The image buffers (BGRA5551/BGR888/BGRA8888, matching 'depth').
+/// @param[in] lengths				The number of pixels in each image.
+/// @param[in] count				The number of images.
+/// @param[in] depth				The bits per pixel of the images (must be 16/24/32).
+/// @param[in] quantizer			The quantizer to use.
+/// @param[in] refinement			The number of k-means iterations run on the palette, 0 for none.
+/// @param[in] samples				The number of pixels (across every image) MEDIAN_CUT and refinement work on, 0 for all.
+/// @param[out] error				Holds the error/status code (can be nullptr).
+/// @return xtga_SharedPalette*		The created palette (or nullptr if an error occured).
+//----------------------------------------------------------------------------------------------------
+XTGAAPI xtga_SharedPalette* xtga_SharedPalette_Build(const void* const* buffers, const addressable* lengths, uint32 count, uchar depth,
+	xtga_QUANTIZER_e quantizer, uchar refinement, uint32 samples, xtga_ERRORCODE_e* error);
+
+//----------------------------------------------------------------------------------------------------
+/// Allocates a new SharedPalette from an existing color map.
+/// @param[in] colormap				The color map (BGRA5551/BGR888/BGRA8888, matching 'depth'), it is copied.
+/// @param[in] length				The number of entries in the color map (1-256).
+/// @param[in] depth				The bits per pixel of the color map (must be 16/24/32).
+/// @param[out] error				Holds the error/status code (can be nullptr).
+/// @return xtga_SharedPalette*		The created palette (or nullptr if an error occured).
+//----------------------------------------------------------------------------------------------------
+XTGAAPI xtga_SharedPalette* xtga_SharedPalette_Alloc(const void* colormap, uint16 length, uchar depth, xtga_ERRORCODE_e* error);
+
+//----------------------------------------------------------------------------------------------------
+/// Frees the supplied SharedPalette object and sets its pointer to nullptr.
+/// @param[in,out] obj				The SharedPalette object to free.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_SharedPalette_Free(xtga_SharedPalette** obj);
+
+//----------------------------------------------------------------------------------------------------
+/// Returns the current color map. It is rewritten in place when the palette is updated, so it can only
+/// be read while no other thread updates or applies the palette (use xtga_SharedPalette_CopyColorMap()).
+/// @param[in] palette				The palette.
+/// @return const void*				The color map.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI const void* xtga_SharedPalette_GetColorMap(xtga_SharedPalette* palette);
+
+//----------------------------------------------------------------------------------------------------
+/// Copies the current color map, the copy is consistent even while other threads update the palette.
+/// @param[in] palette				The palette.
+/// @param[out] out					Receives the color map, room for 256 entries.
+/// @param[out] revision			Receives the revision the copy was taken at (can be NULL).
+/// @return uint16					The number of entries copied.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI uint16 xtga_SharedPalette_CopyColorMap(xtga_SharedPalette* palette, void* out, uint32* revision);
+
+//----------------------------------------------------------------------------------------------------
+/// Returns the number of entries in the current color map.
+/// @param[in] palette				The palette.
+/// @return uint16					The number of entries (1-256).
+//----------------------------------------------------------------------------------------------------
+XTGAAPI uint16 xtga_SharedPalette_GetLength(xtga_SharedPalette* palette);
+
+//----------------------------------------------------------------------------------------------------
+/// Returns the number of times the palette has been updated.
+/// @param[in] palette				The palette.
+/// @return uint32					The revision, 0 until the first update.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI uint32 xtga_SharedPalette_GetRevision(xtga_SharedPalette* palette);
+
+//----------------------------------------------------------------------------------------------------
+/// Sets the error past which applying an image updates the palette first (0 disables updates).
+/// @param[in,out] palette			The palette.
+/// @param[in] threshold			The error threshold (see xtga_ColorMapStats_t).
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_SharedPalette_SetUpdateThreshold(xtga_SharedPalette* palette, double threshold);
+
+//----------------------------------------------------------------------------------------------------
+/// Updates the palette to also cover an image.
+/// @param[in,out] palette			The palette.
+/// @param[in] buffer				The image buffer (of the palette's depth).
+/// @param[in] length				The number of pixels in the image.
+/// @param[out] error				Holds the error/status code (can be nullptr).
+/// @return bool					True if the palette was updated.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI bool xtga_SharedPalette_Update(xtga_SharedPalette* palette, const void* buffer, addressable length, xtga_ERRORCODE_e* error);
+
+//----------------------------------------------------------------------------------------------------
+/// Frees the supplied MipChain object and sets its pointer to nullptr.
+/// @param[in,out] obj				The MipChain object to free.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_MipChain_Free(xtga_MipChain** obj);
+
+//----------------------------------------------------------------------------------------------------
+/// Returns the buffer holding every level.
+/// @param[in] chain				The mip chain.
+/// @return const void*				The buffer, xtga_MipChain_GetSize() bytes long.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI const void* xtga_MipChain_GetData(xtga_MipChain* chain);
+
+//----------------------------------------------------------------------------------------------------
+/// Returns the size of the buffer holding every level.
+/// @param[in] chain				The mip chain.
+/// @return addressable				The size of the buffer (in bytes).
+//----------------------------------------------------------------------------------------------------
+XTGAAPI addressable xtga_MipChain_GetSize(xtga_MipChain* chain);
+
+//----------------------------------------------------------------------------------------------------
+/// Returns the number of levels, level 0 being the full size image and the last one 1x1.
+/// @param[in] chain				The mip chain.
+/// @return uint16					The number of levels.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI uint16 xtga_MipChain_GetLevelCount(xtga_MipChain* chain);
+
+//----------------------------------------------------------------------------------------------------
+/// Returns the position and size of a level.
+/// @param[in] chain				The mip chain.
+/// @param[in] index				The index of the level.
+/// @param[out] error				Holds the error/status code (can be nullptr).
+/// @return const xtga_MipLevel_t*	The level (or nullptr if the index is out of range).
+//----------------------------------------------------------------------------------------------------
+XTGAAPI const xtga_MipLevel_t* xtga_MipChain_GetLevel(xtga_MipChain* chain, uint16 index, xtga_ERRORCODE_e* error);
+
+//----------------------------------------------------------------------------------------------------
+/// Creates a file to write a TGA image to one row at a time, and writes its header. Each row is converted
+/// and run-length encoded as it arrives, so only one row of the image is ever held in memory. Color maps
+/// and thumbnails need the whole image and are not written.
+/// @param[in] filename				The filename/path to save the image to (suffix not added automatically).
+/// @param[in] width				The width of the image (in pixels).
+/// @param[in] height				The height of the image (in pixels).
+/// @param[in] config				The output format and options, InputFormat is the format of the rows.
+/// @param[in] origin				BOTTOM_LEFT if the rows are written bottom to top, TOP_LEFT if top to bottom.
+/// @param[out] error				Holds the error/status code (can be nullptr).
+/// @return xtga_TGAWriter*			The created writer (or nullptr if an error occured). Use xtga_TGAWriter_Free() when done.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI xtga_TGAWriter* xtga_TGAWriter_Open(const char* filename, uint16 width, uint16 height, const xtga_Parameters* config,
+	xtga_IMAGEORIGIN_e origin, xtga_ERRORCODE_e* error);
+
+//----------------------------------------------------------------------------------------------------
+/// Frees the supplied TGAWriter object and sets its pointer to nullptr. A writer that wasn't closed
+/// leaves an incomplete image behind.
+/// @param[in,out] obj				The TGAWriter object to free.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI void xtga_TGAWriter_Free(xtga_TGAWriter** obj);
+
+//----------------------------------------------------------------------------------------------------
+/// Converts, encodes, and writes the next rows of the image.
+/// @param[in,out] writer			The writer.
+/// @param[in] rows					'count' tightly packed rows of InputFormat pixels, in the order set by 'origin'.
+/// @param[in] count				The number of rows.
+/// @param[out] error				Holds the error/status code (can be nullptr).
+/// @return bool					True if the rows were written.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI bool xtga_TGAWriter_WriteRows(xtga_TGAWriter* writer, const void* rows, uint16 count, xtga_ERRORCODE_e* error);
+
+//----------------------------------------------------------------------------------------------------
+/// Returns the number of rows written so far.
+/// @param[in] writer				The writer.
+/// @return uint16					The number of rows.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI uint16 xtga_TGAWriter_GetRowsWritten(xtga_TGAWriter* writer);
+
+//----------------------------------------------------------------------------------------------------
+/// Finishes the file once every row has been written, adding the TGA 2.0 sections if asked for.
+/// @param[in,out] writer			The writer.
+/// @param[out] error				Holds the error/status code (can be nullptr).
+/// @return bool					True if the file was completed.
+//----------------------------------------------------------------------------------------------------
+XTGAAPI bool xtga_TGAWriter_Close(xtga_TGAWriter* writer, xtga_ERRORCODE_e* error);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,448 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: allocator.cpp
+/// purpose : Implements the library's allocator hooks, counters and the Arena class.
+//==============================================================================
+
+#include "xTGA/allocator.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+#	include <malloc.h>
+#endif
+
+#ifdef __linux__
+#	include <sys/mman.h>
+#endif
+
+namespace
+{
+	using namespace xtga;
+	using namespace xtga::memory;
+
+	constexpr addressable MinAlignment = 16;
+
+	// sits right before every buffer, so that it can be freed through the allocator it came from.
+	struct BlockHeader
+	{
+		void (*Free)(void* ptr, void* userdata);
+		void* UserData;
+		void* Block;
+		addressable Size;
+	};
+
+	void* DefaultAllocate(addressable size, addressable alignment, void*)
+	{
+#ifdef _WIN32
+		return _aligned_malloc(size, alignment);
+#else
+		void* p = nullptr;
+		if (posix_memalign(&p, alignment < sizeof(void*) ? sizeof(void*) : alignment, size) != 0)
+			return nullptr;
+		return p;
+#endif
+	}
+
+	void DefaultFree(void* ptr, void*)
+	{
+#ifdef _WIN32
+		_aligned_free(ptr);
+#else
+		free(ptr);
+#endif
+	}
+
+	const Allocator Default = { DefaultAllocate, DefaultFree, nullptr };
+
+	Allocator gAllocator = Default;
+	thread_local Allocator tAllocator = Default;
+	thread_local bool tHasAllocator = false;
+
+	std::atomic<uint64> gAllocations(0);
+	std::atomic<uint64> gFrees(0);
+	std::atomic<uint64> gBytesAllocated(0);
+	std::atomic<uint64> gBytesInUse(0);
+	std::atomic<uint64> gPeakBytesInUse(0);
+	std::atomic<uint64> gHugePageAllocations(0);
+
+	void CountAllocation(addressable size)
+	{
+		gAllocations.fetch_add(1, std::memory_order_relaxed);
+		gBytesAllocated.fetch_add(size, std::memory_order_relaxed);
+
+		uint64 inUse = gBytesInUse.fetch_add(size, std::memory_order_relaxed) + size;
+		uint64 peak = gPeakBytesInUse.load(std::memory_order_relaxed);
+		while (inUse > peak && !gPeakBytesInUse.compare_exchange_weak(peak, inUse, std::memory_order_relaxed)) {}
+	}
+
+	void CountFree(addressable size)
+	{
+		gFrees.fetch_add(1, std::memory_order_relaxed);
+		gBytesInUse.fetch_sub(size, std::memory_order_relaxed);
+	}
+
+	BlockHeader* HeaderOf(void* ptr)
+	{
+		return (BlockHeader*)ptr - 1;
+	}
+
+	constexpr addressable HugePageSize = 2 << 20;
+
+	HugePageOptions gHugePages = { 0, 0 };
+
+#ifdef __linux__
+	struct Mapping
+	{
+		void* Base;
+		addressable Length;
+	};
+
+	std::mutex gMappingLock;
+	std::vector<Mapping> gMappings;			// released mappings kept for reuse.
+	addressable gMappedBytes = 0;
+
+	// maps at least 'length' bytes (a multiple of HugePageSize), aligned to HugePageSize so every page can
+	// be huge. 'mapped' receives the length of the mapping, a reused one can be larger than asked for.
+	void* HugeMap(addressable length, addressable& mapped)
+	{
+		{
+			std::lock_guard<std::mutex> lock(gMappingLock);
+
+			// the smallest cached mapping that fits, one more than twice as large would waste too much.
+			addressable best = gMappings.size();
+			for (addressable i = 0; i < gMappings.size(); ++i)
+			{
+				const addressable l = gMappings[i].Length;
+				if (l >= length && l <= length * 2 && (best == gMappings.size() || l < gMappings[best].Length))
+					best = i;
+			}
+
+			if (best != gMappings.size())
+			{
+				void* rval = gMappings[best].Base;
+				mapped = gMappings[best].Length;
+				gMappedBytes -= mapped;
+				gMappings.erase(gMappings.begin() + best);
+				return rval;
+			}
+		}
+
+		// over-map by a huge page, then trim the ends so the mapping starts on a huge page boundary.
+		void* raw = mmap(nullptr, length + HugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (raw == MAP_FAILED)
+			return nullptr;
+
+		const addressable start = ((addressable)raw + HugePageSize - 1) & ~(HugePageSize - 1);
+		const addressable head = start - (addressable)raw;
+		if (head)
+			munmap(raw, head);
+		if (HugePageSize - head)
+			munmap((void*)(start + length), HugePageSize - head);
+
+#ifdef MADV_HUGEPAGE
+		madvise((void*)start, length, MADV_HUGEPAGE);
+#endif
+		mapped = length;
+		return (void*)start;
+	}
+
+	// the length of the mapping travels in the block header's userdata.
+	void HugeFree(void* ptr, void* userdata)
+	{
+		const addressable length = (addressable)userdata;
+
+		// the pages go back to the OS either way, a kept mapping is only address space.
+		std::lock_guard<std::mutex> lock(gMappingLock);
+		if (gMappedBytes + length <= gHugePages.CacheBytes)
+		{
+			madvise(ptr, length, MADV_DONTNEED);
+			gMappings.push_back({ ptr, length });
+			gMappedBytes += length;
+			return;
+		}
+
+		munmap(ptr, length);
+	}
+
+	void TrimMappings(addressable limit)
+	{
+		std::lock_guard<std::mutex> lock(gMappingLock);
+		while (gMappedBytes > limit)
+		{
+			munmap(gMappings.back().Base, gMappings.back().Length);
+			gMappedBytes -= gMappings.back().Length;
+			gMappings.pop_back();
+		}
+	}
+#endif
+}
+
+void xtga::memory::SetHugePageOptions(const HugePageOptions* options)
+{
+#ifdef __linux__
+	gHugePages = options ? *options : HugePageOptions{ 0, 0 };
+	TrimMappings(gHugePages.CacheBytes);
+#else
+	(void)options;
+#endif
+}
+
+void xtga::memory::SetAllocator(const Allocator* allocator)
+{
+	gAllocator = allocator ? *allocator : Default;
+}
+
+void xtga::memory::SetThreadAllocator(const Allocator* allocator)
+{
+	tAllocator = allocator ? *allocator : Default;
+	tHasAllocator = allocator != nullptr;
+}
+
+xtga::memory::Allocator xtga::memory::GetAllocator()
+{
+	return tHasAllocator ? tAllocator : gAllocator;
+}
+
+bool xtga::memory::GetThreadAllocator(Allocator* allocator)
+{
+	if (allocator && tHasAllocator)
+		*allocator = tAllocator;
+	return tHasAllocator;
+}
+
+void* xtga::memory::Allocate(addressable size, addressable alignment)
+{
+	if (alignment < MinAlignment)
+		alignment = MinAlignment;
+
+	// the header goes in the padding in front of the buffer, which keeps the buffer aligned.
+	const addressable pad = (sizeof(BlockHeader) + alignment - 1) & ~(alignment - 1);
+	const Allocator& a = tHasAllocator ? tAllocator : gAllocator;
+
+#ifdef __linux__
+	if (gHugePages.Threshold && size >= gHugePages.Threshold && a.Allocate == DefaultAllocate && alignment <= HugePageSize)
+	{
+		const addressable length = (size + pad + HugePageSize - 1) & ~(HugePageSize - 1);
+		addressable mapped = 0;
+		void* block = HugeMap(length, mapped);
+
+		if (block)
+		{
+			void* ptr = (uchar*)block + pad;
+			*HeaderOf(ptr) = { HugeFree, (void*)mapped, block, size };
+
+			gHugePageAllocations.fetch_add(1, std::memory_order_relaxed);
+			CountAllocation(size);
+			return ptr;
+		}
+	}
+#endif
+
+	void* block = a.Allocate(size + pad, alignment, a.UserData);
+	if (!block)
+		return nullptr;
+
+	void* ptr = (uchar*)block + pad;
+	*HeaderOf(ptr) = { a.Free, a.UserData, block, size };
+
+	CountAllocation(size);
+	return ptr;
+}
+
+void* xtga::memory::AllocateZeroed(addressable size, addressable alignment)
+{
+	void* ptr = Allocate(size, alignment);
+	if (ptr)
+		memset(ptr, 0, size);
+	return ptr;
+}
+
+void* xtga::memory::Reallocate(void* ptr, addressable size)
+{
+	if (!ptr)
+		return Allocate(size);
+
+	const addressable old = HeaderOf(ptr)->Size;
+	if (size <= old && size >= old / 2)
+		return ptr;
+
+	void* rval = Allocate(size);
+	if (!rval)
+		return nullptr;
+
+	memcpy(rval, ptr, size < old ? size : old);
+	Free(ptr);
+	return rval;
+}
+
+void xtga::memory::Free(void* ptr)
+{
+	if (!ptr)
+		return;
+
+	const BlockHeader header = *HeaderOf(ptr);
+	CountFree(header.Size);
+	header.Free(header.Block, header.UserData);
+}
+
+xtga::memory::AllocationStats xtga::memory::GetStats()
+{
+	AllocationStats rval;
+	rval.Allocations = gAllocations.load(std::memory_order_relaxed);
+	rval.Frees = gFrees.load(std::memory_order_relaxed);
+	rval.BytesAllocated = gBytesAllocated.load(std::memory_order_relaxed);
+	rval.BytesInUse = gBytesInUse.load(std::memory_order_relaxed);
+	rval.PeakBytesInUse = gPeakBytesInUse.load(std::memory_order_relaxed);
+	rval.HugePageAllocations = gHugePageAllocations.load(std::memory_order_relaxed);
+	return rval;
+}
+
+void xtga::memory::ResetStats()
+{
+	gAllocations = 0;
+	gFrees = 0;
+	gBytesAllocated = 0;
+	gPeakBytesInUse = gBytesInUse.load();
+	gHugePageAllocations = 0;
+}
+
+xtga::memory::ScopedAllocator::ScopedAllocator(const Allocator& allocator)
+{
+	_HadPrevious = GetThreadAllocator(&_Previous);
+	SetThreadAllocator(&allocator);
+}
+
+xtga::memory::ScopedAllocator::~ScopedAllocator()
+{
+	SetThreadAllocator(_HadPrevious ? &_Previous : nullptr);
+}
+
+class xtga::memory::Arena::__ArenaImpl
+{
+public:
+	struct Block
+	{
+		uchar* Data;
+		addressable Size;
+	};
+
+	__ArenaImpl(addressable blockSize, const Allocator& parent);
+	~__ArenaImpl();
+
+	void* Allocate(addressable size, addressable alignment);
+
+	mutable std::mutex _Lock;
+	Allocator _Parent;
+	std::vector<Block> _Blocks;
+	addressable _BlockSize;
+	addressable _Current;
+	addressable _Offset;
+	addressable _Used;
+	addressable _Reserved;
+};
+
+xtga::memory::Arena::__ArenaImpl::__ArenaImpl(addressable blockSize, const Allocator& parent)
+{
+	_Parent = parent;
+	_BlockSize = blockSize < 4096 ? 4096 : blockSize;
+	_Current = 0;
+	_Offset = 0;
+	_Used = 0;
+	_Reserved = 0;
+}
+
+xtga::memory::Arena::__ArenaImpl::~__ArenaImpl()
+{
+	for (auto& b : _Blocks)
+		_Parent.Free(b.Data, _Parent.UserData);
+}
+
+void* xtga::memory::Arena::__ArenaImpl::Allocate(addressable size, addressable alignment)
+{
+	std::lock_guard<std::mutex> lock(_Lock);
+
+	for (;;)
+	{
+		// blocks left behind by Reset() are reused in order, ones too small for the request are skipped.
+		for (; _Current < _Blocks.size(); ++_Current, _Offset = 0)
+		{
+			const Block& b = _Blocks[_Current];
+			const addressable start = ((addressable)(b.Data + _Offset) + alignment - 1) & ~(alignment - 1);
+			const addressable offset = start - (addressable)b.Data;
+
+			if (offset + size <= b.Size)
+			{
+				_Used += offset + size - _Offset;
+				_Offset = offset + size;
+				return b.Data + offset;
+			}
+		}
+
+		const addressable bsize = size + alignment > _BlockSize ? size + alignment : _BlockSize;
+		auto data = (uchar*)_Parent.Allocate(bsize, DefaultAlignment, _Parent.UserData);
+		if (!data)
+			return nullptr;
+
+		_Blocks.push_back({ data, bsize });
+		_Reserved += bsize;
+	}
+}
+
+xtga::memory::Arena::Arena() : _impl(nullptr) {}
+
+xtga::memory::Arena* xtga::memory::Arena::Alloc(addressable blockSize, const Allocator* parent)
+{
+	auto r = new Arena();
+	r->_impl = new __ArenaImpl(blockSize, parent ? *parent : Default);
+	return r;
+}
+
+void xtga::memory::Arena::Free(Arena*& obj)
+{
+	if (obj != nullptr)
+	{
+		delete obj->_impl;
+		obj->_impl = nullptr;
+		delete obj;
+		obj = nullptr;
+	}
+}
+
+xtga::memory::Allocator xtga::memory::Arena::GetAllocator()
+{
+	auto ArenaAllocate = [](addressable size, addressable alignment, void* userdata) -> void*
+	{
+		return ((__ArenaImpl*)userdata)->Allocate(size, alignment);
+	};
+	auto ArenaFree = [](void*, void*) {};
+
+	return { ArenaAllocate, ArenaFree, this->_impl };
+}
+
+void xtga::memory::Arena::Reset()
+{
+	std::lock_guard<std::mutex> lock(this->_impl->_Lock);
+	this->_impl->_Current = 0;
+	this->_impl->_Offset = 0;
+	this->_impl->_Used = 0;
+}
+
+addressable xtga::memory::Arena::GetUsed() const
+{
+	std::lock_guard<std::mutex> lock(this->_impl->_Lock);
+	return this->_impl->_Used;
+}
+
+addressable xtga::memory::Arena::GetReserved() const
+{
+	std::lock_guard<std::mutex> lock(this->_impl->_Lock);
+	return this->_impl->_Reserved;
+}
@@ -10,16 +10,42 @@
 #include "codecs.h"
 
 #include "error_macro.h"
+#include "palette.h"
+#include "quantizer.h"
+#include "thread_pool.h"
+#include "xTGA/allocator.h"
 #include "xTGA/error.h"
 #include "xTGA/structures.h"
 
 #include <algorithm>
-#include <cmath>
+#include <atomic>
+#include <cstring>
 #include <mutex>
 #include <set>
-#include <thread>
 #include <vector>
 
+namespace
+{
+	using namespace xtga;
+
+	// fixed size copies compile to single moves, four lookups per step so that the loads overlap.
+	template <uchar N>
+	void ExpandRun(const uchar* in, addressable count, const uchar* palette, uchar* out)
+	{
+		addressable i = 0;
+		for (; i + 4 <= count; i += 4, out += 4 * N)
+		{
+			memcpy(out, palette + in[i] * N, N);
+			memcpy(out + N, palette + in[i + 1] * N, N);
+			memcpy(out + 2 * N, palette + in[i + 2] * N, N);
+			memcpy(out + 3 * N, palette + in[i + 3] * N, N);
+		}
+
+		for (; i < count; ++i, out += N)
+			memcpy(out, palette + in[i] * N, N);
+	}
+}
+
 void* xtga::codecs::DecodeRLE(void const * buffer, uchar depth, addressable length, ERRORCODE* error)
 {
 	if (!(depth == 8 || depth == 16 || depth == 24 || depth == 32))
@@ -28,448 +54,365 @@ void* xtga::codecs::DecodeRLE(void const * buffer, uchar depth, addressable leng
 		return nullptr;
 	}
 
-	addressable count = 0;
-	addressable it = 0;
-	uchar BPP = depth / 8;
+	void* rval = memory::Allocate(length * (addressable)(depth / 8));
+	DecodeRLEInto(buffer, depth, length, rval, error);
+	return rval;
+}
 
-	uchar* rval = (uchar*)malloc(sizeof(uchar) * length * (addressable)BPP);
+bool xtga::codecs::DecodeRLEInto(void const * buffer, uchar depth, addressable length, void* out, ERRORCODE* error)
+{
+	if (!(depth == 8 || depth == 16 || depth == 24 || depth == 32))
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
+		return false;
+	}
+
+	addressable count = 0;
+	auto in = (const uchar*)buffer;
+	auto rval = (uchar*)out;
+	const uchar BPP = depth / 8;
 
 	while (count < length)
 	{
-		auto Packet = (structs::RLEPacket*)( (uchar*)buffer + it );
-		++it;
-		uint16 size = BPP * (Packet->PIXEL_COUNT_MINUS_ONE + 1);
+		auto Packet = (const structs::RLEPacket*)in;
+		++in;
+		addressable n = Packet->PIXEL_COUNT_MINUS_ONE + 1;
+		if (n > length - count)
+			n = length - count;
 
+		uchar* o = rval + count * BPP;
 		if (Packet->RUN_LENGTH)
 		{
-			auto pix = ((uchar*)buffer + it);
-			for (addressable i = 0; i < size; ++i)
-			{
-				rval[count * BPP + i] = pix[i % BPP];
-			}
-			it += BPP;
+			for (addressable i = 0; i < n; ++i, o += BPP)
+				memcpy(o, in, BPP);
+			in += BPP;
 		}
 		else
 		{
-			for (addressable i = 0; i < size; ++i)
-			{
-				rval[count * BPP + i] = *((uchar*)buffer + it + i);
-			}
-			it += size;
+			memcpy(o, in, n * BPP);
+			in += n * BPP;
 		}
 
-		count += Packet->PIXEL_COUNT_MINUS_ONE + 1;
+		count += n;
 	}
 
 	XTGA_SETERROR(error, ERRORCODE::NONE);
-	return rval;
+	return true;
 }
 
-bool xtga::codecs::EncodeRLE(void const* buffer, void*& obuffer, uint16 width, uint16 height, uchar depth, ERRORCODE* error)
+xtga::codecs::RLERowReader::RLERowReader(void const* buffer, uchar depth, uint16 width)
 {
-	using namespace structs;
-	using namespace pixelformats;
-
-	if (!(depth == 8 || depth == 16 || depth == 24 || depth == 32))
-	{
-		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
-		return false;
-	}
-
-	if (width * height == 0)
-	{
-		XTGA_SETERROR(error, ERRORCODE::INDEX_OUT_OF_RANGE);
-		return false;
-	}
-
-	// No sense encoding small width images given the scan-line requirement.
-	if (width < 4)
-	{
-		XTGA_SETERROR(error, ERRORCODE::INDEX_OUT_OF_RANGE);
-		return false;
-	}
-
-	struct PacketPixels
-	{
-		RLEPacket pkt;
-		void* pixels;
-	};
-
-	uchar BPP = depth / 8;
-	std::vector<PacketPixels> output;
+	_Next = (const uchar*)buffer;
+	_Left = 0;
+	_Run = false;
+	_BPP = depth / 8;
+	_Width = width;
+}
 
-	auto EncodeLine8 = [&](const addressable lineStart)
+void xtga::codecs::RLERowReader::Advance(addressable pixels, uchar* out)
+{
+	while (pixels)
 	{
-		auto GetPixel = [&](const uint16 lineOffset) -> I8 *
-		{
-			return ((I8*)buffer + lineStart + lineOffset);
-		};
-
-		auto IsRLE = [&](const uint16 lineOffset) -> bool
+		if (_Left == 0)
 		{
-			if (lineOffset + 2 < width)
-			{
-				auto p1 = *GetPixel(lineOffset);
-				auto p2 = *GetPixel(lineOffset + 1);
-				auto p3 = *GetPixel(lineOffset + 2);
+			auto Packet = (const structs::RLEPacket*)_Next;
+			_Left = Packet->PIXEL_COUNT_MINUS_ONE + 1;
+			_Run = Packet->RUN_LENGTH;
+			++_Next;
+		}
 
-				return (p1 == p2 && p1 == p3);
-			}
-			else
-			{
-				return false;
-			}
-		};
+		const uint32 n = (uint32)std::min<addressable>(pixels, _Left);
 
-		for (uint16 i = 0; i < width;)
+		if (_Run)
 		{
-			auto pivot = GetPixel(i);
-			bool RL = false;
-			auto starti = i;
-
-			while (IsRLE(i))
-			{
-				RL = true;
-				++i;
-
-				if (i == width)
-					break;
-			}
+			for (uint32 i = 0; i < n; ++i)
+				memcpy(out + (addressable)i * _BPP, _Next, _BPP);
+		}
+		else
+		{
+			memcpy(out, _Next, (addressable)n * _BPP);
+			_Next += (addressable)n * _BPP;
+		}
 
-			if (RL)
-			{
-				i += 2;
-				goto constructPkt;
-			}
+		out += (addressable)n * _BPP;
 
-			while (!IsRLE(i))
-			{
-				++i;
+		_Left -= n;
+		pixels -= n;
 
-				if (i == width)
-					break;
-			}
+		// a run's pixel is only passed once the whole run has been read.
+		if (_Left == 0 && _Run)
+			_Next += _BPP;
+	}
+}
 
-		constructPkt:;
-			PacketPixels p;
-			p.pixels = pivot;
+void xtga::codecs::RLERowReader::ReadRow(void* out)
+{
+	Advance(_Width, (uchar*)out);
+}
 
-			auto size = i - starti;
-			if (size > 128)
-			{
-				p.pkt.PIXEL_COUNT_MINUS_ONE = 0x7F;
-				i = starti + 128;
-			}
-			else
-			{
-				p.pkt.PIXEL_COUNT_MINUS_ONE = size - 1;
-			}
+addressable xtga::codecs::EncodeRLERow(void const* row, uint16 width, uchar bpp, void* out)
+{
+	auto Row = (const uchar*)row;
+	auto Out = (uchar*)out;
 
-			p.pkt.RUN_LENGTH = RL;
+	// a run needs three equal pixels, any shorter and a raw packet is no bigger.
+	auto IsRLE = [&](const uint16 i) -> bool
+	{
+		if ((uint32)i + 2 >= width)
+			return false;
 
-			output.push_back(p);
-		}
+		auto p = Row + (addressable)i * bpp;
+		return memcmp(p, p + bpp, bpp) == 0 && memcmp(p, p + 2 * bpp, bpp) == 0;
 	};
 
-	auto EncodeLine16 = [&](const addressable lineStart)
+	for (uint16 i = 0; i < width;)
 	{
-		auto GetPixel = [&](const uint16 lineOffset) -> IA88 *
-		{
-			return ((IA88*)((uchar*)buffer + lineStart) + lineOffset);
-		};
+		const uint16 start = i;
+		bool RL = false;
 
-		auto IsRLE = [&](const uint16 lineOffset) -> bool
+		while (IsRLE(i))
 		{
-			if (lineOffset + 2 < width)
-			{
-				auto p1 = *GetPixel(lineOffset);
-				auto p2 = *GetPixel(lineOffset + 1);
-				auto p3 = *GetPixel(lineOffset + 2);
-
-				return (p1 == p2 && p1 == p3);
-			}
-			else
-			{
-				return false;
-			}
-		};
-
-		for (uint16 i = 0; i < width;)
-		{
-			auto pivot = GetPixel(i);
-			bool RL = false;
-			auto starti = i;
-
-			while (IsRLE(i))
-			{
-				RL = true;
-				++i;
-
-				if (i == width)
-					break;
-			}
-
-			if (RL)
-			{
-				i += 2;
-				goto constructPkt;
-			}
-
-			while (!IsRLE(i))
-			{
-				++i;
-
-				if (i == width)
-					break;
-			}
-
-		constructPkt:;
-			PacketPixels p;
-			p.pixels = pivot;
-
-			auto size = i - starti;
-			if (size > 128)
-			{
-				p.pkt.PIXEL_COUNT_MINUS_ONE = 0x7F;
-				i = starti + 128;
-			}
-			else
-			{
-				p.pkt.PIXEL_COUNT_MINUS_ONE = size - 1;
-			}
-
-			p.pkt.RUN_LENGTH = RL;
-
-			output.push_back(p);
+			RL = true;
+			++i;
 		}
-	};
 
-	auto EncodeLine24 = [&](const addressable lineStart)
-	{
-		auto GetPixel = [&](const uint16 lineOffset) -> RGB888 *
+		if (RL)
 		{
-			return ((RGB888*)((uchar*)buffer + lineStart) + lineOffset);
-		};
-
-		auto IsRLE = [&](const uint16 lineOffset) -> bool
+			i += 2;
+		}
+		else
 		{
-			if (lineOffset + 2 < width)
-			{
-				auto p1 = *GetPixel(lineOffset);
-				auto p2 = *GetPixel(lineOffset + 1);
-				auto p3 = *GetPixel(lineOffset + 2);
-
-				return (p1 == p2 && p1 == p3);
-			}
-			else
-			{
-				return false;
-			}
-		};
+			do { ++i; } while (i < width && !IsRLE(i));
+		}
 
-		for (uint16 i = 0; i < width;)
+		uint32 count = i - start;
+		if (count > 128)
 		{
-			auto pivot = GetPixel(i);
-			bool RL = false;
-			auto starti = i;
-
-			while (IsRLE(i))
-			{
-				RL = true;
-				++i;
-
-				if (i == width)
-					break;
-			}
-
-			if (RL)
-			{
-				i += 2;
-				goto constructPkt;
-			}
-
-			while (!IsRLE(i))
-			{
-				++i;
-
-				if (i == width)
-					break;
-			}
+			count = 128;
+			i = start + 128;
+		}
 
-		constructPkt:;
-			PacketPixels p;
-			p.pixels = pivot;
+		structs::RLEPacket pkt;
+		pkt.PIXEL_COUNT_MINUS_ONE = count - 1;
+		pkt.RUN_LENGTH = RL;
+		*Out++ = *(uchar*)&pkt;
 
-			auto size = i - starti;
-			if (size > 128)
-			{
-				p.pkt.PIXEL_COUNT_MINUS_ONE = 0x7F;
-				i = starti + 128;
-			}
-			else
-			{
-				p.pkt.PIXEL_COUNT_MINUS_ONE = size - 1;
-			}
+		const addressable size = RL ? bpp : (addressable)count * bpp;
+		memcpy(Out, Row + (addressable)start * bpp, size);
+		Out += size;
+	}
 
-			p.pkt.RUN_LENGTH = RL;
+	return (addressable)(Out - (uchar*)out);
+}
 
-			output.push_back(p);
-		}
-	};
+bool xtga::codecs::EncodeRLE(void const* buffer, void*& obuffer, uint16 width, uint16 height, uchar depth, ERRORCODE* error)
+{
+	if (!(depth == 8 || depth == 16 || depth == 24 || depth == 32))
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
+		return false;
+	}
 
-	auto EncodeLine32 = [&](const addressable lineStart)
+	if (width * height == 0)
 	{
-		auto GetPixel = [&](const uint16 lineOffset) -> RGBA8888 *
-		{
-			return ((RGBA8888*)((uchar*)buffer + lineStart) + lineOffset);
-		};
+		XTGA_SETERROR(error, ERRORCODE::INDEX_OUT_OF_RANGE);
+		return false;
+	}
 
-		auto IsRLE = [&](const uint16 lineOffset) -> bool
-		{
-			if (lineOffset + 2 < width)
-			{
-				auto p1 = *GetPixel(lineOffset);
-				auto p2 = *GetPixel(lineOffset + 1);
-				auto p3 = *GetPixel(lineOffset + 2);
+	// No sense encoding small width images given the scan-line requirement.
+	if (width < 4)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INDEX_OUT_OF_RANGE);
+		return false;
+	}
 
-				return (p1 == p2 && p1 == p3);
-			}
-			else
-			{
-				return false;
-			}
-		};
+	uchar BPP = depth / 8;
+	const addressable LineSize = (addressable)width * BPP;
 
-		for (uint16 i = 0; i < width;)
-		{
-			auto pivot = GetPixel(i);
-			bool RL = false;
-			auto starti = i;
+	// encode into a worst case sized buffer and trim it to fit after.
+	uchar* OutBuffer = (uchar*)memory::Allocate(RLERowBound(width, BPP) * height);
+	addressable it = 0;
 
-			while (IsRLE(i))
-			{
-				RL = true;
-				++i;
+	for (uint16 line = 0; line < height; ++line)
+		it += EncodeRLERow((const uchar*)buffer + line * LineSize, width, BPP, OutBuffer + it);
 
-				if (i == width)
-					break;
-			}
+	obuffer = memory::Reallocate(OutBuffer, it);
 
-			if (RL)
-			{
-				i += 2;
-				goto constructPkt;
-			}
+	XTGA_SETERROR(error, ERRORCODE::NONE);
 
-			while (!IsRLE(i))
-			{
-				++i;
+	return true;
+}
 
-				if (i == width)
-					break;
-			}
+void* xtga::codecs::DecodeColorMap(void const* ImageBuffer, addressable length, void const* ColorMap, uchar depth, ERRORCODE* error)
+{
+	if (!(depth == 16 || depth == 24 || depth == 32))
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
+		return nullptr;
+	}
 
-		constructPkt:;
-			PacketPixels p;
-			p.pixels = pivot;
+	uchar BPP = depth / 8;
+	uchar* rval = (uchar*)memory::Allocate((addressable)BPP * length);
 
-			auto size = i - starti;
-			if (size > 128)
-			{
-				p.pkt.PIXEL_COUNT_MINUS_ONE = 0x7F;
-				i = starti + 128;
-			}
-			else
-			{
-				p.pkt.PIXEL_COUNT_MINUS_ONE = size - 1;
-			}
+	ExpandIndices((const uchar*)ImageBuffer, length, ColorMap, BPP, rval);
 
-			p.pkt.RUN_LENGTH = RL;
+	XTGA_SETERROR(error, ERRORCODE::NONE);
+	return rval;
+}
 
-			output.push_back(p);
+void xtga::codecs::ExpandIndices(const uchar* indices, addressable length, const void* palette, uchar bpp, void* out)
+{
+	auto Expand = [&](const addressable& start, const addressable& count)
+	{
+		const uchar* in = indices + start;
+		const uchar* pal = (const uchar*)palette;
+		uchar* o = (uchar*)out + start * bpp;
+		switch (bpp)
+		{
+		case 1: ExpandRun<1>(in, count, pal, o); break;
+		case 2: ExpandRun<2>(in, count, pal, o); break;
+		case 3: ExpandRun<3>(in, count, pal, o); break;
+		case 4: ExpandRun<4>(in, count, pal, o); break;
 		}
 	};
 
-	for (uint16 line = 0; line < height; ++line)
-	{
-		addressable LineStart = (addressable)line * width * BPP;
-
-		if (BPP == 1)
-			EncodeLine8(LineStart);
-		else if (BPP == 2)
-			EncodeLine16(LineStart);
-		else if (BPP == 3)
-			EncodeLine24(LineStart);
-		else
-			EncodeLine32(LineStart);
-	}
+	threading::ParallelFor(threading::ChooseExecution(threading::WORKLOAD::COLORMAP_LOOKUP, length, bpp * 8), length, Expand);
+}
 
-	addressable outputSize = 0;
-	for (auto& i : output)
-	{
-		if (i.pkt.RUN_LENGTH)
-			outputSize += (addressable)1 + BPP;
-		else
-			outputSize += (addressable)1 + ((addressable)i.pkt.PIXEL_COUNT_MINUS_ONE + 1) * BPP;
-	}
+bool xtga::codecs::ExpandColorMapRGBA(const void* ColorMap, uint16 clength, pixelformats::PIXELFORMATS format, pixelformats::RGBA8888* palette, ERRORCODE* error)
+{
+	using namespace xtga::pixelformats;
 
-	uchar* OutBuffer = (uchar*)malloc(sizeof(uchar) * outputSize);
-	addressable it = 0;
+	if (clength > 256)
+		clength = 256;
 
-	for (auto& i : output)
+	for (uint16 i = 0; i < clength; ++i)
 	{
-		if (i.pkt.RUN_LENGTH)
-		{
-			OutBuffer[it] = *(uchar*) & (i.pkt); ++it;
-			for (uchar b = 0; b < BPP; ++b)
-			{
-				OutBuffer[it] = ((uchar*)i.pixels)[b];
-				++it;
-			}
-		}
+		if (format == PIXELFORMATS::BGRA8888)
+			palette[i] = BGRA_To_RGBA(((const BGRA8888*)ColorMap)[i]);
+		else if (format == PIXELFORMATS::BGR888)
+			palette[i] = BGR_To_RGBA(((const BGR888*)ColorMap)[i]);
+		else if (format == PIXELFORMATS::BGRA5551)
+			palette[i] = BGRA16_To_RGBA(((const BGRA5551*)ColorMap)[i]);
+		else if (format == PIXELFORMATS::IA88)
+			palette[i] = IA_To_RGBA(((const IA88*)ColorMap)[i]);
 		else
 		{
-			OutBuffer[it] = *(uchar*) & (i.pkt); ++it;
-			for (uchar j = 0; j < i.pkt.PIXEL_COUNT_MINUS_ONE + 1; ++j)
-			{
-				for (uchar b = 0; b < BPP; ++b)
-				{
-					OutBuffer[it] = ((uchar*)i.pixels)[(uint16)j * BPP + b];
-					++it;
-				}
-			}
+			XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
+			return false;
 		}
 	}
 
-	obuffer = OutBuffer;
+	for (uint16 i = clength; i < 256; ++i)
+		palette[i].R = palette[i].G = palette[i].B = palette[i].A = 0;
 
 	XTGA_SETERROR(error, ERRORCODE::NONE);
+	return true;
+}
+
+bool xtga::codecs::DecodeColorMappedImage(const void* buffer, void*& obuffer, flags::IMAGEORIGIN origin, uint16 w, uint16 h, bool rle, const void* palette, uchar bpp, ERRORCODE* error)
+{
+	if (!(bpp >= 1 && bpp <= 4))
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
+		return false;
+	}
+
+	// reordering 1 byte indices moves a quarter of the data reordering expanded pixels would.
+	void* indices = nullptr;
+	if (!DecodeImage(buffer, indices, origin, w, h, 8, rle, nullptr, error))
+		return false;
 
+	const addressable length = (addressable)w * h;
+	obuffer = memory::Allocate(length * bpp);
+	ExpandIndices((const uchar*)indices, length, palette, bpp, obuffer);
+	memory::Free(indices);
+
+	XTGA_SETERROR(error, ERRORCODE::NONE);
 	return true;
 }
 
-void* xtga::codecs::DecodeColorMap(void const* ImageBuffer, addressable length, void const* ColorMap, uchar depth, ERRORCODE* error)
+bool xtga::codecs::TransformPixels(void* buffer, addressable length, pixelformats::PIXELFORMATS format, bool rle,
+	const std::function<void(pixelformats::RGBA8888&)>& fn, bool parallel, ERRORCODE* error)
 {
-	if (!(depth == 16 || depth == 24 || depth == 32))
+	using namespace xtga::pixelformats;
+
+	uchar bpp = 0;
+	if (format == PIXELFORMATS::BGRA8888)
+		bpp = 4;
+	else if (format == PIXELFORMATS::BGR888)
+		bpp = 3;
+	else if (format == PIXELFORMATS::BGRA5551 || format == PIXELFORMATS::IA88)
+		bpp = 2;
+	else if (format == PIXELFORMATS::I8)
+		bpp = 1;
+	else
 	{
 		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
-		return nullptr;
+		return false;
 	}
 
-	uchar BPP = depth / 8;
-	uchar* rval = (uchar*)malloc((addressable)BPP * length);
+	auto Apply = [&](uchar* p)
+	{
+		RGBA8888 c;
+		if (format == PIXELFORMATS::BGRA8888)
+			c = BGRA_To_RGBA(*(BGRA8888*)p);
+		else if (format == PIXELFORMATS::BGR888)
+			c = BGR_To_RGBA(*(BGR888*)p);
+		else if (format == PIXELFORMATS::BGRA5551)
+			c = BGRA16_To_RGBA(*(BGRA5551*)p);
+		else if (format == PIXELFORMATS::IA88)
+			c = IA_To_RGBA(*(IA88*)p);
+		else
+			c = I_To_RGBA(*(I8*)p);
+
+		fn(c);
+
+		if (format == PIXELFORMATS::BGRA8888)
+			*(BGRA8888*)p = RGBA_To_BGRA(c);
+		else if (format == PIXELFORMATS::BGR888)
+			*(BGR888*)p = RGBA_To_BGR(c);
+		else if (format == PIXELFORMATS::BGRA5551)
+			*(BGRA5551*)p = RGBA_To_BGRA16(c);
+		else if (format == PIXELFORMATS::IA88)
+			*(IA88*)p = RGBA_To_IA(c);
+		else
+			*(I8*)p = RGBA_To_I(c);
+	};
+
+	auto Buff = (uchar*)buffer;
 
-	for (addressable i = 0, it = 0; i < length * (addressable)BPP; ++it, i += BPP)
+	if (rle)
 	{
-		auto index = *((uchar*)ImageBuffer + it);
-		for (uchar j = 0; j < BPP; ++j)
+		// packet headers are left alone, a repeat packet stores its pixel once.
+		addressable done = 0;
+		while (done < length)
 		{
-			rval[i + j] = *( (uchar*)ColorMap + (index * (addressable)BPP) + j );
+			uchar header = *Buff++;
+			uchar count = (header & 0x7F) + 1;
+			uchar stored = (header & 0x80) ? 1 : count;
+
+			for (uchar i = 0; i < stored; ++i, Buff += bpp)
+				Apply(Buff);
+
+			done += count;
 		}
 	}
+	else
+	{
+		const auto Execution = parallel
+			? threading::ChooseExecution(threading::WORKLOAD::COLORMAP_LOOKUP, length, bpp * 8)
+			: threading::EXECUTION::SERIAL;
+
+		threading::ParallelFor(Execution, length, [&](const addressable& start, const addressable& count)
+		{
+			for (addressable i = start; i < start + count; ++i)
+				Apply(Buff + i * bpp);
+		});
+	}
 
 	XTGA_SETERROR(error, ERRORCODE::NONE);
-	return rval;
+	return true;
 }
 
 void* xtga::codecs::Convert_BottomLeft_To_TopLeft(void const* buffer, uint16 width, uint16 height, uchar depth, ERRORCODE* error)
@@ -481,7 +424,7 @@ void* xtga::codecs::Convert_BottomLeft_To_TopLeft(void const* buffer, uint16 wid
 	}
 
 	uchar BPP = depth / 8;
-	uchar* rval = (uchar*)malloc((addressable)width * height * BPP);
+	uchar* rval = (uchar*)memory::Allocate((addressable)width * height * BPP);
 
 	// For each scanline
 	for (uint16 v = 0; v < height; ++v)
@@ -512,7 +455,7 @@ void* xtga::codecs::Convert_BottomRight_To_TopLeft(void const* buffer, uint16 wi
 	}
 
 	uchar BPP = depth / 8;
-	uchar* rval = (uchar*)malloc((addressable)width * height * BPP);
+	uchar* rval = (uchar*)memory::Allocate((addressable)width * height * BPP);
 
 	// For each scanline
 	for (uint16 v = 0; v < height; ++v)
@@ -543,7 +486,7 @@ void* xtga::codecs::Convert_TopRight_To_TopLeft(void const* buffer, uint16 width
 	}
 
 	uchar BPP = depth / 8;
-	uchar* rval = (uchar*)malloc((addressable)width * height * BPP);
+	uchar* rval = (uchar*)memory::Allocate((addressable)width * height * BPP);
 
 	// For each scanline
 	for (uint16 v = 0; v < height; ++v)
@@ -620,7 +563,57 @@ xtga::pixelformats::RGBA8888 xtga::codecs::IA_To_RGBA(xtga::pixelformats::IA88 p
 	return rval;
 }
 
-bool xtga::codecs::GenerateColorMap(const void* inBuff, void*& outBuff, void*& ColorMap, addressable length, uchar depth, uint16& Size, bool force, ERRORCODE* error)
+xtga::pixelformats::BGRA8888 xtga::codecs::RGBA_To_BGRA(xtga::pixelformats::RGBA8888 pixel)
+{
+	using namespace xtga::pixelformats;
+	BGRA8888 rval;
+	rval.B = pixel.B;
+	rval.G = pixel.G;
+	rval.R = pixel.R;
+	rval.A = pixel.A;
+	return rval;
+}
+
+xtga::pixelformats::BGRA5551 xtga::codecs::RGBA_To_BGRA16(xtga::pixelformats::RGBA8888 pixel)
+{
+	using namespace xtga::pixelformats;
+	BGRA5551 rval;
+	rval.B = pixel.B >> 3;
+	rval.G = pixel.G >> 3;
+	rval.R = pixel.R >> 3;
+	rval.A = pixel.A == 255 ? 1 : 0;
+	return rval;
+}
+
+xtga::pixelformats::BGR888 xtga::codecs::RGBA_To_BGR(xtga::pixelformats::RGBA8888 pixel)
+{
+	using namespace xtga::pixelformats;
+	BGR888 rval;
+	rval.B = pixel.B;
+	rval.G = pixel.G;
+	rval.R = pixel.R;
+	return rval;
+}
+
+xtga::pixelformats::I8 xtga::codecs::RGBA_To_I(xtga::pixelformats::RGBA8888 pixel)
+{
+	using namespace xtga::pixelformats;
+	I8 rval;
+	rval.I = (uchar)((pixel.R + 2 * pixel.G + pixel.B) / 4);
+	return rval;
+}
+
+xtga::pixelformats::IA88 xtga::codecs::RGBA_To_IA(xtga::pixelformats::RGBA8888 pixel)
+{
+	using namespace xtga::pixelformats;
+	IA88 rval;
+	rval.I = (uchar)((pixel.R + 2 * pixel.G + pixel.B) / 4);
+	rval.A = pixel.A;
+	return rval;
+}
+
+bool xtga::codecs::GenerateColorMap(const void* inBuff, void*& outBuff, void*& ColorMap, addressable length, uchar depth, uint16& Size, bool force,
+	flags::QUANTIZER quantizer, uchar refinement, addressable samples, ColorMapStats* stats, ERRORCODE* error)
 {
 	if (!(depth == 16 || depth == 24 || depth == 32))
 	{
@@ -628,6 +621,82 @@ bool xtga::codecs::GenerateColorMap(const void* inBuff, void*& outBuff, void*& C
 		return false;
 	}
 
+	const bool sampled = samples != 0 && samples < length;
+
+	if (force && (quantizer != flags::QUANTIZER::MEDIAN_CUT || refinement != 0 || sampled || stats))
+	{
+		ERRORCODE terr = ERRORCODE::NONE;
+
+		// an exact color map is always preferred, and needs neither refinement nor sampling.
+		if (GenerateColorMap(inBuff, outBuff, ColorMap, length, depth, Size, false, flags::QUANTIZER::MEDIAN_CUT, 0, 0, nullptr, &terr))
+		{
+			if (stats)
+				*stats = { length, length, 0.0, 0.0, 0.0 };
+
+			XTGA_SETERROR(error, ERRORCODE::NONE);
+			return true;
+		}
+
+		if (terr != ERRORCODE::COLORMAP_TOO_LARGE)
+		{
+			XTGA_SETERROR(error, terr);
+			return false;
+		}
+
+		// the color map is built (and refined) from the sample, every pixel is only mapped at the end.
+		const void* source = inBuff;
+		addressable count = length;
+		if (sampled)
+		{
+			source = SamplePixels(inBuff, length, depth, samples);
+			count = samples;
+		}
+
+		void* indices = nullptr;
+		bool built = quantizer == flags::QUANTIZER::MEDIAN_CUT
+			? GenerateColorMap(source, indices, ColorMap, count, depth, Size, true, flags::QUANTIZER::MEDIAN_CUT, 0, 0, nullptr, &terr)
+			: QuantizeColorMap(source, indices, ColorMap, count, depth, Size, quantizer, &terr);
+
+		if (built && refinement != 0)
+			RefineColorMap(source, (uchar*)indices, ColorMap, count, depth, Size, refinement);
+
+		if (built && sampled)
+		{
+			memory::Free(indices);
+			indices = MapColorMap(inBuff, length, depth, ColorMap, Size, true);
+
+			if (stats)
+			{
+				// the sample is remapped the way the image was, so the errors only differ in the pixels they cover.
+				uchar* SampleIndices = MapColorMap(source, count, depth, ColorMap, Size, true);
+				double SampleError = ColorMapError(source, SampleIndices, count, depth, ColorMap);
+				memory::Free(SampleIndices);
+
+				double ImageError = ColorMapError(inBuff, (uchar*)indices, length, depth, ColorMap);
+				*stats = { length, samples, ImageError, SampleError, ImageError - SampleError };
+			}
+		}
+		else if (built && stats)
+		{
+			double ImageError = ColorMapError(inBuff, (uchar*)indices, length, depth, ColorMap);
+			*stats = { length, length, ImageError, ImageError, 0.0 };
+		}
+
+		if (sampled)
+			memory::Free((void*)source);
+
+		if (!built)
+		{
+			XTGA_SETERROR(error, terr);
+			return false;
+		}
+
+		outBuff = indices;
+
+		XTGA_SETERROR(error, ERRORCODE::NONE);
+		return true;
+	}
+
 	using namespace pixelformats;
 
 	auto Generate16BitColorMap = [&]() -> bool
@@ -669,7 +738,8 @@ bool xtga::codecs::GenerateColorMap(const void* inBuff, void*& outBuff, void*& C
 			}
 		}
 
-		if (!force)
+		// the exact color map fit (the loop above only clears it once it has too many entries).
+		if (!force || !CMap.empty())
 			goto notForced;
 
 		// Force ColorMap
@@ -698,26 +768,12 @@ bool xtga::codecs::GenerateColorMap(const void* inBuff, void*& outBuff, void*& C
 				return i.B < j.B;
 			};
 
-			uint32 CoreCount = std::thread::hardware_concurrency();
-
-			CoreCount = (uint32)(CoreCount * 0.80f);
-
-			if (CoreCount % 2 != 0)
-				--CoreCount;
-
-			if (CoreCount == 0)
-			{
-				// assume 2
-				CoreCount = 2;
-			}
-
 			std::vector<std::set<BGRA5551, comp>> sets;
-			std::vector<std::thread*> threads;
 			std::mutex Lock;
 
-			bool PureAlpha = false;
-			bool PureWhite = false;
-			bool PureBlack = false;
+			std::atomic<bool> PureAlpha(false);
+			std::atomic<bool> PureWhite(false);
+			std::atomic<bool> PureBlack(false);
 
 			auto InitSet = [&](const addressable& start, const addressable& count)
 			{
@@ -737,67 +793,29 @@ bool xtga::codecs::GenerateColorMap(const void* inBuff, void*& outBuff, void*& C
 				}
 
 				Lock.lock();
-				sets.push_back(s);
+				sets.push_back(std::move(s));
 				Lock.unlock();
 			};
 
-			addressable slice = length / CoreCount;
-
-			// Init Threads for starting sets
-			for (uchar i = 0; i < CoreCount; ++i)
-			{
-				std::thread* t = nullptr;
-				if (i == CoreCount - 1)
-				{
-					addressable count = length - (i * slice);
-					t = new std::thread(InitSet, i * slice, count);
-				}
-				else
-				{
-					t = new std::thread(InitSet, i * slice, slice);
-				}
-				threads.push_back(t);
-			}
-
-			// Join threads
-			for (auto& i : threads)
-			{
-				i->join();
-				delete i;
-			}
-
-			threads.clear();
+			// Build a set per slice
+			threading::ParallelFor(threading::ChooseExecution(threading::WORKLOAD::COLORMAP_BUILD, length, depth), length, InitSet);
 
 			auto CombineSets = [](std::set<BGRA5551, comp>& s1, const std::set<BGRA5551, comp>& s2)
 			{
 				s1.insert(s2.begin(), s2.end());
 			};
 
-			// Combine sets
+			// Combine sets pairwise
 			while (sets.size() > 1)
 			{
-				// spawn threads
-				for (uchar c = 0; c < sets.size() / 2; ++c)
-				{
-					std::thread* t = new std::thread(CombineSets, std::ref(sets[(addressable)c * 2]), std::ref(sets[(addressable)c * 2 + 1]));
-					threads.push_back(t);
-				}
-
-				// join threads
-				for (auto& i : threads)
+				threading::ParallelInvoke((uint32)(sets.size() / 2), [&](uint32 c)
 				{
-					i->join();
-					delete i;
-				}
-
-				threads.clear();
+					CombineSets(sets[(addressable)c * 2], sets[(addressable)c * 2 + 1]);
+				});
 
-				// Remove unused sets
-				for (uchar c = 0; c < sets.size(); ++c)
-				{
-					if (c % 2 == 1)
-						sets.erase(sets.begin() + c);
-				}
+				// Remove the merged sets
+				for (addressable c = 1; c < sets.size(); ++c)
+					sets.erase(sets.begin() + c);
 			}
 
 			auto CheckRange = [](const std::vector<BGRA5551>& set, uint16 mask) -> uchar
@@ -815,7 +833,7 @@ bool xtga::codecs::GenerateColorMap(const void* inBuff, void*& outBuff, void*& C
 
 				for (const BGRA5551& i : set)
 				{
-					auto pix = ((*(uint32*)& i) & mask) >> shift;
+					auto pix = (i.RawBits & mask) >> shift;
 					if (pix > hi) hi = pix;
 					else if (pix < lo) lo = pix;
 				}
@@ -926,105 +944,38 @@ bool xtga::codecs::GenerateColorMap(const void* inBuff, void*& outBuff, void*& C
 			}
 
 			// Find closest pixel for each input
-			auto PixDistance = [](const BGRA5551& i, const BGRA5551& j) -> float
-			{
-				float r1 = i.R;
-				float g1 = i.G;
-				float b1 = i.B;
-				float r2 = j.R;
-				float g2 = j.G;
-				float b2 = j.B;
-
-				auto rdiff = r1 - r2;
-				auto gdiff = g1 - g2;
-				auto bdiff = b1 - b2;
-
-				// Fast tracks for speed (degrade accuracy but with very little visual difference)
-				if (rdiff > 128 || rdiff < -128) return FLT_MAX;
-				if (gdiff > 92 || gdiff < -92) return FLT_MAX;
-				if (bdiff > 128 || bdiff < -128) return FLT_MAX;
-
-				return std::pow((rdiff * 0.30f), 2)
-					+ std::pow((gdiff * 0.60f), 2)
-					+ std::pow((bdiff * 0.10f), 2);
-			};
+			const auto Execution = threading::ChooseExecution(threading::WORKLOAD::COLORMAP_SEARCH, length, 16, (uint16)CMap.size());
+			PaletteMatcher Matcher(CMap.data(), (uint16)CMap.size(), 16, PaletteWeights::RGB(), Execution != threading::EXECUTION::SERIAL);
 
 			IMap.resize(length);
 
 			auto DoDistanceCalc = [&](const addressable& start, const addressable& count)
 			{
-				// close enough �\_(:_:)_/�
-				float eps = 0.00001f;
+				// each thread owns its slice of IMap, no locking needed.
 				for (addressable i = start; i < start + count; ++i)
 				{
-					float distance = FLT_MAX;
-					uchar bestMatch = 0;
-
 					auto val = iPtr[i];
 					if (val == black)
-					{
-						bestMatch = lB;
-						goto found;
-					}
+						IMap[i] = lB;
 					else if (val == white)
-					{
-						bestMatch = lW;
-						goto found;
-					}
-
-					for (uint16 j = 0; j < CMap.size(); ++j)
-					{
-						auto d = PixDistance(iPtr[i], CMap[j]);
-						if (d < distance)
-						{
-							distance = d;
-							bestMatch = (uchar)j;
-							if (d < 0 + eps && d > 0 - eps) break;
-						}
-					}
-
-				found:;
-					Lock.lock();
-					IMap[i] = bestMatch;
-					Lock.unlock();
+						IMap[i] = lW;
+					else
+						IMap[i] = Matcher.NearestPixel(&val);
 				}
 			};
 
-			// Spawn Threads
-			for (uchar i = 0; i < CoreCount; i++)
-			{
-				std::thread* t = nullptr;
-				if (i == CoreCount - 1)
-				{
-					addressable count = length - (i * slice);
-					t = new std::thread(DoDistanceCalc, i * slice, count);
-				}
-				else
-				{
-					t = new std::thread(DoDistanceCalc, i * slice, slice);
-				}
-				threads.push_back(t);
-			}
-
-			// Wait for threads
-			for (auto& i : threads)
-			{
-				i->join();
-				delete i;
-			}
-
-			threads.clear();
+			threading::ParallelFor(Execution, length, DoDistanceCalc);
 		}
 
 	notForced:;
 
-		ColorMap = (BGRA5551*)malloc(sizeof(BGRA5551) * (addressable)CMap.size());
+		ColorMap = (BGRA5551*)memory::Allocate(sizeof(BGRA5551) * (addressable)CMap.size());
 		BGRA5551* cPtr = (BGRA5551*)ColorMap;
 
 		for (uint16 i = 0; i < (uint16)CMap.size(); ++i)
 			cPtr[i] = CMap[i];
 
-		outBuff = (uchar*)malloc((addressable)IMap.size());
+		outBuff = (uchar*)memory::Allocate((addressable)IMap.size());
 		for (addressable i = 0; i < (addressable)IMap.size(); ++i)
 			((uchar*)outBuff)[i] = IMap[i];
 
@@ -1073,7 +1024,8 @@ bool xtga::codecs::GenerateColorMap(const void* inBuff, void*& outBuff, void*& C
 			}
 		}
 
-		if (!force)
+		// the exact color map fit (the loop above only clears it once it has too many entries).
+		if (!force || !CMap.empty())
 			goto notForced;
 
 		// Force ColorMap
@@ -1107,26 +1059,12 @@ bool xtga::codecs::GenerateColorMap(const void* inBuff, void*& outBuff, void*& C
 				return i.B < j.B;
 			};
 
-			uint32 CoreCount = std::thread::hardware_concurrency();
-
-			CoreCount = (uint32)(CoreCount * 0.80f);
-
-			if (CoreCount % 2 != 0)
-				--CoreCount;
-
-			if (CoreCount == 0)
-			{
-				// assume 2
-				CoreCount = 2;
-			}
-
 			std::vector<std::set<BGR888, comp>> sets;
-			std::vector<std::thread*> threads;
 			std::mutex Lock;
 
-			bool PureAlpha = false;
-			bool PureWhite = false;
-			bool PureBlack = false;
+			std::atomic<bool> PureAlpha(false);
+			std::atomic<bool> PureWhite(false);
+			std::atomic<bool> PureBlack(false);
 
 			auto InitSet = [&](const addressable& start, const addressable& count)
 			{
@@ -1146,67 +1084,29 @@ bool xtga::codecs::GenerateColorMap(const void* inBuff, void*& outBuff, void*& C
 				}
 
 				Lock.lock();
-				sets.push_back(s);
+				sets.push_back(std::move(s));
 				Lock.unlock();
 			};
 
-			addressable slice = length / CoreCount;
-
-			// Init Threads for starting sets
-			for (uchar i = 0; i < CoreCount; ++i)
-			{
-				std::thread* t = nullptr;
-				if (i == CoreCount - 1)
-				{
-					addressable count = length - (i * slice);
-					t = new std::thread(InitSet, i * slice, count);
-				}
-				else
-				{
-					t = new std::thread(InitSet, i * slice, slice);
-				}
-				threads.push_back(t);
-			}
-
-			// Join threads
-			for (auto& i : threads)
-			{
-				i->join();
-				delete i;
-			}
-
-			threads.clear();
+			// Build a set per slice
+			threading::ParallelFor(threading::ChooseExecution(threading::WORKLOAD::COLORMAP_BUILD, length, depth), length, InitSet);
 
 			auto CombineSets = [](std::set<BGR888, comp>& s1, const std::set<BGR888, comp>& s2)
 			{
 				s1.insert(s2.begin(), s2.end());
 			};
 
-			// Combine sets
+			// Combine sets pairwise
 			while (sets.size() > 1)
 			{
-				// spawn threads
-				for (uchar c = 0; c < sets.size() / 2; ++c)
-				{
-					std::thread* t = new std::thread(CombineSets, std::ref(sets[(addressable)c * 2]), std::ref(sets[(addressable)c * 2 + 1]));
-					threads.push_back(t);
-				}
-
-				// join threads
-				for (auto& i : threads)
+				threading::ParallelInvoke((uint32)(sets.size() / 2), [&](uint32 c)
 				{
-					i->join();
-					delete i;
-				}
+					CombineSets(sets[(addressable)c * 2], sets[(addressable)c * 2 + 1]);
+				});
 
-				threads.clear();
-
-				// Remove unused sets
-				for (uchar c = 0; c < sets.size(); ++c)
-				{
-					if (c % 2 == 1)
-						sets.erase(sets.begin() + c);
-				}
+				// Remove the merged sets
+				for (addressable c = 1; c < sets.size(); ++c)
+					sets.erase(sets.begin() + c);
 			}
 
 			auto CheckRange = [](const std::vector<BGR888>& set, uint32 mask) -> uchar
@@ -1224,7 +1124,9 @@ bool xtga::codecs::GenerateColorMap(const void* inBuff, void*& outBuff, void*& C
 
 				for (const BGR888& i : set)
 				{
-					auto pix = ((*(uint32*)& i) & mask) >> shift;
+					// a BGR888 is only 3 bytes, so assemble the 0x00RRGGBB value instead of reading past it.
+					uint32 val = ((uint32)i.R << 16) | ((uint32)i.G << 8) | i.B;
+					auto pix = (val & mask) >> shift;
 					if (pix > hi) hi = pix;
 					else if (pix < lo) lo = pix;
 				}
@@ -1336,105 +1238,38 @@ bool xtga::codecs::GenerateColorMap(const void* inBuff, void*& outBuff, void*& C
 			}
 
 			// Find closest pixel for each input
-			auto PixDistance = [](const BGR888& i, const BGR888& j) -> float
-			{
-				float r1 = i.R;
-				float g1 = i.G;
-				float b1 = i.B;
-				float r2 = j.R;
-				float g2 = j.G;
-				float b2 = j.B;
-
-				auto rdiff = r1 - r2;
-				auto gdiff = g1 - g2;
-				auto bdiff = b1 - b2;
-
-				// Fast tracks for speed (degrade accuracy but with very little visual difference)
-				if (rdiff > 128 || rdiff < -128) return FLT_MAX;
-				if (gdiff > 92 || gdiff < -92) return FLT_MAX;
-				if (bdiff > 128 || bdiff < -128) return FLT_MAX;
-
-				return std::pow((rdiff * 0.30f), 2)
-					+ std::pow((gdiff * 0.60f), 2)
-					+ std::pow((bdiff * 0.10f), 2);
-			};
-
-			IMap.resize(length);
-
-			auto DoDistanceCalc = [&](const addressable& start, const addressable& count)
-			{
-				// close enough �\_(:_:)_/�
-				float eps = 0.00001f;
-				for (addressable i = start; i < start + count; ++i)
-				{
-					float distance = FLT_MAX;
-					uchar bestMatch = 0;
-
-					auto val = iPtr[i];
-					if (val == black)
-					{
-						bestMatch = lB;
-						goto found;
-					}
-					else if (val == white)
-					{
-						bestMatch = lW;
-						goto found;
-					}
-
-					for (uint16 j = 0; j < CMap.size(); ++j)
-					{
-						auto d = PixDistance(val, CMap[j]);
-						if (d < distance)
-						{
-							distance = d;
-							bestMatch = (uchar)j;
-							if (d < 0 + eps && d > 0 - eps) break;
-						}
-					}
-
-				found:;
-					Lock.lock();
-					IMap[i] = bestMatch;
-					Lock.unlock();
-				}
-			};
+			const auto Execution = threading::ChooseExecution(threading::WORKLOAD::COLORMAP_SEARCH, length, 24, (uint16)CMap.size());
+			PaletteMatcher Matcher(CMap.data(), (uint16)CMap.size(), 24, PaletteWeights::RGB(), Execution != threading::EXECUTION::SERIAL);
 
-			// Spawn Threads
-			for (uchar i = 0; i < CoreCount; i++)
+			IMap.resize(length);
+
+			auto DoDistanceCalc = [&](const addressable& start, const addressable& count)
 			{
-				std::thread* t = nullptr;
-				if (i == CoreCount - 1)
-				{
-					addressable count = length - (i * slice);
-					t = new std::thread(DoDistanceCalc, i * slice, count);
-				}
-				else
+				// each thread owns its slice of IMap, no locking needed.
+				for (addressable i = start; i < start + count; ++i)
 				{
-					t = new std::thread(DoDistanceCalc, i * slice, slice);
+					auto val = iPtr[i];
+					if (val == black)
+						IMap[i] = lB;
+					else if (val == white)
+						IMap[i] = lW;
+					else
+						IMap[i] = Matcher.NearestPixel(&val);
 				}
-				threads.push_back(t);
-			}
-
-			// Wait for threads
-			for (auto& i : threads)
-			{
-				i->join();
-				delete i;
-			}
+			};
 
-			threads.clear();
+			threading::ParallelFor(Execution, length, DoDistanceCalc);
 		}
 
 	notForced:;
 
-		ColorMap = (BGR888*)malloc(sizeof(BGR888) * (addressable)CMap.size());
+		ColorMap = (BGR888*)memory::Allocate(sizeof(BGR888) * (addressable)CMap.size());
 		BGR888* cPtr = (BGR888*)ColorMap;
 
 		for (uint16 i = 0; i < (uint16)CMap.size(); ++i)
 			cPtr[i] = CMap[i];
 
-		outBuff = (uchar*)malloc((addressable)IMap.size());
+		outBuff = (uchar*)memory::Allocate((addressable)IMap.size());
 		for (addressable i = 0; i < IMap.size(); ++i)
 			((uchar*)outBuff)[i] = IMap[i];
 
@@ -1483,7 +1318,8 @@ bool xtga::codecs::GenerateColorMap(const void* inBuff, void*& outBuff, void*& C
 			}
 		}
 
-		if (!force)
+		// the exact color map fit (the loop above only clears it once it has too many entries).
+		if (!force || !CMap.empty())
 			goto notForced;
 
 		// Force ColorMap
@@ -1517,26 +1353,12 @@ bool xtga::codecs::GenerateColorMap(const void* inBuff, void*& outBuff, void*& C
 				return i.B < j.B;
 			};
 
-			uint32 CoreCount = std::thread::hardware_concurrency();
-
-			CoreCount = (uint32)(CoreCount * 0.80f);
-
-			if (CoreCount % 2 != 0)
-				--CoreCount;
-
-			if (CoreCount == 0)
-			{
-				// assume 2
-				CoreCount = 2;
-			}
-
 			std::vector<std::set<BGRA8888, comp>> sets;
-			std::vector<std::thread*> threads;
 			std::mutex Lock;
 
-			bool PureAlpha = false;
-			bool PureWhite = false;
-			bool PureBlack = false;
+			std::atomic<bool> PureAlpha(false);
+			std::atomic<bool> PureWhite(false);
+			std::atomic<bool> PureBlack(false);
 
 			auto InitSet = [&](const addressable& start, const addressable& count)
 			{
@@ -1557,67 +1379,29 @@ bool xtga::codecs::GenerateColorMap(const void* inBuff, void*& outBuff, void*& C
 				}
 
 				Lock.lock();
-				sets.push_back(s);
+				sets.push_back(std::move(s));
 				Lock.unlock();
 			};
 
-			addressable slice = length / CoreCount;
-
-			// Init Threads for starting sets
-			for (uchar i = 0; i < CoreCount; ++i)
-			{
-				std::thread* t = nullptr;
-				if (i == CoreCount - 1)
-				{
-					addressable count = length - (i * slice);
-					t = new std::thread(InitSet, i * slice, count);
-				}
-				else
-				{
-					t = new std::thread(InitSet, i * slice, slice);
-				}
-				threads.push_back(t);
-			}
-
-			// Join threads
-			for (auto& i : threads)
-			{
-				i->join();
-				delete i;
-			}
-
-			threads.clear();
+			// Build a set per slice
+			threading::ParallelFor(threading::ChooseExecution(threading::WORKLOAD::COLORMAP_BUILD, length, depth), length, InitSet);
 
 			auto CombineSets = [](std::set<BGRA8888, comp>& s1, const std::set<BGRA8888, comp>& s2)
 			{
 				s1.insert(s2.begin(), s2.end());
 			};
 
-			// Combine sets
+			// Combine sets pairwise
 			while (sets.size() > 1)
 			{
-				// spawn threads
-				for (uchar c = 0; c < sets.size() / 2; ++c)
+				threading::ParallelInvoke((uint32)(sets.size() / 2), [&](uint32 c)
 				{
-					std::thread* t = new std::thread(CombineSets, std::ref(sets[(addressable)c * 2]), std::ref(sets[(addressable)c * 2 + 1]));
-					threads.push_back(t);
-				}
-
-				// join threads
-				for (auto& i : threads)
-				{
-					i->join();
-					delete i;
-				}
+					CombineSets(sets[(addressable)c * 2], sets[(addressable)c * 2 + 1]);
+				});
 
-				threads.clear();
-
-				// Remove unused sets
-				for (uchar c = 0; c < sets.size(); ++c)
-				{
-					if (c % 2 == 1)
-						sets.erase(sets.begin() + c);
-				}
+				// Remove the merged sets
+				for (addressable c = 1; c < sets.size(); ++c)
+					sets.erase(sets.begin() + c);
 			}
 
 			auto CheckRange = [](const std::vector<BGRA8888>& set, uint32 mask) -> uchar
@@ -1766,114 +1550,39 @@ bool xtga::codecs::GenerateColorMap(const void* inBuff, void*& outBuff, void*& C
 			}
 
 			// Find closest pixel for each input
-			auto PixDistance = [](const BGRA8888& i, const BGRA8888& j) -> float
-			{
-				float r1 = i.R;
-				float g1 = i.G;
-				float b1 = i.B;
-				float a1 = i.A;
-				float r2 = j.R;
-				float g2 = j.G;
-				float b2 = j.B;
-				float a2 = j.A;
-
-				auto rdiff = r1 - r2;
-				auto gdiff = g1 - g2;
-				auto bdiff = b1 - b2;
-				auto adiff = a1 - a2;
-
-				// Fast tracks for speed (degrade accuracy but with very little visual difference)
-				if (rdiff > 128 || rdiff < -128) return FLT_MAX;
-				if (gdiff > 92 || gdiff < -92) return FLT_MAX;
-				if (bdiff > 128 || bdiff < -128) return FLT_MAX;
-				if (adiff > 64 || adiff < -64) return FLT_MAX;
-
-				return std::pow((rdiff * 0.15f), 2)
-					+ std::pow((gdiff * 0.30f), 2)
-					+ std::pow((bdiff * 0.05f), 2)
-					+ std::pow((adiff * 0.50f), 2);
-			};
+			const auto Execution = threading::ChooseExecution(threading::WORKLOAD::COLORMAP_SEARCH, length, 32, (uint16)CMap.size());
+			PaletteMatcher Matcher(CMap.data(), (uint16)CMap.size(), 32, PaletteWeights::RGBA(), Execution != threading::EXECUTION::SERIAL);
 
 			IMap.resize(length);
 
 			auto DoDistanceCalc = [&](const addressable& start, const addressable& count)
 			{
-				// close enough �\_(:_:)_/�
-				float eps = 0.00001f;
+				// each thread owns its slice of IMap, no locking needed.
 				for (addressable i = start; i < start + count; ++i)
 				{
-					float distance = FLT_MAX;
-					uchar bestMatch = 0;
-
 					auto val = iPtr[i];
 					if (val.A == 0x00)
-					{
-						bestMatch = lA;
-						goto found;
-					}
+						IMap[i] = lA;
 					else if (val == black)
-					{
-						bestMatch = lB;
-						goto found;
-					}
+						IMap[i] = lB;
 					else if (val == white)
-					{
-						bestMatch = lW;
-						goto found;
-					}
-
-					for (uint16 j = 0; j < CMap.size(); ++j)
-					{
-						auto d = PixDistance(val, CMap[j]);
-						if (d < distance)
-						{
-							distance = d;
-							bestMatch = (uchar)j;
-							if (d < 0 + eps && d > 0 - eps) break;
-						}
-					}
-
-				found:;
-					Lock.lock();
-					IMap[i] = bestMatch;
-					Lock.unlock();
+						IMap[i] = lW;
+					else
+						IMap[i] = Matcher.NearestPixel(&val);
 				}
 			};
 
-			// Spawn Threads
-			for (uchar i = 0; i < CoreCount; i++)
-			{
-				std::thread* t = nullptr;
-				if (i == CoreCount - 1)
-				{
-					addressable count = length - (i * slice);
-					t = new std::thread(DoDistanceCalc, i * slice, count);
-				}
-				else
-				{
-					t = new std::thread(DoDistanceCalc, i * slice, slice);
-				}
-				threads.push_back(t);
-			}
-
-			// Wait for threads
-			for (auto& i : threads)
-			{
-				i->join();
-				delete i;
-			}
-
-			threads.clear();
+			threading::ParallelFor(Execution, length, DoDistanceCalc);
 		}
 
 	notForced:;
-		ColorMap = (BGRA8888*)malloc(sizeof(BGRA8888) * (addressable)CMap.size());
+		ColorMap = (BGRA8888*)memory::Allocate(sizeof(BGRA8888) * (addressable)CMap.size());
 		BGRA8888* cPtr = (BGRA8888*)ColorMap;
 
 		for (uint16 i = 0; i < (uint16)CMap.size(); ++i)
 			cPtr[i] = CMap[i];
 
-		outBuff = (uchar*)malloc((addressable)IMap.size());
+		outBuff = (uchar*)memory::Allocate((addressable)IMap.size());
 		for (addressable i = 0; i < IMap.size(); ++i)
 			((uchar*)outBuff)[i] = (uchar)IMap[i];
 
@@ -1894,7 +1603,7 @@ bool xtga::codecs::GenerateColorMap(const void* inBuff, void*& outBuff, void*& C
 		return false;
 }
 
-void* xtga::codecs::ApplyColorMap(const void* buff, addressable ilength, const void* colormap, uint16 clength, uchar depth, ERRORCODE* error)
+void* xtga::codecs::ApplyColorMap(const void* buff, addressable ilength, const void* colormap, uint16 clength, uchar depth, const InverseColorMap* inverse, ERRORCODE* error)
 {
 	if (!(depth == 16 || depth == 24 || depth == 32))
 	{
@@ -1902,263 +1611,29 @@ void* xtga::codecs::ApplyColorMap(const void* buff, addressable ilength, const v
 		return nullptr;
 	}
 
-	using namespace pixelformats;
-
-	uint32 CoreCount = std::thread::hardware_concurrency();
-	CoreCount = (uint32)(CoreCount * 0.80f);
-
-	if (CoreCount % 2 != 0)
-		--CoreCount;
-
-	if (CoreCount == 0)
-	{
-		// assume 2
-		CoreCount = 2;
-	}
-
-	addressable slice = ilength / CoreCount;
-	std::vector<std::thread*> threads;
-
-	auto IMap = (uchar*)malloc(ilength);
-
-	if (depth == 16)
-	{
-		auto PixDistance = [](const BGRA5551& i, const BGRA5551& j) -> float
-		{
-			float r1 = i.R;
-			float g1 = i.G;
-			float b1 = i.B;
-			float r2 = j.R;
-			float g2 = j.G;
-			float b2 = j.B;
-
-			auto rdiff = r1 - r2;
-			auto gdiff = g1 - g2;
-			auto bdiff = b1 - b2;
-
-			// Fast tracks for speed (degrade accuracy but with very little visual difference)
-			if (rdiff > 128 || rdiff < -128) return FLT_MAX;
-			if (gdiff > 92 || gdiff < -92) return FLT_MAX;
-			if (bdiff > 128 || bdiff < -128) return FLT_MAX;
-
-			return std::pow((rdiff * 0.30f), 2)
-				+ std::pow((gdiff * 0.60f), 2)
-				+ std::pow((bdiff * 0.10f), 2);
-		};
-
-		auto iPtr = (BGRA5551*)buff;
-		auto cPtr = (BGRA5551*)colormap;
-
-		auto DoDistanceCalc = [&](const addressable& start, const addressable& count)
-		{
-			// close enough �\_(:_:)_/�
-			float eps = 0.00001f;
-			for (addressable i = start; i < start + count; ++i)
-			{
-				float distance = FLT_MAX;
-				uchar bestMatch = 0;
-
-				auto val = iPtr[i];
-
-				for (uint16 j = 0; j < clength; ++j)
-				{
-					auto d = PixDistance(iPtr[i], cPtr[j]);
-					if (d < distance)
-					{
-						distance = d;
-						bestMatch = (uchar)j;
-						if (d < 0 + eps && d > 0 - eps) break;
-					}
-				}
-
-				IMap[i] = bestMatch;
-			}
-		};
-
-		// Spawn Threads
-		for (uchar i = 0; i < CoreCount; i++)
-		{
-			std::thread* t = nullptr;
-			if (i == CoreCount - 1)
-			{
-				addressable count = ilength - (i * slice);
-				t = new std::thread(DoDistanceCalc, i * slice, count);
-			}
-			else
-			{
-				t = new std::thread(DoDistanceCalc, i * slice, slice);
-			}
-			threads.push_back(t);
-		}
-
-		// Wait for threads
-		for (auto& i : threads)
-		{
-			i->join();
-			delete i;
-		}
-
-		threads.clear();
-	}
-	else if (depth == 24)
-	{
-		auto PixDistance = [](const BGR888& i, const BGR888& j) -> float
-		{
-			float r1 = i.R;
-			float g1 = i.G;
-			float b1 = i.B;
-			float r2 = j.R;
-			float g2 = j.G;
-			float b2 = j.B;
-
-			auto rdiff = r1 - r2;
-			auto gdiff = g1 - g2;
-			auto bdiff = b1 - b2;
-
-			// Fast tracks for speed (degrade accuracy but with very little visual difference)
-			if (rdiff > 128 || rdiff < -128) return FLT_MAX;
-			if (gdiff > 92 || gdiff < -92) return FLT_MAX;
-			if (bdiff > 128 || bdiff < -128) return FLT_MAX;
-
-			return std::pow((rdiff * 0.30f), 2)
-				+ std::pow((gdiff * 0.60f), 2)
-				+ std::pow((bdiff * 0.10f), 2);
-		};
-
-		auto iPtr = (BGR888*)buff;
-		auto cPtr = (BGR888*)colormap;
-
-		auto DoDistanceCalc = [&](const addressable& start, const addressable& count)
-		{
-			// close enough �\_(:_:)_/�
-			float eps = 0.00001f;
-			for (addressable i = start; i < start + count; ++i)
-			{
-				float distance = FLT_MAX;
-				uchar bestMatch = 0;
-
-				auto val = iPtr[i];
-
-				for (uint16 j = 0; j < clength; ++j)
-				{
-					auto d = PixDistance(iPtr[i], cPtr[j]);
-					if (d < distance)
-					{
-						distance = d;
-						bestMatch = (uchar)j;
-						if (d < 0 + eps && d > 0 - eps) break;
-					}
-				}
+	auto IMap = (uchar*)memory::Allocate(ilength);
 
-				IMap[i] = bestMatch;
-			}
-		};
+	// a lattice built for another color map can't be used.
+	if (inverse && inverse->GetColorMap() != colormap)
+		inverse = nullptr;
 
-		// Spawn Threads
-		for (uchar i = 0; i < CoreCount; i++)
-		{
-			std::thread* t = nullptr;
-			if (i == CoreCount - 1)
-			{
-				addressable count = ilength - (i * slice);
-				t = new std::thread(DoDistanceCalc, i * slice, count);
-			}
-			else
-			{
-				t = new std::thread(DoDistanceCalc, i * slice, slice);
-			}
-			threads.push_back(t);
-		}
+	const auto Execution = inverse
+		? threading::ChooseExecution(threading::WORKLOAD::COLORMAP_LOOKUP, ilength, depth)
+		: threading::ChooseExecution(threading::WORKLOAD::COLORMAP_SEARCH, ilength, depth, clength);
 
-		// Wait for threads
-		for (auto& i : threads)
-		{
-			i->join();
-			delete i;
-		}
+	PaletteMatcher Matcher(colormap, clength, depth, PaletteWeights::RGB(), Execution != threading::EXECUTION::SERIAL);
 
-		threads.clear();
-	}
-	else
+	auto DoDistanceCalc = [&](const addressable& start, const addressable& count)
 	{
-		auto PixDistance = [](const BGRA8888& i, const BGRA8888& j) -> float
-		{
-			float r1 = i.R;
-			float g1 = i.G;
-			float b1 = i.B;
-			float r2 = j.R;
-			float g2 = j.G;
-			float b2 = j.B;
-
-			auto rdiff = r1 - r2;
-			auto gdiff = g1 - g2;
-			auto bdiff = b1 - b2;
-
-			// Fast tracks for speed (degrade accuracy but with very little visual difference)
-			if (rdiff > 128 || rdiff < -128) return FLT_MAX;
-			if (gdiff > 92 || gdiff < -92) return FLT_MAX;
-			if (bdiff > 128 || bdiff < -128) return FLT_MAX;
-
-			return std::pow((rdiff * 0.30f), 2)
-				+ std::pow((gdiff * 0.60f), 2)
-				+ std::pow((bdiff * 0.10f), 2);
-		};
-
-		auto iPtr = (BGRA8888*)buff;
-		auto cPtr = (BGRA8888*)colormap;
-
-		auto DoDistanceCalc = [&](const addressable& start, const addressable& count)
-		{
-			// close enough �\_(:_:)_/�
-			float eps = 0.00001f;
-			for (addressable i = start; i < start + count; ++i)
-			{
-				float distance = FLT_MAX;
-				uchar bestMatch = 0;
-
-				auto val = iPtr[i];
-
-				for (uint16 j = 0; j < clength; ++j)
-				{
-					auto d = PixDistance(iPtr[i], cPtr[j]);
-					if (d < distance)
-					{
-						distance = d;
-						bestMatch = (uchar)j;
-						if (d < 0 + eps && d > 0 - eps) break;
-					}
-				}
-
-				IMap[i] = bestMatch;
-			}
-		};
-
-		// Spawn Threads
-		for (uchar i = 0; i < CoreCount; i++)
-		{
-			std::thread* t = nullptr;
-			if (i == CoreCount - 1)
-			{
-				addressable count = ilength - (i * slice);
-				t = new std::thread(DoDistanceCalc, i * slice, count);
-			}
-			else
-			{
-				t = new std::thread(DoDistanceCalc, i * slice, slice);
-			}
-			threads.push_back(t);
-		}
-
-		// Wait for threads
-		for (auto& i : threads)
-		{
-			i->join();
-			delete i;
-		}
+		if (inverse)
+			inverse->LookupRange(buff, start, count, IMap + start);
+		else
+			Matcher.NearestRange(buff, start, count, IMap + start);
+	};
 
-		threads.clear();
-	}
+	threading::ParallelFor(Execution, ilength, DoDistanceCalc);
 
+	XTGA_SETERROR(error, ERRORCODE::NONE);
 	return IMap;
 }
 
@@ -2170,41 +1645,26 @@ bool xtga::codecs::DecodeImage(const void* buffer, void*& obuffer, flags::IMAGEO
 
 	auto tErr = ERRORCODE::NONE;
 
-	uchar tdepth = depth;
+	// Color mapped images are reordered as indices and expanded last
 	if (colormap)
-		tdepth = 8;
-
-	// First decode RLE
-	if (rle)
 	{
-		obuffer = DecodeRLE(buffer, tdepth, (addressable)w * h, &tErr);
-
-		if (tErr != ERRORCODE::NONE)
+		if (!(depth == 16 || depth == 24 || depth == 32))
 		{
-			XTGA_SETERROR(error, tErr);
+			XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
 			return false;
 		}
+
+		return DecodeColorMappedImage(buffer, obuffer, origin, w, h, rle, colormap, depth / 8, error);
 	}
 
-	// Decode color map
-	if (colormap)
+	// First decode RLE
+	if (rle)
 	{
-		if (obuffer)
-		{
-			auto tmp = obuffer;
-			obuffer = DecodeColorMap(obuffer, (addressable)w * h, colormap, depth, &tErr);
-			free(tmp);
-		}
-		else
-		{
-			obuffer = DecodeColorMap(buffer, (addressable)w * h, colormap, depth, &tErr);
-		}
+		obuffer = DecodeRLE(buffer, depth, (addressable)w * h, &tErr);
 
 		if (tErr != ERRORCODE::NONE)
 		{
 			XTGA_SETERROR(error, tErr);
-
-			if (obuffer) free(obuffer);
 			return false;
 		}
 	}
@@ -2216,7 +1676,7 @@ bool xtga::codecs::DecodeImage(const void* buffer, void*& obuffer, flags::IMAGEO
 		{
 			auto tmp = obuffer;
 			obuffer = Convert_BottomLeft_To_TopLeft(tmp, w, h, depth, &tErr);
-			free(tmp);
+			memory::Free(tmp);
 		}
 		else
 		{
@@ -2229,7 +1689,7 @@ bool xtga::codecs::DecodeImage(const void* buffer, void*& obuffer, flags::IMAGEO
 		{
 			auto tmp = obuffer;
 			obuffer = Convert_BottomRight_To_TopLeft(obuffer, w, h, depth, &tErr);
-			free(tmp);
+			memory::Free(tmp);
 		}
 		else
 		{
@@ -2242,7 +1702,7 @@ bool xtga::codecs::DecodeImage(const void* buffer, void*& obuffer, flags::IMAGEO
 		{
 			auto tmp = obuffer;
 			obuffer = Convert_TopRight_To_TopLeft(obuffer, w, h, depth, &tErr);
-			free(tmp);
+			memory::Free(tmp);
 		}
 		else
 		{
@@ -2254,458 +1714,18 @@ bool xtga::codecs::DecodeImage(const void* buffer, void*& obuffer, flags::IMAGEO
 	{
 		XTGA_SETERROR(error, tErr);
 
-		if (obuffer) free(obuffer);
+		if (obuffer) memory::Free(obuffer);
 		return false;
 	}
 
+	// already top left, a single copy.
 	if (!obuffer)
 	{
-		obuffer = (uchar*)malloc((addressable)w * h * depth / 8);
-		for (addressable i = 0; i < (addressable)w * h * depth / 8; ++i)
-		{
-			((uchar*)obuffer)[i] = ((uchar*)buffer)[i];
-		}
+		obuffer = memory::Allocate((addressable)w * h * depth / 8);
+		memcpy(obuffer, buffer, (addressable)w * h * depth / 8);
 	}
 
 	XTGA_SETERROR(error, ERRORCODE::NONE);
 
 	return true;
 }
-
-void* xtga::codecs::ScaleImageBicubic(const void* data, xtga::pixelformats::PIXELFORMATS format, uint16 width, uint16 height, float scale, ERRORCODE* error)
-{
-	using namespace pixelformats;
-
-	uchar BPP = 0;
-	if (format == PIXELFORMATS::BGR888)
-		BPP = 3;
-	else if (format == PIXELFORMATS::BGRA5551)
-		BPP = 2;
-	else if (format == PIXELFORMATS::BGRA8888)
-		BPP = 4;
-	else if (format == PIXELFORMATS::I8)
-		BPP = 1;
-	else if (format == PIXELFORMATS::IA88)
-		BPP = 2;
-	else
-	{
-		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
-		return nullptr;
-	}
-
-	if (width <= 1 || height <= 1)
-	{
-		XTGA_SETERROR(error, ERRORCODE::REDUNDANT_OPERATION);
-		return nullptr;
-	}
-
-	if (scale == 1.0f)
-	{
-		auto rBuff = (uchar*)malloc((addressable)width * height * BPP);
-
-		for (addressable i = 0; i < (addressable)width * height * BPP; ++i)
-			rBuff[i] = ( (uchar*)data )[i];
-
-		XTGA_SETERROR(error, ERRORCODE::REDUNDANT_OPERATION);
-
-		return rBuff;
-	}
-
-	// Check for overflow after scale
-	if (!(scale < 1.0f))
-	{
-		if (width > UINT16_MAX / scale)
-		{
-			XTGA_SETERROR(error, ERRORCODE::OVERFLOW_DETECTED);
-			return nullptr;
-		}
-
-		if (height > UINT16_MAX / scale)
-		{
-			XTGA_SETERROR(error, ERRORCODE::OVERFLOW_DETECTED);
-			return nullptr;
-		}
-	}
-
-	auto CubicInterpolate = [](const float in[4], float x) -> float
-	{
-		return (float)((-0.5 * in[0] + 1.5 * in[1] - 1.5 * in[2] + 0.5 * in[3]) * std::pow(x, 3)
-			+ (in[0] - 2.5 * in[1] + 2.0 * in[2] - 0.5 * in[3]) * std::pow(x, 2)
-			+ (-0.5 * in[0] + 0.5 * in[2]) * x
-			+ in[1]);
-	};
-
-	auto CubicInterpolateBGR24 = [&CubicInterpolate](const BGR888 in[4], float x) -> BGR888
-	{
-		float b[4] = { (float)in[0].B, (float)in[1].B, (float)in[2].B, (float)in[3].B };
-		float g[4] = { (float)in[0].G, (float)in[1].G, (float)in[2].G, (float)in[3].G };
-		float r[4] = { (float)in[0].R, (float)in[1].R, (float)in[2].R, (float)in[3].R };
-
-		float bx = CubicInterpolate(b, x);
-		float gx = CubicInterpolate(g, x);
-		float rx = CubicInterpolate(r, x);
-
-		bx = std::roundf(bx);
-		gx = std::roundf(gx);
-		rx = std::roundf(rx);
-
-		if (bx > 255) bx = 255;
-		else if (bx < 0) bx = 0;
-		if (gx > 255) gx = 255;
-		else if (gx < 0) gx = 0;
-		if (rx > 255) rx = 255;
-		else if (rx < 0) rx = 0;
-
-		BGR888 rval;
-		rval.B = (uchar)bx;
-		rval.G = (uchar)gx;
-		rval.R = (uchar)rx;
-
-		return rval;
-	};
-
-	auto BicubicInterpolateBGR24 = [&CubicInterpolateBGR24](const BGR888 in[4][4], float x, float y) -> BGR888
-	{
-		BGR888 arr[4];
-		arr[0] = CubicInterpolateBGR24(in[0], x);
-		arr[1] = CubicInterpolateBGR24(in[1], x);
-		arr[2] = CubicInterpolateBGR24(in[2], x);
-		arr[3] = CubicInterpolateBGR24(in[3], x);
-		return CubicInterpolateBGR24(arr, y);
-	};
-
-	auto CubicInterpolateBGRA32 = [&CubicInterpolate](const BGRA8888 in[4], float x) -> BGRA8888
-	{
-		float b[4] = { (float)in[0].B, (float)in[1].B, (float)in[2].B, (float)in[3].B };
-		float g[4] = { (float)in[0].G, (float)in[1].G, (float)in[2].G, (float)in[3].G };
-		float r[4] = { (float)in[0].R, (float)in[1].R, (float)in[2].R, (float)in[3].R };
-		float a[4] = { (float)in[0].A, (float)in[1].A, (float)in[2].A, (float)in[3].A };
-
-		float bx = CubicInterpolate(b, x);
-		float gx = CubicInterpolate(g, x);
-		float rx = CubicInterpolate(r, x);
-		float ax = CubicInterpolate(a, x);
-
-		bx = std::roundf(bx);
-		gx = std::roundf(gx);
-		rx = std::roundf(rx);
-		ax = std::roundf(ax);
-
-		if (bx > 255) bx = 255;
-		else if (bx < 0) bx = 0;
-		if (gx > 255) gx = 255;
-		else if (gx < 0) gx = 0;
-		if (rx > 255) rx = 255;
-		else if (rx < 0) rx = 0;
-		if (ax > 255) ax = 255;
-		else if (ax < 0) ax = 0;
-
-		BGRA8888 rval;
-		rval.B = (uchar)bx;
-		rval.G = (uchar)gx;
-		rval.R = (uchar)rx;
-		rval.A = (uchar)ax;
-
-		return rval;
-	};
-
-	auto BicubicInterpolateBGRA32 = [&CubicInterpolateBGRA32](const BGRA8888 in[4][4], float x, float y) -> BGRA8888
-	{
-		BGRA8888 arr[4];
-		arr[0] = CubicInterpolateBGRA32(in[0], x);
-		arr[1] = CubicInterpolateBGRA32(in[1], x);
-		arr[2] = CubicInterpolateBGRA32(in[2], x);
-		arr[3] = CubicInterpolateBGRA32(in[3], x);
-		return CubicInterpolateBGRA32(arr, y);
-	};
-
-	auto CubicInterpolateBGRA16 = [&CubicInterpolate](const BGRA5551 in[4], float x) -> BGRA5551
-	{
-		float b[4] = { (float)in[0].B, (float)in[1].B, (float)in[2].B, (float)in[3].B };
-		float g[4] = { (float)in[0].G, (float)in[1].G, (float)in[2].G, (float)in[3].G };
-		float r[4] = { (float)in[0].R, (float)in[1].R, (float)in[2].R, (float)in[3].R };
-		float a[4] = { (float)in[0].A, (float)in[1].A, (float)in[2].A, (float)in[3].A };
-
-		float bx = CubicInterpolate(b, x);
-		float gx = CubicInterpolate(g, x);
-		float rx = CubicInterpolate(r, x);
-		float ax = CubicInterpolate(a, x);
-
-		bx = std::roundf(bx);
-		gx = std::roundf(gx);
-		rx = std::roundf(rx);
-		if (ax >= 127.5) ax = 1;
-		else ax = 0;
-
-		if (bx > 255) bx = 255;
-		else if (bx < 0) bx = 0;
-		if (gx > 255) gx = 255;
-		else if (gx < 0) gx = 0;
-		if (rx > 255) rx = 255;
-		else if (rx < 0) rx = 0;
-
-		BGRA5551 rval;
-		rval.B = (uchar)bx;
-		rval.G = (uchar)gx;
-		rval.R = (uchar)rx;
-		rval.A = (uchar)ax;
-
-		return rval;
-	};
-
-	auto BicubicInterpolateBGRA16 = [&CubicInterpolateBGRA16](const BGRA5551 in[4][4], float x, float y) -> BGRA5551
-	{
-		BGRA5551 arr[4];
-		arr[0] = CubicInterpolateBGRA16(in[0], x);
-		arr[1] = CubicInterpolateBGRA16(in[1], x);
-		arr[2] = CubicInterpolateBGRA16(in[2], x);
-		arr[3] = CubicInterpolateBGRA16(in[3], x);
-		return CubicInterpolateBGRA16(arr, y);
-	};
-
-	auto CubicInterpolateI = [&CubicInterpolate](const I8 in[4], float x) -> I8
-	{
-		float i[4] = { (float)in[0].I, (float)in[1].I, (float)in[2].I, (float)in[3].I };
-
-		float ix = CubicInterpolate(i, x);
-
-		ix = std::roundf(ix);
-		if (ix > 255) ix = 255;
-		else if (ix < 0) ix = 0;
-
-		I8 rval;
-		rval.I = (uchar)ix;
-
-		return rval;
-	};
-
-	auto BicubicInterpolateI = [&CubicInterpolateI](const I8 in[4][4], float x, float y) -> I8
-	{
-		I8 arr[4];
-		arr[0] = CubicInterpolateI(in[0], x);
-		arr[1] = CubicInterpolateI(in[1], x);
-		arr[2] = CubicInterpolateI(in[2], x);
-		arr[3] = CubicInterpolateI(in[3], x);
-		return CubicInterpolateI(arr, y);
-	};
-
-	auto CubicInterpolateIA = [&CubicInterpolate](const IA88 in[4], float x) -> IA88
-	{
-		float i[4] = { (float)in[0].I, (float)in[1].I, (float)in[2].I, (float)in[3].I };
-		float a[4] = { (float)in[0].A, (float)in[1].A, (float)in[2].A, (float)in[3].A };
-
-		float ix = CubicInterpolate(i, x);
-		float ax = CubicInterpolate(a, x);
-
-		ix = std::roundf(ix);
-		ax = std::roundf(ax);
-		if (ix > 255) ix = 255;
-		else if (ix < 0) ix = 0;
-		if (ax > 255) ax = 255;
-		else if (ax < 0) ax = 0;
-
-		IA88 rval;
-		rval.I = (uchar)ix;
-		rval.A = (uchar)ax;
-
-		return rval;
-	};
-
-	auto BicubicInterpolateIA = [&CubicInterpolateIA](const IA88 in[4][4], float x, float y) -> IA88
-	{
-		IA88 arr[4];
-		arr[0] = CubicInterpolateIA(in[0], x);
-		arr[1] = CubicInterpolateIA(in[1], x);
-		arr[2] = CubicInterpolateIA(in[2], x);
-		arr[3] = CubicInterpolateIA(in[3], x);
-		return CubicInterpolateIA(arr, y);
-	};
-
-	uint16 nWidth = (uint16)(width * scale);
-	uint16 nHeight = (uint16)(height * scale);
-
-	auto rval = (uchar*)malloc((addressable)nWidth * nHeight * BPP);
-
-	// For Each Scanline
-	for (uint16 y = 0; y < nHeight; ++y)
-	{
-		float sy = height * ((float)y / nHeight);
-		uint16 sy0 = (uint16)(sy - 1);
-		uint16 sy1 = (uint16)sy;
-		uint16 sy2 = (uint16)(sy + 1);
-		uint16 sy3 = (uint16)(sy + 2);
-
-		// overflow / boundary checks
-		if (sy0 < 0) sy0 = 0;
-		if (sy2 >= height) sy2 = height - 1;
-		if (sy3 >= height) sy3 = height - 1;
-		if (sy0 > sy1) sy0 = 0;
-		if (sy2 < sy1) sy2 = height - 1;
-		if (sy3 < sy2) sy3 = height - 1;
-
-		float yLoc = sy - sy1;
-
-		// For Each Pixel
-		for (uint16 x = 0; x < nWidth; ++x)
-		{
-			float sx = width * ((float)x / nWidth);
-			uint16 sx0 = (uint16)(sx - 1);
-			uint16 sx1 = (uint16)sx;
-			uint16 sx2 = (uint16)(sx + 1);
-			uint16 sx3 = (uint16)(sx + 2);
-
-			// overflow / boundary checks
-			if (sx0 < 0) sx0 = 0;
-			if (sx2 >= width) sx2 = width - 1;
-			if (sx3 >= width) sx3 = width - 1;
-			if (sx0 > sx1) sx0 = 0;
-			if (sx2 < sx1) sx2 = width - 1;
-			if (sx3 < sx2) sx3 = width - 1;
-
-			float xLoc = sx - sx1;
-
-			if (format == PIXELFORMATS::BGR888)
-			{
-				auto iptr = (BGR888*)data;
-				auto optr = (BGR888*)rval;
-
-				BGR888 cluster[4][4];
-				cluster[0][0] = iptr[sy0 * width + sx0];
-				cluster[0][1] = iptr[sy0 * width + sx1];
-				cluster[0][2] = iptr[sy0 * width + sx2];
-				cluster[0][3] = iptr[sy0 * width + sx3];
-
-				cluster[1][0] = iptr[sy1 * width + sx0];
-				cluster[1][1] = iptr[sy1 * width + sx1];
-				cluster[1][2] = iptr[sy1 * width + sx2];
-				cluster[1][3] = iptr[sy1 * width + sx3];
-
-				cluster[2][0] = iptr[sy2 * width + sx0];
-				cluster[2][1] = iptr[sy2 * width + sx1];
-				cluster[2][2] = iptr[sy2 * width + sx2];
-				cluster[2][3] = iptr[sy2 * width + sx3];
-
-				cluster[3][0] = iptr[sy3 * width + sx0];
-				cluster[3][1] = iptr[sy3 * width + sx1];
-				cluster[3][2] = iptr[sy3 * width + sx2];
-				cluster[3][3] = iptr[sy3 * width + sx3];
-
-				optr[y * nWidth + x] = BicubicInterpolateBGR24(cluster, xLoc, yLoc);
-			}
-			else if (format == PIXELFORMATS::BGRA8888)
-			{
-				auto iptr = (BGRA8888*)data;
-				auto optr = (BGRA8888*)rval;
-
-				BGRA8888 cluster[4][4];
-				cluster[0][0] = iptr[sy0 * width + sx0];
-				cluster[0][1] = iptr[sy0 * width + sx1];
-				cluster[0][2] = iptr[sy0 * width + sx2];
-				cluster[0][3] = iptr[sy0 * width + sx3];
-
-				cluster[1][0] = iptr[sy1 * width + sx0];
-				cluster[1][1] = iptr[sy1 * width + sx1];
-				cluster[1][2] = iptr[sy1 * width + sx2];
-				cluster[1][3] = iptr[sy1 * width + sx3];
-
-				cluster[2][0] = iptr[sy2 * width + sx0];
-				cluster[2][1] = iptr[sy2 * width + sx1];
-				cluster[2][2] = iptr[sy2 * width + sx2];
-				cluster[2][3] = iptr[sy2 * width + sx3];
-
-				cluster[3][0] = iptr[sy3 * width + sx0];
-				cluster[3][1] = iptr[sy3 * width + sx1];
-				cluster[3][2] = iptr[sy3 * width + sx2];
-				cluster[3][3] = iptr[sy3 * width + sx3];
-
-				optr[y * nWidth + x] = BicubicInterpolateBGRA32(cluster, xLoc, yLoc);
-			}
-			else if (format == PIXELFORMATS::BGRA5551)
-			{
-				auto iptr = (BGRA5551*)data;
-				auto optr = (BGRA5551*)rval;
-
-				BGRA5551 cluster[4][4];
-				cluster[0][0] = iptr[sy0 * width + sx0];
-				cluster[0][1] = iptr[sy0 * width + sx1];
-				cluster[0][2] = iptr[sy0 * width + sx2];
-				cluster[0][3] = iptr[sy0 * width + sx3];
-
-				cluster[1][0] = iptr[sy1 * width + sx0];
-				cluster[1][1] = iptr[sy1 * width + sx1];
-				cluster[1][2] = iptr[sy1 * width + sx2];
-				cluster[1][3] = iptr[sy1 * width + sx3];
-
-				cluster[2][0] = iptr[sy2 * width + sx0];
-				cluster[2][1] = iptr[sy2 * width + sx1];
-				cluster[2][2] = iptr[sy2 * width + sx2];
-				cluster[2][3] = iptr[sy2 * width + sx3];
-
-				cluster[3][0] = iptr[sy3 * width + sx0];
-				cluster[3][1] = iptr[sy3 * width + sx1];
-				cluster[3][2] = iptr[sy3 * width + sx2];
-				cluster[3][3] = iptr[sy3 * width + sx3];
-
-				optr[y * nWidth + x] = BicubicInterpolateBGRA16(cluster, xLoc, yLoc);
-			}
-			else if (format == PIXELFORMATS::I8)
-			{
-				auto iptr = (I8*)data;
-				auto optr = (I8*)rval;
-
-				I8 cluster[4][4];
-				cluster[0][0] = iptr[sy0 * width + sx0];
-				cluster[0][1] = iptr[sy0 * width + sx1];
-				cluster[0][2] = iptr[sy0 * width + sx2];
-				cluster[0][3] = iptr[sy0 * width + sx3];
-
-				cluster[1][0] = iptr[sy1 * width + sx0];
-				cluster[1][1] = iptr[sy1 * width + sx1];
-				cluster[1][2] = iptr[sy1 * width + sx2];
-				cluster[1][3] = iptr[sy1 * width + sx3];
-
-				cluster[2][0] = iptr[sy2 * width + sx0];
-				cluster[2][1] = iptr[sy2 * width + sx1];
-				cluster[2][2] = iptr[sy2 * width + sx2];
-				cluster[2][3] = iptr[sy2 * width + sx3];
-
-				cluster[3][0] = iptr[sy3 * width + sx0];
-				cluster[3][1] = iptr[sy3 * width + sx1];
-				cluster[3][2] = iptr[sy3 * width + sx2];
-				cluster[3][3] = iptr[sy3 * width + sx3];
-
-				optr[y * nWidth + x] = BicubicInterpolateI(cluster, xLoc, yLoc);
-			}
-			else
-			{
-				auto iptr = (IA88*)data;
-				auto optr = (IA88*)rval;
-
-				IA88 cluster[4][4];
-				cluster[0][0] = iptr[sy0 * width + sx0];
-				cluster[0][1] = iptr[sy0 * width + sx1];
-				cluster[0][2] = iptr[sy0 * width + sx2];
-				cluster[0][3] = iptr[sy0 * width + sx3];
-
-				cluster[1][0] = iptr[sy1 * width + sx0];
-				cluster[1][1] = iptr[sy1 * width + sx1];
-				cluster[1][2] = iptr[sy1 * width + sx2];
-				cluster[1][3] = iptr[sy1 * width + sx3];
-
-				cluster[2][0] = iptr[sy2 * width + sx0];
-				cluster[2][1] = iptr[sy2 * width + sx1];
-				cluster[2][2] = iptr[sy2 * width + sx2];
-				cluster[2][3] = iptr[sy2 * width + sx3];
-
-				cluster[3][0] = iptr[sy3 * width + sx0];
-				cluster[3][1] = iptr[sy3 * width + sx1];
-				cluster[3][2] = iptr[sy3 * width + sx2];
-				cluster[3][3] = iptr[sy3 * width + sx3];
-
-				optr[y * nWidth + x] = BicubicInterpolateIA(cluster, xLoc, yLoc);
-			}
-		}
-	}
-
-	return rval;
-}
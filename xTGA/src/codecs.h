@@ -12,10 +12,14 @@
 
 #include "xTGA/api.h"
 #include "xTGA/error.h"
+#include "xTGA/flags.h"
 #include "xTGA/pixelformats.h"
 #include "xTGA/structures.h"
+#include "xTGA/tga_file.h"
 #include "xTGA/types.h"
 
+#include <functional>
+
 namespace xtga
 {
 	constexpr uchar LUT5[] = { 0, 8, 16, 25, 33, 41, 49, 58, 66, 74, 82, 90, 99, 107, 115, 123, 132,
@@ -28,6 +32,8 @@ namespace xtga
 
 	namespace codecs
 	{
+		class InverseColorMap;
+
 		//----------------------------------------------------------------------------------------------------
 		/// Decodes a Run-Length encoded image buffer.
 		/// @param[in] buffer				The image buffer to decode.
@@ -39,6 +45,49 @@ namespace xtga
 		//----------------------------------------------------------------------------------------------------
 		void* DecodeRLE(void const * buffer, uchar depth, addressable length, ERRORCODE* error = nullptr);
 
+		//----------------------------------------------------------------------------------------------------
+		/// Decodes a Run-Length encoded image buffer into a caller provided buffer.
+		/// @param[in] buffer				The image buffer to decode.
+		/// @param[in] depth				The number of bits each pixel occupies (must be 8/16/24/32).
+		/// @param[in] length				The number of pixels the buffer contains.
+		/// @param[out] out					Receives the decoded pixels, 'length' * depth / 8 bytes.
+		/// @param[out] error				Holds the error/status code should an error occur (can be nullptr).
+		/// @return bool					True if the image was decoded.
+		//----------------------------------------------------------------------------------------------------
+		bool DecodeRLEInto(void const * buffer, uchar depth, addressable length, void* out, ERRORCODE* error = nullptr);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Decodes a Run-Length encoded image one row at a time, so only a row is ever held in memory.
+		/// Packets may span rows.
+		//----------------------------------------------------------------------------------------------------
+		class RLERowReader
+		{
+		public:
+			//----------------------------------------------------------------------------------------------------
+			/// Starts reading at the first packet of an image.
+			/// @param[in] buffer				The image buffer to decode.
+			/// @param[in] depth				The number of bits each pixel occupies (must be 8/16/24/32).
+			/// @param[in] width				The number of pixels in a row.
+			//----------------------------------------------------------------------------------------------------
+			RLERowReader(void const* buffer, uchar depth, uint16 width);
+
+			//----------------------------------------------------------------------------------------------------
+			/// Decodes the next row.
+			/// @param[out] out					Receives 'width' pixels.
+			//----------------------------------------------------------------------------------------------------
+			void ReadRow(void* out);
+
+		private:
+			// consumes 'pixels' pixels, copying them to 'out'.
+			void Advance(addressable pixels, uchar* out);
+
+			const uchar* _Next;
+			uint32 _Left;
+			bool _Run;
+			uchar _BPP;
+			uint16 _Width;
+		};
+
 		//----------------------------------------------------------------------------------------------------
 		/// Encodes the given image buffer with run-length encoding. (Scanlines Respected)
 		/// @param[in] buffer				The image buffer to encode.
@@ -51,6 +100,27 @@ namespace xtga
 		//----------------------------------------------------------------------------------------------------
 		bool EncodeRLE(void const* buffer, void*& obuffer, uint16 width, uint16 height, uchar depth, ERRORCODE* error = nullptr);
 
+		//----------------------------------------------------------------------------------------------------
+		/// Encodes one scanline with run-length encoding, the packets EncodeRLE() would produce for it.
+		/// @param[in] row					The scanline to encode.
+		/// @param[in] width				The width of the scanline in pixels.
+		/// @param[in] bpp					The number of bytes each pixel occupies (must be 1/2/3/4).
+		/// @param[out] out					Receives the packets, must hold RLERowBound(width, bpp) bytes.
+		/// @return addressable				The number of bytes written.
+		//----------------------------------------------------------------------------------------------------
+		addressable EncodeRLERow(void const* row, uint16 width, uchar bpp, void* out);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the most bytes EncodeRLERow() can write for a scanline, one header per 128 raw pixels.
+		/// @param[in] width				The width of the scanline in pixels.
+		/// @param[in] bpp					The number of bytes each pixel occupies.
+		/// @return addressable				The worst case size of the encoded scanline.
+		//----------------------------------------------------------------------------------------------------
+		constexpr addressable RLERowBound(uint16 width, uchar bpp)
+		{
+			return (addressable)width * bpp + (width + 127) / 128;
+		}
+
 		//----------------------------------------------------------------------------------------------------
 		/// Decodes a color mapped image buffer.
 		/// @param[in] ImageBuffer			The image buffer to decode.
@@ -62,6 +132,59 @@ namespace xtga
 		//----------------------------------------------------------------------------------------------------
 		void* DecodeColorMap(void const* ImageBuffer, addressable length, void const* ColorMap, uchar depth, ERRORCODE* error = nullptr);
 
+		//----------------------------------------------------------------------------------------------------
+		/// Replaces every color map index with its entry, the color map must already be in the output format.
+		/// @param[in] indices				The color map indices.
+		/// @param[in] length				The number of indices.
+		/// @param[in] palette				The color map, in the output format.
+		/// @param[in] bpp					The bytes per entry/output pixel (must be 1/2/3/4).
+		/// @param[out] out					Receives 'length' pixels.
+		//----------------------------------------------------------------------------------------------------
+		void ExpandIndices(const uchar* indices, addressable length, const void* palette, uchar bpp, void* out);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Converts a color map to RGBA8888 once, so that indices can be expanded straight to RGBA.
+		/// @param[in] ColorMap				The color map.
+		/// @param[in] clength				The number of entries in the color map.
+		/// @param[in] format				The format of the entries (BGRA8888/BGR888/BGRA5551/IA88).
+		/// @param[out] palette				Receives 256 entries, those past 'clength' are transparent black.
+		/// @param[out] error				Holds the error/status code should an error occur (can be nullptr).
+		/// @return bool					True if the format is supported.
+		//----------------------------------------------------------------------------------------------------
+		bool ExpandColorMapRGBA(const void* ColorMap, uint16 clength, pixelformats::PIXELFORMATS format, pixelformats::RGBA8888* palette, ERRORCODE* error = nullptr);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Decodes a color mapped image straight to the format of 'palette', with the top left pixel first.
+		/// RLE and the origin are undone on the 8-bit indices, then each index is expanded once.
+		/// @param[in] buffer				The color mapped image buffer.
+		/// @param[out] obuffer				The decoded image (pass through a nullptr).
+		/// @param[in] origin				The location of the first pixel.
+		/// @param[in] w					The width of the image.
+		/// @param[in] h					The height of the image.
+		/// @param[in] rle					True if the image has run-length encoding.
+		/// @param[in] palette				The color map, in the output format.
+		/// @param[in] bpp					The bytes per entry/output pixel (must be 1/2/3/4).
+		/// @param[out] error				Holds the error/status code (can be nullptr).
+		/// @return bool					Returns true if the image was successfully decoded.
+		//----------------------------------------------------------------------------------------------------
+		bool DecodeColorMappedImage(const void* buffer, void*& obuffer, flags::IMAGEORIGIN origin, uint16 w, uint16 h, bool rle, const void* palette, uchar bpp, ERRORCODE* error = nullptr);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Runs a function on every stored pixel of a buffer in place, each pixel goes through RGBA8888. An
+		/// RLE buffer is walked packet by packet and a repeat packet's pixel is transformed once, so neither
+		/// the packets nor the size of the buffer change.
+		/// @param[in,out] buffer			The pixels (or RLE packets), also used for color maps.
+		/// @param[in] length				The number of pixels (once decoded if the buffer is RLE).
+		/// @param[in] format				The format of the pixels (BGRA8888/BGR888/BGRA5551/IA88/I8).
+		/// @param[in] rle					True if the buffer is run-length encoded.
+		/// @param[in] fn					The function to run on each pixel.
+		/// @param[in] parallel				If true (and the buffer isn't RLE) fn may run on several threads at once.
+		/// @param[out] error				Holds the error/status code should an error occur (can be nullptr).
+		/// @return bool					True if the format is supported.
+		//----------------------------------------------------------------------------------------------------
+		bool TransformPixels(void* buffer, addressable length, pixelformats::PIXELFORMATS format, bool rle,
+			const std::function<void(pixelformats::RGBA8888&)>& fn, bool parallel, ERRORCODE* error = nullptr);
+
 		//----------------------------------------------------------------------------------------------------
 		/// Takes an array of pixels with the first entry being the bottom left pixel and converts it to
 		/// an array of pixels with the first entry being the top left pixel.
@@ -133,6 +256,41 @@ namespace xtga
 		//----------------------------------------------------------------------------------------------------
 		pixelformats::RGBA8888 IA_To_RGBA(pixelformats::IA88 pixel);
 
+		//----------------------------------------------------------------------------------------------------
+		/// Converts a pixel of type RGBA to BGRA.
+		/// @param[in] pixel				The RGBA pixel to convert.
+		/// @return BGRA8888				The converted pixel.
+		//----------------------------------------------------------------------------------------------------
+		pixelformats::BGRA8888 RGBA_To_BGRA(pixelformats::RGBA8888 pixel);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Converts a pixel of type RGBA to BGRA16. BGR truncated to 5 bits, A set to 1 only if 0xFF.
+		/// @param[in] pixel				The RGBA pixel to convert.
+		/// @return BGRA5551				The converted pixel.
+		//----------------------------------------------------------------------------------------------------
+		pixelformats::BGRA5551 RGBA_To_BGRA16(pixelformats::RGBA8888 pixel);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Converts a pixel of type RGBA to BGR. A is dropped.
+		/// @param[in] pixel				The RGBA pixel to convert.
+		/// @return BGR888					The converted pixel.
+		//----------------------------------------------------------------------------------------------------
+		pixelformats::BGR888 RGBA_To_BGR(pixelformats::RGBA8888 pixel);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Converts a pixel of type RGBA to I. I is set to (R + 2G + B) / 4, A is dropped.
+		/// @param[in] pixel				The RGBA pixel to convert.
+		/// @return I8						The converted pixel.
+		//----------------------------------------------------------------------------------------------------
+		pixelformats::I8 RGBA_To_I(pixelformats::RGBA8888 pixel);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Converts a pixel of type RGBA to IA. I is set to (R + 2G + B) / 4, A is set to A.
+		/// @param[in] pixel				The RGBA pixel to convert.
+		/// @return IA88					The converted pixel.
+		//----------------------------------------------------------------------------------------------------
+		pixelformats::IA88 RGBA_To_IA(pixelformats::RGBA8888 pixel);
+
 		//----------------------------------------------------------------------------------------------------
 		/// Generates a Color Map from an input buffer.
 		/// @param[in] inBuff				The input image buffer.
@@ -144,10 +302,16 @@ namespace xtga
 		/// @param[in] force				If true a color map will be generated even if it won't perfectly represent
 		///									the input data, this is done by taking the 256 most common values and
 		///									then forcing each pixel to go to the closest common value (weighted).
+		/// @param[in] quantizer			The quantizer used when the color map is forced.
+		/// @param[in] refinement			The number of k-means iterations run on a forced color map (0 for none).
+		/// @param[in] samples				Build a forced color map from this many sampled pixels (0 for every pixel).
+		/// @param[out] stats				Receives the error of the color map (can be nullptr).
 		/// @param[out] error				The error/status code (can be nullptr).
 		/// @return bool					True if the color map could be generated.
 		//----------------------------------------------------------------------------------------------------
-		bool GenerateColorMap(const void* inBuff, void*& outBuff, void*& colorBuff, addressable length, uchar depth, uint16& Size, bool force = false, ERRORCODE* error = nullptr);
+		bool GenerateColorMap(const void* inBuff, void*& outBuff, void*& colorBuff, addressable length, uchar depth, uint16& Size, bool force = false,
+			flags::QUANTIZER quantizer = flags::QUANTIZER::MEDIAN_CUT, uchar refinement = 0, addressable samples = 0, ColorMapStats* stats = nullptr,
+			ERRORCODE* error = nullptr);
 
 		//----------------------------------------------------------------------------------------------------
 		/// Applies a colormap to an existing image buffer.
@@ -156,10 +320,12 @@ namespace xtga
 		/// @param[in] colormap				The input color map.
 		/// @param[in] clength				The length of the colormap buffer (in pixels).
 		/// @param[in] depth				The bits per pixel of the input image (must be 16/24/32).
+		/// @param[in] inverse				An inverse color map built for 'colormap', turns the search for each pixel
+		///									into a single table lookup (can be nullptr).
 		/// @param[out] error				Holds the error/status code (can be nullptr).
 		/// @return void*					The converted image buffer.
 		//----------------------------------------------------------------------------------------------------
-		void* ApplyColorMap(const void* buff, addressable ilength, const void* colormap, uint16 clength, uchar depth, ERRORCODE* error = nullptr);
+		void* ApplyColorMap(const void* buff, addressable ilength, const void* colormap, uint16 clength, uchar depth, const InverseColorMap* inverse = nullptr, ERRORCODE* error = nullptr);
 
 		//----------------------------------------------------------------------------------------------------
 		/// Decodes an input image into its original format with the top left pixel being first.
@@ -175,18 +341,6 @@ namespace xtga
 		/// @return bool					Returns true if the image was successfully decoded.
 		//----------------------------------------------------------------------------------------------------
 		bool DecodeImage(const void* buffer, void*& obuffer, flags::IMAGEORIGIN origin, uint16 w, uint16 h, uchar depth, bool rle, const void* colormap = nullptr, ERRORCODE* error = nullptr);
-
-		//----------------------------------------------------------------------------------------------------
-		/// Scales an image using bicubic interpolation.
-		/// @param[in] data					The input data to scale.
-		/// @param[in] format				Must be BGR888, BGRA8888, BGRA5551, I8, or IA88.
-		/// @param[in] width				The width of the input image (in pixels).
-		/// @param[in] height				The height of the input image (in pixels).
-		/// @param[in] scale				The scale to use.
-		/// @param[out] error				Holds the error/status code (can be nullptr).
-		/// @return void*					The scaled image (or nullptr if an error occured).
-		//----------------------------------------------------------------------------------------------------
-		void* ScaleImageBicubic(const void* data, pixelformats::PIXELFORMATS format, uint16 width, uint16 height, float scale, ERRORCODE* error = nullptr);
 	}
 }
 
@@ -0,0 +1,425 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: convert.cpp
+/// purpose : Converts pixels from the input formats to the formats a TGA file stores.
+//==============================================================================
+
+#include "convert.h"
+
+#include "codecs.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define XTGA_CONVERT_SSE2
+#	include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#	define XTGA_CONVERT_NEON
+#	include <arm_neon.h>
+#endif
+
+using namespace xtga;
+using namespace xtga::pixelformats;
+
+namespace
+{
+	typedef PIXELFORMATS PF;
+
+	BGRA8888 MakeBGRA(uchar b, uchar g, uchar r, uchar a)
+	{
+		BGRA8888 p;
+		p.B = b;
+		p.G = g;
+		p.R = r;
+		p.A = a;
+		return p;
+	}
+
+	// every input format is read into BGRA8888 and every output format written from it (plus the pixel's
+	// intensity for the grayscale ones), formats without alpha read as opaque.
+	template <PF F> struct Pixel;
+
+	template <> struct Pixel<PF::RGB888>
+	{
+		typedef RGB888 Type;
+		static BGRA8888 Load(const Type& p) { return MakeBGRA(p.B, p.G, p.R, 255); }
+	};
+
+	template <> struct Pixel<PF::BGR888>
+	{
+		typedef BGR888 Type;
+		static BGRA8888 Load(const Type& p) { return MakeBGRA(p.B, p.G, p.R, 255); }
+		static void Store(const BGRA8888& c, uchar, Type& p) { p.B = c.B; p.G = c.G; p.R = c.R; }
+	};
+
+	template <> struct Pixel<PF::RGB565>
+	{
+		typedef RGB565 Type;
+		static BGRA8888 Load(const Type& p) { return MakeBGRA(LUT5[p.B], LUT6[p.G], LUT5[p.R], 255); }
+	};
+
+	template <> struct Pixel<PF::BGR565>
+	{
+		typedef BGR565 Type;
+		static BGRA8888 Load(const Type& p) { return MakeBGRA(LUT5[p.B], LUT6[p.G], LUT5[p.R], 255); }
+	};
+
+	template <> struct Pixel<PF::ARGB1555>
+	{
+		typedef ARGB1555 Type;
+		static BGRA8888 Load(const Type& p) { return MakeBGRA(LUT5[p.B], LUT5[p.G], LUT5[p.R], p.A ? 255 : 0); }
+	};
+
+	template <> struct Pixel<PF::BGRA5551>
+	{
+		typedef BGRA5551 Type;
+		static BGRA8888 Load(const Type& p) { return MakeBGRA(LUT5[p.B], LUT5[p.G], LUT5[p.R], p.A ? 255 : 0); }
+		static void Store(const BGRA8888& c, uchar, Type& p)
+		{
+			p.B = c.B >> 3;
+			p.G = c.G >> 3;
+			p.R = c.R >> 3;
+			p.A = c.A == 255 ? 1 : 0;
+		}
+	};
+
+	template <> struct Pixel<PF::I8>
+	{
+		typedef I8 Type;
+		static BGRA8888 Load(const Type& p) { return MakeBGRA(p.I, p.I, p.I, 255); }
+		static void Store(const BGRA8888&, uchar i, Type& p) { p.I = i; }
+	};
+
+	template <> struct Pixel<PF::IA88>
+	{
+		typedef IA88 Type;
+		static BGRA8888 Load(const Type& p) { return MakeBGRA(p.I, p.I, p.I, p.A); }
+		static void Store(const BGRA8888& c, uchar i, Type& p) { p.I = i; p.A = c.A; }
+	};
+
+	template <> struct Pixel<PF::AI88>
+	{
+		typedef AI88 Type;
+		static BGRA8888 Load(const Type& p) { return MakeBGRA(p.I, p.I, p.I, p.A); }
+	};
+
+	template <> struct Pixel<PF::RGBA8888>
+	{
+		typedef RGBA8888 Type;
+		static BGRA8888 Load(const Type& p) { return MakeBGRA(p.B, p.G, p.R, p.A); }
+	};
+
+	template <> struct Pixel<PF::ABGR8888>
+	{
+		typedef ABGR8888 Type;
+		static BGRA8888 Load(const Type& p) { return MakeBGRA(p.B, p.G, p.R, p.A); }
+	};
+
+	template <> struct Pixel<PF::ARGB8888>
+	{
+		typedef ARGB8888 Type;
+		static BGRA8888 Load(const Type& p) { return MakeBGRA(p.B, p.G, p.R, p.A); }
+	};
+
+	template <> struct Pixel<PF::BGRA8888>
+	{
+		typedef BGRA8888 Type;
+		static BGRA8888 Load(const Type& p) { return p; }
+		static void Store(const BGRA8888& c, uchar, Type& p) { p = c; }
+	};
+
+	// the intensity of a pixel, (R + 2G + B) / 4 so that gray inputs come back out unchanged.
+	template <PF F>
+	uchar Intensity(const typename Pixel<F>::Type& p)
+	{
+		const BGRA8888 c = Pixel<F>::Load(p);
+		return (uchar)((c.R + 2 * c.G + c.B) >> 2);
+	}
+
+	// 5-bit channels are averaged before they are expanded.
+	template <>
+	uchar Intensity<PF::ARGB1555>(const ARGB1555& p)
+	{
+		return LUT5[(p.R + 2 * p.G + p.B) >> 2];
+	}
+
+	template <>
+	uchar Intensity<PF::BGRA5551>(const BGRA5551& p)
+	{
+		return LUT5[(p.R + 2 * p.G + p.B) >> 2];
+	}
+
+#if defined(XTGA_CONVERT_SSE2)
+	// swaps the first and third byte of each of four pixels.
+	inline __m128i SwapRB4(__m128i p)
+	{
+		const __m128i ga = _mm_set1_epi32((int)0xFF00FF00);
+		const __m128i lo = _mm_set1_epi32(0x000000FF);
+		return _mm_or_si128(_mm_and_si128(p, ga),
+			_mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 16), lo), _mm_slli_epi32(_mm_and_si128(p, lo), 16)));
+	}
+#endif
+
+	// swaps the R and B bytes of 'count' RGBA/BGRA pixels, the same operation both ways.
+	void SwapRB(const uchar* in, uchar* out, uint32 count)
+	{
+		uint32 x = 0;
+#if defined(XTGA_CONVERT_SSE2)
+		for (; x + 4 <= count; x += 4)
+		{
+			const __m128i p = _mm_loadu_si128((const __m128i*)(in + (addressable)x * 4));
+			_mm_storeu_si128((__m128i*)(out + (addressable)x * 4), SwapRB4(p));
+		}
+#elif defined(XTGA_CONVERT_NEON)
+		for (; x + 16 <= count; x += 16)
+		{
+			uint8x16x4_t p = vld4q_u8(in + (addressable)x * 4);
+			const uint8x16_t t = p.val[0];
+			p.val[0] = p.val[2];
+			p.val[2] = t;
+			vst4q_u8(out + (addressable)x * 4, p);
+		}
+#endif
+		for (; x < count; ++x)
+		{
+			auto i = in + (addressable)x * 4;
+			auto o = out + (addressable)x * 4;
+			const uchar t = i[0];
+			o[0] = i[2];
+			o[1] = i[1];
+			o[2] = t;
+			o[3] = i[3];
+		}
+	}
+
+	// drops the alpha of 'count' 4-byte pixels, swapping R and B if asked. SSE2 packs four pixels in a
+	// register, NEON deinterleaves sixteen, and anything else works on 64-bit words.
+	template <bool Swap>
+	void PackBGR(const uchar* in, uchar* out, uint32 count)
+	{
+		uint32 x = 0;
+#if defined(XTGA_CONVERT_SSE2)
+		const __m128i pair = _mm_set1_epi64x(0x0000000000FFFFFF);
+		const __m128i lo6 = _mm_set_epi32(0, 0, 0x0000FFFF, (int)0xFFFFFFFF);
+		const __m128i hi6 = _mm_set_epi32(0, (int)0xFFFFFFFF, (int)0xFFFF0000, 0);
+		for (; x + 4 <= count; x += 4)
+		{
+			__m128i p = _mm_loadu_si128((const __m128i*)(in + (addressable)x * 4));
+			if (Swap)
+				p = SwapRB4(p);
+
+			// each 64-bit lane -> six bytes, then the lanes are joined into twelve.
+			const __m128i r = _mm_or_si128(_mm_and_si128(p, pair), _mm_srli_epi64(_mm_and_si128(p, _mm_slli_epi64(pair, 32)), 8));
+			const __m128i o = _mm_or_si128(_mm_and_si128(r, lo6), _mm_and_si128(_mm_srli_si128(r, 2), hi6));
+
+			auto d = out + (addressable)x * 3;
+			_mm_storel_epi64((__m128i*)d, o);
+			const int tail = _mm_cvtsi128_si32(_mm_srli_si128(o, 8));
+			memcpy(d + 8, &tail, sizeof(tail));
+		}
+#elif defined(XTGA_CONVERT_NEON)
+		for (; x + 16 <= count; x += 16)
+		{
+			const uint8x16x4_t p = vld4q_u8(in + (addressable)x * 4);
+			uint8x16x3_t o;
+			o.val[0] = Swap ? p.val[2] : p.val[0];
+			o.val[1] = p.val[1];
+			o.val[2] = Swap ? p.val[0] : p.val[2];
+			vst3q_u8(out + (addressable)x * 3, o);
+		}
+#endif
+		for (; x + 4 <= count; x += 4)
+		{
+			uint64 p[2];
+			memcpy(p, in + (addressable)x * 4, sizeof(p));
+
+			if (Swap)
+			{
+				p[0] = (p[0] & 0x0000FF000000FF00) | ((p[0] >> 16) & 0x000000FF000000FF) | ((p[0] & 0x000000FF000000FF) << 16);
+				p[1] = (p[1] & 0x0000FF000000FF00) | ((p[1] >> 16) & 0x000000FF000000FF) | ((p[1] & 0x000000FF000000FF) << 16);
+			}
+
+			// two pixels -> six bytes per word, then the two words -> twelve.
+			const uint64 a = (p[0] & 0xFFFFFF) | ((p[0] >> 8) & 0xFFFFFF000000);
+			const uint64 b = (p[1] & 0xFFFFFF) | ((p[1] >> 8) & 0xFFFFFF000000);
+			const uint64 lo = a | (b << 48);
+			const uint32 hi = (uint32)(b >> 16);
+
+			auto o = out + (addressable)x * 3;
+			memcpy(o, &lo, sizeof(lo));
+			memcpy(o + sizeof(lo), &hi, sizeof(hi));
+		}
+
+		for (; x < count; ++x)
+		{
+			auto i = in + (addressable)x * 4;
+			auto o = out + (addressable)x * 3;
+			o[0] = i[Swap ? 2 : 0];
+			o[1] = i[1];
+			o[2] = i[Swap ? 0 : 2];
+		}
+	}
+
+	template <PF In, PF Out>
+	struct RowKernel
+	{
+		static void Convert(const void* input, void* output, uint32 width)
+		{
+			auto i = (const typename Pixel<In>::Type*)input;
+			auto o = (typename Pixel<Out>::Type*)output;
+
+			for (uint32 x = 0; x < width; ++x)
+				Pixel<Out>::Store(Pixel<In>::Load(i[x]), Intensity<In>(i[x]), o[x]);
+		}
+	};
+
+	template <PF F>
+	struct RowKernel<F, F>
+	{
+		static void Convert(const void* input, void* output, uint32 width)
+		{
+			memcpy(output, input, (addressable)width * sizeof(typename Pixel<F>::Type));
+		}
+	};
+
+	template <>
+	struct RowKernel<PF::RGBA8888, PF::BGRA8888>
+	{
+		static void Convert(const void* input, void* output, uint32 width)
+		{
+			SwapRB((const uchar*)input, (uchar*)output, width);
+		}
+	};
+
+	template <>
+	struct RowKernel<PF::RGBA8888, PF::BGR888>
+	{
+		static void Convert(const void* input, void* output, uint32 width)
+		{
+			PackBGR<true>((const uchar*)input, (uchar*)output, width);
+		}
+	};
+
+	template <>
+	struct RowKernel<PF::BGRA8888, PF::BGR888>
+	{
+		static void Convert(const void* input, void* output, uint32 width)
+		{
+			PackBGR<false>((const uchar*)input, (uchar*)output, width);
+		}
+	};
+
+	// one row of kernels per output format, indexed by the value of the input format.
+#define XTGA_ROW_KERNELS(OUT) {											\
+		&RowKernel<PF::RGB888, PF::OUT>::Convert,		&RowKernel<PF::BGR888, PF::OUT>::Convert,		\
+		&RowKernel<PF::RGB565, PF::OUT>::Convert,		&RowKernel<PF::BGR565, PF::OUT>::Convert,		\
+		&RowKernel<PF::ARGB1555, PF::OUT>::Convert,	&RowKernel<PF::BGRA5551, PF::OUT>::Convert,	\
+		&RowKernel<PF::I8, PF::OUT>::Convert,				&RowKernel<PF::IA88, PF::OUT>::Convert,			\
+		&RowKernel<PF::AI88, PF::OUT>::Convert,			&RowKernel<PF::RGBA8888, PF::OUT>::Convert,	\
+		&RowKernel<PF::ABGR8888, PF::OUT>::Convert,	&RowKernel<PF::ARGB8888, PF::OUT>::Convert,	\
+		&RowKernel<PF::BGRA8888, PF::OUT>::Convert }
+
+	constexpr codecs::RowTransformFunc RowKernels[][13] =
+	{
+		XTGA_ROW_KERNELS(BGR888),
+		XTGA_ROW_KERNELS(BGRA5551),
+		XTGA_ROW_KERNELS(BGRA8888),
+		XTGA_ROW_KERNELS(I8),
+		XTGA_ROW_KERNELS(IA88)
+	};
+
+#undef XTGA_ROW_KERNELS
+
+	// the row of RowKernels for an output format, -1 if it can't be stored.
+	constexpr int OutputIndex(PF format)
+	{
+		return format == PF::BGR888 ? 0 :
+			format == PF::BGRA5551 ? 1 :
+			format == PF::BGRA8888 ? 2 :
+			format == PF::I8 ? 3 :
+			format == PF::IA88 ? 4 : -1;
+	}
+}
+
+uchar xtga::codecs::InputPixelSize(PIXELFORMATS format)
+{
+	switch (format)
+	{
+	case PIXELFORMATS::I8:
+		return 1;
+
+	case PIXELFORMATS::AI88:
+	case PIXELFORMATS::ARGB1555:
+	case PIXELFORMATS::BGR565:
+	case PIXELFORMATS::BGRA5551:
+	case PIXELFORMATS::IA88:
+	case PIXELFORMATS::RGB565:
+		return 2;
+
+	case PIXELFORMATS::BGR888:
+	case PIXELFORMATS::RGB888:
+		return 3;
+
+	case PIXELFORMATS::ABGR8888:
+	case PIXELFORMATS::ARGB8888:
+	case PIXELFORMATS::BGRA8888:
+	case PIXELFORMATS::RGBA8888:
+		return 4;
+
+	default:
+		return 0;
+	}
+}
+
+codecs::RowTransformFunc xtga::codecs::GetRowTransform(PIXELFORMATS from, PIXELFORMATS to)
+{
+	const int out = OutputIndex(to);
+	const uchar in = (uchar)from;
+
+	if (out < 0 || in >= 13)
+		return nullptr;
+
+	return RowKernels[out][in];
+}
+
+bool xtga::codecs::DescribeOutputFormat(structs::Header* header, PIXELFORMATS format)
+{
+	switch (format)
+	{
+	case PIXELFORMATS::BGR888:
+		header->IMAGE_DEPTH = 24;
+		header->IMAGE_DESCRIPTOR.ALPHA_CHANNEL_BITCOUNT = 0;
+		header->IMAGE_TYPE = flags::IMAGETYPE::TRUE_COLOR;
+		return true;
+
+	case PIXELFORMATS::BGRA5551:
+		header->IMAGE_DEPTH = 16;
+		header->IMAGE_DESCRIPTOR.ALPHA_CHANNEL_BITCOUNT = 1;
+		header->IMAGE_TYPE = flags::IMAGETYPE::TRUE_COLOR;
+		return true;
+
+	case PIXELFORMATS::BGRA8888:
+		header->IMAGE_DEPTH = 32;
+		header->IMAGE_DESCRIPTOR.ALPHA_CHANNEL_BITCOUNT = 8;
+		header->IMAGE_TYPE = flags::IMAGETYPE::TRUE_COLOR;
+		return true;
+
+	case PIXELFORMATS::I8:
+		header->IMAGE_DEPTH = 8;
+		header->IMAGE_DESCRIPTOR.ALPHA_CHANNEL_BITCOUNT = 0;
+		header->IMAGE_TYPE = flags::IMAGETYPE::GRAYSCALE;
+		return true;
+
+	case PIXELFORMATS::IA88:
+		header->IMAGE_DEPTH = 16;
+		header->IMAGE_DESCRIPTOR.ALPHA_CHANNEL_BITCOUNT = 8;
+		header->IMAGE_TYPE = flags::IMAGETYPE::GRAYSCALE;
+		return true;
+
+	default:
+		return false;
+	}
+}
@@ -0,0 +1,56 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: convert.h
+/// purpose : Converts pixels from the input formats to the formats a TGA file stores.
+//==============================================================================
+
+#ifndef XTGA_CONVERT_H__
+#define XTGA_CONVERT_H__
+
+#include "xTGA/pixelformats.h"
+#include "xTGA/structures.h"
+#include "xTGA/types.h"
+
+namespace xtga
+{
+	namespace codecs
+	{
+		//----------------------------------------------------------------------------------------------------
+		/// Converts a row of pixels.
+		/// @param[in] input				The pixels to convert.
+		/// @param[out] output				Receives the converted pixels (must not overlap 'input').
+		/// @param[in] width				The number of pixels to convert.
+		//----------------------------------------------------------------------------------------------------
+		typedef void (*RowTransformFunc)(const void* input, void* output, uint32 width);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the size of a pixel in one of the input formats.
+		/// @param[in] format				The pixel format.
+		/// @return uchar					The size of a pixel (in bytes, or 0 if the format is unknown).
+		//----------------------------------------------------------------------------------------------------
+		uchar InputPixelSize(pixelformats::PIXELFORMATS format);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the function that converts rows of pixels from 'from' to 'to'. Every pair has its own
+		/// kernel, generated at compile time, matching formats copy the row and RGBA8888/BGRA8888 to
+		/// BGRA8888/BGR888 swizzle several pixels at a time.
+		/// @param[in] from					The input format.
+		/// @param[in] to					The output format, one of BGR888, BGRA5551, BGRA8888, I8, or IA88.
+		/// @return RowTransformFunc		The conversion (or nullptr if the pair is not supported).
+		//----------------------------------------------------------------------------------------------------
+		RowTransformFunc GetRowTransform(pixelformats::PIXELFORMATS from, pixelformats::PIXELFORMATS to);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Sets the image type, depth, and alpha bits of a header for an uncompressed image stored in 'format'.
+		/// @param[in,out] header			The header to fill.
+		/// @param[in] format				The output format, one of BGR888, BGRA5551, BGRA8888, I8, or IA88.
+		/// @return bool					False if the format can't be stored.
+		//----------------------------------------------------------------------------------------------------
+		bool DescribeOutputFormat(structs::Header* header, pixelformats::PIXELFORMATS format);
+	}
+}
+
+#endif // !XTGA_CONVERT_H__
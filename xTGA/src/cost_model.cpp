@@ -0,0 +1,214 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: cost_model.cpp
+/// purpose : Decides whether work is run serially, vectorized or threaded.
+//==============================================================================
+
+#include "xTGA/threading.h"
+
+#include "palette.h"
+#include "resample.h"
+#include "thread_pool.h"
+#include "xTGA/allocator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace
+{
+	using namespace xtga;
+	using threading::WORKLOAD;
+	using threading::EXECUTION;
+
+	constexpr uchar WorkloadCount = 4;
+
+	// work is only threaded once it would take this many times the dispatch overhead serially.
+	constexpr double OverheadFactor = 8.0;
+
+	// below this the split would be a single part anyway (two of ParallelFor's default grain).
+	constexpr uint64 MinimumThreshold = 8192;
+
+	struct CostModel
+	{
+		std::mutex Lock;
+
+		// nanoseconds to hand work to the pool and wait for it to come back.
+		double DispatchNs = 20000.0;
+
+		// nanoseconds per 32-bit pixel (per pixel and color map entry for COLORMAP_SEARCH, per tap for RESAMPLE).
+		double PixelNs[WorkloadCount] = { 60.0, 0.15, 3.0, 0.3 };
+
+		// nanoseconds per pixel and color map entry for COLORMAP_SEARCH without vector code.
+		double SearchScalarNs = 1.0;
+
+		uint64 Threshold[WorkloadCount] = { 0, 0, 0, 0 };
+	};
+
+	CostModel& Model()
+	{
+		static CostModel m;
+		return m;
+	}
+
+	// BUILD, LOOKUP and RESAMPLE are mostly memory bound, smaller pixels are a little cheaper.
+	double DepthFactor(uchar depth)
+	{
+		uchar bytes = (depth + 7) / 8;
+		return (bytes + 4) / 8.0;
+	}
+
+	double SerialNsPerPixel(const CostModel& m, WORKLOAD workload, uchar depth, uint16 entries)
+	{
+		if (workload == WORKLOAD::COLORMAP_SEARCH)
+		{
+			double perEntry = codecs::PaletteMatcher::HasSimd() ? m.PixelNs[(uchar)workload] : m.SearchScalarNs;
+			return perEntry * std::max<uint16>(entries, 1);
+		}
+
+		return m.PixelNs[(uchar)workload] * DepthFactor(depth);
+	}
+
+	uint64 Threshold(const CostModel& m, WORKLOAD workload, uchar depth, uint16 entries)
+	{
+		if (m.Threshold[(uchar)workload] != 0)
+			return m.Threshold[(uchar)workload];
+
+		double perPixel = SerialNsPerPixel(m, workload, depth, entries);
+		uint64 t = (uint64)std::ceil(OverheadFactor * m.DispatchNs / perPixel);
+		return std::max(t, MinimumThreshold);
+	}
+
+	// runs fn 'reps' times and returns the fastest run in nanoseconds.
+	template <typename Fn>
+	double BestOf(uint32 reps, Fn fn)
+	{
+		double best = HUGE_VAL;
+		for (uint32 r = 0; r < reps; ++r)
+		{
+			auto start = std::chrono::steady_clock::now();
+			fn();
+			auto end = std::chrono::steady_clock::now();
+			best = std::min(best, (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+		}
+		return std::max(best, 1.0);
+	}
+}
+
+xtga::threading::EXECUTION xtga::threading::ChooseExecution(WORKLOAD workload, addressable pixels, uchar depth, uint16 entries)
+{
+	if (Concurrency() > 1 && (uint64)pixels >= GetParallelThreshold(workload, depth, entries))
+		return EXECUTION::THREADED;
+
+	// the vector search scores 8 entries per step, smaller color maps don't fill a single step.
+	if (workload == WORKLOAD::COLORMAP_SEARCH && entries >= 8 && codecs::PaletteMatcher::HasSimd())
+		return EXECUTION::SIMD;
+
+	return EXECUTION::SERIAL;
+}
+
+void xtga::threading::SetParallelThreshold(WORKLOAD workload, uint64 pixels)
+{
+	if ((uchar)workload >= WorkloadCount)
+		return;
+
+	auto& m = Model();
+	std::lock_guard<std::mutex> lock(m.Lock);
+
+	m.Threshold[(uchar)workload] = pixels;
+}
+
+uint64 xtga::threading::GetParallelThreshold(WORKLOAD workload, uchar depth, uint16 entries)
+{
+	if ((uchar)workload >= WorkloadCount || Concurrency() <= 1)
+		return 0;
+
+	auto& m = Model();
+	std::lock_guard<std::mutex> lock(m.Lock);
+
+	return Threshold(m, workload, depth, entries);
+}
+
+void xtga::threading::CalibrateCostModel()
+{
+	constexpr uint32 Pixels = 4096;
+	constexpr uint32 Reps = 3;
+
+	// a fixed pseudo-random palette and image, so that runs are comparable.
+	std::vector<uint32> palette(256);
+	std::vector<uint32> image(Pixels);
+	uint32 seed = 0x2545F491;
+	auto Next = [&seed]() { seed = seed * 1664525u + 1013904223u; return seed; };
+	for (auto& c : palette)
+		c = Next();
+	for (auto& c : image)
+		c = Next();
+
+	std::vector<uchar> out(Pixels);
+	volatile uchar sink = 0;
+
+	// dispatch overhead, the first call only creates the pool.
+	double dispatch = -1.0;
+	uint32 parts = Concurrency();
+	if (parts > 1)
+	{
+		ParallelInvoke(parts, [](uint32) {});
+		dispatch = BestOf(Reps * 8, [&]() { ParallelInvoke(parts, [](uint32) {}); });
+	}
+
+	double build = BestOf(Reps, [&]()
+	{
+		std::set<uint32> s;
+		for (auto c : image)
+			s.insert(c);
+		sink = sink + (uchar)s.size();
+	}) / Pixels;
+
+	codecs::PaletteMatcher vector(palette.data(), 256, 32, codecs::PaletteWeights::RGBA(), true);
+	double search = BestOf(Reps, [&]()
+	{
+		vector.NearestRange(image.data(), 0, Pixels, out.data());
+		sink = sink + out[Pixels - 1];
+	}) / ((double)Pixels * 256);
+
+	codecs::PaletteMatcher scalar(palette.data(), 256, 32, codecs::PaletteWeights::RGBA(), false);
+	double searchScalar = BestOf(Reps, [&]()
+	{
+		scalar.NearestRange(image.data(), 0, Pixels, out.data());
+		sink = sink + out[Pixels - 1];
+	}) / ((double)Pixels * 256);
+
+	codecs::InverseColorMap inverse(palette.data(), 256, 32, codecs::PaletteWeights::RGB(), 5, true);
+	double lookup = BestOf(Reps, [&]()
+	{
+		inverse.LookupRange(image.data(), 0, Pixels, out.data());
+		sink = sink + out[Pixels - 1];
+	}) / Pixels;
+
+	constexpr uint16 Side = 64, Resized = 48;
+	const double taps = (double)Resized * Side * codecs::BicubicTaps(Side, Resized) + (double)Resized * Resized * codecs::BicubicTaps(Side, Resized);
+	double resample = BestOf(Reps, [&]()
+	{
+		auto r = (uchar*)codecs::ResizeImageBicubic(image.data(), pixelformats::PIXELFORMATS::BGRA8888, Side, Side, Resized, Resized, false);
+		sink = sink + r[0];
+		memory::Free(r);
+	}) / taps;
+
+	auto& m = Model();
+	std::lock_guard<std::mutex> lock(m.Lock);
+
+	if (dispatch > 0.0)
+		m.DispatchNs = dispatch;
+	m.PixelNs[(uchar)WORKLOAD::COLORMAP_BUILD] = build;
+	m.PixelNs[(uchar)WORKLOAD::COLORMAP_SEARCH] = search;
+	m.PixelNs[(uchar)WORKLOAD::COLORMAP_LOOKUP] = lookup;
+	m.PixelNs[(uchar)WORKLOAD::RESAMPLE] = resample;
+	m.SearchScalarNs = searchScalar;
+}
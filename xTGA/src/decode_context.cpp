@@ -0,0 +1,80 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: decode_context.cpp
+/// purpose : Implements the DecodeContext class.
+//==============================================================================
+
+#include "xTGA/decode_context.h"
+
+#include "xTGA/allocator.h"
+
+class xtga::DecodeContext::__DecodeContextImpl
+{
+public:
+	__DecodeContextImpl();
+	~__DecodeContextImpl();
+
+	void* _Data;
+	addressable _Size;
+};
+
+xtga::DecodeContext::__DecodeContextImpl::__DecodeContextImpl()
+{
+	_Data = nullptr;
+	_Size = 0;
+}
+
+xtga::DecodeContext::__DecodeContextImpl::~__DecodeContextImpl()
+{
+	memory::Free(_Data);
+}
+
+xtga::DecodeContext::DecodeContext() : _impl(nullptr) {}
+
+xtga::DecodeContext* xtga::DecodeContext::Alloc()
+{
+	auto r = new DecodeContext();
+	r->_impl = new __DecodeContextImpl();
+	return r;
+}
+
+void xtga::DecodeContext::Free(DecodeContext*& obj)
+{
+	if (obj != nullptr)
+	{
+		delete obj->_impl;
+		obj->_impl = nullptr;
+		delete obj;
+		obj = nullptr;
+	}
+}
+
+addressable xtga::DecodeContext::GetReserved() const
+{
+	return this->_impl->_Size;
+}
+
+void xtga::DecodeContext::Trim()
+{
+	memory::Free(this->_impl->_Data);
+	this->_impl->_Data = nullptr;
+	this->_impl->_Size = 0;
+}
+
+void* xtga::DecodeContext::Reserve(addressable size)
+{
+	auto impl = this->_impl;
+
+	// nothing is kept, so growing doesn't copy.
+	if (size > impl->_Size)
+	{
+		memory::Free(impl->_Data);
+		impl->_Data = memory::Allocate(size);
+		impl->_Size = impl->_Data ? size : 0;
+	}
+
+	return impl->_Data;
+}
@@ -10,42 +10,50 @@
 #include "xTGA/marray.h"
 
 #include "error_macro.h"
+#include "xTGA/allocator.h"
 
 #include <cstdlib>
+#include <string.h>
 
 template <class T>
 class xtga::ManagedArray<T>::__ManagedArrayImpl
 {
 public:
 	__ManagedArrayImpl(addressable size);
-	__ManagedArrayImpl(T* data, addressable size);
+	__ManagedArrayImpl(T* data, addressable size, bool foreign);
 	virtual ~__ManagedArrayImpl();
 
 	T* _rawData;
 	addressable _size;
 	uint16 _eSize;
+	bool _foreign;		// the data came from malloc() rather than memory::Allocate().
 };
 
 template <class T>
 xtga::ManagedArray<T>::__ManagedArrayImpl::__ManagedArrayImpl(addressable size)
 {
-	this->_rawData = (T*)malloc(sizeof(T) * size);
+	this->_rawData = (T*)memory::Allocate(sizeof(T) * size);
 	this->_size = size;
 	this->_eSize = sizeof(T);
+	this->_foreign = false;
 }
 
 template <class T>
-xtga::ManagedArray<T>::__ManagedArrayImpl::__ManagedArrayImpl(T* data, addressable size)
+xtga::ManagedArray<T>::__ManagedArrayImpl::__ManagedArrayImpl(T* data, addressable size, bool foreign)
 {
 	this->_rawData = data;
 	this->_size = size;
 	this->_eSize = sizeof(T);
+	this->_foreign = foreign;
 }
 
 template <class T>
 xtga::ManagedArray<T>::__ManagedArrayImpl::~__ManagedArrayImpl()
 {
-	free(this->_rawData);
+	if (this->_foreign)
+		free(this->_rawData);
+	else
+		memory::Free(this->_rawData);
 }
 
 template <class T>
@@ -60,7 +68,15 @@ template <class T>
 xtga::ManagedArray<T>* xtga::ManagedArray<T>::Alloc(T* data, addressable size)
 {
 	auto rval = new xtga::ManagedArray<T>();
-	rval->_impl = new __ManagedArrayImpl(data, size);
+	rval->_impl = new __ManagedArrayImpl(data, size, true);
+	return rval;
+}
+
+template <class T>
+xtga::ManagedArray<T>* xtga::ManagedArray<T>::Adopt(T* data, addressable size)
+{
+	auto rval = new xtga::ManagedArray<T>();
+	rval->_impl = new __ManagedArrayImpl(data, size, false);
 	return rval;
 }
 
@@ -73,6 +89,29 @@ void xtga::ManagedArray<T>::Free(ManagedArray<T>*& obj)
 	obj = nullptr;
 }
 
+template <class T>
+T* xtga::ManagedArray<T>::Release(ManagedArray<T>*& obj)
+{
+	T* rval = obj->_impl->_rawData;
+
+	// the caller frees the data with memory::Free(), so a malloc()'d array is moved over first.
+	// (on failure the object is left as it was).
+	if (obj->_impl->_foreign && rval)
+	{
+		const addressable bytes = obj->_impl->_size * obj->_impl->_eSize;
+		rval = (T*)memory::Allocate(bytes);
+		if (!rval)
+			return nullptr;
+
+		memcpy(rval, obj->_impl->_rawData, bytes);
+	}
+	else
+		obj->_impl->_rawData = nullptr;
+
+	Free(obj);
+	return rval;
+}
+
 template <typename T>
 T& xtga::ManagedArray<T>::at(addressable index, ERRORCODE* error)
 {
@@ -103,6 +142,12 @@ void* xtga::ManagedArray<T>::rawat(addressable index, ERRORCODE* error)
 	return (void*)((uchar*)this->_impl->_rawData + (index * this->_impl->_eSize));
 }
 
+template <typename T>
+T* xtga::ManagedArray<T>::data()
+{
+	return this->_impl->_rawData;
+}
+
 template <typename T>
 addressable xtga::ManagedArray<T>::size() const
 {
@@ -123,3 +168,4 @@ template class xtga::ManagedArray<xtga::pixelformats::BGR565>;
 template class xtga::ManagedArray<xtga::pixelformats::I8>;
 template class xtga::ManagedArray<xtga::pixelformats::IA88>;
 template class xtga::ManagedArray<xtga::pixelformats::IPixel>;
+template class xtga::ManagedArray<uchar>;
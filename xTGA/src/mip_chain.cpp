@@ -0,0 +1,458 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: mip_chain.cpp
+/// purpose : Implements the MipChain class and the 2x2 reductions that build it.
+//==============================================================================
+
+#include "xTGA/mip_chain.h"
+
+#include "codecs.h"
+#include "error_macro.h"
+#include "thread_pool.h"
+#include "xTGA/allocator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define XTGA_MIP_SSE2
+#	include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#	define XTGA_MIP_NEON
+#	include <arm_neon.h>
+#endif
+
+namespace
+{
+	using namespace xtga;
+	using namespace xtga::pixelformats;
+
+	// levels are built TileLevels at a time in tiles of TileSize pixels (of the first level), a tile only
+	// reads pixels of its own, so every level after the first is reduced from cache rather than memory.
+	constexpr uint16 TileLevels = 6;
+	constexpr uint32 TileSize = 1 << TileLevels;
+	constexpr addressable LevelAlign = 16;
+
+	uchar Channels(PIXELFORMATS format)
+	{
+		switch (format)
+		{
+		case PIXELFORMATS::RGBA8888:
+		case PIXELFORMATS::BGRA8888:
+			return 4;
+		case PIXELFORMATS::RGB888:
+		case PIXELFORMATS::BGR888:
+			return 3;
+		case PIXELFORMATS::IA88:
+			return 2;
+		case PIXELFORMATS::I8:
+			return 1;
+		default:
+			return 0;
+		}
+	}
+
+	// sRGB to linear light in 16-bits, and back from the top 14 bits of a linear value.
+	struct GammaTables
+	{
+		uint16 ToLinear[256];
+		uchar ToGamma[1 << 14];
+
+		GammaTables()
+		{
+			for (uint32 i = 0; i < 256; ++i)
+			{
+				const double c = i / 255.0;
+				const double l = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+				ToLinear[i] = (uint16)std::lround(l * 65535.0);
+			}
+
+			for (uint32 i = 0; i < (1 << 14); ++i)
+			{
+				const double l = (i + 0.5) / (1 << 14);
+				const double c = l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+				ToGamma[i] = (uchar)std::lround(std::min(c, 1.0) * 255.0);
+			}
+		}
+	};
+
+	const GammaTables& Gamma()
+	{
+		static const GammaTables Tables;
+		return Tables;
+	}
+
+#if defined(XTGA_MIP_SSE2)
+	// sums horizontally adjacent pixels of two rows' vertical sums, 8 16-bit channel sums out.
+	template <uchar C>
+	__m128i PairSums(__m128i lo, __m128i hi);
+
+	template <>
+	__m128i PairSums<4>(__m128i lo, __m128i hi)
+	{
+		return _mm_unpacklo_epi64(_mm_add_epi16(lo, _mm_srli_si128(lo, 8)), _mm_add_epi16(hi, _mm_srli_si128(hi, 8)));
+	}
+
+	template <>
+	__m128i PairSums<2>(__m128i lo, __m128i hi)
+	{
+		lo = _mm_shuffle_epi32(_mm_add_epi16(lo, _mm_srli_epi64(lo, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+		hi = _mm_shuffle_epi32(_mm_add_epi16(hi, _mm_srli_epi64(hi, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+		return _mm_unpacklo_epi64(lo, hi);
+	}
+
+	template <>
+	__m128i PairSums<1>(__m128i lo, __m128i hi)
+	{
+		const __m128i ones = _mm_set1_epi16(1);
+		return _mm_packs_epi32(_mm_madd_epi16(lo, ones), _mm_madd_epi16(hi, ones));
+	}
+#elif defined(XTGA_MIP_NEON)
+	template <uchar C>
+	uint16x8_t PairSums(uint16x8_t lo, uint16x8_t hi);
+
+	template <>
+	uint16x8_t PairSums<4>(uint16x8_t lo, uint16x8_t hi)
+	{
+		return vcombine_u16(vadd_u16(vget_low_u16(lo), vget_high_u16(lo)), vadd_u16(vget_low_u16(hi), vget_high_u16(hi)));
+	}
+
+	template <>
+	uint16x8_t PairSums<2>(uint16x8_t lo, uint16x8_t hi)
+	{
+		const uint32x4x2_t p = vuzpq_u32(vreinterpretq_u32_u16(lo), vreinterpretq_u32_u16(hi));
+		return vaddq_u16(vreinterpretq_u16_u32(p.val[0]), vreinterpretq_u16_u32(p.val[1]));
+	}
+
+	template <>
+	uint16x8_t PairSums<1>(uint16x8_t lo, uint16x8_t hi)
+	{
+		return vcombine_u16(vpadd_u16(vget_low_u16(lo), vget_high_u16(lo)), vpadd_u16(vget_low_u16(hi), vget_high_u16(hi)));
+	}
+#endif
+
+	// box filters outputs [x, end) of a row, 16 source bytes of each row at a time. Returns the first
+	// output it didn't reach.
+	template <uchar C>
+	uint32 ReduceBoxVector(const uchar* r0, const uchar* r1, uchar* out, uint32 x, uint32 end, uint16 width)
+	{
+#if defined(XTGA_MIP_SSE2) || defined(XTGA_MIP_NEON)
+		constexpr uint32 Step = 8 / C;
+		const addressable limit = (addressable)width * C;
+
+		for (; x + Step <= end && (addressable)x * 2 * C + 16 <= limit; x += Step)
+		{
+			const addressable s = (addressable)x * 2 * C;
+#	if defined(XTGA_MIP_SSE2)
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i a = _mm_loadu_si128((const __m128i*)(r0 + s));
+			const __m128i b = _mm_loadu_si128((const __m128i*)(r1 + s));
+			const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+			const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+			const __m128i sum = _mm_srli_epi16(_mm_add_epi16(PairSums<C>(lo, hi), _mm_set1_epi16(2)), 2);
+			_mm_storel_epi64((__m128i*)(out + (addressable)x * C), _mm_packus_epi16(sum, sum));
+#	else
+			const uint8x16_t a = vld1q_u8(r0 + s);
+			const uint8x16_t b = vld1q_u8(r1 + s);
+			const uint16x8_t lo = vaddl_u8(vget_low_u8(a), vget_low_u8(b));
+			const uint16x8_t hi = vaddl_u8(vget_high_u8(a), vget_high_u8(b));
+			vst1_u8(out + (addressable)x * C, vrshrn_n_u16(PairSums<C>(lo, hi), 2));
+#	endif
+		}
+#endif
+		return x;
+	}
+
+	template <>
+	uint32 ReduceBoxVector<3>(const uchar*, const uchar*, uchar*, uint32 x, uint32, uint16)
+	{
+		return x;
+	}
+
+	// reduces outputs [x, end) of a row from source rows r0 and r1, each output averages source columns
+	// 2x and 2x + 1 (the same column for a 1 pixel wide source).
+	template <uchar C, bool Linear, bool Weighted>
+	void ReduceRow(const uchar* r0, const uchar* r1, uchar* out, uint32 x, uint32 end, uint16 width)
+	{
+		constexpr uchar Alpha = C == 4 ? 3 : (C == 2 ? 1 : C);
+
+		if (!Linear && !Weighted)
+			x = ReduceBoxVector<C>(r0, r1, out, x, end, width);
+
+		const auto& Tables = Gamma();
+
+		for (; x < end; ++x)
+		{
+			const addressable s0 = (addressable)x * 2 * C;
+			const addressable s1 = width > 1 ? s0 + C : s0;
+			const uchar* p[4] = { r0 + s0, r0 + s1, r1 + s0, r1 + s1 };
+			uchar* o = out + (addressable)x * C;
+
+			uint32 weights = 0;
+			if (Weighted)
+				weights = (uint32)p[0][Alpha] + p[1][Alpha] + p[2][Alpha] + p[3][Alpha];
+
+			for (uchar c = 0; c < C; ++c)
+			{
+				if (c == Alpha)
+				{
+					o[c] = (uchar)((p[0][c] + p[1][c] + p[2][c] + p[3][c] + 2) >> 2);
+					continue;
+				}
+
+				uint32 v[4];
+				for (uchar i = 0; i < 4; ++i)
+					v[i] = Linear ? Tables.ToLinear[p[i][c]] : p[i][c];
+
+				uint32 mean;
+				if (Weighted && weights)
+					mean = (v[0] * p[0][Alpha] + v[1] * p[1][Alpha] + v[2] * p[2][Alpha] + v[3] * p[3][Alpha] + weights / 2) / weights;
+				else
+					mean = (v[0] + v[1] + v[2] + v[3] + 2) >> 2;
+
+				o[c] = Linear ? Tables.ToGamma[mean >> 2] : (uchar)mean;
+			}
+		}
+	}
+
+	typedef void (*ReduceFunc)(const uchar* r0, const uchar* r1, uchar* out, uint32 x, uint32 end, uint16 width);
+
+	template <uchar C>
+	ReduceFunc SelectReduce(bool gamma, bool weighted)
+	{
+		if (gamma)
+			return weighted ? ReduceRow<C, true, true> : ReduceRow<C, true, false>;
+		return weighted ? ReduceRow<C, false, true> : ReduceRow<C, false, false>;
+	}
+
+	ReduceFunc SelectReduce(uchar channels, bool gamma, bool weighted)
+	{
+		switch (channels)
+		{
+		case 4: return SelectReduce<4>(gamma, weighted);
+		case 3: return SelectReduce<3>(gamma, false);
+		case 2: return SelectReduce<2>(gamma, weighted);
+		default: return SelectReduce<1>(gamma, false);
+		}
+	}
+
+	void ConvertRow(const RGBA8888* in, uchar* out, uint16 width, PIXELFORMATS format)
+	{
+		switch (format)
+		{
+		case PIXELFORMATS::RGBA8888:
+			memcpy(out, in, (addressable)width * 4);
+			break;
+		case PIXELFORMATS::BGRA8888:
+			for (uint16 x = 0; x < width; ++x, out += 4)
+			{
+				out[0] = in[x].B; out[1] = in[x].G; out[2] = in[x].R; out[3] = in[x].A;
+			}
+			break;
+		case PIXELFORMATS::RGB888:
+			for (uint16 x = 0; x < width; ++x, out += 3)
+			{
+				out[0] = in[x].R; out[1] = in[x].G; out[2] = in[x].B;
+			}
+			break;
+		case PIXELFORMATS::BGR888:
+			for (uint16 x = 0; x < width; ++x, out += 3)
+			{
+				out[0] = in[x].B; out[1] = in[x].G; out[2] = in[x].R;
+			}
+			break;
+		case PIXELFORMATS::IA88:
+			for (uint16 x = 0; x < width; ++x, out += 2)
+			{
+				out[0] = codecs::RGBA_To_IA(in[x]).I; out[1] = in[x].A;
+			}
+			break;
+		default:
+			for (uint16 x = 0; x < width; ++x)
+				out[x] = codecs::RGBA_To_I(in[x]).I;
+			break;
+		}
+	}
+}
+
+class xtga::MipChain::__MipChainImpl
+{
+public:
+	__MipChainImpl();
+	~__MipChainImpl();
+
+	uchar* _Data;
+	addressable _Size;
+	std::vector<MipLevel> _Levels;
+	pixelformats::PIXELFORMATS _Format;
+};
+
+xtga::MipChain::__MipChainImpl::__MipChainImpl()
+{
+	_Data = nullptr;
+	_Size = 0;
+	_Format = pixelformats::PIXELFORMATS::RGBA8888;
+}
+
+xtga::MipChain::__MipChainImpl::~__MipChainImpl()
+{
+	memory::Free(_Data);
+}
+
+xtga::MipChain::MipChain() : _impl(nullptr) {}
+
+xtga::MipChain* xtga::MipChain::Build(const pixelformats::RGBA8888* image, uint16 width, uint16 height, pixelformats::PIXELFORMATS format,
+	bool gamma, bool weighted, ERRORCODE* error)
+{
+	const uchar C = Channels(format);
+	if (C == 0)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
+		return nullptr;
+	}
+
+	if (!image || width == 0 || height == 0)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_OPERATION);
+		return nullptr;
+	}
+
+	auto impl = new __MipChainImpl();
+	impl->_Format = format;
+
+	// every level halves each side (rounding down, stopping at 1) until both are 1.
+	uint16 w = width, h = height;
+	for (;;)
+	{
+		MipLevel level;
+		level.Offset = (impl->_Size + LevelAlign - 1) / LevelAlign * LevelAlign;
+		level.Size = (addressable)w * h * C;
+		level.Width = w;
+		level.Height = h;
+		impl->_Levels.push_back(level);
+		impl->_Size = level.Offset + level.Size;
+
+		if (w == 1 && h == 1)
+			break;
+		w = std::max(w / 2, 1);
+		h = std::max(h / 2, 1);
+	}
+
+	impl->_Data = (uchar*)memory::Allocate(impl->_Size);
+	auto Data = impl->_Data;
+	const auto& Levels = impl->_Levels;
+
+	const auto Execution = threading::ChooseExecution(threading::WORKLOAD::RESAMPLE, (addressable)width * height, C * 8);
+
+	threading::ParallelFor(Execution, height, [&](const addressable& start, const addressable& count)
+	{
+		for (addressable y = start; y < start + count; ++y)
+			ConvertRow(image + y * width, Data + y * width * C, width, format);
+	}, 16);
+
+	const auto Reduce = SelectReduce(C, gamma, weighted);
+	const uint16 LevelCount = (uint16)Levels.size();
+
+	for (uint16 base = 0; base + 1 < LevelCount; base += TileLevels)
+	{
+		const uint16 last = std::min<uint16>(base + TileLevels, LevelCount - 1);
+		const uint32 tilesX = (Levels[base].Width + TileSize - 1) / TileSize;
+		const uint32 tilesY = (Levels[base].Height + TileSize - 1) / TileSize;
+
+		const auto TileExecution = threading::ChooseExecution(threading::WORKLOAD::RESAMPLE,
+			(addressable)Levels[base].Width * Levels[base].Height, C * 8);
+
+		threading::ParallelFor(TileExecution, (addressable)tilesX * tilesY, [&](const addressable& start, const addressable& count)
+		{
+			for (addressable t = start; t < start + count; ++t)
+			{
+				const uint32 tx = (uint32)(t % tilesX);
+				const uint32 ty = (uint32)(t / tilesX);
+
+				for (uint16 l = base + 1; l <= last; ++l)
+				{
+					const MipLevel& src = Levels[l - 1];
+					const MipLevel& dst = Levels[l];
+					const uint32 span = TileSize >> (l - base);
+					const uint32 x0 = tx * span, x1 = std::min<uint32>(x0 + span, dst.Width);
+					const uint32 y0 = ty * span, y1 = std::min<uint32>(y0 + span, dst.Height);
+
+					// the tile is past the edge of this level, and so of every level after it.
+					if (x0 >= x1 || y0 >= y1)
+						break;
+
+					const addressable spitch = (addressable)src.Width * C;
+					const addressable dpitch = (addressable)dst.Width * C;
+
+					for (uint32 y = y0; y < y1; ++y)
+					{
+						const uchar* r0 = Data + src.Offset + (addressable)y * 2 * spitch;
+						const uchar* r1 = src.Height > 1 ? r0 + spitch : r0;
+						Reduce(r0, r1, Data + dst.Offset + y * dpitch, x0, x1, src.Width);
+					}
+				}
+			}
+		}, 4);
+	}
+
+	auto r = new MipChain();
+	r->_impl = impl;
+
+	XTGA_SETERROR(error, ERRORCODE::NONE);
+	return r;
+}
+
+void xtga::MipChain::Free(MipChain*& obj)
+{
+	if (obj != nullptr)
+	{
+		delete obj->_impl;
+		obj->_impl = nullptr;
+		delete obj;
+		obj = nullptr;
+	}
+}
+
+const void* xtga::MipChain::GetData() const
+{
+	return this->_impl->_Data;
+}
+
+addressable xtga::MipChain::GetSize() const
+{
+	return this->_impl->_Size;
+}
+
+xtga::pixelformats::PIXELFORMATS xtga::MipChain::GetFormat() const
+{
+	return this->_impl->_Format;
+}
+
+uint16 xtga::MipChain::GetLevelCount() const
+{
+	return (uint16)this->_impl->_Levels.size();
+}
+
+const xtga::MipLevel* xtga::MipChain::GetLevel(uint16 index, ERRORCODE* error) const
+{
+	if (index >= this->_impl->_Levels.size())
+	{
+		XTGA_SETERROR(error, ERRORCODE::INDEX_OUT_OF_RANGE);
+		return nullptr;
+	}
+
+	XTGA_SETERROR(error, ERRORCODE::NONE);
+	return &this->_impl->_Levels[index];
+}
+
+const void* xtga::MipChain::GetLevelData(uint16 index, ERRORCODE* error) const
+{
+	auto level = GetLevel(index, error);
+	return level ? this->_impl->_Data + level->Offset : nullptr;
+}
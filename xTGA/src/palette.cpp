@@ -0,0 +1,371 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: palette.cpp
+/// purpose : Provides the nearest color map entry search used by the quantizers.
+//==============================================================================
+
+#include "palette.h"
+
+#include "xTGA/pixelformats.h"
+
+#include <climits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define XTGA_PALETTE_SSE2
+#	include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#	define XTGA_PALETTE_NEON
+#	include <arm_neon.h>
+#endif
+
+xtga::codecs::PaletteMatcher::PaletteMatcher(const void* colormap, uint16 clength, uchar depth, PaletteWeights weights, bool simd)
+{
+	this->_Length = clength;
+	this->_Depth = depth;
+	this->_Simd = simd && HasSimd();
+	this->_Weights = weights;
+
+	// pad to a multiple of 8 entries with copies of entry 0, ties go to the lower index so they never win.
+	this->_Groups = (uint16)(((clength + 7) / 8) * 2);
+
+	const uchar stride = depth / 8;
+	for (uint16 i = 0; i < this->_Groups * 4; ++i)
+	{
+		int16_t c[4];
+		Unpack((const uchar*)colormap + (addressable)(i < clength ? i : 0) * stride, depth, c);
+		this->_RG[i * 2] = c[0];
+		this->_RG[i * 2 + 1] = c[1];
+		this->_BA[i * 2] = c[2];
+		this->_BA[i * 2 + 1] = c[3];
+	}
+}
+
+void xtga::codecs::PaletteMatcher::Unpack(const void* pixel, uchar depth, int16_t (&c)[4])
+{
+	using namespace pixelformats;
+
+	if (depth == 16)
+	{
+		auto p = (const BGRA5551*)pixel;
+		c[0] = p->R; c[1] = p->G; c[2] = p->B; c[3] = p->A;
+	}
+	else if (depth == 24)
+	{
+		auto p = (const BGR888*)pixel;
+		c[0] = p->R; c[1] = p->G; c[2] = p->B; c[3] = 0;
+	}
+	else
+	{
+		auto p = (const BGRA8888*)pixel;
+		c[0] = p->R; c[1] = p->G; c[2] = p->B; c[3] = p->A;
+	}
+}
+
+void xtga::codecs::PaletteMatcher::Pack(const int16_t (&c)[4], uchar depth, void* pixel)
+{
+	using namespace pixelformats;
+
+	if (depth == 16)
+	{
+		auto p = (BGRA5551*)pixel;
+		p->R = c[0]; p->G = c[1]; p->B = c[2]; p->A = c[3];
+	}
+	else if (depth == 24)
+	{
+		auto p = (BGR888*)pixel;
+		p->R = (uchar)c[0]; p->G = (uchar)c[1]; p->B = (uchar)c[2];
+	}
+	else
+	{
+		auto p = (BGRA8888*)pixel;
+		p->R = (uchar)c[0]; p->G = (uchar)c[1]; p->B = (uchar)c[2]; p->A = (uchar)c[3];
+	}
+}
+
+bool xtga::codecs::PaletteMatcher::HasSimd()
+{
+#if defined(XTGA_PALETTE_SSE2) || defined(XTGA_PALETTE_NEON)
+	return true;
+#else
+	return false;
+#endif
+}
+
+uchar xtga::codecs::PaletteMatcher::NearestScalar(int16_t r, int16_t g, int16_t b, int16_t a) const
+{
+	const PaletteWeights& w = this->_Weights;
+	int32_t bestD = INT_MAX;
+	uchar bestI = 0;
+
+	for (uint16 j = 0; j < this->_Length; ++j)
+	{
+		int32_t dr = r - this->_RG[j * 2];
+		int32_t dg = g - this->_RG[j * 2 + 1];
+		int32_t db = b - this->_BA[j * 2];
+		int32_t da = a - this->_BA[j * 2 + 1];
+		int32_t d = w.R * dr * dr + w.G * dg * dg + w.B * db * db + w.A * da * da;
+
+		if (d < bestD)
+		{
+			bestD = d;
+			bestI = (uchar)j;
+		}
+	}
+
+	return bestI;
+}
+
+uchar xtga::codecs::PaletteMatcher::Nearest(int16_t r, int16_t g, int16_t b, int16_t a) const
+{
+	if (!this->_Simd)
+		return this->NearestScalar(r, g, b, a);
+
+	const PaletteWeights& w = this->_Weights;
+
+#if defined(XTGA_PALETTE_SSE2)
+	// Each register holds 4 entries as (R,G) or (B,A) pairs; d * (d * w) summed pairwise by madd
+	// gives the weighted distance of 4 entries in 32-bit lanes. Two groups (8 entries) per step.
+	const __m128i prg = _mm_set_epi16(g, r, g, r, g, r, g, r);
+	const __m128i pba = _mm_set_epi16(a, b, a, b, a, b, a, b);
+	const __m128i wrg = _mm_set_epi16(w.G, w.R, w.G, w.R, w.G, w.R, w.G, w.R);
+	const __m128i wba = _mm_set_epi16(w.A, w.B, w.A, w.B, w.A, w.B, w.A, w.B);
+	const __m128i step = _mm_set1_epi32(8);
+
+	__m128i bestD0 = _mm_set1_epi32(INT_MAX), bestD1 = bestD0;
+	__m128i bestI0 = _mm_setzero_si128(), bestI1 = bestI0;
+	__m128i idx0 = _mm_set_epi32(3, 2, 1, 0);
+	__m128i idx1 = _mm_set_epi32(7, 6, 5, 4);
+
+	auto Score = [&](uint16 group) -> __m128i
+	{
+		__m128i drg = _mm_sub_epi16(prg, _mm_load_si128((const __m128i*)(this->_RG + group * 8)));
+		__m128i dba = _mm_sub_epi16(pba, _mm_load_si128((const __m128i*)(this->_BA + group * 8)));
+		return _mm_add_epi32(_mm_madd_epi16(drg, _mm_mullo_epi16(drg, wrg)), _mm_madd_epi16(dba, _mm_mullo_epi16(dba, wba)));
+	};
+
+	for (uint16 i = 0; i < this->_Groups; i += 2)
+	{
+		__m128i d0 = Score(i);
+		__m128i d1 = Score(i + 1);
+		__m128i lt0 = _mm_cmplt_epi32(d0, bestD0);
+		__m128i lt1 = _mm_cmplt_epi32(d1, bestD1);
+		bestD0 = _mm_or_si128(_mm_and_si128(lt0, d0), _mm_andnot_si128(lt0, bestD0));
+		bestD1 = _mm_or_si128(_mm_and_si128(lt1, d1), _mm_andnot_si128(lt1, bestD1));
+		bestI0 = _mm_or_si128(_mm_and_si128(lt0, idx0), _mm_andnot_si128(lt0, bestI0));
+		bestI1 = _mm_or_si128(_mm_and_si128(lt1, idx1), _mm_andnot_si128(lt1, bestI1));
+		idx0 = _mm_add_epi32(idx0, step);
+		idx1 = _mm_add_epi32(idx1, step);
+	}
+
+	alignas(16) int32_t D[8];
+	alignas(16) int32_t I[8];
+	_mm_store_si128((__m128i*)D, bestD0);
+	_mm_store_si128((__m128i*)(D + 4), bestD1);
+	_mm_store_si128((__m128i*)I, bestI0);
+	_mm_store_si128((__m128i*)(I + 4), bestI1);
+#elif defined(XTGA_PALETTE_NEON)
+	const int16_t vrg[8] = { r, g, r, g, r, g, r, g };
+	const int16_t vba[8] = { b, a, b, a, b, a, b, a };
+	const int16_t vwrg[8] = { w.R, w.G, w.R, w.G, w.R, w.G, w.R, w.G };
+	const int16_t vwba[8] = { w.B, w.A, w.B, w.A, w.B, w.A, w.B, w.A };
+	const int32_t vidx[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+
+	const int16x8_t prg = vld1q_s16(vrg);
+	const int16x8_t pba = vld1q_s16(vba);
+	const int16x8_t wrg = vld1q_s16(vwrg);
+	const int16x8_t wba = vld1q_s16(vwba);
+	const int32x4_t step = vdupq_n_s32(8);
+
+	int32x4_t bestD0 = vdupq_n_s32(INT_MAX), bestD1 = bestD0;
+	int32x4_t bestI0 = vdupq_n_s32(0), bestI1 = bestI0;
+	int32x4_t idx0 = vld1q_s32(vidx);
+	int32x4_t idx1 = vld1q_s32(vidx + 4);
+
+	auto Score = [&](uint16 group) -> int32x4_t
+	{
+		int16x8_t drg = vsubq_s16(prg, vld1q_s16(this->_RG + group * 8));
+		int16x8_t dba = vsubq_s16(pba, vld1q_s16(this->_BA + group * 8));
+		int16x8_t wdrg = vmulq_s16(drg, wrg);
+		int16x8_t wdba = vmulq_s16(dba, wba);
+		int32x4_t rg = vpaddq_s32(vmull_s16(vget_low_s16(drg), vget_low_s16(wdrg)), vmull_high_s16(drg, wdrg));
+		int32x4_t ba = vpaddq_s32(vmull_s16(vget_low_s16(dba), vget_low_s16(wdba)), vmull_high_s16(dba, wdba));
+		return vaddq_s32(rg, ba);
+	};
+
+	for (uint16 i = 0; i < this->_Groups; i += 2)
+	{
+		int32x4_t d0 = Score(i);
+		int32x4_t d1 = Score(i + 1);
+		uint32x4_t lt0 = vcltq_s32(d0, bestD0);
+		uint32x4_t lt1 = vcltq_s32(d1, bestD1);
+		bestD0 = vbslq_s32(lt0, d0, bestD0);
+		bestD1 = vbslq_s32(lt1, d1, bestD1);
+		bestI0 = vbslq_s32(lt0, idx0, bestI0);
+		bestI1 = vbslq_s32(lt1, idx1, bestI1);
+		idx0 = vaddq_s32(idx0, step);
+		idx1 = vaddq_s32(idx1, step);
+	}
+
+	int32_t D[8];
+	int32_t I[8];
+	vst1q_s32(D, bestD0);
+	vst1q_s32(D + 4, bestD1);
+	vst1q_s32(I, bestI0);
+	vst1q_s32(I + 4, bestI1);
+#else
+	return this->NearestScalar(r, g, b, a);
+#endif
+
+#if defined(XTGA_PALETTE_SSE2) || defined(XTGA_PALETTE_NEON)
+
+	// reduce the lanes, equal distances resolve to the lowest index.
+	int32_t bestD = D[0];
+	int32_t bestI = I[0];
+	for (uchar i = 1; i < 8; ++i)
+	{
+		if (D[i] < bestD || (D[i] == bestD && I[i] < bestI))
+		{
+			bestD = D[i];
+			bestI = I[i];
+		}
+	}
+
+	return (uchar)bestI;
+#endif
+}
+
+uchar xtga::codecs::PaletteMatcher::NearestPixel(const void* pixel) const
+{
+	int16_t c[4];
+	Unpack(pixel, this->_Depth, c);
+	return this->Nearest(c[0], c[1], c[2], c[3]);
+}
+
+void xtga::codecs::PaletteMatcher::NearestRange(const void* buff, addressable start, addressable count, uchar* out) const
+{
+	const uchar stride = this->_Depth / 8;
+	const uchar* iPtr = (const uchar*)buff + start * stride;
+
+	for (addressable i = 0; i < count; ++i)
+		out[i] = this->NearestPixel(iPtr + i * stride);
+}
+
+xtga::codecs::InverseColorMap::InverseColorMap(const void* colormap, uint16 clength, uchar depth, PaletteWeights weights, uchar bits, bool refine)
+{
+	const uchar ChannelBits = depth == 16 ? 5 : 8;
+	if (bits < 4) bits = 4;
+	if (bits > 6) bits = 6;
+	if (bits > ChannelBits) bits = ChannelBits;
+
+	this->_ColorMap = colormap;
+	this->_Weights = weights;
+	this->_Depth = depth;
+	this->_Bits = bits;
+	this->_Shift = ChannelBits - bits;
+	this->_Candidates = refine ? Candidates : 1;
+
+	const uchar stride = depth / 8;
+	for (uint16 i = 0; i < clength; ++i)
+	{
+		int16_t c[4];
+		PaletteMatcher::Unpack((const uchar*)colormap + (addressable)i * stride, depth, c);
+		this->_R[i] = c[0];
+		this->_G[i] = c[1];
+		this->_B[i] = c[2];
+	}
+
+	const int32_t n = 1 << bits;
+	const int32_t s = 1 << this->_Shift;
+	const int32_t c0 = s >> 1;
+	const uchar K = this->_Candidates;
+	const int32_t wr = weights.R, wg = weights.G, wb = weights.B;
+
+	std::vector<int32_t> Distances((addressable)n * n * n * K, INT_MAX);
+	this->_Cells.assign((addressable)n * n * n * K, 0);
+
+	// Sweep each entry over the lattice, along the blue axis the distance grows by a
+	// second order difference so the inner loop is two additions.
+	for (uint16 j = 0; j < clength; ++j)
+	{
+		for (int32_t r = 0; r < n; ++r)
+		{
+			int32_t dr = (r << this->_Shift) + c0 - this->_R[j];
+			int32_t DR = wr * dr * dr;
+
+			for (int32_t g = 0; g < n; ++g)
+			{
+				int32_t dg = (g << this->_Shift) + c0 - this->_G[j];
+				int32_t db = c0 - this->_B[j];
+
+				int32_t d = DR + wg * dg * dg + wb * db * db;
+				int32_t inc = wb * (2 * s * db + s * s);
+				const int32_t inc2 = 2 * wb * s * s;
+
+				addressable slot = (addressable)((r * n + g) * n) * K;
+				for (int32_t b = 0; b < n; ++b, slot += K, d += inc, inc += inc2)
+				{
+					int32_t* dist = Distances.data() + slot;
+					if (d >= dist[K - 1])
+						continue;
+
+					uchar* idx = this->_Cells.data() + slot;
+					uchar pos = K - 1;
+					while (pos > 0 && dist[pos - 1] > d)
+					{
+						dist[pos] = dist[pos - 1];
+						idx[pos] = idx[pos - 1];
+						--pos;
+					}
+					dist[pos] = d;
+					idx[pos] = (uchar)j;
+				}
+			}
+		}
+	}
+}
+
+uchar xtga::codecs::InverseColorMap::Lookup(const void* pixel) const
+{
+	int16_t c[4];
+	PaletteMatcher::Unpack(pixel, this->_Depth, c);
+
+	addressable cell = (((addressable)(c[0] >> this->_Shift) << this->_Bits | (c[1] >> this->_Shift)) << this->_Bits) | (c[2] >> this->_Shift);
+	const uchar* idx = this->_Cells.data() + cell * this->_Candidates;
+
+	if (this->_Candidates == 1)
+		return idx[0];
+
+	int32_t bestD = INT_MAX;
+	uchar bestI = idx[0];
+	for (uchar i = 0; i < this->_Candidates; ++i)
+	{
+		int32_t dr = c[0] - this->_R[idx[i]];
+		int32_t dg = c[1] - this->_G[idx[i]];
+		int32_t db = c[2] - this->_B[idx[i]];
+		int32_t d = this->_Weights.R * dr * dr + this->_Weights.G * dg * dg + this->_Weights.B * db * db;
+		if (d < bestD)
+		{
+			bestD = d;
+			bestI = idx[i];
+		}
+	}
+
+	return bestI;
+}
+
+void xtga::codecs::InverseColorMap::LookupRange(const void* buff, addressable start, addressable count, uchar* out) const
+{
+	const uchar stride = this->_Depth / 8;
+	const uchar* iPtr = (const uchar*)buff + start * stride;
+
+	for (addressable i = 0; i < count; ++i)
+		out[i] = this->Lookup(iPtr + i * stride);
+}
+
+const void* xtga::codecs::InverseColorMap::GetColorMap() const
+{
+	return this->_ColorMap;
+}
@@ -0,0 +1,173 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: palette.h
+/// purpose : Provides the nearest color map entry search used by the quantizers.
+//==============================================================================
+
+#ifndef XTGA_PALETTE_H__
+#define XTGA_PALETTE_H__
+
+#include "xTGA/types.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace xtga
+{
+	namespace codecs
+	{
+		//----------------------------------------------------------------------------------------------------
+		/// Integer channel weights used when measuring the distance between two colors. The distance is
+		/// R*dr^2 + G*dg^2 + B*db^2 + A*da^2, each weight must be <= 128.
+		//----------------------------------------------------------------------------------------------------
+		struct PaletteWeights
+		{
+			int16_t R, G, B, A;
+
+			//----------------------------------------------------------------------------------------------------
+			/// Luma-like weighting of the color channels, alpha is ignored.
+			//----------------------------------------------------------------------------------------------------
+			static PaletteWeights RGB() { return { 9, 36, 1, 0 }; }
+
+			//----------------------------------------------------------------------------------------------------
+			/// Luma-like weighting of the color channels, with alpha weighted above all others.
+			//----------------------------------------------------------------------------------------------------
+			static PaletteWeights RGBA() { return { 9, 36, 1, 100 }; }
+		};
+
+		//----------------------------------------------------------------------------------------------------
+		/// Finds the closest color map entry for a pixel. The color map is re-laid out once on construction
+		/// so that 8 (SSE2/NEON) entries are scored per step with integer math, the object is read-only
+		/// afterwards and can be shared by any number of threads.
+		//----------------------------------------------------------------------------------------------------
+		class PaletteMatcher
+		{
+		public:
+			//----------------------------------------------------------------------------------------------------
+			/// Creates a matcher for the given color map.
+			/// @param[in] colormap				The color map (BGRA5551/BGR888/BGRA8888).
+			/// @param[in] clength				The number of entries in the color map (1-256).
+			/// @param[in] depth				The bits per pixel of the color map (must be 16/24/32).
+			/// @param[in] weights				The channel weights to use.
+			/// @param[in] simd					If false the scalar search is used even if a vector one is available.
+			//----------------------------------------------------------------------------------------------------
+			PaletteMatcher(const void* colormap, uint16 clength, uchar depth, PaletteWeights weights, bool simd = true);
+
+			//----------------------------------------------------------------------------------------------------
+			/// Returns the index of the closest color map entry, ties go to the lowest index.
+			/// @param[in] r,g,b,a				The channels of the pixel (in the color map's units).
+			/// @return uchar					The index of the closest entry.
+			//----------------------------------------------------------------------------------------------------
+			uchar Nearest(int16_t r, int16_t g, int16_t b, int16_t a) const;
+
+			//----------------------------------------------------------------------------------------------------
+			/// Returns the index of the closest color map entry for the pixel at 'pixel'.
+			/// @param[in] pixel				The pixel, must be of the same format as the color map.
+			/// @return uchar					The index of the closest entry.
+			//----------------------------------------------------------------------------------------------------
+			uchar NearestPixel(const void* pixel) const;
+
+			//----------------------------------------------------------------------------------------------------
+			/// Maps a range of pixels to their closest color map entries.
+			/// @param[in] buff					The input image buffer, must be of the same format as the color map.
+			/// @param[in] start				The first pixel to map.
+			/// @param[in] count				The number of pixels to map.
+			/// @param[out] out					Receives 'count' indices, out[0] being the index of buff[start].
+			//----------------------------------------------------------------------------------------------------
+			void NearestRange(const void* buff, addressable start, addressable count, uchar* out) const;
+
+			//----------------------------------------------------------------------------------------------------
+			/// Splits a pixel into its four channels.
+			/// @param[in] pixel				The pixel.
+			/// @param[in] depth				The bits per pixel (must be 16/24/32).
+			/// @param[out] c					Receives R, G, B, A (A is 0 for 24-bit).
+			//----------------------------------------------------------------------------------------------------
+			static void Unpack(const void* pixel, uchar depth, int16_t (&c)[4]);
+
+			//----------------------------------------------------------------------------------------------------
+			/// Joins four channels into a pixel, the inverse of Unpack().
+			/// @param[in] c					R, G, B, A (A is ignored for 24-bit).
+			/// @param[in] depth				The bits per pixel (must be 16/24/32).
+			/// @param[out] pixel				Receives the pixel.
+			//----------------------------------------------------------------------------------------------------
+			static void Pack(const int16_t (&c)[4], uchar depth, void* pixel);
+
+			//----------------------------------------------------------------------------------------------------
+			/// Returns true if the library was built with a vector search (SSE2/NEON).
+			//----------------------------------------------------------------------------------------------------
+			static bool HasSimd();
+
+		private:
+			uchar NearestScalar(int16_t r, int16_t g, int16_t b, int16_t a) const;
+
+			// (R,G) and (B,A) pairs interleaved, 4 entries per group, padded with copies of entry 0.
+			alignas(16) int16_t _RG[256 * 2];
+			alignas(16) int16_t _BA[256 * 2];
+			uint16 _Groups;
+			uint16 _Length;
+			uchar _Depth;
+			bool _Simd;
+			PaletteWeights _Weights;
+		};
+
+		//----------------------------------------------------------------------------------------------------
+		/// An inverse color map, a RGB lattice where each cell holds the color map entry closest to its
+		/// center. Once built, mapping a pixel to the color map is a single table lookup. Alpha is not
+		/// part of the lattice and is ignored. The object is read-only after construction.
+		//----------------------------------------------------------------------------------------------------
+		class InverseColorMap
+		{
+		public:
+			//----------------------------------------------------------------------------------------------------
+			/// Builds the lattice by sweeping every color map entry across it with incremental distances.
+			/// @param[in] colormap				The color map (BGRA5551/BGR888/BGRA8888).
+			/// @param[in] clength				The number of entries in the color map (1-256).
+			/// @param[in] depth				The bits per pixel of the color map (must be 16/24/32).
+			/// @param[in] weights				The channel weights to use (A is ignored).
+			/// @param[in] bits					The number of bits per lattice axis (4-6), 5 gives a 32x32x32 lattice.
+			///									For 16-bit color maps this is capped at 5, at which point lookups are exact.
+			/// @param[in] refine				If true each cell keeps its closest few entries and lookups pick the
+			///									closest of those to the actual pixel, rather than to the cell's center.
+			//----------------------------------------------------------------------------------------------------
+			InverseColorMap(const void* colormap, uint16 clength, uchar depth, PaletteWeights weights, uchar bits = 5, bool refine = false);
+
+			//----------------------------------------------------------------------------------------------------
+			/// Returns the color map index for the pixel at 'pixel'.
+			/// @param[in] pixel				The pixel, must be of the same format as the color map.
+			/// @return uchar					The color map index.
+			//----------------------------------------------------------------------------------------------------
+			uchar Lookup(const void* pixel) const;
+
+			//----------------------------------------------------------------------------------------------------
+			/// Maps a range of pixels to color map indices.
+			/// @param[in] buff					The input image buffer, must be of the same format as the color map.
+			/// @param[in] start				The first pixel to map.
+			/// @param[in] count				The number of pixels to map.
+			/// @param[out] out					Receives 'count' indices, out[0] being the index of buff[start].
+			//----------------------------------------------------------------------------------------------------
+			void LookupRange(const void* buff, addressable start, addressable count, uchar* out) const;
+
+			//----------------------------------------------------------------------------------------------------
+			/// Returns the color map this lattice was built for (as passed to the constructor).
+			//----------------------------------------------------------------------------------------------------
+			const void* GetColorMap() const;
+
+		private:
+			static constexpr uchar Candidates = 4;
+
+			std::vector<uchar> _Cells;
+			int16_t _R[256], _G[256], _B[256];
+			const void* _ColorMap;
+			PaletteWeights _Weights;
+			uchar _Depth;
+			uchar _Bits;
+			uchar _Shift;
+			uchar _Candidates;
+		};
+	}
+}
+
+#endif // !XTGA_PALETTE_H__
@@ -0,0 +1,683 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: quantizer.cpp
+/// purpose : Provides the octree and Wu quantizers, k-means refinement and sampling.
+//==============================================================================
+
+#include "quantizer.h"
+
+#include "codecs.h"
+#include "error_macro.h"
+#include "palette.h"
+#include "thread_pool.h"
+#include "xTGA/allocator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	using namespace xtga;
+	using namespace xtga::codecs;
+
+	constexpr uint32 Bins = 32;
+	constexpr uint32 Cells = Bins * Bins * Bins;
+
+	// Wu's moments keep a zero border at index 0 of every axis.
+	constexpr uint32 Side = Bins + 1;
+
+	using Cell = HistogramCell;
+
+	const Cell EmptyCell = { 0, 0, 0, 0, 0, 0 };
+
+	PaletteWeights WeightsFor(uchar depth)
+	{
+		return depth == 32 ? PaletteWeights::RGBA() : PaletteWeights::RGB();
+	}
+
+	// writes the mean color of 'c' to 'out'.
+	void EmitEntry(uint64 N, uint64 R, uint64 G, uint64 B, uint64 A, uchar depth, uchar* out)
+	{
+		int16_t c[4] = {
+			(int16_t)((R + N / 2) / N),
+			(int16_t)((G + N / 2) / N),
+			(int16_t)((B + N / 2) / N),
+			(int16_t)((A + N / 2) / N) };
+		PaletteMatcher::Pack(c, depth, out);
+	}
+
+	//==============================================================================
+	// Octree
+	//==============================================================================
+
+	// the histogram cells are the leaves of a 5 level octree, a node's id at level L is the top 3*L
+	// bits of the interleaved (r,g,b) code of its leaves.
+	struct Octree
+	{
+		std::vector<Cell> Nodes[6];
+		std::vector<bool> Folded[6];
+	};
+
+	uint32 Interleave(uint32 r, uint32 g, uint32 b)
+	{
+		uint32 code = 0;
+		for (int bit = 4; bit >= 0; --bit)
+			code = (code << 3) | (((r >> bit) & 1) << 2) | (((g >> bit) & 1) << 1) | ((b >> bit) & 1);
+		return code;
+	}
+
+	void EmitOctree(const Octree& tree, uint32 level, uint32 id, uchar depth, uchar* cmap, uint16& size)
+	{
+		const Cell& c = tree.Nodes[level][id];
+		if (c.N == 0)
+			return;
+
+		if (level == 5 || tree.Folded[level][id])
+		{
+			EmitEntry(c.N, c.R, c.G, c.B, c.A, depth, cmap + (addressable)size * (depth / 8));
+			++size;
+			return;
+		}
+
+		for (uint32 child = 0; child < 8; ++child)
+			EmitOctree(tree, level + 1, (id << 3) | child, depth, cmap, size);
+	}
+
+	uint16 QuantizeOctree(const std::vector<Cell>& hist, uchar depth, uchar* cmap)
+	{
+		Octree tree;
+
+		tree.Nodes[5].assign(Cells, EmptyCell);
+		for (uint32 r = 0; r < Bins; ++r)
+			for (uint32 g = 0; g < Bins; ++g)
+				for (uint32 b = 0; b < Bins; ++b)
+					tree.Nodes[5][Interleave(r, g, b)] = hist[(r << 10) | (g << 5) | b];
+
+		for (int level = 4; level >= 0; --level)
+		{
+			tree.Nodes[level].assign((size_t)1 << (3 * level), EmptyCell);
+			for (uint32 id = 0; id < (uint32)tree.Nodes[level + 1].size(); ++id)
+				tree.Nodes[level][id >> 3].Add(tree.Nodes[level + 1][id]);
+		}
+
+		for (uint32 level = 0; level < 6; ++level)
+			tree.Folded[level].assign(tree.Nodes[level].size(), false);
+
+		uint32 leaves = 0;
+		for (const Cell& c : tree.Nodes[5])
+			if (c.N != 0) ++leaves;
+
+		// fold the deepest, least populated nodes first. A level is only left once every node on it
+		// was folded, so the children of the nodes being folded are always leaves.
+		for (int level = 4; level >= 0 && leaves > 256; --level)
+		{
+			std::vector<uint32> nodes;
+			for (uint32 id = 0; id < (uint32)tree.Nodes[level].size(); ++id)
+				if (tree.Nodes[level][id].N != 0)
+					nodes.push_back(id);
+
+			std::stable_sort(nodes.begin(), nodes.end(), [&](uint32 i, uint32 j)
+			{
+				return tree.Nodes[level][i].N < tree.Nodes[level][j].N;
+			});
+
+			for (uint32 id : nodes)
+			{
+				if (leaves <= 256)
+					break;
+
+				uint32 children = 0;
+				for (uint32 child = 0; child < 8; ++child)
+					if (tree.Nodes[level + 1][(id << 3) | child].N != 0) ++children;
+
+				tree.Folded[level][id] = true;
+				leaves -= children - 1;
+			}
+		}
+
+		uint16 size = 0;
+		EmitOctree(tree, 0, 0, depth, cmap, size);
+		return size;
+	}
+
+	//==============================================================================
+	// Wu
+	//==============================================================================
+
+	struct Box
+	{
+		int r0, r1, g0, g1, b0, b1;
+		int vol;
+	};
+
+	enum class Axis { R, G, B };
+
+	// cumulative moments, m[r][g][b] is the sum over every cell <= (r, g, b).
+	struct Moments
+	{
+		std::vector<int64_t> W, R, G, B, A, M2;
+
+		static uint32 At(int r, int g, int b) { return (uint32)(r * Side * Side + g * Side + b); }
+	};
+
+	int64_t Vol(const Box& c, const std::vector<int64_t>& m)
+	{
+		return m[Moments::At(c.r1, c.g1, c.b1)] - m[Moments::At(c.r1, c.g1, c.b0)]
+			- m[Moments::At(c.r1, c.g0, c.b1)] + m[Moments::At(c.r1, c.g0, c.b0)]
+			- m[Moments::At(c.r0, c.g1, c.b1)] + m[Moments::At(c.r0, c.g1, c.b0)]
+			+ m[Moments::At(c.r0, c.g0, c.b1)] - m[Moments::At(c.r0, c.g0, c.b0)];
+	}
+
+	// the part of Vol() that doesn't depend on the cut position along 'axis'.
+	int64_t Bottom(const Box& c, Axis axis, const std::vector<int64_t>& m)
+	{
+		switch (axis)
+		{
+		case Axis::R:
+			return -m[Moments::At(c.r0, c.g1, c.b1)] + m[Moments::At(c.r0, c.g1, c.b0)]
+				+ m[Moments::At(c.r0, c.g0, c.b1)] - m[Moments::At(c.r0, c.g0, c.b0)];
+		case Axis::G:
+			return -m[Moments::At(c.r1, c.g0, c.b1)] + m[Moments::At(c.r1, c.g0, c.b0)]
+				+ m[Moments::At(c.r0, c.g0, c.b1)] - m[Moments::At(c.r0, c.g0, c.b0)];
+		default:
+			return -m[Moments::At(c.r1, c.g1, c.b0)] + m[Moments::At(c.r1, c.g0, c.b0)]
+				+ m[Moments::At(c.r0, c.g1, c.b0)] - m[Moments::At(c.r0, c.g0, c.b0)];
+		}
+	}
+
+	// the part of Vol() that depends on the cut position 'pos' along 'axis'.
+	int64_t Top(const Box& c, Axis axis, int pos, const std::vector<int64_t>& m)
+	{
+		switch (axis)
+		{
+		case Axis::R:
+			return m[Moments::At(pos, c.g1, c.b1)] - m[Moments::At(pos, c.g1, c.b0)]
+				- m[Moments::At(pos, c.g0, c.b1)] + m[Moments::At(pos, c.g0, c.b0)];
+		case Axis::G:
+			return m[Moments::At(c.r1, pos, c.b1)] - m[Moments::At(c.r1, pos, c.b0)]
+				- m[Moments::At(c.r0, pos, c.b1)] + m[Moments::At(c.r0, pos, c.b0)];
+		default:
+			return m[Moments::At(c.r1, c.g1, pos)] - m[Moments::At(c.r1, c.g0, pos)]
+				- m[Moments::At(c.r0, c.g1, pos)] + m[Moments::At(c.r0, c.g0, pos)];
+		}
+	}
+
+	double Variance(const Box& c, const Moments& m)
+	{
+		double dr = (double)Vol(c, m.R);
+		double dg = (double)Vol(c, m.G);
+		double db = (double)Vol(c, m.B);
+		double w = (double)Vol(c, m.W);
+		return (double)Vol(c, m.M2) - (dr * dr + dg * dg + db * db) / w;
+	}
+
+	double Maximize(const Box& c, Axis axis, int first, int last, int& cut, const int64_t (&whole)[4], const Moments& m)
+	{
+		const int64_t baseR = Bottom(c, axis, m.R);
+		const int64_t baseG = Bottom(c, axis, m.G);
+		const int64_t baseB = Bottom(c, axis, m.B);
+		const int64_t baseW = Bottom(c, axis, m.W);
+
+		double best = 0.0;
+		cut = -1;
+
+		for (int i = first; i < last; ++i)
+		{
+			double halfR = (double)(baseR + Top(c, axis, i, m.R));
+			double halfG = (double)(baseG + Top(c, axis, i, m.G));
+			double halfB = (double)(baseB + Top(c, axis, i, m.B));
+			int64_t halfW = baseW + Top(c, axis, i, m.W);
+
+			// both halves must hold pixels.
+			if (halfW == 0 || halfW == whole[3])
+				continue;
+
+			double score = (halfR * halfR + halfG * halfG + halfB * halfB) / (double)halfW;
+
+			halfR = (double)whole[0] - halfR;
+			halfG = (double)whole[1] - halfG;
+			halfB = (double)whole[2] - halfB;
+			score += (halfR * halfR + halfG * halfG + halfB * halfB) / (double)(whole[3] - halfW);
+
+			if (score > best)
+			{
+				best = score;
+				cut = i;
+			}
+		}
+
+		return best;
+	}
+
+	bool CutBox(Box& set1, Box& set2, const Moments& m)
+	{
+		const int64_t whole[4] = { Vol(set1, m.R), Vol(set1, m.G), Vol(set1, m.B), Vol(set1, m.W) };
+
+		int cutR, cutG, cutB;
+		double maxR = Maximize(set1, Axis::R, set1.r0 + 1, set1.r1, cutR, whole, m);
+		double maxG = Maximize(set1, Axis::G, set1.g0 + 1, set1.g1, cutG, whole, m);
+		double maxB = Maximize(set1, Axis::B, set1.b0 + 1, set1.b1, cutB, whole, m);
+
+		Axis axis;
+		if (maxR >= maxG && maxR >= maxB)
+		{
+			axis = Axis::R;
+			if (cutR < 0)
+				return false;
+		}
+		else if (maxG >= maxR && maxG >= maxB)
+			axis = Axis::G;
+		else
+			axis = Axis::B;
+
+		set2.r1 = set1.r1;
+		set2.g1 = set1.g1;
+		set2.b1 = set1.b1;
+
+		switch (axis)
+		{
+		case Axis::R:
+			set2.r0 = set1.r1 = cutR;
+			set2.g0 = set1.g0;
+			set2.b0 = set1.b0;
+			break;
+		case Axis::G:
+			set2.g0 = set1.g1 = cutG;
+			set2.r0 = set1.r0;
+			set2.b0 = set1.b0;
+			break;
+		case Axis::B:
+			set2.b0 = set1.b1 = cutB;
+			set2.r0 = set1.r0;
+			set2.g0 = set1.g0;
+			break;
+		}
+
+		set1.vol = (set1.r1 - set1.r0) * (set1.g1 - set1.g0) * (set1.b1 - set1.b0);
+		set2.vol = (set2.r1 - set2.r0) * (set2.g1 - set2.g0) * (set2.b1 - set2.b0);
+
+		return true;
+	}
+
+	uint16 QuantizeWu(const std::vector<Cell>& hist, uchar depth, uchar* cmap)
+	{
+		Moments m;
+		for (auto* v : { &m.W, &m.R, &m.G, &m.B, &m.A, &m.M2 })
+			v->assign(Side * Side * Side, 0);
+
+		for (uint32 r = 0; r < Bins; ++r)
+		{
+			for (uint32 g = 0; g < Bins; ++g)
+			{
+				for (uint32 b = 0; b < Bins; ++b)
+				{
+					const Cell& c = hist[(r << 10) | (g << 5) | b];
+					uint32 at = Moments::At(r + 1, g + 1, b + 1);
+					m.W[at] = (int64_t)c.N;
+					m.R[at] = (int64_t)c.R;
+					m.G[at] = (int64_t)c.G;
+					m.B[at] = (int64_t)c.B;
+					m.A[at] = (int64_t)c.A;
+					m.M2[at] = (int64_t)c.M2;
+				}
+			}
+		}
+
+		auto Cumulate = [](std::vector<int64_t>& v)
+		{
+			int64_t area[Side];
+			for (uint32 r = 1; r < Side; ++r)
+			{
+				std::fill(area, area + Side, 0);
+				for (uint32 g = 1; g < Side; ++g)
+				{
+					int64_t line = 0;
+					for (uint32 b = 1; b < Side; ++b)
+					{
+						line += v[Moments::At(r, g, b)];
+						area[b] += line;
+						v[Moments::At(r, g, b)] = v[Moments::At(r - 1, g, b)] + area[b];
+					}
+				}
+			}
+		};
+
+		// the six moments are independent.
+		std::vector<int64_t>* all[] = { &m.W, &m.R, &m.G, &m.B, &m.A, &m.M2 };
+		threading::ParallelInvoke(6, [&](uint32 i) { Cumulate(*all[i]); });
+
+		Box cubes[256];
+		double vv[256];
+		cubes[0] = { 0, (int)Bins, 0, (int)Bins, 0, (int)Bins, 0 };
+		vv[0] = 0.0;
+
+		uint16 count = 256;
+		int next = 0;
+		for (int i = 1; i < 256; ++i)
+		{
+			if (CutBox(cubes[next], cubes[i], m))
+			{
+				vv[next] = cubes[next].vol > 1 ? Variance(cubes[next], m) : 0.0;
+				vv[i] = cubes[i].vol > 1 ? Variance(cubes[i], m) : 0.0;
+			}
+			else
+			{
+				// this box can't be split, don't try it again.
+				vv[next] = 0.0;
+				--i;
+			}
+
+			next = 0;
+			double best = vv[0];
+			for (int k = 1; k <= i; ++k)
+			{
+				if (vv[k] > best)
+				{
+					best = vv[k];
+					next = k;
+				}
+			}
+
+			if (best <= 0.0)
+			{
+				count = (uint16)(i + 1);
+				break;
+			}
+		}
+
+		uint16 size = 0;
+		for (uint16 k = 0; k < count; ++k)
+		{
+			int64_t w = Vol(cubes[k], m.W);
+			if (w <= 0)
+				continue;
+
+			EmitEntry((uint64)w, (uint64)Vol(cubes[k], m.R), (uint64)Vol(cubes[k], m.G), (uint64)Vol(cubes[k], m.B),
+				(uint64)Vol(cubes[k], m.A), depth, cmap + (addressable)size * (depth / 8));
+			++size;
+		}
+
+		return size;
+	}
+}
+
+xtga::codecs::ColorHistogram::ColorHistogram(uchar depth) : _Cells(Cells, EmptyCell), _Pixels(0), _Depth(depth) {}
+
+// counts every pixel into the cell indexed (r << 10) | (g << 5) | b.
+void xtga::codecs::ColorHistogram::Add(const void* buff, addressable length)
+{
+	std::mutex Lock;
+
+	// 16-bit channels are already 5 bits.
+	const uchar depth = _Depth;
+	const uchar shift = depth == 16 ? 0 : 3;
+	const uchar stride = depth / 8;
+
+	auto Accumulate = [&](const addressable& start, const addressable& count)
+	{
+		// a lone part (serial or small inputs) has the histogram to itself, only split work needs a
+		// local one to merge.
+		const bool whole = count == length;
+		std::vector<Cell> local;
+		if (!whole)
+			local.assign(Cells, EmptyCell);
+		Cell* cells = whole ? _Cells.data() : local.data();
+
+		const uchar* p = (const uchar*)buff + start * stride;
+		for (addressable i = 0; i < count; ++i, p += stride)
+		{
+			int16_t c[4];
+			PaletteMatcher::Unpack(p, depth, c);
+
+			Cell& cell = cells[((c[0] >> shift) << 10) | ((c[1] >> shift) << 5) | (c[2] >> shift)];
+			++cell.N;
+			cell.R += c[0];
+			cell.G += c[1];
+			cell.B += c[2];
+			cell.A += c[3];
+			cell.M2 += (uint64)(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]);
+		}
+
+		if (whole)
+			return;
+
+		std::lock_guard<std::mutex> lock(Lock);
+		for (uint32 i = 0; i < Cells; ++i)
+			_Cells[i].Add(local[i]);
+	};
+
+	// every part counts at least as many pixels as a local histogram has cells, so clearing and merging
+	// it never outweighs the counting.
+	threading::ParallelFor(threading::ChooseExecution(threading::WORKLOAD::COLORMAP_BUILD, length, depth), length, Accumulate, Cells);
+
+	_Pixels += length;
+}
+
+uint16 xtga::codecs::ColorHistogram::Quantize(flags::QUANTIZER quantizer, void* ColorMap) const
+{
+	if (_Pixels == 0)
+		return 0;
+
+	if (quantizer == flags::QUANTIZER::OCTREE)
+		return QuantizeOctree(_Cells, _Depth, (uchar*)ColorMap);
+
+	return QuantizeWu(_Cells, _Depth, (uchar*)ColorMap);
+}
+
+uint64 xtga::codecs::ColorHistogram::GetPixels() const
+{
+	return _Pixels;
+}
+
+bool xtga::codecs::QuantizeColorMap(const void* inBuff, void*& outBuff, void*& ColorMap, addressable length, uchar depth, uint16& Size, flags::QUANTIZER quantizer, ERRORCODE* error)
+{
+	if (!(depth == 16 || depth == 24 || depth == 32))
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
+		return false;
+	}
+
+	if (length == 0)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_OPERATION);
+		return false;
+	}
+
+	ColorHistogram hist(depth);
+	hist.Add(inBuff, length);
+
+	auto cmap = (uchar*)memory::Allocate(256 * (addressable)(depth / 8));
+	Size = hist.Quantize(quantizer, cmap);
+
+	ColorMap = cmap;
+	outBuff = MapColorMap(inBuff, length, depth, cmap, Size);
+
+	XTGA_SETERROR(error, ERRORCODE::NONE);
+	return true;
+}
+
+uchar xtga::codecs::RefineColorMap(const void* inBuff, uchar* indices, void* ColorMap, addressable length, uchar depth, uint16 Size, uchar iterations)
+{
+	const uchar stride = depth / 8;
+	uchar ran = 0;
+
+	for (; ran < iterations; ++ran)
+	{
+		// update, move every entry to the mean of its pixels (entries without pixels stay put).
+		std::vector<Cell> sums(Size, EmptyCell);
+		std::mutex Lock;
+
+		auto Accumulate = [&](const addressable& start, const addressable& count)
+		{
+			std::vector<Cell> local(Size, EmptyCell);
+
+			const uchar* p = (const uchar*)inBuff + start * stride;
+			for (addressable i = start; i < start + count; ++i, p += stride)
+			{
+				int16_t c[4];
+				PaletteMatcher::Unpack(p, depth, c);
+
+				Cell& cell = local[indices[i]];
+				++cell.N;
+				cell.R += c[0];
+				cell.G += c[1];
+				cell.B += c[2];
+				cell.A += c[3];
+			}
+
+			std::lock_guard<std::mutex> lock(Lock);
+			for (uint16 k = 0; k < Size; ++k)
+				sums[k].Add(local[k]);
+		};
+
+		threading::ParallelFor(threading::ChooseExecution(threading::WORKLOAD::COLORMAP_BUILD, length, depth), length, Accumulate);
+
+		for (uint16 k = 0; k < Size; ++k)
+		{
+			const Cell& c = sums[k];
+			if (c.N != 0)
+				EmitEntry(c.N, c.R, c.G, c.B, c.A, depth, (uchar*)ColorMap + (addressable)k * stride);
+		}
+
+		// assign, remap every pixel to its now closest entry.
+		const auto Execution = threading::ChooseExecution(threading::WORKLOAD::COLORMAP_SEARCH, length, depth, Size);
+		PaletteMatcher Matcher(ColorMap, Size, depth, WeightsFor(depth), Execution != threading::EXECUTION::SERIAL);
+		std::atomic<addressable> changed(0);
+
+		auto Assign = [&](const addressable& start, const addressable& count)
+		{
+			uchar chunk[1024];
+			addressable moved = 0;
+
+			for (addressable i = start; i < start + count; i += sizeof(chunk))
+			{
+				addressable n = std::min<addressable>(sizeof(chunk), start + count - i);
+				Matcher.NearestRange(inBuff, i, n, chunk);
+
+				for (addressable j = 0; j < n; ++j)
+				{
+					if (indices[i + j] != chunk[j])
+					{
+						indices[i + j] = chunk[j];
+						++moved;
+					}
+				}
+			}
+
+			changed += moved;
+		};
+
+		threading::ParallelFor(Execution, length, Assign);
+
+		if (changed == 0)
+		{
+			++ran;
+			break;
+		}
+	}
+
+	return ran;
+}
+
+void* xtga::codecs::SamplePixels(const void* inBuff, addressable length, uchar depth, addressable samples)
+{
+	const uchar stride = depth / 8;
+	auto out = (uchar*)memory::Allocate(samples * stride);
+
+	threading::ParallelFor(samples, [&](const addressable& start, const addressable& count)
+	{
+		for (addressable k = start; k < start + count; ++k)
+		{
+			addressable first = length * k / samples;
+			addressable size = length * (k + 1) / samples - first;
+
+			// splitmix64 of the run index, the same image always gives the same sample.
+			uint64 z = (uint64)k + 0x9E3779B97F4A7C15ull;
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			z ^= z >> 31;
+
+			addressable pick = first + (addressable)(z % size);
+			memcpy(out + k * stride, (const uchar*)inBuff + pick * stride, stride);
+		}
+	});
+
+	return out;
+}
+
+uchar* xtga::codecs::MapColorMap(const void* inBuff, addressable length, uchar depth, const void* ColorMap, uint16 Size, bool approximate)
+{
+	auto IMap = (uchar*)memory::Allocate(length);
+
+	// the lattice ignores alpha, so 32-bit images always search.
+	if (depth == 16 || (depth == 24 && approximate))
+	{
+		InverseColorMap Inverse(ColorMap, Size, depth, WeightsFor(depth), 5, true);
+
+		threading::ParallelFor(threading::ChooseExecution(threading::WORKLOAD::COLORMAP_LOOKUP, length, depth), length,
+			[&](const addressable& start, const addressable& count)
+		{
+			Inverse.LookupRange(inBuff, start, count, IMap + start);
+		});
+
+		return IMap;
+	}
+
+	const auto Execution = threading::ChooseExecution(threading::WORKLOAD::COLORMAP_SEARCH, length, depth, Size);
+	PaletteMatcher Matcher(ColorMap, Size, depth, WeightsFor(depth), Execution != threading::EXECUTION::SERIAL);
+
+	threading::ParallelFor(Execution, length, [&](const addressable& start, const addressable& count)
+	{
+		Matcher.NearestRange(inBuff, start, count, IMap + start);
+	});
+
+	return IMap;
+}
+
+double xtga::codecs::ColorMapError(const void* inBuff, const uchar* indices, addressable length, uchar depth, const void* ColorMap)
+{
+	if (length == 0)
+		return 0.0;
+
+	const uchar stride = depth / 8;
+	const uchar channels = depth == 32 ? 4 : 3;
+	std::atomic<uint64> total(0);
+
+	// 16-bit channels are brought to the 8-bit scale so that errors are comparable across depths.
+	auto To8 = [depth](int16_t (&c)[4])
+	{
+		if (depth == 16)
+		{
+			c[0] = LUT5[c[0]];
+			c[1] = LUT5[c[1]];
+			c[2] = LUT5[c[2]];
+		}
+	};
+
+	threading::ParallelFor(length, [&](const addressable& start, const addressable& count)
+	{
+		uint64 sse = 0;
+		const uchar* p = (const uchar*)inBuff + start * stride;
+		for (addressable i = start; i < start + count; ++i, p += stride)
+		{
+			int16_t o[4], d[4];
+			PaletteMatcher::Unpack(p, depth, o);
+			PaletteMatcher::Unpack((const uchar*)ColorMap + (addressable)indices[i] * stride, depth, d);
+			To8(o);
+			To8(d);
+
+			for (uchar c = 0; c < channels; ++c)
+				sse += (uint64)((o[c] - d[c]) * (o[c] - d[c]));
+		}
+		total += sse;
+	});
+
+	return (double)total / ((double)length * channels);
+}
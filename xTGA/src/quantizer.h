@@ -0,0 +1,144 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: quantizer.h
+/// purpose : Provides the octree and Wu quantizers, k-means refinement and sampling.
+//==============================================================================
+
+#ifndef XTGA_QUANTIZER_H__
+#define XTGA_QUANTIZER_H__
+
+#include "xTGA/error.h"
+#include "xTGA/flags.h"
+#include "xTGA/types.h"
+
+#include <vector>
+
+namespace xtga
+{
+	namespace codecs
+	{
+		//----------------------------------------------------------------------------------------------------
+		/// A cell of a ColorHistogram, the pixel count and channel sums of the pixels that fell into it.
+		//----------------------------------------------------------------------------------------------------
+		struct HistogramCell
+		{
+			uint64 N, R, G, B, A, M2;
+
+			void Add(const HistogramCell& o)
+			{
+				N += o.N; R += o.R; G += o.G; B += o.B; A += o.A; M2 += o.M2;
+			}
+		};
+
+		//----------------------------------------------------------------------------------------------------
+		/// A 32x32x32 RGB histogram that the octree and Wu quantizers build their color maps from. Pixels can
+		/// be added to it at any time, so one histogram can cover several images. Counts are integers, so the
+		/// result never depends on the thread count.
+		//----------------------------------------------------------------------------------------------------
+		class ColorHistogram
+		{
+		public:
+			//----------------------------------------------------------------------------------------------------
+			/// Creates an empty histogram.
+			/// @param[in] depth				The bits per pixel of the images that will be added (must be 16/24/32).
+			//----------------------------------------------------------------------------------------------------
+			explicit ColorHistogram(uchar depth);
+
+			//----------------------------------------------------------------------------------------------------
+			/// Counts every pixel of an image into the histogram.
+			/// @param[in] buff					The image buffer (of the histogram's depth).
+			/// @param[in] length				The number of pixels in the image.
+			//----------------------------------------------------------------------------------------------------
+			void Add(const void* buff, addressable length);
+
+			//----------------------------------------------------------------------------------------------------
+			/// Builds a color map of at most 256 entries from the histogram.
+			/// @param[in] quantizer			The quantizer to use (OCTREE, anything else uses WU).
+			/// @param[out] ColorMap			Receives the color map, must hold 256 entries of the histogram's depth.
+			/// @return uint16					The number of entries written, 0 if the histogram is empty.
+			//----------------------------------------------------------------------------------------------------
+			uint16 Quantize(flags::QUANTIZER quantizer, void* ColorMap) const;
+
+			//----------------------------------------------------------------------------------------------------
+			/// Returns the number of pixels counted so far.
+			//----------------------------------------------------------------------------------------------------
+			uint64 GetPixels() const;
+
+		private:
+			std::vector<HistogramCell> _Cells;
+			uint64 _Pixels;
+			uchar _Depth;
+		};
+
+		//----------------------------------------------------------------------------------------------------
+		/// Builds a color map of at most 256 entries with the given quantizer and maps every pixel to its
+		/// closest entry. Both quantizers work on a 32x32x32 RGB histogram, alpha is averaged per entry.
+		/// @param[in] inBuff				The image buffer.
+		/// @param[out] outBuff				Receives the color map indices (one uchar per pixel), free with memory::Free().
+		/// @param[out] ColorMap			Receives the color map (in the image's format), free with memory::Free().
+		/// @param[in] length				The number of pixels in the image.
+		/// @param[in] depth				The bits per pixel of the image (must be 16/24/32).
+		/// @param[out] Size				Receives the number of entries in the color map.
+		/// @param[in] quantizer			The quantizer to use (OCTREE or WU).
+		/// @param[out] error				Holds the error/status code should an error occur (can be nullptr).
+		/// @return bool					True if the color map was built.
+		//----------------------------------------------------------------------------------------------------
+		bool QuantizeColorMap(const void* inBuff, void*& outBuff, void*& ColorMap, addressable length, uchar depth, uint16& Size, flags::QUANTIZER quantizer, ERRORCODE* error = nullptr);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Refines a color map with k-means, each iteration moves every entry to the mean of the pixels
+		/// mapped to it and then remaps the pixels. Stops early once no pixel changes entry.
+		/// @param[in] inBuff				The image buffer.
+		/// @param[in,out] indices			The color map indices of every pixel.
+		/// @param[in,out] ColorMap			The color map (in the image's format).
+		/// @param[in] length				The number of pixels in the image.
+		/// @param[in] depth				The bits per pixel of the image (must be 16/24/32).
+		/// @param[in] Size					The number of entries in the color map.
+		/// @param[in] iterations			The maximum number of iterations.
+		/// @return uchar					The number of iterations run.
+		//----------------------------------------------------------------------------------------------------
+		uchar RefineColorMap(const void* inBuff, uchar* indices, void* ColorMap, addressable length, uchar depth, uint16 Size, uchar iterations);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Picks a stratified sample of the image, the image is split into 'samples' equal runs of pixels
+		/// and one pixel is taken from a pseudo-random position within each run.
+		/// @param[in] inBuff				The image buffer.
+		/// @param[in] length				The number of pixels in the image.
+		/// @param[in] depth				The bits per pixel of the image (must be 16/24/32).
+		/// @param[in] samples				The number of pixels to pick (must be <= length).
+		/// @return void*					The sampled pixels (in the image's format), free with memory::Free().
+		//----------------------------------------------------------------------------------------------------
+		void* SamplePixels(const void* inBuff, addressable length, uchar depth, addressable samples);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Maps every pixel to its closest color map entry. 16-bit images always go through an (exact)
+		/// inverse color map.
+		/// @param[in] inBuff				The image buffer.
+		/// @param[in] length				The number of pixels in the image.
+		/// @param[in] depth				The bits per pixel of the image (must be 16/24/32).
+		/// @param[in] ColorMap				The color map (in the image's format).
+		/// @param[in] Size					The number of entries in the color map.
+		/// @param[in] approximate			If true 24-bit images also go through an inverse color map, a few
+		///									pixels may then get their second closest entry.
+		/// @return uchar*					The color map indices (one per pixel), free with memory::Free().
+		//----------------------------------------------------------------------------------------------------
+		uchar* MapColorMap(const void* inBuff, addressable length, uchar depth, const void* ColorMap, uint16 Size, bool approximate = false);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Measures how closely a color mapped image matches its source.
+		/// @param[in] inBuff				The source image buffer.
+		/// @param[in] indices				The color map indices of every pixel.
+		/// @param[in] length				The number of pixels in the image.
+		/// @param[in] depth				The bits per pixel of the image (must be 16/24/32).
+		/// @param[in] ColorMap				The color map (in the image's format).
+		/// @return double					The mean squared error per channel (8-bit scale), over R, G, B and
+		///									for 32-bit images A.
+		//----------------------------------------------------------------------------------------------------
+		double ColorMapError(const void* inBuff, const uchar* indices, addressable length, uchar depth, const void* ColorMap);
+	}
+}
+
+#endif // !XTGA_QUANTIZER_H__
@@ -0,0 +1,689 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: resample.cpp
+/// purpose : Provides the resamplers used to resize images and build thumbnails.
+//==============================================================================
+
+#include "resample.h"
+
+#include "codecs.h"
+#include "error_macro.h"
+#include "thread_pool.h"
+#include "xTGA/allocator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define XTGA_RESAMPLE_SSE2
+#	include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#	define XTGA_RESAMPLE_NEON
+#	include <arm_neon.h>
+#endif
+
+namespace
+{
+	using namespace xtga;
+
+	constexpr int32_t WeightBits = 14;
+	constexpr int32_t WeightOne = 1 << WeightBits;
+	constexpr int32_t WeightRound = 1 << (WeightBits - 1);
+
+	// the filter of one axis, output sample o reads Taps source samples from Start[o] on.
+	struct FilterTable
+	{
+		std::vector<uint32> Start;
+		std::vector<int16_t> Weights;
+		uint32 Taps;
+	};
+
+	// Catmull-Rom, the same curve the per-pixel interpolation used before.
+	double Cubic(double x)
+	{
+		x = std::fabs(x);
+		if (x < 1.0)
+			return (1.5 * x - 2.5) * x * x + 1.0;
+		if (x < 2.0)
+			return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+		return 0.0;
+	}
+
+	double Stretch(uint16 in, uint16 out)
+	{
+		return std::max((double)in / out, 1.0);
+	}
+
+	FilterTable BuildFilter(uint16 in, uint16 out)
+	{
+		const double scale = (double)in / out;
+		const double stretch = Stretch(in, out);
+		const double support = 2.0 * stretch;
+
+		FilterTable t;
+		t.Taps = codecs::BicubicTaps(in, out);
+		t.Start.resize(out);
+		t.Weights.assign((addressable)out * t.Taps, 0);
+
+		std::vector<double> w(t.Taps);
+		for (uint32 o = 0; o < out; ++o)
+		{
+			// samples whose centers lie within the support, those past the edges repeat the edge sample.
+			const double center = (o + 0.5) * scale;
+			const int32_t first = (int32_t)std::ceil(center - support - 0.5);
+			const int32_t last = (int32_t)std::floor(center + support - 0.5);
+			const int32_t start = std::min(std::max(first, 0), (int32_t)in - (int32_t)t.Taps);
+
+			std::fill(w.begin(), w.end(), 0.0);
+			double sum = 0.0;
+			for (int32_t i = first; i <= last; ++i)
+			{
+				const int32_t s = std::min(std::max(i, 0), (int32_t)in - 1);
+				const double v = Cubic((i + 0.5 - center) / stretch);
+				w[s - start] += v;
+				sum += v;
+			}
+
+			// the weights must sum to exactly one in fixed point, the rounding error goes to the largest.
+			int16_t* q = &t.Weights[(addressable)o * t.Taps];
+			int32_t total = 0;
+			uint32 largest = 0;
+			for (uint32 k = 0; k < t.Taps; ++k)
+			{
+				q[k] = (int16_t)std::lround(w[k] / sum * WeightOne);
+				total += q[k];
+				if (q[k] > q[largest])
+					largest = k;
+			}
+			q[largest] = (int16_t)(q[largest] + WeightOne - total);
+
+			t.Start[o] = (uint32)start;
+		}
+
+		return t;
+	}
+
+	uchar Clamp(int32_t v)
+	{
+		return v < 0 ? 0 : (v > 255 ? 255 : (uchar)v);
+	}
+
+	template <uchar C>
+	uint32 LoadPixel(const uchar* p)
+	{
+		uint32 v = 0;
+		memcpy(&v, p, C);
+		return v;
+	}
+
+	// filters one row of C-byte pixels along x.
+	template <uchar C>
+	void FilterRow(const uchar* in, uchar* out, const FilterTable& t)
+	{
+		const uint32 Taps = t.Taps;
+		const addressable count = t.Start.size();
+
+		for (addressable o = 0; o < count; ++o)
+		{
+			const uchar* src = in + (addressable)t.Start[o] * C;
+			const int16_t* w = &t.Weights[o * Taps];
+
+#if defined(XTGA_RESAMPLE_SSE2)
+			// two taps per step, the pixels are interleaved per channel so madd sums both taps at once.
+			const __m128i zero = _mm_setzero_si128();
+			__m128i acc = _mm_set1_epi32(WeightRound);
+			uint32 k = 0;
+			for (; k + 1 < Taps; k += 2)
+			{
+				__m128i p = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)LoadPixel<C>(src + k * C)), _mm_cvtsi32_si128((int)LoadPixel<C>(src + (k + 1) * C)));
+				p = _mm_unpacklo_epi8(p, zero);
+				const __m128i wk = _mm_set1_epi32((int32_t)(((uint32)(uint16_t)w[k + 1] << 16) | (uint16_t)w[k]));
+				acc = _mm_add_epi32(acc, _mm_madd_epi16(p, wk));
+			}
+			if (k < Taps)
+			{
+				__m128i p = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)LoadPixel<C>(src + k * C)), zero);
+				p = _mm_unpacklo_epi8(p, zero);
+				acc = _mm_add_epi32(acc, _mm_madd_epi16(p, _mm_set1_epi32((uint16_t)w[k])));
+			}
+
+			acc = _mm_srai_epi32(acc, WeightBits);
+			acc = _mm_packus_epi16(_mm_packs_epi32(acc, acc), zero);
+			const uint32 v = (uint32)_mm_cvtsi128_si32(acc);
+			memcpy(out + o * C, &v, C);
+#elif defined(XTGA_RESAMPLE_NEON)
+			int32x4_t acc = vdupq_n_s32(WeightRound);
+			for (uint32 k = 0; k < Taps; ++k)
+			{
+				const int16x4_t p = vreinterpret_s16_u16(vget_low_u16(vmovl_u8(vcreate_u8(LoadPixel<C>(src + k * C)))));
+				acc = vmlal_n_s16(acc, p, w[k]);
+			}
+
+			const uint16x4_t n = vqmovun_s32(vshrq_n_s32(acc, WeightBits));
+			const uint32 v = vget_lane_u32(vreinterpret_u32_u8(vqmovn_u16(vcombine_u16(n, n))), 0);
+			memcpy(out + o * C, &v, C);
+#else
+			for (uchar c = 0; c < C; ++c)
+			{
+				int32_t acc = WeightRound;
+				for (uint32 k = 0; k < Taps; ++k)
+					acc += w[k] * src[k * C + c];
+				out[o * C + c] = Clamp(acc >> WeightBits);
+			}
+#endif
+		}
+	}
+
+	// filters one output row along y, from Taps rows of 'stride' bytes.
+	void FilterColumns(const uchar* const* rows, const int16_t* w, uint32 Taps, uchar* out, addressable stride)
+	{
+		addressable x = 0;
+
+#if defined(XTGA_RESAMPLE_SSE2)
+		const __m128i zero = _mm_setzero_si128();
+		for (; x + 8 <= stride; x += 8)
+		{
+			__m128i acc0 = _mm_set1_epi32(WeightRound), acc1 = acc0;
+			uint32 k = 0;
+			for (; k + 1 < Taps; k += 2)
+			{
+				const __m128i ab = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(rows[k] + x)), _mm_loadl_epi64((const __m128i*)(rows[k + 1] + x)));
+				const __m128i wk = _mm_set1_epi32((int32_t)(((uint32)(uint16_t)w[k + 1] << 16) | (uint16_t)w[k]));
+				acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi8(ab, zero), wk));
+				acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi8(ab, zero), wk));
+			}
+			if (k < Taps)
+			{
+				const __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(rows[k] + x)), zero);
+				const __m128i wk = _mm_set1_epi32((uint16_t)w[k]);
+				acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi8(a, zero), wk));
+				acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi8(a, zero), wk));
+			}
+
+			acc0 = _mm_srai_epi32(acc0, WeightBits);
+			acc1 = _mm_srai_epi32(acc1, WeightBits);
+			_mm_storel_epi64((__m128i*)(out + x), _mm_packus_epi16(_mm_packs_epi32(acc0, acc1), zero));
+		}
+#elif defined(XTGA_RESAMPLE_NEON)
+		for (; x + 8 <= stride; x += 8)
+		{
+			int32x4_t acc0 = vdupq_n_s32(WeightRound), acc1 = acc0;
+			for (uint32 k = 0; k < Taps; ++k)
+			{
+				const int16x8_t p = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(rows[k] + x)));
+				acc0 = vmlal_n_s16(acc0, vget_low_s16(p), w[k]);
+				acc1 = vmlal_n_s16(acc1, vget_high_s16(p), w[k]);
+			}
+
+			const uint16x8_t n = vcombine_u16(vqmovun_s32(vshrq_n_s32(acc0, WeightBits)), vqmovun_s32(vshrq_n_s32(acc1, WeightBits)));
+			vst1_u8(out + x, vqmovn_u16(n));
+		}
+#endif
+
+		for (; x < stride; ++x)
+		{
+			int32_t acc = WeightRound;
+			for (uint32 k = 0; k < Taps; ++k)
+				acc += w[k] * rows[k][x];
+			out[x] = Clamp(acc >> WeightBits);
+		}
+	}
+
+	// the part of the source an output sample of a box filter covers. Coordinates are scaled so that both
+	// grids are whole numbers, a source sample is 'out' units wide and an output sample 'in' units wide.
+	// Samples First..First+Count are fully covered, Left and Right are the partly covered ones at the edges.
+	struct BoxSpan
+	{
+		uint32 First, Count;
+		uint32 Left, LeftWeight;
+		uint32 Right, RightWeight;
+	};
+
+	std::vector<BoxSpan> BuildSpans(uint16 in, uint16 out)
+	{
+		std::vector<BoxSpan> spans(out);
+		for (uint32 o = 0; o < out; ++o)
+		{
+			const uint64 L = (uint64)o * in;
+			const uint64 R = (uint64)(o + 1) * in;
+			const uint32 xL = (uint32)(L / out);
+			const uint32 xR = (uint32)((R - 1) / out);
+
+			BoxSpan& b = spans[o];
+			if (xL == xR)
+			{
+				b = { xL, 0, xL, (uint32)(R - L), xL, 0 };
+				continue;
+			}
+
+			uint32 first = xL + 1, last = xR;
+			uint32 lw = (uint32)((uint64)(xL + 1) * out - L);
+			uint32 rw = (uint32)(R - (uint64)xR * out);
+			if (lw == out)
+			{
+				first = xL;
+				lw = 0;
+			}
+			if (rw == out)
+			{
+				last = xR + 1;
+				rw = 0;
+			}
+
+			b = { first, last - first, xL, lw, xR, rw };
+		}
+		return spans;
+	}
+
+	// adds up each channel of 'count' C-byte pixels into sums.
+	template <uchar C>
+	void SumRun(const uchar* p, uint32 count, uint32* sums)
+	{
+		const addressable bytes = (addressable)count * C;
+		addressable i = 0;
+
+#if defined(XTGA_RESAMPLE_SSE2) || defined(XTGA_RESAMPLE_NEON)
+		// 48 bytes hold a whole number of pixels for every C, so each byte lane always sees the same
+		// channel. Lanes add up in 16 bits for at most 256 blocks and are then folded into the sums.
+		while (i + 48 <= bytes)
+		{
+			const addressable blocks = std::min<addressable>((bytes - i) / 48, 256);
+			alignas(16) uint16_t lanes[48];
+
+#if defined(XTGA_RESAMPLE_SSE2)
+			const __m128i zero = _mm_setzero_si128();
+			__m128i acc[6] = { zero, zero, zero, zero, zero, zero };
+			for (addressable b = 0; b < blocks; ++b, i += 48)
+			{
+				for (uchar v = 0; v < 3; ++v)
+				{
+					const __m128i x = _mm_loadu_si128((const __m128i*)(p + i + v * 16));
+					acc[v * 2] = _mm_add_epi16(acc[v * 2], _mm_unpacklo_epi8(x, zero));
+					acc[v * 2 + 1] = _mm_add_epi16(acc[v * 2 + 1], _mm_unpackhi_epi8(x, zero));
+				}
+			}
+			for (uchar v = 0; v < 6; ++v)
+				_mm_store_si128((__m128i*)(lanes + v * 8), acc[v]);
+#else
+			uint16x8_t acc[6] = { vdupq_n_u16(0), vdupq_n_u16(0), vdupq_n_u16(0), vdupq_n_u16(0), vdupq_n_u16(0), vdupq_n_u16(0) };
+			for (addressable b = 0; b < blocks; ++b, i += 48)
+			{
+				for (uchar v = 0; v < 3; ++v)
+				{
+					const uint8x16_t x = vld1q_u8(p + i + v * 16);
+					acc[v * 2] = vaddw_u8(acc[v * 2], vget_low_u8(x));
+					acc[v * 2 + 1] = vaddw_u8(acc[v * 2 + 1], vget_high_u8(x));
+				}
+			}
+			for (uchar v = 0; v < 6; ++v)
+				vst1q_u16(lanes + v * 8, acc[v]);
+#endif
+
+			for (uchar l = 0; l < 48; ++l)
+				sums[l % C] += lanes[l];
+		}
+#endif
+
+		for (; i < bytes; ++i)
+			sums[i % C] += p[i];
+	}
+
+	// reduces one row of C-byte pixels along x, each output sample holds its weighted sum (of weight 'in').
+	template <uchar C>
+	void ReduceRow(const uchar* in, uint32* out, const std::vector<BoxSpan>& spans, uint32 full)
+	{
+		for (addressable o = 0; o < spans.size(); ++o)
+		{
+			const BoxSpan& b = spans[o];
+			uint32 sums[4] = { 0, 0, 0, 0 };
+			SumRun<C>(in + (addressable)b.First * C, b.Count, sums);
+
+			for (uchar c = 0; c < C; ++c)
+				out[o * C + c] = sums[c] * full + in[(addressable)b.Left * C + c] * b.LeftWeight + in[(addressable)b.Right * C + c] * b.RightWeight;
+		}
+	}
+
+	// 16-bit pixels are filtered as 8-bit BGRA and packed again at the end.
+	uchar* Unpack5551(const void* data, addressable length)
+	{
+		using namespace pixelformats;
+
+		auto out = (uchar*)memory::Allocate(length * 4);
+		for (addressable i = 0; i < length; ++i)
+		{
+			const BGRA5551 p = ((const BGRA5551*)data)[i];
+			out[i * 4 + 0] = LUT5[p.B];
+			out[i * 4 + 1] = LUT5[p.G];
+			out[i * 4 + 2] = LUT5[p.R];
+			out[i * 4 + 3] = (uchar)(p.A * 0xFF);
+		}
+		return out;
+	}
+
+	// packs in place, returns the (shrunk) buffer.
+	uchar* Pack5551(uchar* data, addressable length)
+	{
+		using namespace pixelformats;
+
+		auto out = (BGRA5551*)data;
+		for (addressable i = 0; i < length; ++i)
+		{
+			const uchar* p = data + i * 4;
+			BGRA5551 v;
+			v.B = (p[0] * 31 + 127) / 255;
+			v.G = (p[1] * 31 + 127) / 255;
+			v.R = (p[2] * 31 + 127) / 255;
+			v.A = p[3] >= 128 ? 1 : 0;
+			out[i] = v;
+		}
+		return (uchar*)memory::Reallocate(data, length * sizeof(BGRA5551));
+	}
+
+	// the number of bytes per pixel the resamplers work on, 0 if the format isn't supported.
+	uchar Channels(pixelformats::PIXELFORMATS format)
+	{
+		using namespace pixelformats;
+
+		if (format == PIXELFORMATS::BGR888)
+			return 3;
+		if (format == PIXELFORMATS::BGRA5551 || format == PIXELFORMATS::BGRA8888)
+			return 4;
+		if (format == PIXELFORMATS::I8)
+			return 1;
+		if (format == PIXELFORMATS::IA88)
+			return 2;
+		return 0;
+	}
+
+	void FilterRows(const uchar* in, uchar* out, const FilterTable& t, uchar C, addressable istride, addressable ostride, addressable count)
+	{
+		for (addressable y = 0; y < count; ++y)
+		{
+			if (C == 1)
+				FilterRow<1>(in + y * istride, out + y * ostride, t);
+			else if (C == 2)
+				FilterRow<2>(in + y * istride, out + y * ostride, t);
+			else if (C == 3)
+				FilterRow<3>(in + y * istride, out + y * ostride, t);
+			else
+				FilterRow<4>(in + y * istride, out + y * ostride, t);
+		}
+	}
+}
+
+uint32 xtga::codecs::BicubicTaps(uint16 in, uint16 out)
+{
+	if (in == 0 || out == 0)
+		return 0;
+
+	const double support = 2.0 * Stretch(in, out);
+	return std::min<uint32>((uint32)std::ceil(2.0 * support) + 1, in);
+}
+
+void* xtga::codecs::ResizeImageBicubic(const void* data, pixelformats::PIXELFORMATS format, uint16 width, uint16 height,
+	uint16 nWidth, uint16 nHeight, bool parallel, ERRORCODE* error)
+{
+	using namespace pixelformats;
+
+	const uchar C = Channels(format);
+	if (C == 0)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
+		return nullptr;
+	}
+
+	if (!data || width == 0 || height == 0 || nWidth == 0 || nHeight == 0)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_OPERATION);
+		return nullptr;
+	}
+
+	const bool Packed = format == PIXELFORMATS::BGRA5551;
+
+	uchar* unpacked = Packed ? Unpack5551(data, (addressable)width * height) : nullptr;
+	const uchar* src = Packed ? unpacked : (const uchar*)data;
+
+	const FilterTable tx = BuildFilter(width, nWidth);
+	const FilterTable ty = BuildFilter(height, nHeight);
+
+	const addressable istride = (addressable)width * C;
+	const addressable ostride = (addressable)nWidth * C;
+
+	// only the source rows some output row reads are filtered along x.
+	const uint32 firstRow = ty.Start.front();
+	const uint32 rowCount = ty.Start.back() + ty.Taps - firstRow;
+
+	const addressable taps = (addressable)nWidth * rowCount * tx.Taps + (addressable)nWidth * nHeight * ty.Taps;
+	const auto Execution = parallel
+		? threading::ChooseExecution(threading::WORKLOAD::RESAMPLE, taps, C * 8)
+		: threading::EXECUTION::SERIAL;
+
+	uchar* tmp = (uchar*)memory::Allocate((addressable)rowCount * ostride);
+	threading::ParallelFor(Execution, rowCount, [&](const addressable& start, const addressable& count)
+	{
+		FilterRows(src + (firstRow + start) * istride, tmp + start * ostride, tx, C, istride, ostride, count);
+	}, 4);
+
+	memory::Free(unpacked);
+
+	uchar* rval = (uchar*)memory::Allocate((addressable)nHeight * ostride);
+	threading::ParallelFor(Execution, nHeight, [&](const addressable& start, const addressable& count)
+	{
+		std::vector<const uchar*> rows(ty.Taps);
+		for (addressable y = start; y < start + count; ++y)
+		{
+			for (uint32 k = 0; k < ty.Taps; ++k)
+				rows[k] = tmp + (addressable)(ty.Start[y] - firstRow + k) * ostride;
+
+			FilterColumns(rows.data(), &ty.Weights[y * ty.Taps], ty.Taps, rval + y * ostride, ostride);
+		}
+	}, 4);
+
+	memory::Free(tmp);
+
+	if (Packed)
+		rval = Pack5551(rval, (addressable)nWidth * nHeight);
+
+	XTGA_SETERROR(error, ERRORCODE::NONE);
+	return rval;
+}
+
+void* xtga::codecs::ResizeImageBox(const void* data, pixelformats::PIXELFORMATS format, uint16 width, uint16 height,
+	uint16 nWidth, uint16 nHeight, bool parallel, ERRORCODE* error)
+{
+	using namespace pixelformats;
+
+	const uchar C = Channels(format);
+	if (C == 0)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
+		return nullptr;
+	}
+
+	if (!data || width == 0 || height == 0 || nWidth == 0 || nHeight == 0)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_OPERATION);
+		return nullptr;
+	}
+
+	const bool Packed = format == PIXELFORMATS::BGRA5551;
+	uchar* unpacked = Packed ? Unpack5551(data, (addressable)width * height) : nullptr;
+	const uchar* src = Packed ? unpacked : (const uchar*)data;
+
+	const std::vector<BoxSpan> spans = BuildSpans(width, nWidth);
+	const addressable istride = (addressable)width * C;
+	const addressable ostride = (addressable)nWidth * C;
+	const uint64 area = (uint64)width * height;
+
+	const auto Execution = parallel
+		? threading::ChooseExecution(threading::WORKLOAD::RESAMPLE, (addressable)width * height, C * 8)
+		: threading::EXECUTION::SERIAL;
+
+	uchar* rval = (uchar*)memory::Allocate((addressable)nHeight * ostride);
+
+	// each band streams through its source rows once, a row straddling two output rows is reduced once
+	// and added to both.
+	threading::ParallelFor(Execution, nHeight, [&](const addressable& start, const addressable& count)
+	{
+		std::vector<uint32> row(ostride);
+		std::vector<uint64> acc(ostride);
+		int64_t reduced = -1;
+
+		for (addressable oy = start; oy < start + count; ++oy)
+		{
+			std::fill(acc.begin(), acc.end(), 0);
+
+			const uint64 L = (uint64)oy * height;
+			const uint64 R = (uint64)(oy + 1) * height;
+			const uint32 y0 = (uint32)(L / nHeight);
+			const uint32 y1 = (uint32)((R - 1) / nHeight);
+
+			for (uint32 y = y0; y <= y1; ++y)
+			{
+				const uint64 wy = std::min<uint64>((uint64)(y + 1) * nHeight, R) - std::max<uint64>((uint64)y * nHeight, L);
+
+				if ((int64_t)y != reduced)
+				{
+					const uchar* in = src + y * istride;
+					if (C == 1)
+						ReduceRow<1>(in, row.data(), spans, nWidth);
+					else if (C == 2)
+						ReduceRow<2>(in, row.data(), spans, nWidth);
+					else if (C == 3)
+						ReduceRow<3>(in, row.data(), spans, nWidth);
+					else
+						ReduceRow<4>(in, row.data(), spans, nWidth);
+					reduced = y;
+				}
+
+				for (addressable i = 0; i < ostride; ++i)
+					acc[i] += row[i] * wy;
+			}
+
+			uchar* out = rval + oy * ostride;
+			for (addressable i = 0; i < ostride; ++i)
+				out[i] = (uchar)((acc[i] + area / 2) / area);
+		}
+	}, 2);
+
+	memory::Free(unpacked);
+
+	if (Packed)
+		rval = Pack5551(rval, (addressable)nWidth * nHeight);
+
+	XTGA_SETERROR(error, ERRORCODE::NONE);
+	return rval;
+}
+
+void* xtga::codecs::DecimateRLEImage(const void* data, pixelformats::PIXELFORMATS format, const void* palette, uint16 width, uint16 height,
+	uint16 nWidth, uint16 nHeight, ERRORCODE* error)
+{
+	using namespace pixelformats;
+
+	const uchar C = Channels(format);
+	if (C == 0)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
+		return nullptr;
+	}
+
+	if (!data || nWidth == 0 || nHeight == 0 || nWidth > width || nHeight > height)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_OPERATION);
+		return nullptr;
+	}
+
+	const bool Packed = format == PIXELFORMATS::BGRA5551;
+	const uchar PixelSize = Packed ? 2 : C;
+	const uchar StoredSize = palette ? 1 : PixelSize;
+
+	const std::vector<BoxSpan> spans = BuildSpans(width, nWidth);
+	const addressable ostride = (addressable)nWidth * C;
+	const uint64 area = (uint64)width * height;
+
+	RLERowReader reader(data, StoredSize * 8, width);
+	std::vector<uchar> stored((addressable)width * StoredSize);
+	std::vector<uchar> expanded((addressable)width * C);
+	std::vector<uint32> row(ostride);
+	std::vector<uint64> acc(ostride);
+	uchar* rval = (uchar*)memory::Allocate((addressable)nHeight * ostride);
+
+	// the same area average as ResizeImageBox(), on rows decoded one at a time. Every row is read once, a
+	// row straddling two output rows is reduced once and added to both.
+	int64_t reduced = -1;
+	for (uint32 oy = 0; oy < nHeight; ++oy)
+	{
+		std::fill(acc.begin(), acc.end(), 0);
+
+		const uint64 L = (uint64)oy * height;
+		const uint64 R = (uint64)(oy + 1) * height;
+		const uint32 y0 = (uint32)(L / nHeight);
+		const uint32 y1 = (uint32)((R - 1) / nHeight);
+
+		for (uint32 y = y0; y <= y1; ++y)
+		{
+			const uint64 wy = std::min<uint64>((uint64)(y + 1) * nHeight, R) - std::max<uint64>((uint64)y * nHeight, L);
+
+			if ((int64_t)y != reduced)
+			{
+				reader.ReadRow(stored.data());
+
+				// color map indices and 16-bit pixels are expanded to 8-bit channels first.
+				const uchar* in = stored.data();
+				if (palette || Packed)
+				{
+					for (addressable x = 0; x < width; ++x)
+					{
+						const uchar* p = &stored[x * StoredSize];
+						if (palette)
+							p = (const uchar*)palette + (addressable)*p * PixelSize;
+
+						uchar* e = &expanded[x * C];
+						if (Packed)
+						{
+							BGRA5551 v;
+							memcpy(&v, p, sizeof(v));
+							e[0] = LUT5[v.B];
+							e[1] = LUT5[v.G];
+							e[2] = LUT5[v.R];
+							e[3] = (uchar)(v.A * 0xFF);
+						}
+						else
+							memcpy(e, p, C);
+					}
+					in = expanded.data();
+				}
+
+				if (C == 1)
+					ReduceRow<1>(in, row.data(), spans, nWidth);
+				else if (C == 2)
+					ReduceRow<2>(in, row.data(), spans, nWidth);
+				else if (C == 3)
+					ReduceRow<3>(in, row.data(), spans, nWidth);
+				else
+					ReduceRow<4>(in, row.data(), spans, nWidth);
+				reduced = y;
+			}
+
+			for (addressable i = 0; i < ostride; ++i)
+				acc[i] += row[i] * wy;
+		}
+
+		uchar* out = rval + (addressable)oy * ostride;
+		for (addressable i = 0; i < ostride; ++i)
+			out[i] = (uchar)((acc[i] + area / 2) / area);
+	}
+
+	if (Packed)
+		rval = Pack5551(rval, (addressable)nWidth * nHeight);
+
+	XTGA_SETERROR(error, ERRORCODE::NONE);
+	return rval;
+}
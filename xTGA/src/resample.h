@@ -0,0 +1,89 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: resample.h
+/// purpose : Provides the resamplers used to resize images and build thumbnails.
+//==============================================================================
+
+#ifndef XTGA_RESAMPLE_H__
+#define XTGA_RESAMPLE_H__
+
+#include "xTGA/error.h"
+#include "xTGA/pixelformats.h"
+#include "xTGA/types.h"
+
+namespace xtga
+{
+	namespace codecs
+	{
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the number of source samples each output sample reads when one axis of an image is
+		/// resized with ResizeImageBicubic().
+		/// @param[in] in					The length of the axis in the source image.
+		/// @param[in] out					The length of the axis in the resized image.
+		/// @return uint32					The number of filter taps.
+		//----------------------------------------------------------------------------------------------------
+		uint32 BicubicTaps(uint16 in, uint16 out);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Resizes an image with a separable bicubic (Catmull-Rom) filter, rows first and then columns. The
+		/// filter weights of every output row and column are computed once, in 14-bit fixed point, and the
+		/// inner loops run on integers (SSE2/NEON where available). When shrinking an axis the filter is
+		/// widened by the scale so that every source sample is accounted for. Both passes are split across
+		/// threads in bands of rows when the image is large enough.
+		/// @param[in] data					The input image, top left pixel first.
+		/// @param[in] format				Must be BGR888, BGRA8888, BGRA5551, I8, or IA88.
+		/// @param[in] width				The width of the input image (in pixels).
+		/// @param[in] height				The height of the input image (in pixels).
+		/// @param[in] nWidth				The width of the resized image (in pixels).
+		/// @param[in] nHeight				The height of the resized image (in pixels).
+		/// @param[in] parallel				If false the work always runs on the calling thread.
+		/// @param[out] error				Holds the error/status code (can be nullptr).
+		/// @return void*					The resized image, free with memory::Free() (or nullptr if an error occured).
+		//----------------------------------------------------------------------------------------------------
+		void* ResizeImageBicubic(const void* data, pixelformats::PIXELFORMATS format, uint16 width, uint16 height,
+			uint16 nWidth, uint16 nHeight, bool parallel = true, ERRORCODE* error = nullptr);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Resizes an image by averaging the area each output pixel covers, a box filter meant for large
+		/// reductions where a bicubic filter would need many taps. Partly covered source pixels count in
+		/// proportion to their coverage, so any size works and the result is exact integer math. Source rows
+		/// are streamed into a row accumulator (their sums use SSE2/NEON where available), so each source
+		/// pixel is read once. The work is split across threads in bands of output rows when large enough.
+		/// @param[in] data					The input image, top left pixel first.
+		/// @param[in] format				Must be BGR888, BGRA8888, BGRA5551, I8, or IA88.
+		/// @param[in] width				The width of the input image (in pixels).
+		/// @param[in] height				The height of the input image (in pixels).
+		/// @param[in] nWidth				The width of the resized image (in pixels).
+		/// @param[in] nHeight				The height of the resized image (in pixels).
+		/// @param[in] parallel				If false the work always runs on the calling thread.
+		/// @param[out] error				Holds the error/status code (can be nullptr).
+		/// @return void*					The resized image, free with memory::Free() (or nullptr if an error occured).
+		//----------------------------------------------------------------------------------------------------
+		void* ResizeImageBox(const void* data, pixelformats::PIXELFORMATS format, uint16 width, uint16 height,
+			uint16 nWidth, uint16 nHeight, bool parallel = true, ERRORCODE* error = nullptr);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Shrinks a run-length encoded image without decoding all of it at once. Each output pixel averages
+		/// the area it covers exactly as ResizeImageBox() does, with the same result. Rows are decoded one at
+		/// a time straight from the packets and reduced as they arrive, so memory use is O(width) rather than
+		/// O(width x height).
+		/// @param[in] data					The run-length encoded image (in the order it is stored).
+		/// @param[in] format				The format of the pixels, or of the color map entries if 'palette' is
+		///									set. Must be BGR888, BGRA8888, BGRA5551, I8, or IA88.
+		/// @param[in] palette				The color map the 8-bit pixels index into (nullptr if not color mapped).
+		/// @param[in] width				The width of the input image (in pixels).
+		/// @param[in] height				The height of the input image (in pixels).
+		/// @param[in] nWidth				The width of the resized image (in pixels, at most 'width').
+		/// @param[in] nHeight				The height of the resized image (in pixels, at most 'height').
+		/// @param[out] error				Holds the error/status code (can be nullptr).
+		/// @return void*					The resized image in 'format', free with memory::Free() (or nullptr if an error occured).
+		//----------------------------------------------------------------------------------------------------
+		void* DecimateRLEImage(const void* data, pixelformats::PIXELFORMATS format, const void* palette, uint16 width, uint16 height,
+			uint16 nWidth, uint16 nHeight, ERRORCODE* error = nullptr);
+	}
+}
+
+#endif // !XTGA_RESAMPLE_H__
@@ -0,0 +1,92 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: section.h
+/// purpose : Tracks who owns the memory behind each section of a TGA file.
+//==============================================================================
+
+#ifndef XTGA_SECTION_H__
+#define XTGA_SECTION_H__
+
+#include "xTGA/allocator.h"
+#include "xTGA/types.h"
+
+#include <memory>
+
+namespace xtga
+{
+	//----------------------------------------------------------------------------------------------------
+	/// Wraps a library buffer so that several sections can share it, the buffer is freed once none of
+	/// them reference it.
+	/// @param[in] data					The buffer (allocated with memory::Allocate()).
+	/// @return std::shared_ptr<void>	The shared buffer.
+	//----------------------------------------------------------------------------------------------------
+	inline std::shared_ptr<void> ShareBuffer(void* data)
+	{
+		return std::shared_ptr<void>(data, memory::Free);
+	}
+
+	/**
+	* @brief the memory behind one section of a file (header, image, color map, ...). It is either owned
+	* (allocated with memory::Allocate() or adopted from the caller, and freed as soon as the section is replaced
+	* or reset), a range of a shared buffer such as the raw file (kept alive while any section views it), or
+	* borrowed from the caller (never freed and never written to). Converts to T* so sections read like plain
+	* pointers.
+	*/
+	template <typename T>
+	class Section
+	{
+	public:
+		Section() : _Borrowed(false) {}
+		Section(const Section&) = delete;
+		Section& operator=(const Section&) = delete;
+
+		// takes ownership of 'data' (allocated with memory::Allocate()), releasing what was held.
+		void Own(void* data)
+		{
+			_Data.reset((T*)data, memory::Free);
+			_Borrowed = false;
+		}
+
+		// takes ownership of a buffer allocated outside the library (e.g. with malloc), freed with 'deleter'.
+		void Own(void* data, void (*deleter)(void*))
+		{
+			_Data.reset((T*)data, deleter);
+			_Borrowed = false;
+		}
+
+		// views 'offset' bytes into 'buffer', which stays alive until every section viewing it lets go.
+		void View(const std::shared_ptr<void>& buffer, addressable offset)
+		{
+			_Data = std::shared_ptr<T>(buffer, (T*)((uchar*)buffer.get() + offset));
+			_Borrowed = false;
+		}
+
+		// references memory that belongs to the caller.
+		void Borrow(const void* data)
+		{
+			_Data = std::shared_ptr<T>(std::shared_ptr<T>(), (T*)const_cast<void*>(data));
+			_Borrowed = true;
+		}
+
+		void Reset()
+		{
+			_Data.reset();
+			_Borrowed = false;
+		}
+
+		bool IsBorrowed() const { return _Borrowed; }
+
+		T* Get() const { return _Data.get(); }
+		T* operator->() const { return _Data.get(); }
+		operator T*() const { return _Data.get(); }
+
+	private:
+		std::shared_ptr<T> _Data;
+		bool _Borrowed;
+	};
+}
+
+#endif // !XTGA_SECTION_H__
@@ -0,0 +1,352 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: shared_palette.cpp
+/// purpose : Implements the SharedPalette class.
+//==============================================================================
+
+#include "xTGA/shared_palette.h"
+
+#include "codecs.h"
+#include "error_macro.h"
+#include "palette.h"
+#include "quantizer.h"
+#include "thread_pool.h"
+#include "xTGA/allocator.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+namespace
+{
+	using namespace xtga;
+	using namespace xtga::codecs;
+
+	PaletteWeights WeightsFor(uchar depth)
+	{
+		return depth == 32 ? PaletteWeights::RGBA() : PaletteWeights::RGB();
+	}
+
+	// copies every pixel, or a stratified sample of 'samples' pixels spread over the images in proportion
+	// to their size, into one buffer.
+	void* GatherPixels(const void* const* buffers, const addressable* lengths, uint32 count, uchar depth, addressable total, addressable samples, addressable& gathered)
+	{
+		const uchar stride = depth / 8;
+		const bool sampled = samples && samples < total;
+		gathered = sampled ? samples : total;
+
+		auto out = (uchar*)memory::Allocate(gathered * stride);
+		auto p = out;
+		addressable seen = 0;
+
+		for (uint32 i = 0; i < count; ++i)
+		{
+			addressable n = lengths[i];
+			if (sampled)
+				n = (addressable)((seen + lengths[i]) * samples / total - seen * samples / total);
+			seen += lengths[i];
+
+			if (n == 0)
+				continue;
+
+			if (sampled)
+			{
+				auto s = SamplePixels(buffers[i], lengths[i], depth, n);
+				memcpy(p, s, n * stride);
+				memory::Free(s);
+			}
+			else
+			{
+				memcpy(p, buffers[i], n * stride);
+			}
+			p += n * stride;
+		}
+
+		return out;
+	}
+}
+
+class xtga::SharedPalette::__SharedPaletteImpl
+{
+public:
+	__SharedPaletteImpl(uchar depth, flags::QUANTIZER quantizer);
+
+	mutable std::mutex _Lock;
+	ColorHistogram _History;
+	std::unique_ptr<InverseColorMap> _Inverse;
+	std::unique_ptr<PaletteMatcher> _Matcher;
+	uchar _ColorMap[256 * 4];
+	flags::QUANTIZER _Quantizer;
+	double _Threshold;
+	uint32 _Revision;
+	uint16 _Length;
+	uchar _Depth;
+
+	void Prepare();
+	uchar* Map(const void* buffer, addressable length) const;
+	bool Update(const void* buffer, addressable length, ERRORCODE* error);
+};
+
+xtga::SharedPalette::__SharedPaletteImpl::__SharedPaletteImpl(uchar depth, flags::QUANTIZER quantizer) : _History(depth)
+{
+	memset(_ColorMap, 0, sizeof(_ColorMap));
+	_Quantizer = quantizer;
+	_Threshold = 0.0;
+	_Revision = 0;
+	_Length = 0;
+	_Depth = depth;
+}
+
+// builds the lookup for the current color map, 16-bit lattices are exact and 24-bit ones refine each
+// lookup against the cell's closest entries. The lattice ignores alpha, so 32-bit palettes search.
+void xtga::SharedPalette::__SharedPaletteImpl::Prepare()
+{
+	_Inverse.reset();
+	_Matcher.reset();
+
+	if (_Depth == 32)
+		_Matcher.reset(new PaletteMatcher(_ColorMap, _Length, _Depth, WeightsFor(_Depth)));
+	else
+		_Inverse.reset(new InverseColorMap(_ColorMap, _Length, _Depth, WeightsFor(_Depth), 5, true));
+}
+
+uchar* xtga::SharedPalette::__SharedPaletteImpl::Map(const void* buffer, addressable length) const
+{
+	auto IMap = (uchar*)memory::Allocate(length);
+
+	const auto Execution = _Inverse
+		? threading::ChooseExecution(threading::WORKLOAD::COLORMAP_LOOKUP, length, _Depth)
+		: threading::ChooseExecution(threading::WORKLOAD::COLORMAP_SEARCH, length, _Depth, _Length);
+
+	threading::ParallelFor(Execution, length, [&](const addressable& start, const addressable& count)
+	{
+		if (_Inverse)
+			_Inverse->LookupRange(buffer, start, count, IMap + start);
+		else
+			_Matcher->NearestRange(buffer, start, count, IMap + start);
+	});
+
+	return IMap;
+}
+
+bool xtga::SharedPalette::__SharedPaletteImpl::Update(const void* buffer, addressable length, ERRORCODE* error)
+{
+	if (!buffer || length == 0)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_OPERATION);
+		return false;
+	}
+
+	// median cut needs every pixel at once, so updates always go through the histogram.
+	_History.Add(buffer, length);
+	_Length = _History.Quantize(_Quantizer == flags::QUANTIZER::OCTREE ? flags::QUANTIZER::OCTREE : flags::QUANTIZER::WU, _ColorMap);
+	++_Revision;
+	Prepare();
+
+	XTGA_SETERROR(error, ERRORCODE::NONE);
+	return true;
+}
+
+xtga::SharedPalette::SharedPalette() : _impl(nullptr) {}
+
+xtga::SharedPalette* xtga::SharedPalette::Build(const void* const* buffers, const addressable* lengths, uint32 count, uchar depth, flags::QUANTIZER quantizer, uchar refinement, uint32 samples, ERRORCODE* error)
+{
+	if (!(depth == 16 || depth == 24 || depth == 32))
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
+		return nullptr;
+	}
+
+	addressable total = 0;
+	for (uint32 i = 0; i < count; ++i)
+	{
+		if (!buffers || !lengths || !buffers[i])
+		{
+			XTGA_SETERROR(error, ERRORCODE::INVALID_OPERATION);
+			return nullptr;
+		}
+		total += lengths[i];
+	}
+
+	if (total == 0)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_OPERATION);
+		return nullptr;
+	}
+
+	auto impl = new __SharedPaletteImpl(depth, quantizer);
+	for (uint32 i = 0; i < count; ++i)
+		impl->_History.Add(buffers[i], lengths[i]);
+
+	const uchar stride = depth / 8;
+	const bool median = quantizer == flags::QUANTIZER::MEDIAN_CUT;
+
+	if (median || refinement)
+	{
+		addressable gathered = 0;
+		auto pixels = GatherPixels(buffers, lengths, count, depth, total, samples, gathered);
+
+		void* indices = nullptr;
+		if (median)
+		{
+			void* cmap = nullptr;
+			ERRORCODE terr = ERRORCODE::NONE;
+			if (!GenerateColorMap(pixels, indices, cmap, gathered, depth, impl->_Length, true, quantizer, refinement, 0, nullptr, &terr))
+			{
+				memory::Free(pixels);
+				delete impl;
+				XTGA_SETERROR(error, terr);
+				return nullptr;
+			}
+
+			memcpy(impl->_ColorMap, cmap, (addressable)impl->_Length * stride);
+			memory::Free(cmap);
+		}
+		else
+		{
+			impl->_Length = impl->_History.Quantize(quantizer, impl->_ColorMap);
+			indices = MapColorMap(pixels, gathered, depth, impl->_ColorMap, impl->_Length);
+			RefineColorMap(pixels, (uchar*)indices, impl->_ColorMap, gathered, depth, impl->_Length, refinement);
+		}
+
+		memory::Free(indices);
+		memory::Free(pixels);
+	}
+	else
+	{
+		impl->_Length = impl->_History.Quantize(quantizer, impl->_ColorMap);
+	}
+
+	impl->Prepare();
+
+	auto r = new SharedPalette();
+	r->_impl = impl;
+
+	XTGA_SETERROR(error, ERRORCODE::NONE);
+	return r;
+}
+
+xtga::SharedPalette* xtga::SharedPalette::Alloc(const void* colormap, uint16 length, uchar depth, ERRORCODE* error)
+{
+	if (!(depth == 16 || depth == 24 || depth == 32))
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
+		return nullptr;
+	}
+
+	if (!colormap || length == 0 || length > 256)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_OPERATION);
+		return nullptr;
+	}
+
+	// a caller's palette has no histogram, updates will only know the images they were given.
+	auto impl = new __SharedPaletteImpl(depth, flags::QUANTIZER::WU);
+	memcpy(impl->_ColorMap, colormap, (addressable)length * (depth / 8));
+	impl->_Length = length;
+	impl->Prepare();
+
+	auto r = new SharedPalette();
+	r->_impl = impl;
+
+	XTGA_SETERROR(error, ERRORCODE::NONE);
+	return r;
+}
+
+void xtga::SharedPalette::Free(SharedPalette*& obj)
+{
+	if (obj != nullptr)
+	{
+		delete obj->_impl;
+		obj->_impl = nullptr;
+		delete obj;
+		obj = nullptr;
+	}
+}
+
+const void* xtga::SharedPalette::GetColorMap() const
+{
+	return this->_impl->_ColorMap;
+}
+
+uint16 xtga::SharedPalette::CopyColorMap(void* out, uint32* revision) const
+{
+	std::lock_guard<std::mutex> lock(this->_impl->_Lock);
+	memcpy(out, this->_impl->_ColorMap, (addressable)this->_impl->_Length * (this->_impl->_Depth / 8));
+	if (revision)
+		*revision = this->_impl->_Revision;
+	return this->_impl->_Length;
+}
+
+uint16 xtga::SharedPalette::GetLength() const
+{
+	std::lock_guard<std::mutex> lock(this->_impl->_Lock);
+	return this->_impl->_Length;
+}
+
+uchar xtga::SharedPalette::GetDepth() const
+{
+	return this->_impl->_Depth;
+}
+
+uint32 xtga::SharedPalette::GetRevision() const
+{
+	std::lock_guard<std::mutex> lock(this->_impl->_Lock);
+	return this->_impl->_Revision;
+}
+
+void xtga::SharedPalette::SetUpdateThreshold(double threshold)
+{
+	std::lock_guard<std::mutex> lock(this->_impl->_Lock);
+	this->_impl->_Threshold = threshold < 0.0 ? 0.0 : threshold;
+}
+
+double xtga::SharedPalette::GetUpdateThreshold() const
+{
+	std::lock_guard<std::mutex> lock(this->_impl->_Lock);
+	return this->_impl->_Threshold;
+}
+
+bool xtga::SharedPalette::Update(const void* buffer, addressable length, ERRORCODE* error)
+{
+	std::lock_guard<std::mutex> lock(this->_impl->_Lock);
+	return this->_impl->Update(buffer, length, error);
+}
+
+bool xtga::SharedPalette::Apply(const void* buffer, addressable length, uchar*& indices, void*& ColorMap, uint16& Size, ColorMapStats& stats, ERRORCODE* error)
+{
+	if (!buffer || length == 0)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_OPERATION);
+		return false;
+	}
+
+	auto impl = this->_impl;
+	std::lock_guard<std::mutex> lock(impl->_Lock);
+
+	indices = impl->Map(buffer, length);
+	double e = ColorMapError(buffer, indices, length, impl->_Depth, impl->_ColorMap);
+
+	if (impl->_Threshold > 0.0 && e > impl->_Threshold)
+	{
+		memory::Free(indices);
+		impl->Update(buffer, length, nullptr);
+		indices = impl->Map(buffer, length);
+		e = ColorMapError(buffer, indices, length, impl->_Depth, impl->_ColorMap);
+	}
+
+	// every image keeps its own copy, later updates don't touch images already applied.
+	const addressable csize = (addressable)impl->_Length * (impl->_Depth / 8);
+	ColorMap = memory::Allocate(csize);
+	memcpy(ColorMap, impl->_ColorMap, csize);
+	Size = impl->_Length;
+
+	stats = { (uint64)length, (uint64)length, e, e, 0.0 };
+
+	XTGA_SETERROR(error, ERRORCODE::NONE);
+	return true;
+}
@@ -0,0 +1,21 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: signatures.h
+/// purpose : The signatures found in, and written to, TGA 2.0 files.
+//==============================================================================
+
+#ifndef XTGA_SIGNATURES_H__
+#define XTGA_SIGNATURES_H__
+
+#include "xTGA/api.h"
+#include "xTGA/types.h"
+
+constexpr uchar TGA2SIG[] = "TRUEVISION-XFILE.";
+constexpr uchar XTGASIG[] = "xTGA by xNWP";
+constexpr uchar XTGALET = ' ';
+constexpr uint16 XTGAVER = XTGA_VERSION;
+
+#endif // !XTGA_SIGNATURES_H__
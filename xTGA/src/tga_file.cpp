@@ -10,21 +10,27 @@
 #include "xTGA/tga_file.h"
 
 #include "codecs.h"
+#include "convert.h"
 #include "error_macro.h"
+#include "palette.h"
+#include "resample.h"
+#include "section.h"
+#include "signatures.h"
+#include "thread_pool.h"
+#include "xTGA/allocator.h"
+#include "xTGA/decode_context.h"
 #include "xTGA/error.h"
 #include "xTGA/flags.h"
+#include "xTGA/mip_chain.h"
+#include "xTGA/shared_palette.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <ctime>
 #include <stdio.h>
 #include <string.h>
 #include <vector>
 
-constexpr uchar TGA2SIG[] = "TRUEVISION-XFILE.";
-constexpr uchar XTGASIG[] = "xTGA by xNWP";
-constexpr uchar XTGALET = ' ';
-constexpr uint16 XTGAVER = XTGA_VERSION;
-
 namespace xtga
 {
 	XTGAAPI uint16 WhatVersion();
@@ -39,6 +45,40 @@ struct DeveloperDirectoryEntryImpl : xtga::structs::DeveloperDirectoryEntry
 	void* DATA;
 };
 
+namespace
+{
+	using namespace xtga;
+
+	// converts stored pixels to RGBA a row at a time, reordering them for the top left pixel to be first.
+	// Rows are read bottom up if 'flipV' and right to left if 'flipH'.
+	template <typename T, typename F>
+	void StoredToRGBA(const T* in, pixelformats::RGBA8888* out, uint16 width, uint16 height, bool flipV, bool flipH, const F& convert)
+	{
+		auto Run = [&](const addressable& start, const addressable& count)
+		{
+			for (addressable y = start; y < start + count; ++y)
+			{
+				const T* row = in + (flipV ? height - 1 - y : y) * width;
+				pixelformats::RGBA8888* o = out + y * width;
+
+				if (flipH)
+				{
+					for (uint16 x = 0; x < width; ++x)
+						o[x] = convert(row[width - 1 - x]);
+				}
+				else
+				{
+					for (uint16 x = 0; x < width; ++x)
+						o[x] = convert(row[x]);
+				}
+			}
+		};
+
+		const auto Execution = threading::ChooseExecution(threading::WORKLOAD::COLORMAP_LOOKUP, (addressable)width * height, 32);
+		threading::ParallelFor(Execution, height, Run, 1 + 4096 / width);
+	}
+}
+
 xtga::Parameters xtga::Parameters::BGR24()
 {
 	Parameters rval;
@@ -338,38 +378,44 @@ public:
 	__TGAFileImpl(const void* buffer, uint16 width, uint16 height, const Parameters& config, ERRORCODE* error);
 	~__TGAFileImpl();
 
-	std::vector<void*> __DanglingArrays;
-	std::vector<void*> __DanglingPtrs;
 	std::vector<DeveloperDirectoryEntryImpl*> __DeveloperEntries;
 
-	void* _RawData;
-	structs::Header* _Header;
-	structs::Footer* _Footer;
-	structs::ExtensionArea* _Extensions;
-	uchar* _ImageId;
-	void* _ColorMapData;
-	void* _ImageData;
-	structs::ColorCorrectionEntry* _ColorCorrectionTable;
-	uint32* _ScanLineTable;
-	void* _ThumbnailData;
+	// each section either owns its memory, views the file it was loaded from, or borrows the caller's
+	// buffer. Replacing a section releases its old memory, the file is freed once no section views it.
+	Section<structs::Header> _Header;
+	Section<structs::Footer> _Footer;
+	Section<structs::ExtensionArea> _Extensions;
+	Section<uchar> _ImageId;
+	Section<void> _ColorMapData;
+	Section<void> _ImageData;
+	Section<structs::ColorCorrectionEntry> _ColorCorrectionTable;
+	Section<uint32> _ScanLineTable;
+	Section<void> _ThumbnailData;
 	uchar _ThumbnailWidth;
 	uchar _ThumbnailHeight;
+	codecs::InverseColorMap* _InverseColorMap;
+	flags::QUANTIZER _Quantizer;
+	uchar _QuantizerRefinement;
+	uint32 _QuantizerSampleSize;
+	ColorMapStats _ColorMapStats;
+	bool _HasColorMapStats;
+
+	bool GenerateColorMap(bool force, flags::QUANTIZER quantizer, uchar refinement, uint32 samples, SharedPalette* palette, ERRORCODE* error);
+	bool ColorMapFormat(pixelformats::PIXELFORMATS& format, flags::ALPHATYPE& alpha, ERRORCODE* error);
+	bool DecodeRGBA(const void* data, uint16 width, uint16 height, bool rle, pixelformats::RGBA8888* out, DecodeContext* context, flags::ALPHATYPE* AlphaType, ERRORCODE* error);
+	bool TransformColors(const std::function<void(pixelformats::RGBA8888&)>& fn, bool parallel, ERRORCODE* error);
 };
 
 xtga::TGAFile::__TGAFileImpl::__TGAFileImpl()
 {
-	_RawData = nullptr;
-	_Header = nullptr;
-	_Footer = nullptr;
-	_Extensions = nullptr;
-	_ImageId = nullptr;
-	_ColorMapData = nullptr;
-	_ImageData = nullptr;
-	_ColorCorrectionTable = nullptr;
-	_ScanLineTable = nullptr;
-	_ThumbnailData = nullptr;
 	_ThumbnailWidth = 0;
 	_ThumbnailHeight = 0;
+	_InverseColorMap = nullptr;
+	_Quantizer = flags::QUANTIZER::MEDIAN_CUT;
+	_QuantizerRefinement = 0;
+	_QuantizerSampleSize = 0;
+	_ColorMapStats = {};
+	_HasColorMapStats = false;
 }
 
 xtga::TGAFile::__TGAFileImpl::__TGAFileImpl(char const * filename, ERRORCODE* error) : __TGAFileImpl ()
@@ -386,20 +432,20 @@ xtga::TGAFile::__TGAFileImpl::__TGAFileImpl(char const * filename, ERRORCODE* er
 	fseek(File, 0, SEEK_END);
 	addressable DataSize = ftell(File);
 
-	// Read the entire file into memory
-	_RawData = malloc(DataSize);
+	// Read the entire file into memory, the sections below share it.
+	auto RawData = ShareBuffer(memory::Allocate(DataSize));
 	fseek(File, 0, SEEK_SET);
-	fread(_RawData, 1, DataSize, File);
+	fread(RawData.get(), 1, DataSize, File);
 
 	// Done with the file we can close it now.
 	fclose(File);
 
 	// Read the header
-	_Header = (structs::Header*)((uchar*)_RawData);
+	_Header.View(RawData, 0);
 
 	// Set some pointers
 	if (_Header->ID_LENGTH)
-		_ImageId = (uchar*)_RawData + sizeof(structs::Header);
+		_ImageId.View(RawData, sizeof(structs::Header));
 
 	if (_Header->COLOR_MAP_TYPE)
 	{
@@ -409,52 +455,52 @@ xtga::TGAFile::__TGAFileImpl::__TGAFileImpl(char const * filename, ERRORCODE* er
 			return;
 		}
 
-		_ColorMapData = (void*)((uchar*)_RawData + sizeof(structs::Header) + _Header->ID_LENGTH);
-		_ImageData = (void*)( (uchar*)_ColorMapData + ((addressable)_Header->COLOR_MAP_BITS_PER_ENTRY / 8 * _Header->COLOR_MAP_LENGTH) );
+		_ColorMapData.View(RawData, sizeof(structs::Header) + _Header->ID_LENGTH);
+		_ImageData.View(RawData, sizeof(structs::Header) + _Header->ID_LENGTH + ((addressable)_Header->COLOR_MAP_BITS_PER_ENTRY / 8 * _Header->COLOR_MAP_LENGTH));
 	}
 	else
 	{
-		_ImageData = (void*)((uchar*)_RawData + sizeof(structs::Header) + _Header->ID_LENGTH);
+		_ImageData.View(RawData, sizeof(structs::Header) + _Header->ID_LENGTH);
 	}
 
 
 	// Try to read the footer (TGA 2.0 File)
-	_Footer = (structs::Footer*)( (uchar*)_RawData + DataSize - 26 );
+	_Footer.View(RawData, DataSize - 26);
 
 	// Check the signature
 	if (memcmp(_Footer->SIGNATURE, TGA2SIG, 18) != 0)
 	{
-		_Footer = nullptr;
+		_Footer.Reset();
 	}
 
 	if (_Footer)
 	{
 		if (_Footer->EXTENSION_AREA_OFFSET)
 		{
-			_Extensions = (structs::ExtensionArea*)((uchar*)_RawData + _Footer->EXTENSION_AREA_OFFSET);
+			_Extensions.View(RawData, _Footer->EXTENSION_AREA_OFFSET);
 
 			if (_Extensions->COLOR_CORRECTION_TABLE)
 			{
-				_ColorCorrectionTable = (structs::ColorCorrectionEntry*)((uchar*)_RawData + _Extensions->COLOR_CORRECTION_TABLE);
+				_ColorCorrectionTable.View(RawData, _Extensions->COLOR_CORRECTION_TABLE);
 			}
 
 			if (_Extensions->THUMBNAIL_OFFSET)
 			{
-				_ThumbnailWidth = *((uchar*)_RawData + _Extensions->THUMBNAIL_OFFSET);
-				_ThumbnailHeight = *((uchar*)_RawData + _Extensions->THUMBNAIL_OFFSET + 1);
-				_ThumbnailData = (void*)((uchar*)_RawData + _Extensions->THUMBNAIL_OFFSET + 2);
+				_ThumbnailWidth = *((uchar*)RawData.get() + _Extensions->THUMBNAIL_OFFSET);
+				_ThumbnailHeight = *((uchar*)RawData.get() + _Extensions->THUMBNAIL_OFFSET + 1);
+				_ThumbnailData.View(RawData, _Extensions->THUMBNAIL_OFFSET + 2);
 			}
 
 			if (_Extensions->SCAN_LINE_OFFSET)
 			{
-				_ScanLineTable = (uint32*)((uchar*)_RawData + _Extensions->SCAN_LINE_OFFSET);
+				_ScanLineTable.View(RawData, _Extensions->SCAN_LINE_OFFSET);
 			}
 		}
 
 		if (_Footer->DEVELOPER_DIRECTORY_OFFSET)
 		{
-			auto DeveloperDirectorySize = *(uint16*)((uchar*)_RawData + _Footer->DEVELOPER_DIRECTORY_OFFSET);
-			auto DeveloperDirectory = (DeveloperDirectoryEntryImpl*)((uchar*)_RawData + _Footer->DEVELOPER_DIRECTORY_OFFSET + 2);
+			auto DeveloperDirectorySize = *(uint16*)((uchar*)RawData.get() + _Footer->DEVELOPER_DIRECTORY_OFFSET);
+			auto DeveloperDirectory = (DeveloperDirectoryEntryImpl*)((uchar*)RawData.get() + _Footer->DEVELOPER_DIRECTORY_OFFSET + 2);
 
 			// Push each developer entry into array, this is done so that adding/removing entries can be done
 			// more easily. It does use a bit more memory, but really a negligible amount in practice.
@@ -463,8 +509,8 @@ xtga::TGAFile::__TGAFileImpl::__TGAFileImpl(char const * filename, ERRORCODE* er
 				auto* entry = new DeveloperDirectoryEntryImpl;
 
 				memcpy(entry, &DeveloperDirectory[i], sizeof(structs::DeveloperDirectoryEntry));
-				entry->DATA = malloc(entry->ENTRY_SIZE);
-				memcpy(entry->DATA, (uchar*)_RawData + entry->ENTRY_OFFSET, entry->ENTRY_SIZE);
+				entry->DATA = memory::Allocate(entry->ENTRY_SIZE);
+				memcpy(entry->DATA, (uchar*)RawData.get() + entry->ENTRY_OFFSET, entry->ENTRY_SIZE);
 
 				__DeveloperEntries.push_back(entry);
 			}
@@ -478,1079 +524,400 @@ xtga::TGAFile::__TGAFileImpl::__TGAFileImpl(const void* buffer, uint16 width, ui
 {
 	using namespace pixelformats;
 
-	void* ImageData = nullptr;
-	uchar InputBPP = 0;
-	uchar OutputBPP = 0;
-	void (*PixelTransform)(const void* input, void* output);
+	_Quantizer = config.Quantizer;
+	_QuantizerRefinement = config.QuantizerRefinement;
+	_QuantizerSampleSize = config.QuantizerSampleSize;
+
+	const uchar InputBPP = codecs::InputPixelSize(config.InputFormat);
+	const auto RowTransform = codecs::GetRowTransform(config.InputFormat, config.GetOutputFormat());
+
+	if (InputBPP == 0 || !RowTransform)
+	{
+		XTGA_SETERROR(error, ERRORCODE::UNKNOWN);
+		return;
+	}
+
+	// rows are either kept in the order of the input or flipped, mirrored columns aren't supported.
+	const bool TopLeft = config.Origin == flags::IMAGEORIGIN::TOP_LEFT;
+	if (!TopLeft && config.Origin != flags::IMAGEORIGIN::BOTTOM_LEFT)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_OPERATION);
+		return;
+	}
+
+	this->_Header.Own(memory::AllocateZeroed(sizeof(structs::Header)));
+	this->_Header->IMAGE_WIDTH = width;
+	this->_Header->IMAGE_HEIGHT = height;
+	this->_Header->IMAGE_DESCRIPTOR.IMAGE_ORIGIN = config.Origin;
+	codecs::DescribeOutputFormat(this->_Header, config.GetOutputFormat());
 
-	switch (config.InputFormat)
+	const uchar OutputBPP = this->_Header->IMAGE_DEPTH / 8;
+
+	// the input is already what would be stored, reference it (Alloc() takes ownership when adopting).
+	if (config.BufferMode != flags::BUFFERMODE::COPY && config.InputFormat == config.GetOutputFormat()
+		&& !config.UseColorMap && !config.RunLengthEncode)
 	{
-	case PIXELFORMATS::ABGR8888:
-		InputBPP = 4;
-		break;
+		this->_Header->IMAGE_DESCRIPTOR.IMAGE_ORIGIN = flags::IMAGEORIGIN::TOP_LEFT;
+		this->_ImageData.Borrow(buffer);
 
-	case PIXELFORMATS::AI88:
-		InputBPP = 2;
-		break;
-		
-	case PIXELFORMATS::ARGB1555:
-		InputBPP = 2;
-		break;
+		XTGA_SETERROR(error, ERRORCODE::NONE);
+		return;
+	}
+
+	void* ImageData = memory::Allocate((addressable)OutputBPP * width * height);
+
+	// Setup Image
+	for (uint16 h = 0; h < height; ++h)
+	{
+		RowTransform((const uchar*)buffer + (addressable)h * width * InputBPP,
+			(uchar*)ImageData + (addressable)(TopLeft ? h : height - 1 - h) * width * OutputBPP, width);
+	}
+
+	// Apply Color Map
+	if (config.UseColorMap && config.Palette)
+	{
+		if (config.Palette->GetDepth() != OutputBPP * 8)
+		{
+			memory::Free(ImageData);
+			XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
+			return;
+		}
+
+		uchar* Indices = nullptr;
+		void* ColorMap = nullptr;
+		uint16 csize = 0;
+		if (config.Palette->Apply(ImageData, width * height, Indices, ColorMap, csize, this->_ColorMapStats, error))
+		{
+			this->_Header->IMAGE_DEPTH = 8;
+			this->_Header->COLOR_MAP_BITS_PER_ENTRY = OutputBPP * 8;
+			this->_Header->COLOR_MAP_LENGTH = csize;
+			this->_Header->COLOR_MAP_TYPE = 1;
+			this->_Header->IMAGE_TYPE = flags::IMAGETYPE::COLOR_MAPPED;
+			memory::Free(ImageData);
+			ImageData = Indices;
+			this->_ColorMapData.Own(ColorMap);
+			this->_HasColorMapStats = true;
+		}
+	}
+	else if (config.UseColorMap && OutputBPP >= 16)
+	{
+		void* ColorMap = nullptr;
+		uint16 csize = 0;
+		auto tmp = ImageData;
+		if(codecs::GenerateColorMap(ImageData, ImageData, ColorMap, width * height, OutputBPP, csize, false, config.Quantizer, config.QuantizerRefinement, 0, nullptr, error))
+		{
+			this->_Header->IMAGE_DEPTH = 8;
+			this->_Header->COLOR_MAP_BITS_PER_ENTRY = InputBPP * 8;
+			this->_Header->COLOR_MAP_LENGTH = csize;
+			this->_Header->COLOR_MAP_TYPE = 1;
+			this->_Header->IMAGE_TYPE = flags::IMAGETYPE::COLOR_MAPPED;
+			memory::Free(tmp);
+			this->_ColorMapData.Own(ColorMap);
+		}
+	}
+
+// Apply RLE
+if (config.RunLengthEncode)
+{
+	auto tmp = ImageData;
+	if (!codecs::EncodeRLE(ImageData, ImageData, width, height, this->_Header->IMAGE_DEPTH, error))
+	{
+		memory::Free(tmp);
+		return;
+	}
+
+	if (this->_Header->IMAGE_TYPE == flags::IMAGETYPE::COLOR_MAPPED)
+		this->_Header->IMAGE_TYPE = flags::IMAGETYPE::COLOR_MAPPED_RLE;
+	else if (this->_Header->IMAGE_TYPE == flags::IMAGETYPE::GRAYSCALE)
+		this->_Header->IMAGE_TYPE = flags::IMAGETYPE::GRAYSCALE_RLE;
+	else if (this->_Header->IMAGE_TYPE == flags::IMAGETYPE::TRUE_COLOR)
+		this->_Header->IMAGE_TYPE = flags::IMAGETYPE::TRUE_COLOR_RLE;
+
+	memory::Free(tmp);
+}
+
+this->_ImageData.Own(ImageData);
 
-	case PIXELFORMATS::ARGB8888:
-		InputBPP = 4;
-		break;
+XTGA_SETERROR(error, ERRORCODE::NONE);
+}
+
+xtga::TGAFile::__TGAFileImpl::~__TGAFileImpl()
+{
+	for (auto& i : this->__DeveloperEntries)
+	{
+		if (i)
+		{
+			memory::Free(i->DATA);
+			delete i;
+		}
+	}
 
-	case PIXELFORMATS::BGR565:
-		InputBPP = 2;
-		break;
+	delete this->_InverseColorMap;
+	this->_InverseColorMap = nullptr;
+}
 
-	case PIXELFORMATS::BGR888:
-		InputBPP = 3;
-		break;
+xtga::TGAFile* xtga::TGAFile::Alloc(char const* filename, ERRORCODE* error)
+{
+	ERRORCODE err;
+	auto impl = new __TGAFileImpl(filename, &err);
 
-	case PIXELFORMATS::BGRA5551:
-		InputBPP = 2;
-		break;
+	if (err != ERRORCODE::NONE)
+	{
+		delete impl;
+		XTGA_SETERROR(error, err);
 
-	case PIXELFORMATS::BGRA8888:
-		InputBPP = 4;
-		break;
+		return nullptr;
+	}
 
-	case PIXELFORMATS::I8:
-		InputBPP = 1;
-		break;
+	XTGA_SETERROR(error, err);
 
-	case PIXELFORMATS::IA88:
-		InputBPP = 2;
-		break;
+	TGAFile* r = new TGAFile();
+	r->_impl = impl;
 
-	case PIXELFORMATS::RGB565:
-		InputBPP = 2;
-		break;
+	return r;
+}
 
-	case PIXELFORMATS::RGB888:
-		InputBPP = 3;
-		break;
+xtga::TGAFile* xtga::TGAFile::Alloc(const void* buffer, uint16 width, uint16 height, const Parameters& config, ERRORCODE* error)
+{
+	ERRORCODE err;
+	auto impl = new __TGAFileImpl(buffer, width, height, config, &err);
 
-	case PIXELFORMATS::RGBA8888:
-		InputBPP = 4;
-		break;
+	if (err != ERRORCODE::NONE)
+	{
+		delete impl;
+		XTGA_SETERROR(error, err);
 
-	default:
-		XTGA_SETERROR(error, ERRORCODE::UNKNOWN);
-		return;
+		return nullptr;
 	}
 
-	this->_Header = new structs::Header;
-	memset(this->_Header, 0, sizeof(structs::Header));
-	this->_Header->IMAGE_WIDTH = width;
-	this->_Header->IMAGE_HEIGHT = height;
+	TGAFile* r = new TGAFile();
+	r->_impl = impl;
 
-	// Convert Various To BGR24
-	if (config.GetOutputFormat() == PIXELFORMATS::BGR888)
+	if (config.TGA2File)
 	{
-		ImageData = malloc((addressable)sizeof(BGR888) * width * height);
-		OutputBPP = 3;
-		this->_Header->IMAGE_TYPE = flags::IMAGETYPE::TRUE_COLOR;
+		r->UpgradeToTGATwo(&err);
 
-		if (config.InputFormat == PIXELFORMATS::ABGR8888)
+		if (err != ERRORCODE::NONE)
 		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (ABGR8888*)input;
-				auto oPtr = (BGR888*)output;
-				oPtr->B = iPtr->B;
-				oPtr->G = iPtr->G;
-				oPtr->R = iPtr->R;
-			};
+			TGAFile::Free(r);
+			return nullptr;
 		}
-		else if (config.InputFormat == PIXELFORMATS::AI88)
+		
+		if (config.UseThumbnailImage)
 		{
-			PixelTransform = [](const void* input, void* output)
+			if(!r->GenerateThumbnail(64, &err))
 			{
-				auto iPtr = (AI88*)input;
-				auto oPtr = (BGR888*)output;
-				oPtr->B = iPtr->I;
-				oPtr->G = iPtr->I;
-				oPtr->R = iPtr->I;
-			};
+				TGAFile::Free(r);
+				return nullptr;
+			}
 		}
-		else if (config.InputFormat == PIXELFORMATS::ARGB1555)
+
+		r->_impl->_Extensions->ALPHATYPE = config.AlphaType;
+	}
+
+	// adopted buffers come from malloc rather than the library's allocator.
+	if (config.BufferMode == flags::BUFFERMODE::ADOPT)
+	{
+		if (r->_impl->_ImageData.IsBorrowed())
 		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (ARGB1555*)input;
-				auto oPtr = (BGR888*)output;
-				oPtr->B = LUT5[iPtr->B];
-				oPtr->G = LUT5[iPtr->G];
-				oPtr->R = LUT5[iPtr->R];
-			};
+			r->_impl->_ImageData.Own(const_cast<void*>(buffer), free);
 		}
-		else if (config.InputFormat == PIXELFORMATS::ARGB8888)
+		else
 		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (ARGB8888*)input;
-				auto oPtr = (BGR888*)output;
-				oPtr->B = iPtr->B;
-				oPtr->G = iPtr->G;
-				oPtr->R = iPtr->R;
-			};
+			free(const_cast<void*>(buffer));
 		}
-		else if (config.InputFormat == PIXELFORMATS::BGR565)
+	}
+
+	XTGA_SETERROR(error, ERRORCODE::NONE);
+	return r;
+}
+
+void xtga::TGAFile::Free(xtga::TGAFile*& obj)
+{
+	if (obj != nullptr)
+	{
+		delete obj->_impl;
+		obj->_impl = nullptr;
+		delete obj;
+		obj = nullptr;
+	}
+}
+
+bool xtga::TGAFile::SaveFile(const char* filename, ERRORCODE* error)
+{
+	std::vector<uchar> Buffer;
+	ERRORCODE terr = ERRORCODE::NONE;
+
+	if (!this->SaveToMemory(Buffer, &terr))
+	{
+		XTGA_SETERROR(error, terr);
+		return false;
+	}
+
+	auto file = fopen(filename, "wb");
+
+	if (!file)
+	{
+		XTGA_SETERROR(error, ERRORCODE::FILE_ERROR);
+		return false;
+	}
+
+	// the whole file is already in one buffer, skip the stream's own buffering so it goes out in one write.
+	setvbuf(file, nullptr, _IONBF, 0);
+	bool Written = fwrite(Buffer.data(), 1, Buffer.size(), file) == Buffer.size();
+	Written = (fclose(file) == 0) && Written;
+
+	if (!Written)
+	{
+		XTGA_SETERROR(error, ERRORCODE::FILE_ERROR);
+		return false;
+	}
+
+	XTGA_SETERROR(error, ERRORCODE::NONE);
+	return true;
+}
+
+bool xtga::TGAFile::SaveToMemory(std::vector<uchar>& buffer, ERRORCODE* error)
+{
+	auto Header = this->_impl->_Header.Get();
+
+	ERRORCODE terr = ERRORCODE::NONE;
+	auto iSize = this->GetImageDataSize(&terr);
+
+	if (terr != ERRORCODE::NONE)
+	{
+		XTGA_SETERROR(error, terr);
+		return false;
+	}
+
+	// Lay out the file, every offset is known before a single byte is copied
+	const addressable idSize = this->_impl->_ImageId ? Header->ID_LENGTH : 0;
+	const addressable cmapSize = this->_impl->_ColorMapData ? (addressable)Header->COLOR_MAP_LENGTH * Header->COLOR_MAP_BITS_PER_ENTRY / 8 : 0;
+	addressable FileSize = sizeof(structs::Header) + idSize + cmapSize + iSize;
+
+	uint32 devDirOffset = 0;
+	uint32 scanLineOffset = 0;
+	uint32 thumbnailOffset = 0;
+	uint32 ccTableOffset = 0;
+	uint32 extOffset = 0;
+	addressable scanLineSize = 0;
+	addressable thumbnailSize = 0;
+
+	if (this->_impl->_Footer)
+	{
+		// Developer Fields
+		if (this->_impl->__DeveloperEntries.size() > 0)
 		{
-			PixelTransform = [](const void* input, void* output)
+			for (auto& entry : _impl->__DeveloperEntries)
 			{
-				auto iPtr = (BGR565*)input;
-				auto oPtr = (BGR888*)output;
-				oPtr->B = LUT5[iPtr->B];
-				oPtr->G = LUT6[iPtr->G];
-				oPtr->R = LUT5[iPtr->R];
-			};
+				entry->ENTRY_OFFSET = (uint32)FileSize;
+				FileSize += entry->ENTRY_SIZE;
+			}
+
+			devDirOffset = (uint32)FileSize;
+			FileSize += sizeof(uint16) + _impl->__DeveloperEntries.size() * sizeof(structs::DeveloperDirectoryEntry);
 		}
-		else if (config.InputFormat == PIXELFORMATS::BGR888)
+
+		// Scanline Table
+		scanLineOffset = (uint32)FileSize;
+		if (this->_impl->_ScanLineTable)
 		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (BGR888*)input;
-				auto oPtr = (BGR888*)output;
-				*oPtr = *iPtr;
-			};
+			scanLineSize = Header->IMAGE_HEIGHT * sizeof(uint32);
+			FileSize += scanLineSize;
 		}
-		else if (config.InputFormat == PIXELFORMATS::BGRA5551)
+
+		// Thumbnail, its width and height come first
+		thumbnailOffset = (uint32)FileSize;
+		if (this->_impl->_ThumbnailData)
 		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (BGRA5551*)input;
-				auto oPtr = (BGR888*)output;
-				oPtr->B = LUT5[iPtr->B];
-				oPtr->G = LUT5[iPtr->G];
-				oPtr->R = LUT5[iPtr->R];
-			};
+			thumbnailSize = (addressable)_impl->_ThumbnailWidth * _impl->_ThumbnailHeight * (Header->IMAGE_DEPTH / 8);
+			FileSize += 2 + thumbnailSize;
 		}
-		else if (config.InputFormat == PIXELFORMATS::BGRA8888)
+
+		// Color Correction Table
+		ccTableOffset = (uint32)FileSize;
+		if (this->_impl->_ColorCorrectionTable)
+			FileSize += 256 * sizeof(structs::ColorCorrectionEntry);
+
+		// Extensions
+		extOffset = (uint32)FileSize;
+		if (this->_impl->_Extensions)
+			FileSize += sizeof(structs::ExtensionArea);
+
+		FileSize += sizeof(structs::Footer);
+	}
+
+	buffer.resize((size_t)FileSize);
+	auto out = buffer.data();
+
+	// Write Header
+	// uwu so scawey
+	memcpy(out, Header, sizeof(structs::Header));
+	out += sizeof(structs::Header);
+
+	// Write ImageID
+	if (idSize)
+		memcpy(out, this->_impl->_ImageId, idSize);
+	out += idSize;
+
+	// Write Color Map
+	if (cmapSize)
+		memcpy(out, this->_impl->_ColorMapData, cmapSize);
+	out += cmapSize;
+
+	// Write Image Data
+	memcpy(out, this->_impl->_ImageData, (size_t)iSize);
+	out += iSize;
+
+	// TGA 2.0 Stuffs
+	if (this->_impl->_Footer)
+	{
+		// Write Developer Fields
+		if (this->_impl->__DeveloperEntries.size() > 0)
 		{
-			PixelTransform = [](const void* input, void* output)
+			// Data
+			for (auto& entry : _impl->__DeveloperEntries)
 			{
-				auto iPtr = (BGRA8888*)input;
-				auto oPtr = (BGR888*)output;
-				oPtr->B = iPtr->B;
-				oPtr->G = iPtr->G;
-				oPtr->R = iPtr->R;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::I8)
-		{
-			PixelTransform = [](const void* input, void* output)
+				memcpy(out, entry->DATA, entry->ENTRY_SIZE);
+				out += entry->ENTRY_SIZE;
+			}
+
+			// Directory
+			auto size = (uint16)_impl->__DeveloperEntries.size();
+			memcpy(out, &size, sizeof(uint16));
+			out += sizeof(uint16);
+
+			for (auto& entry : _impl->__DeveloperEntries)
 			{
-				auto iPtr = (I8*)input;
-				auto oPtr = (BGR888*)output;
-				oPtr->B = iPtr->I;
-				oPtr->G = iPtr->I;
-				oPtr->R = iPtr->I;
-			};
+				memcpy(out, entry, sizeof(structs::DeveloperDirectoryEntry));
+				out += sizeof(structs::DeveloperDirectoryEntry);
+			}
 		}
-		else if (config.InputFormat == PIXELFORMATS::IA88)
+
+		// Write Scanline Table
+		if (scanLineSize)
 		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (IA88*)input;
-				auto oPtr = (BGR888*)output;
-				oPtr->B = iPtr->I;
-				oPtr->G = iPtr->I;
-				oPtr->R = iPtr->I;
-			};
+			memcpy(out, this->_impl->_ScanLineTable, scanLineSize);
+			out += scanLineSize;
 		}
-		else if (config.InputFormat == PIXELFORMATS::RGB565)
+
+		// Write Thumbnail
+		if (this->_impl->_ThumbnailData)
 		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (RGB565*)input;
-				auto oPtr = (BGR888*)output;
-				oPtr->B = LUT5[iPtr->B];
-				oPtr->G = LUT6[iPtr->G];
-				oPtr->R = LUT5[iPtr->R];
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::RGB888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (RGB888*)input;
-				auto oPtr = (BGR888*)output;
-				oPtr->B = iPtr->B;
-				oPtr->G = iPtr->G;
-				oPtr->R = iPtr->R;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::RGBA8888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (RGBA8888*)input;
-				auto oPtr = (BGR888*)output;
-				oPtr->B = iPtr->B;
-				oPtr->G = iPtr->G;
-				oPtr->R = iPtr->R;
-			};
-		}
-		else
-		{
-			XTGA_SETERROR(error, ERRORCODE::UNKNOWN);
-			return;
-		}
-	}
-	else if (config.GetOutputFormat() == PIXELFORMATS::BGRA5551) // Convert Various To BGR16
-	{
-		ImageData = malloc((addressable)sizeof(BGRA5551) * width * height);
-		OutputBPP = 2;
-		this->_Header->IMAGE_DESCRIPTOR.ALPHA_CHANNEL_BITCOUNT = 1;
-		this->_Header->IMAGE_TYPE = flags::IMAGETYPE::TRUE_COLOR;
-
-		if (config.InputFormat == PIXELFORMATS::ABGR8888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (ABGR8888*)input;
-				auto oPtr = (BGRA5551*)output;
-				oPtr->B = (iPtr->B & 0xF8) >> 3;
-				oPtr->G = (iPtr->G & 0xF8) >> 3;
-				oPtr->R = (iPtr->R & 0xF8) >> 3;
-				oPtr->A = iPtr->A == 255 ? 1 : 0;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::AI88)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (AI88*)input;
-				auto oPtr = (BGRA5551*)output;
-				oPtr->B = (iPtr->I & 0xF8) >> 3;
-				oPtr->G = (iPtr->I & 0xF8) >> 3;
-				oPtr->R = (iPtr->I & 0xF8) >> 3;
-				oPtr->A = iPtr->A == 255 ? 1 : 0;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::ARGB1555)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (ARGB1555*)input;
-				auto oPtr = (BGRA5551*)output;
-				oPtr->B = iPtr->B;
-				oPtr->G = iPtr->G;
-				oPtr->R = iPtr->R;
-				oPtr->A = iPtr->A;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::ARGB8888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (ARGB8888*)input;
-				auto oPtr = (BGRA5551*)output;
-				oPtr->B = (iPtr->B & 0xF8) >> 3;
-				oPtr->G = (iPtr->G & 0xF8) >> 3;
-				oPtr->R = (iPtr->R & 0xF8) >> 3;
-				oPtr->A = iPtr->A == 255 ? 1 : 0;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::BGR565)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (BGR565*)input;
-				auto oPtr = (BGRA5551*)output;
-				oPtr->B = iPtr->B;
-				oPtr->G = (iPtr->G & 0x3E) >> 1;
-				oPtr->R = iPtr->R;
-				oPtr->A = 1;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::BGR888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (BGR888*)input;
-				auto oPtr = (BGRA5551*)output;
-				oPtr->B = (iPtr->B & 0xF8) >> 3;
-				oPtr->G = (iPtr->G & 0xF8) >> 3;
-				oPtr->R = (iPtr->R & 0xF8) >> 3;
-				oPtr->A = 1;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::BGRA5551)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (BGRA5551*)input;
-				auto oPtr = (BGRA5551*)output;
-				*oPtr = *iPtr;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::BGRA8888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (BGRA8888*)input;
-				auto oPtr = (BGRA5551*)output;
-				oPtr->B = (iPtr->B & 0xF8) >> 3;
-				oPtr->G = (iPtr->G & 0xF8) >> 3;
-				oPtr->R = (iPtr->R & 0xF8) >> 3;
-				oPtr->A = iPtr->A == 255 ? 1 : 0;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::I8)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (I8*)input;
-				auto oPtr = (BGRA5551*)output;
-				oPtr->B = (iPtr->I & 0xF8) >> 3;
-				oPtr->G = (iPtr->I & 0xF8) >> 3;
-				oPtr->R = (iPtr->I & 0xF8) >> 3;
-				oPtr->A = 1;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::IA88)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (IA88*)input;
-				auto oPtr = (BGRA5551*)output;
-				oPtr->B = (iPtr->I & 0xF8) >> 3;
-				oPtr->G = (iPtr->I & 0xF8) >> 3;
-				oPtr->R = (iPtr->I & 0xF8) >> 3;
-				oPtr->A = iPtr->A == 255 ? 1 : 0;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::RGB565)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (RGB565*)input;
-				auto oPtr = (BGRA5551*)output;
-				oPtr->B = iPtr->B;
-				oPtr->G = (iPtr->G & 0x3E) >> 1;
-				oPtr->R = iPtr->R;
-				oPtr->A = 1;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::RGB888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (RGB888*)input;
-				auto oPtr = (BGRA5551*)output;
-				oPtr->B = (iPtr->B & 0xF8) >> 3;
-				oPtr->G = (iPtr->G & 0xF8) >> 3;
-				oPtr->R = (iPtr->R & 0xF8) >> 3;
-				oPtr->A = 1;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::RGBA8888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (RGBA8888*)input;
-				auto oPtr = (BGRA5551*)output;
-				oPtr->B = (iPtr->B & 0xF8) >> 3;
-				oPtr->G = (iPtr->G & 0xF8) >> 3;
-				oPtr->R = (iPtr->R & 0xF8) >> 3;
-				oPtr->A = iPtr->A == 255 ? 1 : 0;
-			};
-		}
-		else
-		{
-			XTGA_SETERROR(error, ERRORCODE::UNKNOWN);
-			return;
-		}
-	}
-	else if (config.GetOutputFormat() == PIXELFORMATS::BGRA8888) // Convert Various To BGRA32
-	{
-		ImageData = malloc((addressable)sizeof(BGRA8888) * width * height);
-		OutputBPP = 4;
-		this->_Header->IMAGE_DESCRIPTOR.ALPHA_CHANNEL_BITCOUNT = 8;
-		this->_Header->IMAGE_TYPE = flags::IMAGETYPE::TRUE_COLOR;
-
-		if (config.InputFormat == PIXELFORMATS::ABGR8888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (ABGR8888*)input;
-				auto oPtr = (BGRA8888*)output;
-				oPtr->B = iPtr->B;
-				oPtr->G = iPtr->G;
-				oPtr->R = iPtr->R;
-				oPtr->A = iPtr->A;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::AI88)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (AI88*)input;
-				auto oPtr = (BGRA8888*)output;
-				oPtr->B = iPtr->I;
-				oPtr->G = iPtr->I;
-				oPtr->R = iPtr->I;
-				oPtr->A = iPtr->A;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::ARGB1555)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (ARGB1555*)input;
-				auto oPtr = (BGRA8888*)output;
-				oPtr->B = LUT5[iPtr->B];
-				oPtr->G = LUT5[iPtr->G];
-				oPtr->R = LUT5[iPtr->R];
-				oPtr->A = iPtr->A == 1 ? 255 : 0;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::ARGB8888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (ARGB8888*)input;
-				auto oPtr = (BGRA8888*)output;
-				oPtr->B = iPtr->B;
-				oPtr->G = iPtr->G;
-				oPtr->R = iPtr->R;
-				oPtr->A = iPtr->A;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::BGR565)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (BGR565*)input;
-				auto oPtr = (BGRA8888*)output;
-				oPtr->B = LUT5[iPtr->B];
-				oPtr->G = LUT6[iPtr->G];
-				oPtr->R = LUT5[iPtr->R];
-				oPtr->A = 255;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::BGR888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (BGR888*)input;
-				auto oPtr = (BGRA8888*)output;
-				oPtr->B = iPtr->B;
-				oPtr->G = iPtr->G;
-				oPtr->R = iPtr->R;
-				oPtr->A = 255;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::BGRA5551)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (BGRA5551*)input;
-				auto oPtr = (BGRA8888*)output;
-				oPtr->B = LUT5[iPtr->B];
-				oPtr->G = LUT5[iPtr->G];
-				oPtr->R = LUT5[iPtr->R];
-				oPtr->A = iPtr->A == 1 ? 255 : 0;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::BGRA8888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (BGRA8888*)input;
-				auto oPtr = (BGRA8888*)output;
-				*oPtr = *iPtr;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::I8)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (I8*)input;
-				auto oPtr = (BGRA8888*)output;
-				oPtr->B = iPtr->I;
-				oPtr->G = iPtr->I;
-				oPtr->R = iPtr->I;
-				oPtr->A = 255;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::IA88)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (IA88*)input;
-				auto oPtr = (BGRA8888*)output;
-				oPtr->B = iPtr->I;
-				oPtr->G = iPtr->I;
-				oPtr->R = iPtr->I;
-				oPtr->A = iPtr->A;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::RGB565)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (RGB565*)input;
-				auto oPtr = (BGRA8888*)output;
-				oPtr->B = LUT5[iPtr->B];
-				oPtr->G = LUT6[iPtr->G];
-				oPtr->R = LUT5[iPtr->R];
-				oPtr->A = 255;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::RGB888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (RGB888*)input;
-				auto oPtr = (BGRA8888*)output;
-				oPtr->B = iPtr->B;
-				oPtr->G = iPtr->G;
-				oPtr->R = iPtr->R;
-				oPtr->A = 255;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::RGBA8888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (RGBA8888*)input;
-				auto oPtr = (BGRA8888*)output;
-				oPtr->B = iPtr->B;
-				oPtr->G = iPtr->G;
-				oPtr->R = iPtr->R;
-				oPtr->A = iPtr->A;
-			};
-		}
-		else
-		{
-			XTGA_SETERROR(error, ERRORCODE::UNKNOWN);
-			return;
-		}
-	}
-	else if (config.GetOutputFormat() == PIXELFORMATS::I8) 	// Convert Various To I8
-	{
-		ImageData = malloc((addressable)sizeof(I8) * width * height);
-		OutputBPP = 1;
-		this->_Header->IMAGE_TYPE = flags::IMAGETYPE::GRAYSCALE;
-
-		if (config.InputFormat == PIXELFORMATS::ABGR8888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (ABGR8888*)input;
-				auto oPtr = (I8*)output;
-				oPtr->I = (uchar)((float)iPtr->R * 0.25 + (float)iPtr->G * 0.50 + (float)iPtr->B * 0.25);
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::AI88)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (AI88*)input;
-				auto oPtr = (I8*)output;
-				oPtr->I = iPtr->I;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::ARGB1555)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (ARGB1555*)input;
-				auto oPtr = (I8*)output;
-				oPtr->I = LUT5[(uchar)((float)iPtr->R * 0.25 + (float)iPtr->G * 0.50 + (float)iPtr->B * 0.25)];
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::ARGB8888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (ARGB8888*)input;
-				auto oPtr = (I8*)output;
-				oPtr->I = (uchar)((float)iPtr->R * 0.25 + (float)iPtr->G * 0.50 + (float)iPtr->B * 0.25);
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::BGR565)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (BGR565*)input;
-				auto oPtr = (I8*)output;
-				oPtr->I = (uchar)((float)LUT5[iPtr->R] * 0.25 + (float)LUT6[iPtr->G] * 0.50 + (float)LUT5[iPtr->B] * 0.25);
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::BGR888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (BGR888*)input;
-				auto oPtr = (I8*)output;
-				oPtr->I = (uchar)((float)iPtr->R * 0.25 + (float)iPtr->G * 0.50 + (float)iPtr->B * 0.25);
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::BGRA5551)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (BGRA5551*)input;
-				auto oPtr = (I8*)output;
-				oPtr->I = LUT5[(uchar)((float)iPtr->R * 0.25 + (float)iPtr->G * 0.50 + (float)iPtr->B * 0.25)];
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::BGRA8888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (BGRA8888*)input;
-				auto oPtr = (I8*)output;
-				oPtr->I = (uchar)((float)iPtr->R * 0.25 + (float)iPtr->G * 0.50 + (float)iPtr->B * 0.25);
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::I8)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (I8*)input;
-				auto oPtr = (I8*)output;
-				*oPtr = *iPtr;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::IA88)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (IA88*)input;
-				auto oPtr = (I8*)output;
-				oPtr->I = iPtr->I;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::RGB565)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (RGB565*)input;
-				auto oPtr = (I8*)output;
-				oPtr->I = (uchar)((float)LUT5[iPtr->R] * 0.25 + (float)LUT6[iPtr->G] * 0.50 + (float)LUT5[iPtr->B] * 0.25);
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::RGB888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (RGB888*)input;
-				auto oPtr = (I8*)output;
-				oPtr->I = (uchar)((float)iPtr->R * 0.25 + (float)iPtr->G * 0.50 + (float)iPtr->B * 0.25);
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::RGBA8888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (RGBA8888*)input;
-				auto oPtr = (I8*)output;
-				oPtr->I = (uchar)((float)iPtr->R * 0.25 + (float)iPtr->G * 0.50 + (float)iPtr->B * 0.25);
-			};
-		}
-		else
-		{
-			XTGA_SETERROR(error, ERRORCODE::UNKNOWN);
-			return;
-		}
-	}
-	else if (config.GetOutputFormat() == PIXELFORMATS::IA88) // Convert Various To IA16
-	{
-		ImageData = malloc((addressable)sizeof(IA88) * width * height);
-		OutputBPP = 2;
-		this->_Header->IMAGE_DESCRIPTOR.ALPHA_CHANNEL_BITCOUNT = 8;
-		this->_Header->IMAGE_TYPE = flags::IMAGETYPE::GRAYSCALE;
-
-		if (config.InputFormat == PIXELFORMATS::ABGR8888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (ABGR8888*)input;
-				auto oPtr = (IA88*)output;
-				oPtr->I = (uchar)((float)iPtr->R * 0.25 + (float)iPtr->G * 0.50 + (float)iPtr->B * 0.25);
-				oPtr->A = iPtr->A;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::AI88)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (AI88*)input;
-				auto oPtr = (IA88*)output;
-				oPtr->I = iPtr->I;
-				oPtr->A = iPtr->A;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::ARGB1555)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (ARGB1555*)input;
-				auto oPtr = (IA88*)output;
-				oPtr->I = LUT5[(uchar)((float)iPtr->R * 0.25 + (float)iPtr->G * 0.50 + (float)iPtr->B * 0.25)];
-				oPtr->A = iPtr->A == 1 ? 255 : 0;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::ARGB8888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (ARGB8888*)input;
-				auto oPtr = (IA88*)output;
-				oPtr->I = (uchar)((float)iPtr->R * 0.25 + (float)iPtr->G * 0.50 + (float)iPtr->B * 0.25);
-				oPtr->A = iPtr->A;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::BGR565)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (BGR565*)input;
-				auto oPtr = (IA88*)output;
-				oPtr->I = (uchar)((float)LUT5[iPtr->R] * 0.25 + (float)LUT6[iPtr->G] * 0.50 + (float)LUT5[iPtr->B] * 0.25);
-				oPtr->A = 255;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::BGR888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (BGR888*)input;
-				auto oPtr = (IA88*)output;
-				oPtr->I = (uchar)((float)iPtr->R * 0.25 + (float)iPtr->G * 0.50 + (float)iPtr->B * 0.25);
-				oPtr->A = 255;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::BGRA5551)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (BGRA5551*)input;
-				auto oPtr = (IA88*)output;
-				oPtr->I = LUT5[(uchar)((float)iPtr->R * 0.25 + (float)iPtr->G * 0.50 + (float)iPtr->B * 0.25)];
-				oPtr->A = iPtr->A == 1 ? 255 : 0;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::BGRA8888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (BGRA8888*)input;
-				auto oPtr = (IA88*)output;
-				oPtr->I = (uchar)((float)iPtr->R * 0.25 + (float)iPtr->G * 0.50 + (float)iPtr->B * 0.25);
-				oPtr->A = iPtr->A;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::I8)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (I8*)input;
-				auto oPtr = (IA88*)output;
-				oPtr->I = iPtr->I;
-				oPtr->A = 255;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::IA88)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (IA88*)input;
-				auto oPtr = (IA88*)output;
-				*oPtr = *iPtr;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::RGB565)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (RGB565*)input;
-				auto oPtr = (IA88*)output;
-				oPtr->I = (uchar)((float)LUT5[iPtr->R] * 0.25 + (float)LUT6[iPtr->G] * 0.50 + (float)LUT5[iPtr->B] * 0.25);
-				oPtr->A = 255;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::RGB888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (RGB888*)input;
-				auto oPtr = (IA88*)output;
-				oPtr->I = (uchar)((float)iPtr->R * 0.25 + (float)iPtr->G * 0.50 + (float)iPtr->B * 0.25);
-				oPtr->A = 255;
-			};
-		}
-		else if (config.InputFormat == PIXELFORMATS::RGBA8888)
-		{
-			PixelTransform = [](const void* input, void* output)
-			{
-				auto iPtr = (RGBA8888*)input;
-				auto oPtr = (IA88*)output;
-				oPtr->I = (uchar)((float)iPtr->R * 0.25 + (float)iPtr->G * 0.50 + (float)iPtr->B * 0.25);
-				oPtr->A = iPtr->A;
-			};
-		}
-		else
-		{
-			XTGA_SETERROR(error, ERRORCODE::UNKNOWN);
-			return;
-		}
-	}
-	else
-	{
-		XTGA_SETERROR(error, ERRORCODE::UNKNOWN);
-		return;
-	}
-
-	this->_Header->IMAGE_DEPTH = OutputBPP * 8;
-
-	// Setup Image
-	for (uint16 h = 0; h < height; ++h)
-	{
-		for (uint16 w = 0; w < width; ++w)
-		{
-			PixelTransform( ( (uchar*)buffer + (h * width + w) * InputBPP ), ( (uchar*)ImageData + ((height - 1 - h) * width + w) * OutputBPP ));
-		}
-	}
-
-	// Apply Color Map
-	if (config.UseColorMap && OutputBPP >= 16)
-	{
-		void* ColorMap = nullptr;
-		uint16 csize = 0;
-		auto tmp = ImageData;
-		if(codecs::GenerateColorMap(ImageData, ImageData, ColorMap, width * height, OutputBPP, csize, false, error))
-		{
-			this->_Header->IMAGE_DEPTH = 8;
-			this->_Header->COLOR_MAP_BITS_PER_ENTRY = InputBPP * 8;
-			this->_Header->COLOR_MAP_LENGTH = csize;
-			this->_Header->COLOR_MAP_TYPE = 1;
-			this->_Header->IMAGE_TYPE = flags::IMAGETYPE::COLOR_MAPPED;
-			free(tmp);
-			this->_ColorMapData = ColorMap;
-			this->__DanglingArrays.push_back(ColorMap);
-		}
-	}
-
-// Apply RLE
-if (config.RunLengthEncode)
-{
-	auto tmp = ImageData;
-	if (!codecs::EncodeRLE(ImageData, ImageData, width, height, this->_Header->IMAGE_DEPTH, error))
-	{
-		free(tmp);
-		this->~__TGAFileImpl();
-		return;
-	}
-
-	if (this->_Header->IMAGE_TYPE == flags::IMAGETYPE::COLOR_MAPPED)
-		this->_Header->IMAGE_TYPE = flags::IMAGETYPE::COLOR_MAPPED_RLE;
-	else if (this->_Header->IMAGE_TYPE == flags::IMAGETYPE::GRAYSCALE)
-		this->_Header->IMAGE_TYPE = flags::IMAGETYPE::GRAYSCALE_RLE;
-	else if (this->_Header->IMAGE_TYPE == flags::IMAGETYPE::TRUE_COLOR)
-		this->_Header->IMAGE_TYPE = flags::IMAGETYPE::TRUE_COLOR_RLE;
-
-	free(tmp);
-}
-
-this->_ImageData = ImageData;
-this->__DanglingArrays.push_back(ImageData);
-
-XTGA_SETERROR(error, ERRORCODE::NONE);
-}
-
-xtga::TGAFile::__TGAFileImpl::~__TGAFileImpl()
-{
-	if (this->_RawData) free(this->_RawData);
-	for (auto& i : this->__DanglingArrays)
-	{
-		if (i) free(i);
-	}
-	for (auto& i : this->__DanglingPtrs)
-	{
-		if (i) free(i);
-	}
-	for (auto& i : this->__DeveloperEntries)
-	{
-		if (i)
-		{
-			free(i->DATA);
-			delete i;
-		}
-	}
-}
-
-xtga::TGAFile* xtga::TGAFile::Alloc(char const* filename, ERRORCODE* error)
-{
-	ERRORCODE err;
-	auto impl = new __TGAFileImpl(filename, &err);
-
-	if (err != ERRORCODE::NONE)
-	{
-		delete impl;
-		XTGA_SETERROR(error, err);
-
-		return nullptr;
-	}
-
-	XTGA_SETERROR(error, err);
-
-	TGAFile* r = new TGAFile();
-	r->_impl = impl;
-
-	return r;
-}
-
-xtga::TGAFile* xtga::TGAFile::Alloc(const void* buffer, uint16 width, uint16 height, const Parameters& config, ERRORCODE* error)
-{
-	ERRORCODE err;
-	auto impl = new __TGAFileImpl(buffer, width, height, config, &err);
-
-	if (err != ERRORCODE::NONE)
-	{
-		delete impl;
-		XTGA_SETERROR(error, err);
-
-		return nullptr;
-	}
-
-	TGAFile* r = new TGAFile();
-	r->_impl = impl;
-
-	if (config.TGA2File)
-	{
-		r->UpgradeToTGATwo(&err);
-
-		if (err != ERRORCODE::NONE)
-		{
-			TGAFile::Free(r);
-			return nullptr;
-		}
-		
-		if (config.UseThumbnailImage)
-		{
-			if(!r->GenerateThumbnail(64, &err))
-			{
-				TGAFile::Free(r);
-				return nullptr;
-			}
-		}
-
-		r->_impl->_Extensions->ALPHATYPE = config.AlphaType;
-	}
-
-	XTGA_SETERROR(error, ERRORCODE::NONE);
-	return r;
-}
-
-void xtga::TGAFile::Free(xtga::TGAFile*& obj)
-{
-	if (obj != nullptr)
-	{
-		delete obj->_impl;
-		obj->_impl = nullptr;
-		delete obj;
-		obj = nullptr;
-	}
-}
-
-bool xtga::TGAFile::SaveFile(const char* filename, ERRORCODE* error)
-{
-	auto file = fopen(filename, "wb");
-
-	if (!file)
-	{
-		XTGA_SETERROR(error, ERRORCODE::FILE_ERROR);
-		return false;
-	}
-
-	auto Header = this->_impl->_Header;
-
-	// Write Header
-	// uwu so scawey
-	fwrite(Header, 1, sizeof(structs::Header), file);
-
-	// Write ImageID
-	if (this->_impl->_ImageId)
-		fwrite(this->_impl->_ImageId, 1, Header->ID_LENGTH, file);
-
-	// Write Color Map
-	if (this->_impl->_ColorMapData)
-		fwrite(this->_impl->_ColorMapData, 1, Header->COLOR_MAP_LENGTH * Header->COLOR_MAP_BITS_PER_ENTRY / 8, file);
-
-	// Write Image Data
-	ERRORCODE terr = ERRORCODE::NONE;
-	auto iSize = this->GetImageDataSize(&terr);
-
-	if (terr != ERRORCODE::NONE)
-	{
-		XTGA_SETERROR(error, terr);
-		fclose(file);
-		return false;
-	}
-
-	fwrite(this->_impl->_ImageData, 1, (size_t)iSize, file);
-
-	// TGA 2.0 Stuffs
-	if (this->_impl->_Footer)
-	{
-		// Write Developer Fields
-		uint32 devDirOffset = 0;
-		if (this->_impl->__DeveloperEntries.size() > 0)
-		{
-			// Data
-			for (auto& entry : _impl->__DeveloperEntries)
-			{
-				uint32 offset = ftell(file);
-				fwrite(entry->DATA, 1, entry->ENTRY_SIZE, file);
-				entry->ENTRY_OFFSET = offset;
-			}
-
-			// Directory
-			devDirOffset = ftell(file);
-			auto size = (uint16)_impl->__DeveloperEntries.size();
-			fwrite(&size, 1, sizeof(uint16), file);
-
-			for (auto& entry : _impl->__DeveloperEntries)
-			{
-				fwrite(entry, 1, sizeof(structs::DeveloperDirectoryEntry), file);
-			}
-
-			uint32 devDirOffset = ftell(file);
-		}
-
-		// Write Scanline Table
-		uint32 scanLineOffset = ftell(file);
-		if (this->_impl->_ScanLineTable)
-		{
-			fwrite(this->_impl->_ScanLineTable, 1, Header->IMAGE_HEIGHT * sizeof(uint32), file);
-		}
-
-		// Write Thumbnail
-		uint32 thumbnailOffset = ftell(file);
-		if (this->_impl->_ThumbnailData)
-		{
-			uint16 size = (uint16)_impl->_ThumbnailWidth * _impl->_ThumbnailHeight * _impl->_Header->IMAGE_DEPTH;
-			fwrite(this->_impl->_ThumbnailData, 1, size, file);
+			*out++ = _impl->_ThumbnailWidth;
+			*out++ = _impl->_ThumbnailHeight;
+			memcpy(out, this->_impl->_ThumbnailData, thumbnailSize);
+			out += thumbnailSize;
 		}
 
 		// Write Color Correction Table
-		uint32 ccTableOffset = ftell(file);
 		if (this->_impl->_ColorCorrectionTable)
 		{
-			fwrite(this->_impl->_ColorCorrectionTable, 1, 256 * sizeof(structs::ColorCorrectionEntry), file);
+			memcpy(out, this->_impl->_ColorCorrectionTable, 256 * sizeof(structs::ColorCorrectionEntry));
+			out += 256 * sizeof(structs::ColorCorrectionEntry);
 		}
 
 		// Write Extensions
-		uint32 extOffset = ftell(file);
 		if (this->_impl->_Extensions)
 		{
 			time_t t = time(NULL);
@@ -1579,7 +946,8 @@ bool xtga::TGAFile::SaveFile(const char* filename, ERRORCODE* error)
 			if (this->_impl->_ScanLineTable)
 				this->_impl->_Extensions->SCAN_LINE_OFFSET = scanLineOffset;
 
-			fwrite(this->_impl->_Extensions, 1, sizeof(structs::ExtensionArea), file);
+			memcpy(out, this->_impl->_Extensions, sizeof(structs::ExtensionArea));
+			out += sizeof(structs::ExtensionArea);
 		}
 
 		// Write footer
@@ -1590,14 +958,10 @@ bool xtga::TGAFile::SaveFile(const char* filename, ERRORCODE* error)
 
 		this->_impl->_Footer->DEVELOPER_DIRECTORY_OFFSET = devDirOffset;
 
-		fwrite(this->_impl->_Footer, 1, sizeof(structs::Footer), file);
+		memcpy(out, this->_impl->_Footer, sizeof(structs::Footer));
 	}
 
-	// And finally clean up
-
 	XTGA_SETERROR(error, ERRORCODE::NONE);
-	fclose(file);
-
 	return true;
 }
 
@@ -1608,14 +972,15 @@ uchar const * xtga::TGAFile::GetImageID()
 
 void xtga::TGAFile::SetImageID(const void* data, uchar size)
 {
-	this->_impl->_ImageId = (uchar*)malloc(size);
+	auto ImageId = (uchar*)memory::Allocate(size);
 
 	for (uchar i = 0; i < size && i < 256; ++i)
 	{
-		this->_impl->_ImageId[i] = ((uchar*)data)[i];
+		ImageId[i] = ((uchar*)data)[i];
 	}
 
-	this->_impl->__DanglingArrays.push_back(this->_impl->_ImageId);
+	this->_impl->_ImageId.Own(ImageId);
+	this->_impl->_Header->ID_LENGTH = size;
 }
 
 void* xtga::TGAFile::GetColorMap()
@@ -1623,15 +988,15 @@ void* xtga::TGAFile::GetColorMap()
 	return this->_impl->_ColorMapData;
 }
 
-bool xtga::TGAFile::GenerateColorMap(bool force, xtga::ERRORCODE* error)
+bool xtga::TGAFile::__TGAFileImpl::GenerateColorMap(bool force, flags::QUANTIZER quantizer, uchar refinement, uint32 samples, SharedPalette* palette, ERRORCODE* error)
 {
-	if (this->_impl->_ColorMapData)
+	if (this->_ColorMapData)
 	{
 		XTGA_SETERROR(error, ERRORCODE::REDUNDANT_OPERATION);
 		return false;
 	}
 
-	if (this->_impl->_Header->IMAGE_DEPTH < 16)
+	if (this->_Header->IMAGE_DEPTH < 16)
 	{
 		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
 		return false;
@@ -1642,7 +1007,7 @@ bool xtga::TGAFile::GenerateColorMap(bool force, xtga::ERRORCODE* error)
 	using namespace codecs;
 	using namespace pixelformats;
 
-	auto Header = this->_impl->_Header;
+	auto Header = this->_Header.Get();
 	auto pCount = Header->IMAGE_WIDTH * Header->IMAGE_HEIGHT;
 	auto depth = Header->IMAGE_DEPTH;
 
@@ -1652,8 +1017,15 @@ bool xtga::TGAFile::GenerateColorMap(bool force, xtga::ERRORCODE* error)
 		return false;
 	}
 
-	void* iBuff = this->_impl->_ImageData;
+	if (palette && palette->GetDepth() != depth)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
+		return false;
+	}
+
+	void* iBuff = this->_ImageData;
 	void* EncBuff = nullptr;
+	void* ColorMap = nullptr;
 	uint16 CSize = 0;
 
 	bool RLE = false;
@@ -1668,41 +1040,57 @@ bool xtga::TGAFile::GenerateColorMap(bool force, xtga::ERRORCODE* error)
 
 	if (terr != ERRORCODE::NONE)
 	{
-		free(iBuff);
+		memory::Free(iBuff);
 		return false;
 	}
 
-	if (!codecs::GenerateColorMap(iBuff, EncBuff, this->_impl->_ColorMapData, pCount, depth, CSize, force, &terr))
+	// an exact (not forced) color map has no error.
+	ColorMapStats Stats = { (uint64)pCount, (uint64)pCount, 0.0, 0.0, 0.0 };
+
+	bool Generated = false;
+	if (palette)
+	{
+		uchar* Indices = nullptr;
+		Generated = palette->Apply(iBuff, pCount, Indices, ColorMap, CSize, Stats, &terr);
+		EncBuff = Indices;
+	}
+	else
+	{
+		Generated = codecs::GenerateColorMap(iBuff, EncBuff, ColorMap, pCount, depth, CSize, force, quantizer, refinement, samples, &Stats, &terr);
+	}
+
+	if (!Generated)
 	{
 		XTGA_SETERROR(error, terr);
-		if (RLE) free(iBuff);
+		if (RLE) memory::Free(iBuff);
 		return false;
 	}
 
-	if (RLE) free(iBuff);
+	if (RLE) memory::Free(iBuff);
 
 	if (RLE)
 	{
 		void* tbuff = nullptr;
 		if (terr != ERRORCODE::NONE)
 		{
-			free(EncBuff);
+			memory::Free(EncBuff);
+			memory::Free(ColorMap);
 			XTGA_SETERROR(error, terr);
 			return false;
 		}
 
 		if (!EncodeRLE(EncBuff, tbuff, Header->IMAGE_WIDTH, Header->IMAGE_HEIGHT, 8, &terr))
 		{
-			free(EncBuff);
+			memory::Free(EncBuff);
+			memory::Free(ColorMap);
 			XTGA_SETERROR(error, terr);
 			return false;
 		}
 
-		free(EncBuff);
+		memory::Free(EncBuff);
 		EncBuff = tbuff;
 	}
 
-	this->_impl->_ImageData = EncBuff;
 	Header->COLOR_MAP_BITS_PER_ENTRY = Header->IMAGE_DEPTH;
 	Header->COLOR_MAP_FIRST_ENTRY_INDEX = 0;
 	Header->COLOR_MAP_LENGTH = CSize;
@@ -1711,15 +1099,49 @@ bool xtga::TGAFile::GenerateColorMap(bool force, xtga::ERRORCODE* error)
 	if (RLE) Header->IMAGE_TYPE = IMAGETYPE::COLOR_MAPPED_RLE;
 	else Header->IMAGE_TYPE = IMAGETYPE::COLOR_MAPPED;
 
-	this->_impl->_ImageData = EncBuff;
-	this->_impl->__DanglingArrays.push_back(EncBuff);
-	this->_impl->__DanglingArrays.push_back(this->_impl->_ColorMapData);
+	// the true color image is released here rather than with the file.
+	this->_ImageData.Own(EncBuff);
+	this->_ColorMapData.Own(ColorMap);
+
+	this->_ColorMapStats = Stats;
+	this->_HasColorMapStats = true;
 
 	XTGA_SETERROR(error, ERRORCODE::NONE);
 
 	return true;
 }
 
+bool xtga::TGAFile::GenerateColorMap(bool force, xtga::ERRORCODE* error)
+{
+	return this->_impl->GenerateColorMap(force, this->_impl->_Quantizer, this->_impl->_QuantizerRefinement, this->_impl->_QuantizerSampleSize, nullptr, error);
+}
+
+bool xtga::TGAFile::GenerateColorMap(flags::QUANTIZER quantizer, uchar refinement, ERRORCODE* error)
+{
+	return this->_impl->GenerateColorMap(true, quantizer, refinement, 0, nullptr, error);
+}
+
+bool xtga::TGAFile::GenerateColorMap(flags::QUANTIZER quantizer, uchar refinement, uint32 samples, ERRORCODE* error)
+{
+	return this->_impl->GenerateColorMap(true, quantizer, refinement, samples, nullptr, error);
+}
+
+bool xtga::TGAFile::ApplyPalette(SharedPalette* palette, ERRORCODE* error)
+{
+	if (!palette)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_OPERATION);
+		return false;
+	}
+
+	return this->_impl->GenerateColorMap(true, flags::QUANTIZER::MEDIAN_CUT, 0, 0, palette, error);
+}
+
+const xtga::ColorMapStats* xtga::TGAFile::GetColorMapStats()
+{
+	return this->_impl->_HasColorMapStats ? &this->_impl->_ColorMapStats : nullptr;
+}
+
 void* xtga::TGAFile::GetImageData()
 {
 	return this->_impl->_ImageData;
@@ -1730,7 +1152,7 @@ addressable xtga::TGAFile::GetImageDataSize(ERRORCODE* error)
 	using namespace flags;
 	using namespace codecs;
 
-	auto Header = this->_impl->_Header;
+	auto Header = this->_impl->_Header.Get();
 	auto Frmt = Header->IMAGE_TYPE;
 	addressable pCount = (addressable)Header->IMAGE_WIDTH * Header->IMAGE_HEIGHT;
 	ERRORCODE terr = ERRORCODE::NONE;
@@ -1752,7 +1174,7 @@ addressable xtga::TGAFile::GetImageDataSize(ERRORCODE* error)
 
 		while (count < pCount)
 		{
-			auto Packet = (structs::RLEPacket*)((uchar*)this->_impl->_ImageData + it);
+			auto Packet = (structs::RLEPacket*)((uchar*)this->_impl->_ImageData.Get() + it);
 			++it;
 			addressable size = BPP * (Packet->PIXEL_COUNT_MINUS_ONE + 1);
 
@@ -1782,7 +1204,7 @@ bool xtga::TGAFile::CompressWithRLE(xtga::ERRORCODE* error)
 {
 	using namespace flags;
 	using namespace codecs;
-	auto Header = this->_impl->_Header;
+	auto Header = this->_impl->_Header.Get();
 
 	if (Header->IMAGE_TYPE == IMAGETYPE::COLOR_MAPPED_RLE ||
 		Header->IMAGE_TYPE == IMAGETYPE::GRAYSCALE_RLE ||
@@ -1803,8 +1225,7 @@ bool xtga::TGAFile::CompressWithRLE(xtga::ERRORCODE* error)
 		return false;
 	}
 
-	this->_impl->_ImageData = out;
-	this->_impl->__DanglingArrays.push_back(out);
+	this->_impl->_ImageData.Own(out);
 
 	if (Header->IMAGE_TYPE == IMAGETYPE::COLOR_MAPPED)
 		Header->IMAGE_TYPE = IMAGETYPE::COLOR_MAPPED_RLE;
@@ -1895,8 +1316,8 @@ bool xtga::TGAFile::EditDeveloperEntry(uint16 index, const void* data, uint32 si
 	auto entry = _impl->__DeveloperEntries[index];
 	if (tag) entry->TAG = *tag;
 	entry->ENTRY_SIZE = size;
-	free(entry->DATA);
-	entry->DATA = malloc(size);
+	memory::Free(entry->DATA);
+	entry->DATA = memory::Allocate(size);
 	memcpy(entry->DATA, data, size);
 
 	XTGA_SETERROR(error, ERRORCODE::NONE);
@@ -1921,7 +1342,7 @@ bool xtga::TGAFile::AddDeveloperEntry(uint16 tag, const void* data, uint32 size,
 	e->ENTRY_OFFSET = 0;
 	e->ENTRY_SIZE = size;
 	e->TAG = tag;
-	e->DATA = malloc(size);
+	e->DATA = memory::Allocate(size);
 	memcpy(e->DATA, data, size);
 
 	_impl->__DeveloperEntries.push_back(e);
@@ -1975,48 +1396,16 @@ bool xtga::TGAFile::GenerateThumbnail(uchar LongEdgeLength, ERRORCODE* error)
 	}
 
 	float scale = 1;
-	auto header = _impl->_Header;
+	auto header = _impl->_Header.Get();
 
 	if (header->IMAGE_HEIGHT > header->IMAGE_WIDTH)
 		scale = (float)LongEdgeLength / header->IMAGE_HEIGHT;
 	else
 		scale = (float)LongEdgeLength / header->IMAGE_WIDTH;
 
-	void* tbuff = nullptr;
-
-	if (header->IMAGE_TYPE == IMAGETYPE::TRUE_COLOR_RLE || header->IMAGE_TYPE == IMAGETYPE::COLOR_MAPPED_RLE || header->IMAGE_TYPE == IMAGETYPE::GRAYSCALE_RLE)
-	{
-		tbuff = DecodeRLE(this->_impl->_ImageData, header->IMAGE_DEPTH, header->IMAGE_HEIGHT * header->IMAGE_WIDTH, &terr);
-
-		if (terr != ERRORCODE::NONE)
-		{
-			XTGA_SETERROR(error, terr);
-			return false;
-		}
-	}
-
-	bool CMAP = false;
-	if (header->IMAGE_TYPE == IMAGETYPE::COLOR_MAPPED || header->IMAGE_TYPE == IMAGETYPE::COLOR_MAPPED_RLE)
-	{
-		auto tmp = tbuff;
-		CMAP = true;
-
-		if (tbuff)
-		{
-			tbuff = DecodeColorMap(tbuff, header->IMAGE_HEIGHT * header->IMAGE_WIDTH, _impl->_ColorMapData, header->COLOR_MAP_BITS_PER_ENTRY, &terr);
-			free(tmp);
-		}
-		else
-		{
-			tbuff = DecodeColorMap(this->_impl->_ImageData, header->IMAGE_HEIGHT * header->IMAGE_WIDTH, _impl->_ColorMapData, header->COLOR_MAP_BITS_PER_ENTRY, &terr);
-		}
-
-		if (terr != ERRORCODE::NONE)
-		{
-			XTGA_SETERROR(error, terr);
-			return false;
-		}
-	}
+	const bool RLE = header->IMAGE_TYPE == IMAGETYPE::TRUE_COLOR_RLE || header->IMAGE_TYPE == IMAGETYPE::COLOR_MAPPED_RLE ||
+		header->IMAGE_TYPE == IMAGETYPE::GRAYSCALE_RLE;
+	const bool CMAP = header->IMAGE_TYPE == IMAGETYPE::COLOR_MAPPED || header->IMAGE_TYPE == IMAGETYPE::COLOR_MAPPED_RLE;
 
 	PIXELFORMATS pf = PIXELFORMATS::RGB565;
 	uchar depth = 0;
@@ -2043,14 +1432,67 @@ bool xtga::TGAFile::GenerateThumbnail(uchar LongEdgeLength, ERRORCODE* error)
 	else
 		pf = PIXELFORMATS::I8;
 
-	auto tmp = tbuff;
-	if (!tbuff)
-		tbuff = _impl->_ImageData;
+	// the short edge keeps at least one pixel.
+	const uint16 nWidth = std::max<uint16>((uint16)(scale * header->IMAGE_WIDTH), 1);
+	const uint16 nHeight = std::max<uint16>((uint16)(scale * header->IMAGE_HEIGHT), 1);
+
+	// from a 4x reduction on the bicubic filter reads 17+ taps per axis, averaging the covered area reads
+	// each pixel once and aliases less.
+	const bool Reduction = header->IMAGE_WIDTH >= 4 * nWidth && header->IMAGE_HEIGHT >= 4 * nHeight;
+
+	void* tbuff = nullptr;
+
+	if (RLE && Reduction)
+	{
+		// averaged a row at a time straight from the packets, the full size image is never held in memory.
+		tbuff = DecimateRLEImage(_impl->_ImageData, pf, CMAP ? _impl->_ColorMapData.Get() : nullptr,
+			header->IMAGE_WIDTH, header->IMAGE_HEIGHT, nWidth, nHeight, &terr);
+	}
+	else
+	{
+		if (RLE)
+		{
+			tbuff = DecodeRLE(this->_impl->_ImageData, header->IMAGE_DEPTH, header->IMAGE_HEIGHT * header->IMAGE_WIDTH, &terr);
+
+			if (terr != ERRORCODE::NONE)
+			{
+				XTGA_SETERROR(error, terr);
+				return false;
+			}
+		}
+
+		if (CMAP)
+		{
+			auto tmp = tbuff;
+
+			if (tbuff)
+			{
+				tbuff = DecodeColorMap(tbuff, header->IMAGE_HEIGHT * header->IMAGE_WIDTH, _impl->_ColorMapData, header->COLOR_MAP_BITS_PER_ENTRY, &terr);
+				memory::Free(tmp);
+			}
+			else
+			{
+				tbuff = DecodeColorMap(this->_impl->_ImageData, header->IMAGE_HEIGHT * header->IMAGE_WIDTH, _impl->_ColorMapData, header->COLOR_MAP_BITS_PER_ENTRY, &terr);
+			}
+
+			if (terr != ERRORCODE::NONE)
+			{
+				XTGA_SETERROR(error, terr);
+				return false;
+			}
+		}
+
+		auto tmp = tbuff;
+		if (!tbuff)
+			tbuff = _impl->_ImageData;
 
-	tbuff = ScaleImageBicubic(tbuff, pf,
-		header->IMAGE_WIDTH, header->IMAGE_HEIGHT, scale, &terr);
+		if (Reduction)
+			tbuff = ResizeImageBox(tbuff, pf, header->IMAGE_WIDTH, header->IMAGE_HEIGHT, nWidth, nHeight, true, &terr);
+		else
+			tbuff = ResizeImageBicubic(tbuff, pf, header->IMAGE_WIDTH, header->IMAGE_HEIGHT, nWidth, nHeight, true, &terr);
 
-	if (tmp) free(tmp);
+		if (tmp) memory::Free(tmp);
+	}
 
 	if (terr != ERRORCODE::NONE)
 	{
@@ -2061,10 +1503,15 @@ bool xtga::TGAFile::GenerateThumbnail(uchar LongEdgeLength, ERRORCODE* error)
 	if (CMAP)
 	{
 		// TODO: determine if the array should be color map indices or just straight values
-		tmp = tbuff;
-		tbuff = ApplyColorMap(tbuff, (addressable)header->IMAGE_HEIGHT * header->IMAGE_WIDTH, _impl->_ColorMapData, header->COLOR_MAP_LENGTH, header->COLOR_MAP_BITS_PER_ENTRY, &terr);
+		// The color map never changes once set, so the inverse map is built once and kept for later thumbnails.
+		if (!_impl->_InverseColorMap)
+			_impl->_InverseColorMap = new InverseColorMap(_impl->_ColorMapData, header->COLOR_MAP_LENGTH, header->COLOR_MAP_BITS_PER_ENTRY, PaletteWeights::RGB(), 5, true);
+
+		auto tmp = tbuff;
+		tbuff = ApplyColorMap(tbuff, (addressable)nWidth * nHeight,
+			_impl->_ColorMapData, header->COLOR_MAP_LENGTH, header->COLOR_MAP_BITS_PER_ENTRY, _impl->_InverseColorMap, &terr);
 
-		free(tmp);
+		memory::Free(tmp);
 
 		if (terr != ERRORCODE::NONE)
 		{
@@ -2073,11 +1520,10 @@ bool xtga::TGAFile::GenerateThumbnail(uchar LongEdgeLength, ERRORCODE* error)
 		}
 	}
 
-	_impl->_ThumbnailWidth = (uchar)(scale * header->IMAGE_WIDTH);
-	_impl->_ThumbnailHeight = (uchar)(scale * header->IMAGE_HEIGHT);
+	_impl->_ThumbnailWidth = (uchar)nWidth;
+	_impl->_ThumbnailHeight = (uchar)nHeight;
 
-	_impl->_ThumbnailData = tbuff;
-	_impl->__DanglingArrays.push_back(tbuff);
+	_impl->_ThumbnailData.Own(tbuff);
 	return true;
 }
 
@@ -2099,201 +1545,406 @@ xtga::ManagedArray<xtga::pixelformats::IPixel>* xtga::TGAFile::GetThumbnail(xtga
 		depth = _impl->_Header->COLOR_MAP_BITS_PER_ENTRY;
 	}
 
-	bool rle = false;
-	if (_impl->_Header->IMAGE_TYPE == IMAGETYPE::COLOR_MAPPED_RLE || _impl->_Header->IMAGE_TYPE == IMAGETYPE::TRUE_COLOR_RLE ||
-		_impl->_Header->IMAGE_TYPE == IMAGETYPE::GRAYSCALE_RLE)
+	ERRORCODE terr = ERRORCODE::NONE;
+
+	// thumbnails are always stored raw, even for run-length encoded images.
+	void* ReturnBuff = nullptr;
+	if (!DecodeImage(_impl->_ThumbnailData, ReturnBuff, _impl->_Header->IMAGE_DESCRIPTOR.IMAGE_ORIGIN,
+		_impl->_ThumbnailWidth, _impl->_ThumbnailHeight, depth, false, _impl->_ColorMapData, &terr))
+	{
+		XTGA_SETERROR(error, terr);
+		return nullptr;
+	}
+
+	addressable pCount = (addressable)_impl->_ThumbnailWidth * _impl->_ThumbnailHeight;
+	ManagedArray<IPixel>* rarr = nullptr;
+
+	if (depth == 32)
+	{
+		rarr = (ManagedArray<IPixel>*)ManagedArray<BGRA8888>::Adopt((BGRA8888*)ReturnBuff, pCount);
+		XTGA_SETERROR(AlphaType, ALPHATYPE::UNDEFINED_ALPHA_KEEP);
+		XTGA_SETERROR(PixelType, PIXELFORMATS::BGRA8888);
+	}
+	else if (depth == 24)
+	{
+		rarr = (ManagedArray<IPixel>*)ManagedArray<BGR888>::Adopt((BGR888*)ReturnBuff, pCount);
+		XTGA_SETERROR(AlphaType, ALPHATYPE::NOALPHA);
+		XTGA_SETERROR(PixelType, PIXELFORMATS::BGR888);
+	}
+	else if (depth == 16 && _impl->_Header->IMAGE_DESCRIPTOR.ALPHA_CHANNEL_BITCOUNT == 1)
+	{
+		rarr = (ManagedArray<IPixel>*)ManagedArray<BGRA5551>::Adopt((BGRA5551*)ReturnBuff, pCount);
+		XTGA_SETERROR(AlphaType, ALPHATYPE::UNDEFINED_ALPHA_IGNORE);
+		XTGA_SETERROR(PixelType, PIXELFORMATS::BGRA5551);
+	}
+	else if (depth == 16 && _impl->_Header->IMAGE_DESCRIPTOR.ALPHA_CHANNEL_BITCOUNT == 8)
+	{
+		rarr = (ManagedArray<IPixel>*)ManagedArray<IA88>::Adopt((IA88*)ReturnBuff, pCount);
+		XTGA_SETERROR(AlphaType, ALPHATYPE::UNDEFINED_ALPHA_KEEP);
+		XTGA_SETERROR(PixelType, PIXELFORMATS::IA88);
+	}
+	else if (depth == 8)
+	{
+		rarr = (ManagedArray<IPixel>*)ManagedArray<I8>::Adopt((I8*)ReturnBuff, pCount);
+		XTGA_SETERROR(AlphaType, ALPHATYPE::NOALPHA);
+		XTGA_SETERROR(PixelType, PIXELFORMATS::I8);
+	}
+	else
+	{
+		memory::Free(ReturnBuff);
+		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
+		return nullptr;
+	}
+
+	XTGA_SETERROR(error, ERRORCODE::NONE);
+
+	if (_impl->_Extensions)
+	{
+		XTGA_SETERROR(AlphaType, _impl->_Extensions->ALPHATYPE);
+	}
+
+	return rarr;
+}
+
+bool xtga::TGAFile::__TGAFileImpl::ColorMapFormat(pixelformats::PIXELFORMATS& format, flags::ALPHATYPE& alpha, ERRORCODE* error)
+{
+	using namespace pixelformats;
+	using namespace flags;
+
+	uchar depth = this->_Header->COLOR_MAP_BITS_PER_ENTRY;
+
+	if (depth == 32)
+	{
+		format = PIXELFORMATS::BGRA8888;
+		alpha = ALPHATYPE::UNDEFINED_ALPHA_KEEP;
+	}
+	else if (depth == 24)
+	{
+		format = PIXELFORMATS::BGR888;
+		alpha = ALPHATYPE::NOALPHA;
+	}
+	else if (depth == 16 && this->_Header->IMAGE_DESCRIPTOR.ALPHA_CHANNEL_BITCOUNT == 1)
+	{
+		format = PIXELFORMATS::BGRA5551;
+		alpha = ALPHATYPE::UNDEFINED_ALPHA_IGNORE;
+	}
+	else if (depth == 16 && this->_Header->IMAGE_DESCRIPTOR.ALPHA_CHANNEL_BITCOUNT == 8)
+	{
+		format = PIXELFORMATS::IA88;
+		alpha = ALPHATYPE::UNDEFINED_ALPHA_KEEP;
+	}
+	else
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
+		return false;
+	}
+
+	if (this->_Extensions)
+		alpha = this->_Extensions->ALPHATYPE;
+
+	XTGA_SETERROR(error, ERRORCODE::NONE);
+	return true;
+}
+
+bool xtga::TGAFile::__TGAFileImpl::DecodeRGBA(const void* data, uint16 width, uint16 height, bool rle, pixelformats::RGBA8888* out, DecodeContext* context, flags::ALPHATYPE* AlphaType, ERRORCODE* error)
+{
+	using namespace pixelformats;
+	using namespace flags;
+	using namespace codecs;
+
+	const auto Type = this->_Header->IMAGE_TYPE;
+	const bool Mapped = Type == IMAGETYPE::COLOR_MAPPED || Type == IMAGETYPE::COLOR_MAPPED_RLE;
+	const uchar depth = Mapped ? this->_Header->COLOR_MAP_BITS_PER_ENTRY : this->_Header->IMAGE_DEPTH;
+	const uchar alphaBits = this->_Header->IMAGE_DESCRIPTOR.ALPHA_CHANNEL_BITCOUNT;
+	const bool Palette = Mapped && this->_ColorMapData;
+
+	PIXELFORMATS format;
+	ALPHATYPE alpha;
+	if (Palette)
+	{
+		if (!ColorMapFormat(format, alpha, error))
+			return false;
+	}
+	else if (depth == 32)
+	{
+		format = PIXELFORMATS::BGRA8888;
+		alpha = ALPHATYPE::UNDEFINED_ALPHA_KEEP;
+	}
+	else if (depth == 24)
+	{
+		format = PIXELFORMATS::BGR888;
+		alpha = ALPHATYPE::NOALPHA;
+	}
+	else if (depth == 16 && alphaBits == 1)
+	{
+		format = PIXELFORMATS::BGRA5551;
+		alpha = ALPHATYPE::UNDEFINED_ALPHA_IGNORE;
+	}
+	else if (depth == 16 && alphaBits == 8)
+	{
+		format = PIXELFORMATS::IA88;
+		alpha = ALPHATYPE::UNDEFINED_ALPHA_KEEP;
+	}
+	else if (depth == 8)
+	{
+		format = PIXELFORMATS::I8;
+		alpha = ALPHATYPE::NOALPHA;
+	}
+	else
 	{
-		rle = true;
+		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
+		return false;
 	}
 
+	// the stored pixels (or indices), run-length encoded ones are expanded into the context first.
+	const uchar StoredDepth = Palette ? 8 : depth;
+	const addressable Length = (addressable)width * height;
+	const void* stored = data;
 	ERRORCODE terr = ERRORCODE::NONE;
 
-	void* ReturnBuff = nullptr;
-	if (!DecodeImage(_impl->_ThumbnailData, ReturnBuff, _impl->_Header->IMAGE_DESCRIPTOR.IMAGE_ORIGIN,
-		_impl->_ThumbnailWidth, _impl->_ThumbnailHeight, depth, rle, _impl->_ColorMapData, &terr))
+	if (rle)
 	{
-		XTGA_SETERROR(error, terr);
-		return nullptr;
+		void* scratch = context->Reserve(Length * (StoredDepth / 8));
+		if (!DecodeRLEInto(data, StoredDepth, Length, scratch, &terr))
+		{
+			XTGA_SETERROR(error, terr);
+			return false;
+		}
+		stored = scratch;
 	}
 
-	addressable pCount = (addressable)_impl->_ThumbnailWidth * _impl->_ThumbnailHeight;
-	ManagedArray<IPixel>* rarr = nullptr;
+	const auto Origin = this->_Header->IMAGE_DESCRIPTOR.IMAGE_ORIGIN;
+	const bool FlipV = Origin == IMAGEORIGIN::BOTTOM_LEFT || Origin == IMAGEORIGIN::BOTTOM_RIGHT;
+	const bool FlipH = Origin == IMAGEORIGIN::BOTTOM_RIGHT || Origin == IMAGEORIGIN::TOP_RIGHT;
 
-	if (depth == 32)
+	if (Palette)
 	{
-		rarr = (ManagedArray<IPixel>*)ManagedArray<BGRA8888>::Alloc((BGRA8888*)ReturnBuff, pCount);
-		XTGA_SETERROR(AlphaType, ALPHATYPE::UNDEFINED_ALPHA_KEEP);
-		XTGA_SETERROR(PixelType, PIXELFORMATS::BGRA8888);
+		// the color map is converted once, each index then expands straight to RGBA.
+		RGBA8888 Colors[256];
+		if (!ExpandColorMapRGBA(this->_ColorMapData, this->_Header->COLOR_MAP_LENGTH, format, Colors, &terr))
+		{
+			XTGA_SETERROR(error, terr);
+			return false;
+		}
+
+		StoredToRGBA((const uchar*)stored, out, width, height, FlipV, FlipH, [&](uchar i) { return Colors[i]; });
 	}
-	else if (depth == 24)
+	else if (format == PIXELFORMATS::BGRA8888)
 	{
-		rarr = (ManagedArray<IPixel>*)ManagedArray<BGR888>::Alloc((BGR888*)ReturnBuff, pCount);
-		XTGA_SETERROR(AlphaType, ALPHATYPE::NOALPHA);
-		XTGA_SETERROR(PixelType, PIXELFORMATS::BGR888);
+		StoredToRGBA((const BGRA8888*)stored, out, width, height, FlipV, FlipH, [](const BGRA8888& p) -> RGBA8888
+		{
+			RGBA8888 c; c.R = p.R; c.G = p.G; c.B = p.B; c.A = p.A;
+			return c;
+		});
 	}
-	else if (depth == 16 && _impl->_Header->IMAGE_DESCRIPTOR.ALPHA_CHANNEL_BITCOUNT == 1)
+	else if (format == PIXELFORMATS::BGR888)
 	{
-		rarr = (ManagedArray<IPixel>*)ManagedArray<BGRA5551>::Alloc((BGRA5551*)ReturnBuff, pCount);
-		XTGA_SETERROR(AlphaType, ALPHATYPE::UNDEFINED_ALPHA_IGNORE);
-		XTGA_SETERROR(PixelType, PIXELFORMATS::BGRA5551);
+		StoredToRGBA((const BGR888*)stored, out, width, height, FlipV, FlipH, [](const BGR888& p) -> RGBA8888
+		{
+			RGBA8888 c; c.R = p.R; c.G = p.G; c.B = p.B; c.A = 0xFF;
+			return c;
+		});
 	}
-	else if (depth == 16 && _impl->_Header->IMAGE_DESCRIPTOR.ALPHA_CHANNEL_BITCOUNT == 8)
+	else if (format == PIXELFORMATS::BGRA5551)
 	{
-		rarr = (ManagedArray<IPixel>*)ManagedArray<IA88>::Alloc((IA88*)ReturnBuff, pCount);
-		XTGA_SETERROR(AlphaType, ALPHATYPE::UNDEFINED_ALPHA_KEEP);
-		XTGA_SETERROR(PixelType, PIXELFORMATS::IA88);
+		StoredToRGBA((const BGRA5551*)stored, out, width, height, FlipV, FlipH, BGRA16_To_RGBA);
 	}
-	else if (depth == 8)
+	else if (format == PIXELFORMATS::IA88)
 	{
-		rarr = (ManagedArray<IPixel>*)ManagedArray<I8>::Alloc((I8*)ReturnBuff, pCount);
-		XTGA_SETERROR(AlphaType, ALPHATYPE::NOALPHA);
-		XTGA_SETERROR(PixelType, PIXELFORMATS::I8);
+		StoredToRGBA((const IA88*)stored, out, width, height, FlipV, FlipH, IA_To_RGBA);
 	}
 	else
 	{
-		free(ReturnBuff);
-		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
-		return nullptr;
+		StoredToRGBA((const I8*)stored, out, width, height, FlipV, FlipH, I_To_RGBA);
 	}
 
+	if (this->_Extensions)
+		alpha = this->_Extensions->ALPHATYPE;
+
+	XTGA_SETERROR(AlphaType, alpha);
 	XTGA_SETERROR(error, ERRORCODE::NONE);
+	return true;
+}
 
-	if (_impl->_Extensions)
+xtga::ManagedArray<xtga::pixelformats::RGBA8888>* xtga::TGAFile::GetThumbnailRGBA(xtga::flags::ALPHATYPE* AlphaType, ERRORCODE* error)
+{
+	if (!_impl->_ThumbnailData)
 	{
-		XTGA_SETERROR(AlphaType, _impl->_Extensions->ALPHATYPE);
+		XTGA_SETERROR(error, ERRORCODE::INVALID_OPERATION);
+		return nullptr;
 	}
 
+	auto rarr = ManagedArray<pixelformats::RGBA8888>::Alloc((addressable)_impl->_ThumbnailWidth * _impl->_ThumbnailHeight);
+	auto context = DecodeContext::Alloc();
+
+	const bool ok = _impl->DecodeRGBA(_impl->_ThumbnailData, _impl->_ThumbnailWidth, _impl->_ThumbnailHeight, false, (pixelformats::RGBA8888*)rarr->rawat(0), context, AlphaType, error);
+	DecodeContext::Free(context);
+
+	if (!ok)
+		ManagedArray<pixelformats::RGBA8888>::Free(rarr);
+
 	return rarr;
 }
 
-xtga::ManagedArray<xtga::pixelformats::RGBA8888>* xtga::TGAFile::GetThumbnailRGBA(xtga::flags::ALPHATYPE* AlphaType, ERRORCODE* error)
+xtga::structs::ColorCorrectionEntry* xtga::TGAFile::GetColorCorrectionTable()
 {
-	using namespace pixelformats;
-	using namespace flags;
-	using namespace codecs;
+	return this->_impl->_ColorCorrectionTable;
+}
 
-	uchar depth = _impl->_Header->IMAGE_DEPTH;
-	if (_impl->_Header->IMAGE_TYPE == IMAGETYPE::COLOR_MAPPED || _impl->_Header->IMAGE_TYPE == IMAGETYPE::COLOR_MAPPED_RLE)
-	{
-		depth = _impl->_Header->COLOR_MAP_BITS_PER_ENTRY;
-	}
+void xtga::TGAFile::GenerateColorCorrectionTable()
+{
+	// TODO: verify that this works + make return a bool for redundant task
 
-	bool rle = false;
-	if (_impl->_Header->IMAGE_TYPE == IMAGETYPE::COLOR_MAPPED_RLE || _impl->_Header->IMAGE_TYPE == IMAGETYPE::TRUE_COLOR_RLE ||
-		_impl->_Header->IMAGE_TYPE == IMAGETYPE::GRAYSCALE_RLE)
-	{
-		rle = true;
-	}
+	if (this->_impl->_ColorCorrectionTable)
+		return;
 
-	auto terr = ERRORCODE::NONE;
+	this->_impl->_ColorCorrectionTable.Own(memory::Allocate(sizeof(structs::ColorCorrectionEntry) * 256));
 
-	void* ReturnBuff = nullptr;
-	if (!DecodeImage(_impl->_ThumbnailData, ReturnBuff, _impl->_Header->IMAGE_DESCRIPTOR.IMAGE_ORIGIN,
-		_impl->_ThumbnailWidth, _impl->_ThumbnailHeight, depth, rle, _impl->_ColorMapData, &terr))
+	for (uint16 i = 0; i < 256; ++i)
 	{
-		XTGA_SETERROR(error, terr);
-		return nullptr;
+		this->_impl->_ColorCorrectionTable[i].B = i * 256;
+		this->_impl->_ColorCorrectionTable[i].G = i * 256;
+		this->_impl->_ColorCorrectionTable[i].R = i * 256;
+		this->_impl->_ColorCorrectionTable[i].A = i * 256;
 	}
+}
 
-	addressable pCount = (addressable)_impl->_ThumbnailWidth * _impl->_ThumbnailHeight;
-	auto rarr = ManagedArray<RGBA8888>::Alloc(pCount);
+bool xtga::TGAFile::__TGAFileImpl::TransformColors(const std::function<void(pixelformats::RGBA8888&)>& fn, bool parallel, ERRORCODE* error)
+{
+	using namespace pixelformats;
+	using namespace flags;
+	using namespace codecs;
 
-	// Convert from various pixel formats to RGBA
-	if (depth == 32)
-	{
-		auto buff = ManagedArray<BGRA8888>::Alloc((BGRA8888*)ReturnBuff, pCount);
-		for (addressable i = 0; i < pCount; ++i)
-		{
-			rarr->at(i) = BGRA_To_RGBA(buff->at(i));
-		}
-		ManagedArray<BGRA8888>::Free(buff);
+	auto type = this->_Header->IMAGE_TYPE;
 
-		XTGA_SETERROR(AlphaType, ALPHATYPE::UNDEFINED_ALPHA_KEEP);
-	}
-	else if (depth == 24)
+	if (type == IMAGETYPE::COLOR_MAPPED || type == IMAGETYPE::COLOR_MAPPED_RLE)
 	{
-		auto buff = ManagedArray<BGR888>::Alloc((BGR888*)ReturnBuff, pCount);
-		for (addressable i = 0; i < pCount; ++i)
+		if (!this->_ColorMapData)
 		{
-			rarr->at(i) = BGR_To_RGBA(buff->at(i));
+			XTGA_SETERROR(error, ERRORCODE::INVALID_OPERATION);
+			return false;
 		}
-		ManagedArray<BGR888>::Free(buff);
 
-		XTGA_SETERROR(AlphaType, ALPHATYPE::NOALPHA);
-	}
-	else if (depth == 16 && _impl->_Header->IMAGE_DESCRIPTOR.ALPHA_CHANNEL_BITCOUNT == 1)
-	{
-		auto buff = ManagedArray<BGRA5551>::Alloc((BGRA5551*)ReturnBuff, pCount);
-		for (addressable i = 0; i < pCount; ++i)
-		{
-			rarr->at(i) = BGRA16_To_RGBA(buff->at(i));
-		}
-		ManagedArray<BGRA5551>::Free(buff);
+		// every pixel (and the thumbnail) goes through the color map, so it is all that changes.
+		PIXELFORMATS format;
+		ALPHATYPE alpha;
+		if (!ColorMapFormat(format, alpha, error))
+			return false;
 
-		XTGA_SETERROR(AlphaType, ALPHATYPE::UNDEFINED_ALPHA_IGNORE);
-	}
-	else if (depth == 8)
-	{
-		auto buff = ManagedArray<I8>::Alloc((I8*)ReturnBuff, pCount);
-		for (addressable i = 0; i < pCount; ++i)
-		{
-			rarr->at(i) = I_To_RGBA(buff->at(i));
-		}
-		ManagedArray<I8>::Free(buff);
+		if (!TransformPixels(this->_ColorMapData, this->_Header->COLOR_MAP_LENGTH, format, false, fn, false, error))
+			return false;
 
-		XTGA_SETERROR(AlphaType, ALPHATYPE::NOALPHA);
+		delete this->_InverseColorMap;
+		this->_InverseColorMap = nullptr;
+
+		XTGA_SETERROR(error, ERRORCODE::NONE);
+		return true;
 	}
-	else if (depth == 16 && _impl->_Header->IMAGE_DESCRIPTOR.ALPHA_CHANNEL_BITCOUNT == 8)
-	{
-		auto buff = ManagedArray<IA88>::Alloc((IA88*)ReturnBuff, pCount);
-		for (addressable i = 0; i < pCount; ++i)
-		{
-			rarr->at(i) = IA_To_RGBA(buff->at(i));
-		}
-		ManagedArray<IA88>::Free(buff);
 
-		XTGA_SETERROR(AlphaType, ALPHATYPE::UNDEFINED_ALPHA_KEEP);
+	if (!this->_ImageData)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_OPERATION);
+		return false;
 	}
+
+	const uchar depth = this->_Header->IMAGE_DEPTH;
+	const bool gray = type == IMAGETYPE::GRAYSCALE || type == IMAGETYPE::GRAYSCALE_RLE;
+	const bool rle = type == IMAGETYPE::TRUE_COLOR_RLE || type == IMAGETYPE::GRAYSCALE_RLE;
+
+	PIXELFORMATS format;
+	if (depth == 32)
+		format = PIXELFORMATS::BGRA8888;
+	else if (depth == 24)
+		format = PIXELFORMATS::BGR888;
+	else if (depth == 16)
+		format = gray ? PIXELFORMATS::IA88 : PIXELFORMATS::BGRA5551;
+	else if (depth == 8 && gray)
+		format = PIXELFORMATS::I8;
 	else
 	{
-		ManagedArray<RGBA8888>::Free(rarr);
 		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
-		return nullptr;
+		return false;
 	}
 
-	if (_impl->_Extensions)
+	// a borrowed buffer is never written to, edit a copy of it (borrowed images are never encoded).
+	if (this->_ImageData.IsBorrowed())
 	{
-		XTGA_SETERROR(AlphaType, _impl->_Extensions->ALPHATYPE);
+		const addressable size = (addressable)this->_Header->IMAGE_WIDTH * this->_Header->IMAGE_HEIGHT * (depth / 8);
+		void* copy = memory::Allocate(size);
+		memcpy(copy, this->_ImageData, size);
+		this->_ImageData.Own(copy);
 	}
 
+	if (!TransformPixels(this->_ImageData, (addressable)this->_Header->IMAGE_WIDTH * this->_Header->IMAGE_HEIGHT, format, rle, fn, parallel, error))
+		return false;
+
+	// thumbnails are always stored raw, even for run-length encoded images.
+	if (this->_ThumbnailData)
+		TransformPixels(this->_ThumbnailData, (addressable)this->_ThumbnailWidth * this->_ThumbnailHeight, format, false, fn, parallel, nullptr);
+
 	XTGA_SETERROR(error, ERRORCODE::NONE);
+	return true;
+}
 
-	return rarr;
+bool xtga::TGAFile::TransformColors(ColorTransformFunc func, void* userdata, ERRORCODE* error)
+{
+	if (!func)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_OPERATION);
+		return false;
+	}
+
+	return this->_impl->TransformColors([&](pixelformats::RGBA8888& c) { func(c, userdata); }, false, error);
 }
 
-xtga::structs::ColorCorrectionEntry* xtga::TGAFile::GetColorCorrectionTable()
+bool xtga::TGAFile::TransformChannels(const uchar* R, const uchar* G, const uchar* B, const uchar* A, ERRORCODE* error)
 {
-	return this->_impl->_ColorCorrectionTable;
+	if (!R && !G && !B && !A)
+	{
+		XTGA_SETERROR(error, ERRORCODE::REDUNDANT_OPERATION);
+		return false;
+	}
+
+	return this->_impl->TransformColors([&](pixelformats::RGBA8888& c)
+	{
+		if (R) c.R = R[c.R];
+		if (G) c.G = G[c.G];
+		if (B) c.B = B[c.B];
+		if (A) c.A = A[c.A];
+	}, true, error);
 }
 
-void xtga::TGAFile::GenerateColorCorrectionTable()
+bool xtga::TGAFile::ApplyColorCorrectionTable(ERRORCODE* error)
 {
-	// TODO: verify that this works + make return a bool for redundant task
+	auto table = this->_impl->_ColorCorrectionTable.Get();
+	if (!table)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_OPERATION);
+		return false;
+	}
 
-	if (this->_impl->_ColorCorrectionTable)
-		return;
+	// entries are 16-bit, keep the high byte.
+	uchar R[256], G[256], B[256], A[256];
+	for (uint16 i = 0; i < 256; ++i)
+	{
+		R[i] = (uchar)(table[i].R >> 8);
+		G[i] = (uchar)(table[i].G >> 8);
+		B[i] = (uchar)(table[i].B >> 8);
+		A[i] = (uchar)(table[i].A >> 8);
+	}
 
-	this->_impl->_ColorCorrectionTable = (structs::ColorCorrectionEntry*)malloc(sizeof(structs::ColorCorrectionEntry) * 256);
+	if (!TransformChannels(R, G, B, A, error))
+		return false;
 
 	for (uint16 i = 0; i < 256; ++i)
 	{
-		this->_impl->_ColorCorrectionTable[i].B = i * 256;
-		this->_impl->_ColorCorrectionTable[i].G = i * 256;
-		this->_impl->_ColorCorrectionTable[i].R = i * 256;
-		this->_impl->_ColorCorrectionTable[i].A = i * 256;
+		table[i].B = i * 256;
+		table[i].G = i * 256;
+		table[i].R = i * 256;
+		table[i].A = i * 256;
 	}
 
-	this->_impl->__DanglingArrays.push_back(this->_impl->_ColorCorrectionTable);
+	return true;
 }
 
 xtga::ManagedArray<xtga::pixelformats::IPixel>* xtga::TGAFile::GetImage(xtga::pixelformats::PIXELFORMATS* PixelType, xtga::flags::ALPHATYPE* AlphaType, xtga::ERRORCODE* error)
@@ -2330,42 +1981,42 @@ xtga::ManagedArray<xtga::pixelformats::IPixel>* xtga::TGAFile::GetImage(xtga::pi
 
 	if (depth == 32)
 	{
-		rarr = (ManagedArray<IPixel>*)ManagedArray<BGRA8888>::Alloc((BGRA8888*)ReturnBuff, pCount);
+		rarr = (ManagedArray<IPixel>*)ManagedArray<BGRA8888>::Adopt((BGRA8888*)ReturnBuff, pCount);
 
 		XTGA_SETERROR(PixelType, PIXELFORMATS::BGRA8888);
 		XTGA_SETERROR(AlphaType, ALPHATYPE::UNDEFINED_ALPHA_KEEP);
 	}
 	else if (depth == 24)
 	{
-		rarr = (ManagedArray<IPixel>*)ManagedArray<BGR888>::Alloc((BGR888*)ReturnBuff, pCount);
+		rarr = (ManagedArray<IPixel>*)ManagedArray<BGR888>::Adopt((BGR888*)ReturnBuff, pCount);
 
 		XTGA_SETERROR(PixelType, PIXELFORMATS::BGR888);
 		XTGA_SETERROR(AlphaType, ALPHATYPE::NOALPHA);
 	}
 	else if (depth == 16 && _impl->_Header->IMAGE_DESCRIPTOR.ALPHA_CHANNEL_BITCOUNT == 1)
 	{
-		rarr = (ManagedArray<IPixel>*)ManagedArray<BGRA5551>::Alloc((BGRA5551*)ReturnBuff, pCount);
+		rarr = (ManagedArray<IPixel>*)ManagedArray<BGRA5551>::Adopt((BGRA5551*)ReturnBuff, pCount);
 
 		XTGA_SETERROR(PixelType, PIXELFORMATS::BGRA5551);
 		XTGA_SETERROR(AlphaType, ALPHATYPE::UNDEFINED_ALPHA_IGNORE);
 	}
 	else if (depth == 16 && _impl->_Header->IMAGE_DESCRIPTOR.ALPHA_CHANNEL_BITCOUNT == 8)
 	{
-		rarr = (ManagedArray<IPixel>*)ManagedArray<IA88>::Alloc((IA88*)ReturnBuff, pCount);
+		rarr = (ManagedArray<IPixel>*)ManagedArray<IA88>::Adopt((IA88*)ReturnBuff, pCount);
 
 		XTGA_SETERROR(PixelType, PIXELFORMATS::IA88);
 		XTGA_SETERROR(AlphaType, ALPHATYPE::UNDEFINED_ALPHA_KEEP);
 	}
 	else if (depth == 8)
 	{
-		rarr = (ManagedArray<IPixel>*)ManagedArray<I8>::Alloc((I8*)ReturnBuff, pCount);
+		rarr = (ManagedArray<IPixel>*)ManagedArray<I8>::Adopt((I8*)ReturnBuff, pCount);
 
 		XTGA_SETERROR(PixelType, PIXELFORMATS::I8);
 		XTGA_SETERROR(AlphaType, ALPHATYPE::NOALPHA);
 	}
 	else
 	{
-		free(ReturnBuff);
+		memory::Free(ReturnBuff);
 		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
 		return nullptr;
 	}
@@ -2382,107 +2033,119 @@ xtga::ManagedArray<xtga::pixelformats::IPixel>* xtga::TGAFile::GetImage(xtga::pi
 
 xtga::ManagedArray<xtga::pixelformats::RGBA8888>* xtga::TGAFile::GetImageRGBA(xtga::flags::ALPHATYPE* AlphaType, ERRORCODE* error)
 {
-	using namespace pixelformats;
-	using namespace flags;
-	using namespace codecs;
+	auto rarr = ManagedArray<pixelformats::RGBA8888>::Alloc((addressable)_impl->_Header->IMAGE_WIDTH * _impl->_Header->IMAGE_HEIGHT);
 
-	uchar depth = _impl->_Header->IMAGE_DEPTH;
-	if (_impl->_Header->IMAGE_TYPE == IMAGETYPE::COLOR_MAPPED || _impl->_Header->IMAGE_TYPE == IMAGETYPE::COLOR_MAPPED_RLE)
+	if (!DecodeImageRGBA((pixelformats::RGBA8888*)rarr->rawat(0), nullptr, AlphaType, error))
+		ManagedArray<pixelformats::RGBA8888>::Free(rarr);
+
+	return rarr;
+}
+
+bool xtga::TGAFile::DecodeImageRGBA(pixelformats::RGBA8888* out, DecodeContext* context, flags::ALPHATYPE* AlphaType, ERRORCODE* error)
+{
+	if (!out)
 	{
-		depth = _impl->_Header->COLOR_MAP_BITS_PER_ENTRY;
+		XTGA_SETERROR(error, ERRORCODE::INVALID_OPERATION);
+		return false;
 	}
 
-	bool rle = false;
-	if (_impl->_Header->IMAGE_TYPE == IMAGETYPE::COLOR_MAPPED_RLE || _impl->_Header->IMAGE_TYPE == IMAGETYPE::TRUE_COLOR_RLE ||
-		_impl->_Header->IMAGE_TYPE == IMAGETYPE::GRAYSCALE_RLE)
+	// without a context the scratch memory only lives for this call.
+	auto local = context ? nullptr : DecodeContext::Alloc();
+
+	const auto Type = _impl->_Header->IMAGE_TYPE;
+	const bool rle = Type == flags::IMAGETYPE::COLOR_MAPPED_RLE || Type == flags::IMAGETYPE::TRUE_COLOR_RLE || Type == flags::IMAGETYPE::GRAYSCALE_RLE;
+	const bool ok = _impl->DecodeRGBA(_impl->_ImageData, _impl->_Header->IMAGE_WIDTH, _impl->_Header->IMAGE_HEIGHT, rle, out,
+		context ? context : local, AlphaType, error);
+
+	DecodeContext::Free(local);
+	return ok;
+}
+
+bool xtga::TGAFile::DecodeImageRGBA(PixelBuffer<pixelformats::RGBA8888>& out, DecodeContext* context, flags::ALPHATYPE* AlphaType, ERRORCODE* error)
+{
+	if (!out.resize((addressable)_impl->_Header->IMAGE_WIDTH * _impl->_Header->IMAGE_HEIGHT))
 	{
-		rle = true;
+		XTGA_SETERROR(error, ERRORCODE::UNKNOWN);
+		return false;
 	}
 
-	auto terr = ERRORCODE::NONE;
+	return DecodeImageRGBA(out.data(), context, AlphaType, error);
+}
 
-	void* ReturnBuff = nullptr;
-	if (!DecodeImage(_impl->_ImageData, ReturnBuff, _impl->_Header->IMAGE_DESCRIPTOR.IMAGE_ORIGIN,
-		_impl->_Header->IMAGE_WIDTH, _impl->_Header->IMAGE_HEIGHT, depth, rle, _impl->_ColorMapData, &terr))
+xtga::ManagedArray<uchar>* xtga::TGAFile::GetIndexedImage(ManagedArray<pixelformats::IPixel>** Palette, pixelformats::PIXELFORMATS* PaletteType, flags::ALPHATYPE* AlphaType, ERRORCODE* error)
+{
+	using namespace pixelformats;
+	using namespace flags;
+	using namespace codecs;
+
+	auto Header = _impl->_Header.Get();
+	if (!_impl->_ColorMapData || !(Header->IMAGE_TYPE == IMAGETYPE::COLOR_MAPPED || Header->IMAGE_TYPE == IMAGETYPE::COLOR_MAPPED_RLE))
 	{
-		XTGA_SETERROR(error, terr);
+		XTGA_SETERROR(error, ERRORCODE::INVALID_OPERATION);
 		return nullptr;
 	}
 
-	addressable pCount = (addressable)this->_impl->_Header->IMAGE_WIDTH * this->_impl->_Header->IMAGE_HEIGHT;
-	auto rarr = ManagedArray<RGBA8888>::Alloc(pCount);
+	PIXELFORMATS format;
+	ALPHATYPE alpha;
+	if (!_impl->ColorMapFormat(format, alpha, error))
+		return nullptr;
 
-	// Convert from various pixel formats to RGBA
-	if (depth == 32)
-	{
-		auto buff = ManagedArray<BGRA8888>::Alloc((BGRA8888*)ReturnBuff, pCount);
-		for (addressable i = 0; i < pCount; ++i)
-		{
-			rarr->at(i) = BGRA_To_RGBA(buff->at(i));
-		}
-		ManagedArray<BGRA8888>::Free(buff);
+	ERRORCODE terr = ERRORCODE::NONE;
 
-		XTGA_SETERROR(AlphaType, ALPHATYPE::UNDEFINED_ALPHA_KEEP);
-	}
-	else if (depth == 24)
+	void* Indices = nullptr;
+	if (!DecodeImage(_impl->_ImageData, Indices, Header->IMAGE_DESCRIPTOR.IMAGE_ORIGIN,
+		Header->IMAGE_WIDTH, Header->IMAGE_HEIGHT, 8, Header->IMAGE_TYPE == IMAGETYPE::COLOR_MAPPED_RLE, nullptr, &terr))
 	{
-		auto buff = ManagedArray<BGR888>::Alloc((BGR888*)ReturnBuff, pCount);
-		for (addressable i = 0; i < pCount; ++i)
-		{
-			rarr->at(i) = BGR_To_RGBA(buff->at(i));
-		}
-		ManagedArray<BGR888>::Free(buff);
-
-		XTGA_SETERROR(AlphaType, ALPHATYPE::NOALPHA);
+		XTGA_SETERROR(error, terr);
+		return nullptr;
 	}
-	else if (depth == 16 && _impl->_Header->IMAGE_DESCRIPTOR.ALPHA_CHANNEL_BITCOUNT == 1)
-	{
-		auto buff = ManagedArray<BGRA5551>::Alloc((BGRA5551*)ReturnBuff, pCount);
-		for (addressable i = 0; i < pCount; ++i)
-		{
-			rarr->at(i) = BGRA16_To_RGBA(buff->at(i));
-		}
-		ManagedArray<BGRA5551>::Free(buff);
 
-		XTGA_SETERROR(AlphaType, ALPHATYPE::UNDEFINED_ALPHA_IGNORE);
-	}
-	else if (depth == 8)
+	if (Palette)
 	{
-		auto buff = ManagedArray<I8>::Alloc((I8*)ReturnBuff, pCount);
-		for (addressable i = 0; i < pCount; ++i)
-		{
-			rarr->at(i) = I_To_RGBA(buff->at(i));
-		}
-		ManagedArray<I8>::Free(buff);
+		addressable csize = (addressable)Header->COLOR_MAP_LENGTH * (Header->COLOR_MAP_BITS_PER_ENTRY / 8);
+		void* CMap = memory::Allocate(csize);
+		memcpy(CMap, _impl->_ColorMapData, csize);
 
-		XTGA_SETERROR(AlphaType, ALPHATYPE::NOALPHA);
+		if (format == PIXELFORMATS::BGRA8888)
+			*Palette = (ManagedArray<IPixel>*)ManagedArray<BGRA8888>::Adopt((BGRA8888*)CMap, Header->COLOR_MAP_LENGTH);
+		else if (format == PIXELFORMATS::BGR888)
+			*Palette = (ManagedArray<IPixel>*)ManagedArray<BGR888>::Adopt((BGR888*)CMap, Header->COLOR_MAP_LENGTH);
+		else if (format == PIXELFORMATS::BGRA5551)
+			*Palette = (ManagedArray<IPixel>*)ManagedArray<BGRA5551>::Adopt((BGRA5551*)CMap, Header->COLOR_MAP_LENGTH);
+		else
+			*Palette = (ManagedArray<IPixel>*)ManagedArray<IA88>::Adopt((IA88*)CMap, Header->COLOR_MAP_LENGTH);
 	}
-	else if (depth == 16 && _impl->_Header->IMAGE_DESCRIPTOR.ALPHA_CHANNEL_BITCOUNT == 8)
-	{
-		auto buff = ManagedArray<IA88>::Alloc((IA88*)ReturnBuff, pCount);
-		for (addressable i = 0; i < pCount; ++i)
-		{
-			rarr->at(i) = IA_To_RGBA(buff->at(i));
-		}
-		ManagedArray<IA88>::Free(buff);
 
-		XTGA_SETERROR(AlphaType, ALPHATYPE::UNDEFINED_ALPHA_KEEP);
-	}
-	else
+	XTGA_SETERROR(PaletteType, format);
+	XTGA_SETERROR(AlphaType, alpha);
+	XTGA_SETERROR(error, ERRORCODE::NONE);
+
+	return ManagedArray<uchar>::Adopt((uchar*)Indices, (addressable)Header->IMAGE_WIDTH * Header->IMAGE_HEIGHT);
+}
+
+xtga::MipChain* xtga::TGAFile::GenerateMipChain(flags::MIPFILTER filter, pixelformats::PIXELFORMATS outFormat, ERRORCODE* error)
+{
+	using namespace flags;
+
+	auto terr = ERRORCODE::NONE;
+	auto alpha = ALPHATYPE::NOALPHA;
+	auto image = GetImageRGBA(&alpha, &terr);
+	if (!image)
 	{
-		ManagedArray<RGBA8888>::Free(rarr);
-		XTGA_SETERROR(error, ERRORCODE::INVALID_DEPTH);
+		XTGA_SETERROR(error, terr);
 		return nullptr;
 	}
 
-	XTGA_SETERROR(error, ERRORCODE::NONE);
+	const bool gamma = ((uchar)filter & (uchar)MIPFILTER::GAMMA) != 0;
 
-	if (_impl->_Extensions)
-	{
-		XTGA_SETERROR(AlphaType, _impl->_Extensions->ALPHATYPE);
-	}
+	// premultiplied colors are already weighted by their alpha.
+	const bool weighted = ((uchar)filter & (uchar)MIPFILTER::PREMULTIPLIED) != 0 && alpha != ALPHATYPE::PREMULTIPLIED;
 
-	return rarr;
+	auto chain = MipChain::Build((const pixelformats::RGBA8888*)image->rawat(0), _impl->_Header->IMAGE_WIDTH, _impl->_Header->IMAGE_HEIGHT,
+		outFormat, gamma, weighted, error);
+
+	ManagedArray<pixelformats::RGBA8888>::Free(image);
+	return chain;
 }
 
 void xtga::TGAFile::UpgradeToTGATwo(xtga::ERRORCODE* error)
@@ -2495,13 +2158,11 @@ void xtga::TGAFile::UpgradeToTGATwo(xtga::ERRORCODE* error)
 	else
 	{
 		// Fill footer
-		this->_impl->_Footer = new structs::Footer;
-		memset(this->_impl->_Footer, 0, sizeof(structs::Footer));
+		this->_impl->_Footer.Own(memory::AllocateZeroed(sizeof(structs::Footer)));
 		memcpy(this->_impl->_Footer->SIGNATURE, TGA2SIG, sizeof(TGA2SIG));
 
 		// Fill extensions
-		this->_impl->_Extensions = new structs::ExtensionArea;
-		memset(this->_impl->_Extensions, 0, sizeof(structs::ExtensionArea));
+		this->_impl->_Extensions.Own(memory::AllocateZeroed(sizeof(structs::ExtensionArea)));
 		this->_impl->_Extensions->EXTENSION_SIZE = sizeof(structs::ExtensionArea);
 		memcpy(this->_impl->_Extensions->SOFTWARE_ID, XTGASIG, sizeof(XTGASIG));
 		this->_impl->_Extensions->SOFTWARE_VERSION = XTGAVER;
@@ -2509,9 +2170,6 @@ void xtga::TGAFile::UpgradeToTGATwo(xtga::ERRORCODE* error)
 
 		if (this->_impl->_Header->IMAGE_DESCRIPTOR.ALPHA_CHANNEL_BITCOUNT > 0)
 			this->_impl->_Extensions->ALPHATYPE = flags::ALPHATYPE::UNDEFINED_ALPHA_KEEP;
-
-		this->_impl->__DanglingPtrs.push_back(this->_impl->_Footer);
-		this->_impl->__DanglingPtrs.push_back(this->_impl->_Extensions);
 	}
 }
 
@@ -0,0 +1,304 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: tga_writer.cpp
+/// purpose : Implements the TGAWriter class.
+//==============================================================================
+
+#include "xTGA/tga_writer.h"
+
+#include "codecs.h"
+#include "convert.h"
+#include "error_macro.h"
+#include "section.h"
+#include "signatures.h"
+#include "xTGA/structures.h"
+
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+class xtga::TGAWriter::__TGAWriterImpl
+{
+public:
+	__TGAWriterImpl();
+
+	std::unique_ptr<std::ofstream> _File;
+	std::ostream* _Stream;
+	structs::Header _Header;
+	Section<uchar> _Row;
+	Section<uchar> _Encoded;
+	std::vector<uint32> _ScanLines;
+	codecs::RowTransformFunc _Transform;
+	flags::ALPHATYPE _AlphaType;
+	uint64 _Offset;
+	addressable _RowSize;
+	uint16 _Rows;
+	uchar _InputBPP;
+	bool _RLE;
+	bool _TGA2;
+	bool _Closed;
+
+	bool Begin(std::ostream& stream, uint16 width, uint16 height, const Parameters& config, flags::IMAGEORIGIN origin, ERRORCODE* error);
+	bool Put(const void* data, addressable size, ERRORCODE* error);
+};
+
+xtga::TGAWriter::__TGAWriterImpl::__TGAWriterImpl()
+{
+	memset(&_Header, 0, sizeof(_Header));
+	_Stream = nullptr;
+	_Transform = nullptr;
+	_AlphaType = flags::ALPHATYPE::UNDEFINED_ALPHA_KEEP;
+	_Offset = 0;
+	_RowSize = 0;
+	_Rows = 0;
+	_InputBPP = 0;
+	_RLE = false;
+	_TGA2 = false;
+	_Closed = false;
+}
+
+bool xtga::TGAWriter::__TGAWriterImpl::Begin(std::ostream& stream, uint16 width, uint16 height, const Parameters& config, flags::IMAGEORIGIN origin, ERRORCODE* error)
+{
+	if (origin != flags::IMAGEORIGIN::BOTTOM_LEFT && origin != flags::IMAGEORIGIN::TOP_LEFT)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_OPERATION);
+		return false;
+	}
+
+	// same limits as EncodeRLE(), packets can't span scanlines so tiny widths aren't worth encoding.
+	if (width == 0 || height == 0 || (config.RunLengthEncode && width < 4))
+	{
+		XTGA_SETERROR(error, ERRORCODE::INDEX_OUT_OF_RANGE);
+		return false;
+	}
+
+	_InputBPP = codecs::InputPixelSize(config.InputFormat);
+	_Transform = codecs::GetRowTransform(config.InputFormat, config.GetOutputFormat());
+
+	if (_InputBPP == 0 || !_Transform || !codecs::DescribeOutputFormat(&_Header, config.GetOutputFormat()))
+	{
+		XTGA_SETERROR(error, ERRORCODE::UNKNOWN);
+		return false;
+	}
+
+	_Header.IMAGE_WIDTH = width;
+	_Header.IMAGE_HEIGHT = height;
+	_Header.IMAGE_DESCRIPTOR.IMAGE_ORIGIN = origin;
+
+	_RLE = config.RunLengthEncode;
+	if (_RLE)
+	{
+		if (_Header.IMAGE_TYPE == flags::IMAGETYPE::GRAYSCALE)
+			_Header.IMAGE_TYPE = flags::IMAGETYPE::GRAYSCALE_RLE;
+		else
+			_Header.IMAGE_TYPE = flags::IMAGETYPE::TRUE_COLOR_RLE;
+
+		_Encoded.Own(memory::Allocate(codecs::RLERowBound(width, _Header.IMAGE_DEPTH / 8)));
+	}
+
+	_TGA2 = config.TGA2File;
+	_AlphaType = config.AlphaType;
+	_RowSize = (addressable)width * (_Header.IMAGE_DEPTH / 8);
+	_Row.Own(memory::Allocate(_RowSize));
+
+	if (_TGA2)
+		_ScanLines.reserve(height);
+
+	_Stream = &stream;
+	return Put(&_Header, sizeof(structs::Header), error);
+}
+
+bool xtga::TGAWriter::__TGAWriterImpl::Put(const void* data, addressable size, ERRORCODE* error)
+{
+	_Stream->write((const char*)data, (std::streamsize)size);
+	_Offset += size;
+
+	if (!_Stream->good())
+	{
+		XTGA_SETERROR(error, ERRORCODE::FILE_ERROR);
+		return false;
+	}
+
+	return true;
+}
+
+xtga::TGAWriter::TGAWriter() : _impl(nullptr) {}
+
+xtga::TGAWriter* xtga::TGAWriter::Open(const char* filename, uint16 width, uint16 height, const Parameters& config, flags::IMAGEORIGIN origin, ERRORCODE* error)
+{
+	std::unique_ptr<std::ofstream> file(new std::ofstream(filename, std::ios::binary | std::ios::trunc));
+
+	if (!file->is_open())
+	{
+		XTGA_SETERROR(error, ERRORCODE::FILE_ERROR);
+		return nullptr;
+	}
+
+	auto r = Open(*file, width, height, config, origin, error);
+	if (r)
+		r->_impl->_File = std::move(file);
+
+	return r;
+}
+
+xtga::TGAWriter* xtga::TGAWriter::Open(std::ostream& stream, uint16 width, uint16 height, const Parameters& config, flags::IMAGEORIGIN origin, ERRORCODE* error)
+{
+	auto impl = new __TGAWriterImpl();
+
+	if (!impl->Begin(stream, width, height, config, origin, error))
+	{
+		delete impl;
+		return nullptr;
+	}
+
+	auto r = new TGAWriter();
+	r->_impl = impl;
+
+	XTGA_SETERROR(error, ERRORCODE::NONE);
+	return r;
+}
+
+void xtga::TGAWriter::Free(TGAWriter*& obj)
+{
+	if (obj != nullptr)
+	{
+		delete obj->_impl;
+		obj->_impl = nullptr;
+		delete obj;
+		obj = nullptr;
+	}
+}
+
+bool xtga::TGAWriter::WriteRows(const void* rows, uint16 count, ERRORCODE* error)
+{
+	auto impl = this->_impl;
+
+	if (impl->_Closed || !rows)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_OPERATION);
+		return false;
+	}
+
+	if ((uint32)impl->_Rows + count > impl->_Header.IMAGE_HEIGHT)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INDEX_OUT_OF_RANGE);
+		return false;
+	}
+
+	const uint16 width = impl->_Header.IMAGE_WIDTH;
+	const uchar OutputBPP = impl->_Header.IMAGE_DEPTH / 8;
+	const addressable InputStride = (addressable)width * impl->_InputBPP;
+
+	for (uint16 r = 0; r < count; ++r)
+	{
+		// the scan line table and footer store 32-bit offsets.
+		if (impl->_TGA2 && impl->_Offset > 0xFFFFFFFF)
+		{
+			XTGA_SETERROR(error, ERRORCODE::OVERFLOW_DETECTED);
+			return false;
+		}
+
+		auto out = impl->_Row.Get();
+		impl->_Transform((const uchar*)rows + r * InputStride, out, width);
+
+		if (impl->_TGA2)
+			impl->_ScanLines.push_back((uint32)impl->_Offset);
+
+		bool ok;
+		if (impl->_RLE)
+			ok = impl->Put(impl->_Encoded, codecs::EncodeRLERow(out, width, OutputBPP, impl->_Encoded), error);
+		else
+			ok = impl->Put(out, impl->_RowSize, error);
+
+		if (!ok)
+			return false;
+
+		++impl->_Rows;
+	}
+
+	XTGA_SETERROR(error, ERRORCODE::NONE);
+	return true;
+}
+
+uint16 xtga::TGAWriter::GetRowsWritten() const
+{
+	return this->_impl->_Rows;
+}
+
+bool xtga::TGAWriter::Close(ERRORCODE* error)
+{
+	auto impl = this->_impl;
+
+	if (impl->_Closed)
+	{
+		XTGA_SETERROR(error, ERRORCODE::REDUNDANT_OPERATION);
+		return false;
+	}
+
+	if (impl->_Rows != impl->_Header.IMAGE_HEIGHT)
+	{
+		XTGA_SETERROR(error, ERRORCODE::INVALID_OPERATION);
+		return false;
+	}
+
+	if (impl->_TGA2)
+	{
+		const addressable ScanLineSize = impl->_ScanLines.size() * sizeof(uint32);
+		const addressable extOffset = impl->_Offset + ScanLineSize;
+
+		if (extOffset > 0xFFFFFFFF)
+		{
+			XTGA_SETERROR(error, ERRORCODE::OVERFLOW_DETECTED);
+			return false;
+		}
+
+		structs::ExtensionArea Extensions;
+		memset(&Extensions, 0, sizeof(structs::ExtensionArea));
+		Extensions.EXTENSION_SIZE = sizeof(structs::ExtensionArea);
+		memcpy(Extensions.SOFTWARE_ID, XTGASIG, sizeof(XTGASIG));
+		Extensions.SOFTWARE_VERSION = XTGAVER;
+		Extensions.SOFTWARE_LETTER = XTGALET;
+		Extensions.ALPHATYPE = impl->_AlphaType;
+		Extensions.SCAN_LINE_OFFSET = (uint32)impl->_Offset;
+
+		time_t t = time(NULL);
+		tm* tPtr = localtime(&t);
+		Extensions.SAVE_DATE_YEAR = tPtr->tm_year + 1900;
+		Extensions.SAVE_DATE_MONTH = tPtr->tm_mon + 1;
+		Extensions.SAVE_DATE_DAY = tPtr->tm_mday;
+		Extensions.SAVE_DATE_HOUR = tPtr->tm_hour;
+		Extensions.SAVE_DATE_MINUTE = tPtr->tm_min;
+		Extensions.SAVE_DATE_SECOND = tPtr->tm_sec;
+
+		structs::Footer Footer;
+		memset(&Footer, 0, sizeof(structs::Footer));
+		Footer.EXTENSION_AREA_OFFSET = (uint32)extOffset;
+		memcpy(Footer.SIGNATURE, TGA2SIG, sizeof(TGA2SIG));
+
+		if (!impl->Put(impl->_ScanLines.data(), ScanLineSize, error) ||
+			!impl->Put(&Extensions, sizeof(structs::ExtensionArea), error) ||
+			!impl->Put(&Footer, sizeof(structs::Footer), error))
+			return false;
+	}
+
+	impl->_Stream->flush();
+	if (impl->_File)
+		impl->_File->close();
+
+	if (impl->_Stream->fail())
+	{
+		XTGA_SETERROR(error, ERRORCODE::FILE_ERROR);
+		return false;
+	}
+
+	impl->_Closed = true;
+
+	XTGA_SETERROR(error, ERRORCODE::NONE);
+	return true;
+}
@@ -0,0 +1,381 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: thread_pool.cpp
+/// purpose : Provides the library's persistent work-stealing thread pool.
+//==============================================================================
+
+#include "thread_pool.h"
+
+#include "xTGA/allocator.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	using namespace xtga;
+
+	struct TaskGroup
+	{
+		const std::function<void(uint32)>* Fn;
+		std::atomic<uint32> Remaining;
+	};
+
+	struct Job
+	{
+		TaskGroup* Group;
+		uint32 Part;
+	};
+
+	struct WorkQueue
+	{
+		std::mutex Lock;
+		std::deque<Job> Jobs;
+	};
+
+	class ThreadPool;
+
+	// The pool that owns this thread and the index of its worker, nullptr and -1 for threads no pool owns.
+	thread_local const ThreadPool* tWorkerPool = nullptr;
+	thread_local int tWorkerIndex = -1;
+
+	class ThreadPool
+	{
+	public:
+		ThreadPool(uint32 threads);
+		~ThreadPool();
+
+		void Run(uint32 parts, const std::function<void(uint32)>& fn);
+
+	private:
+		bool TryPop(WorkQueue& q, bool back, Job& job);
+		bool TryRunOne(int home);
+		void WorkerLoop(uint32 index);
+
+		std::vector<std::unique_ptr<WorkQueue>> _Queues;
+		std::vector<std::thread> _Threads;
+		std::mutex _SleepLock;
+		std::condition_variable _Wake;
+		std::atomic<uint64> _Pending;
+		std::atomic<uint32> _NextQueue;
+		bool _Stop;
+	};
+
+	ThreadPool::ThreadPool(uint32 threads) : _Pending(0), _NextQueue(0), _Stop(false)
+	{
+		// the calling thread always helps out, so one less worker is needed.
+		uint32 workers = threads - 1;
+
+		for (uint32 i = 0; i < workers; ++i)
+			_Queues.emplace_back(new WorkQueue());
+
+		for (uint32 i = 0; i < workers; ++i)
+			_Threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_SleepLock);
+			_Stop = true;
+		}
+		_Wake.notify_all();
+
+		for (auto& t : _Threads)
+			t.join();
+	}
+
+	bool ThreadPool::TryPop(WorkQueue& q, bool back, Job& job)
+	{
+		std::lock_guard<std::mutex> lock(q.Lock);
+		if (q.Jobs.empty())
+			return false;
+
+		if (back)
+		{
+			job = q.Jobs.back();
+			q.Jobs.pop_back();
+		}
+		else
+		{
+			job = q.Jobs.front();
+			q.Jobs.pop_front();
+		}
+		return true;
+	}
+
+	bool ThreadPool::TryRunOne(int home)
+	{
+		Job job;
+		bool found = false;
+
+		// own work newest first (cache warm), others' work oldest first.
+		if (home >= 0)
+			found = TryPop(*_Queues[home], true, job);
+
+		for (uint32 i = 0; !found && i < (uint32)_Queues.size(); ++i)
+		{
+			uint32 victim = (uint32)(home + 1 + i) % (uint32)_Queues.size();
+			found = TryPop(*_Queues[victim], false, job);
+		}
+
+		if (!found)
+			return false;
+
+		_Pending.fetch_sub(1, std::memory_order_relaxed);
+		(*job.Group->Fn)(job.Part);
+
+		// the last part wakes the thread waiting on the group in Run().
+		if (job.Group->Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			std::lock_guard<std::mutex> lock(_SleepLock);
+			_Wake.notify_all();
+		}
+		return true;
+	}
+
+	void ThreadPool::WorkerLoop(uint32 index)
+	{
+		tWorkerPool = this;
+		tWorkerIndex = (int)index;
+
+		for (;;)
+		{
+			if (TryRunOne((int)index))
+				continue;
+
+			std::unique_lock<std::mutex> lock(_SleepLock);
+			_Wake.wait(lock, [this]() { return _Stop || _Pending.load(std::memory_order_relaxed) > 0; });
+			if (_Stop)
+				return;
+		}
+	}
+
+	void ThreadPool::Run(uint32 parts, const std::function<void(uint32)>& fn)
+	{
+		TaskGroup group;
+		group.Fn = &fn;
+		group.Remaining = parts;
+
+		// a worker of another pool (one replaced by SetThreadCount()) has no queue here.
+		const int home = tWorkerPool == this ? tWorkerIndex : -1;
+
+		// counted before the jobs are visible so that a fast thief never takes the count below zero.
+		{
+			std::lock_guard<std::mutex> lock(_SleepLock);
+			_Pending.fetch_add(parts, std::memory_order_relaxed);
+		}
+
+		if (home >= 0)
+		{
+			std::lock_guard<std::mutex> lock(_Queues[home]->Lock);
+			for (uint32 p = 0; p < parts; ++p)
+				_Queues[home]->Jobs.push_back({ &group, p });
+		}
+		else
+		{
+			uint32 q = _NextQueue.fetch_add(1, std::memory_order_relaxed);
+			for (uint32 p = 0; p < parts; ++p, ++q)
+			{
+				WorkQueue& wq = *_Queues[q % _Queues.size()];
+				std::lock_guard<std::mutex> lock(wq.Lock);
+				wq.Jobs.push_back({ &group, p });
+			}
+		}
+
+		_Wake.notify_all();
+
+		// help out until every part has run, sleeping while the remaining ones run elsewhere.
+		while (group.Remaining.load(std::memory_order_acquire) != 0)
+		{
+			if (TryRunOne(home))
+				continue;
+
+			std::unique_lock<std::mutex> lock(_SleepLock);
+			_Wake.wait(lock, [this, &group]()
+			{
+				return group.Remaining.load(std::memory_order_acquire) == 0 || _Pending.load(std::memory_order_relaxed) > 0;
+			});
+		}
+	}
+
+	struct PoolState
+	{
+		std::mutex Lock;
+		uint32 ThreadCount = 0;
+		std::shared_ptr<ThreadPool> Pool;		// callers hold a copy while they run, so a replaced pool outlives its work.
+
+		threading::ExecutorFunc Executor = nullptr;
+		void* ExecutorData = nullptr;
+		uint32 ExecutorConcurrency = 0;
+	};
+
+	PoolState& State()
+	{
+		static PoolState s;
+		return s;
+	}
+
+	uint32 HardwareThreads()
+	{
+		uint32 n = std::thread::hardware_concurrency();
+		return n == 0 ? 1 : n;
+	}
+
+	uint32 ResolvedThreadCount(const PoolState& s)
+	{
+		return s.ThreadCount == 0 ? HardwareThreads() : s.ThreadCount;
+	}
+}
+
+void xtga::threading::SetThreadCount(uint32 count)
+{
+	auto& s = State();
+	std::shared_ptr<ThreadPool> old;
+	{
+		std::lock_guard<std::mutex> lock(s.Lock);
+
+		if (count == s.ThreadCount)
+			return;
+
+		s.ThreadCount = count;
+		old.swap(s.Pool);
+	}
+
+	// the old pool's threads are joined here, or by the last call still running work on it.
+}
+
+uint32 xtga::threading::GetThreadCount()
+{
+	auto& s = State();
+	std::lock_guard<std::mutex> lock(s.Lock);
+
+	return ResolvedThreadCount(s);
+}
+
+void xtga::threading::SetExecutor(ExecutorFunc executor, void* userdata, uint32 concurrency)
+{
+	auto& s = State();
+	std::lock_guard<std::mutex> lock(s.Lock);
+
+	s.Executor = executor;
+	s.ExecutorData = userdata;
+	s.ExecutorConcurrency = concurrency == 0 ? HardwareThreads() : concurrency;
+}
+
+uint32 xtga::threading::Concurrency()
+{
+	auto& s = State();
+	std::lock_guard<std::mutex> lock(s.Lock);
+
+	if (s.Executor)
+		return s.ExecutorConcurrency;
+
+	return ResolvedThreadCount(s);
+}
+
+void xtga::threading::ParallelInvoke(uint32 parts, const std::function<void(uint32 part)>& fn)
+{
+	if (parts == 0)
+		return;
+
+	// parts run on other threads allocate from the calling thread's allocator.
+	const std::function<void(uint32)>* run = &fn;
+	std::function<void(uint32)> scoped;
+	memory::Allocator allocator;
+	if (memory::GetThreadAllocator(&allocator))
+	{
+		scoped = [&](uint32 part)
+		{
+			memory::ScopedAllocator scope(allocator);
+			fn(part);
+		};
+		run = &scoped;
+	}
+
+	auto& s = State();
+	ExecutorFunc executor = nullptr;
+	void* userdata = nullptr;
+	std::shared_ptr<ThreadPool> pool;
+	{
+		std::lock_guard<std::mutex> lock(s.Lock);
+
+		if (s.Executor)
+		{
+			executor = s.Executor;
+			userdata = s.ExecutorData;
+		}
+		else if (parts > 1 && ResolvedThreadCount(s) > 1)
+		{
+			if (!s.Pool)
+				s.Pool = std::make_shared<ThreadPool>(ResolvedThreadCount(s));
+			pool = s.Pool;
+		}
+	}
+
+	if (executor)
+	{
+		auto Trampoline = [](void* task, uint32 index)
+		{
+			(*(const std::function<void(uint32)>*)task)(index);
+		};
+		executor(Trampoline, (void*)run, parts, userdata);
+	}
+	else if (pool)
+	{
+		pool->Run(parts, *run);
+	}
+	else
+	{
+		for (uint32 p = 0; p < parts; ++p)
+			(*run)(p);
+	}
+}
+
+void xtga::threading::ParallelFor(addressable length, const std::function<void(addressable start, addressable count)>& fn, addressable grain)
+{
+	if (length == 0)
+		return;
+
+	if (grain == 0)
+		grain = 1;
+
+	// a few parts per thread so that stealing can even out uneven work.
+	addressable parts = (addressable)Concurrency() * 4;
+	addressable maxParts = (length + grain - 1) / grain;
+	if (parts > maxParts)
+		parts = maxParts;
+
+	if (parts <= 1)
+	{
+		fn(0, length);
+		return;
+	}
+
+	ParallelInvoke((uint32)parts, [&](uint32 part)
+	{
+		addressable start = length * part / parts;
+		addressable end = length * (part + 1) / parts;
+		fn(start, end - start);
+	});
+}
+
+void xtga::threading::ParallelFor(EXECUTION execution, addressable length, const std::function<void(addressable start, addressable count)>& fn, addressable grain)
+{
+	if (execution == EXECUTION::THREADED)
+	{
+		ParallelFor(length, fn, grain);
+		return;
+	}
+
+	if (length != 0)
+		fn(0, length);
+}
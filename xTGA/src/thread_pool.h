@@ -0,0 +1,57 @@
+//============ Copyright © 2019 Brett Anthony. All rights reserved. ============
+///
+/// This work is licensed under the terms of the MIT license.
+/// For a copy, see <https://opensource.org/licenses/MIT>.
+//==============================================================================
+/// file 	: thread_pool.h
+/// purpose : Provides the library's persistent work-stealing thread pool.
+//==============================================================================
+
+#ifndef XTGA_THREAD_POOL_H__
+#define XTGA_THREAD_POOL_H__
+
+#include "xTGA/threading.h"
+#include "xTGA/types.h"
+
+#include <functional>
+
+namespace xtga
+{
+	namespace threading
+	{
+		//----------------------------------------------------------------------------------------------------
+		/// Returns the number of parts work should be split into to keep every thread busy.
+		/// @return uint32					The concurrency of the current executor (1 if threading is disabled).
+		//----------------------------------------------------------------------------------------------------
+		uint32 Concurrency();
+
+		//----------------------------------------------------------------------------------------------------
+		/// Runs fn(part) for every part in [0, parts) and returns once all of them have. The calling thread
+		/// takes part in the work, so calls may be nested.
+		/// @param[in] parts				The number of parts.
+		/// @param[in] fn					The function to run.
+		//----------------------------------------------------------------------------------------------------
+		void ParallelInvoke(uint32 parts, const std::function<void(uint32 part)>& fn);
+
+		//----------------------------------------------------------------------------------------------------
+		/// Splits [0, length) into contiguous ranges and runs fn(start, count) on each, returns once all
+		/// of them have.
+		/// @param[in] length				The number of elements.
+		/// @param[in] fn					The function to run.
+		/// @param[in] grain				The smallest range worth handing to another thread.
+		//----------------------------------------------------------------------------------------------------
+		void ParallelFor(addressable length, const std::function<void(addressable start, addressable count)>& fn, addressable grain = 4096);
+
+		//----------------------------------------------------------------------------------------------------
+		/// As above, but the work is only split if 'execution' is THREADED, otherwise it runs fn(0, length)
+		/// on the calling thread.
+		/// @param[in] execution			How to run the work, usually from ChooseExecution().
+		/// @param[in] length				The number of elements.
+		/// @param[in] fn					The function to run.
+		/// @param[in] grain				The smallest range worth handing to another thread.
+		//----------------------------------------------------------------------------------------------------
+		void ParallelFor(EXECUTION execution, addressable length, const std::function<void(addressable start, addressable count)>& fn, addressable grain = 4096);
+	}
+}
+
+#endif // !XTGA_THREAD_POOL_H__
@@ -13,6 +13,25 @@
 #include "error_macro.h"
 
 #include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+namespace
+{
+	// xtga_ColorTransformFunc takes the color as a uchar*, so it can't be called through an
+	// xtga::ColorTransformFunc. The C function and its userdata are passed through this instead.
+	struct ColorTransformTrampoline
+	{
+		xtga_ColorTransformFunc Func;
+		void* UserData;
+	};
+
+	void ForwardColorTransform(xtga::pixelformats::RGBA8888& c, void* userdata)
+	{
+		const ColorTransformTrampoline* t = (const ColorTransformTrampoline*)userdata;
+		t->Func((uchar*)&c, t->UserData);
+	}
+}
 
 extern "C"
 {
@@ -24,14 +43,121 @@ extern "C"
 
 	void xtga_FreeMem(void** mem)
 	{
-		free(*mem);
+		xtga::memory::Free(*mem);
 		mem = nullptr;
 	}
 
+	void xtga_SetThreadCount(uint32 count)
+	{
+		xtga::threading::SetThreadCount(count);
+	}
+
+	uint32 xtga_GetThreadCount()
+	{
+		return xtga::threading::GetThreadCount();
+	}
+
+	void xtga_SetExecutor(xtga_ExecutorFunc executor, void* userdata, uint32 concurrency)
+	{
+		xtga::threading::SetExecutor((xtga::threading::ExecutorFunc)executor, userdata, concurrency);
+	}
+
+	xtga_EXECUTION_e xtga_ChooseExecution(xtga_WORKLOAD_e workload, addressable pixels, uchar depth, uint16 entries)
+	{
+		return (xtga_EXECUTION_e)xtga::threading::ChooseExecution((xtga::threading::WORKLOAD)workload, pixels, depth, entries);
+	}
+
+	void xtga_SetParallelThreshold(xtga_WORKLOAD_e workload, uint64 pixels)
+	{
+		xtga::threading::SetParallelThreshold((xtga::threading::WORKLOAD)workload, pixels);
+	}
+
+	uint64 xtga_GetParallelThreshold(xtga_WORKLOAD_e workload, uchar depth, uint16 entries)
+	{
+		return xtga::threading::GetParallelThreshold((xtga::threading::WORKLOAD)workload, depth, entries);
+	}
+
+	void xtga_CalibrateCostModel()
+	{
+		xtga::threading::CalibrateCostModel();
+	}
+
+	void xtga_SetAllocator(const xtga_Allocator_t* allocator)
+	{
+		xtga::memory::SetAllocator((const xtga::memory::Allocator*)allocator);
+	}
+
+	void xtga_SetThreadAllocator(const xtga_Allocator_t* allocator)
+	{
+		xtga::memory::SetThreadAllocator((const xtga::memory::Allocator*)allocator);
+	}
+
+	void xtga_SetHugePageOptions(const xtga_HugePageOptions_t* options)
+	{
+		xtga::memory::SetHugePageOptions((const xtga::memory::HugePageOptions*)options);
+	}
+
+	void* xtga_Allocate(addressable size, addressable alignment)
+	{
+		return xtga::memory::Allocate(size, alignment == 0 ? xtga::memory::DefaultAlignment : alignment);
+	}
+
+	void xtga_GetAllocationStats(xtga_AllocationStats_t* stats)
+	{
+		auto s = xtga::memory::GetStats();
+		memcpy(stats, &s, sizeof(xtga_AllocationStats_t));
+	}
+
+	void xtga_ResetAllocationStats()
+	{
+		xtga::memory::ResetStats();
+	}
+
+	xtga_Arena* xtga_Arena_Alloc(addressable blockSize, const xtga_Allocator_t* parent)
+	{
+		return (xtga_Arena*)xtga::memory::Arena::Alloc(blockSize, (const xtga::memory::Allocator*)parent);
+	}
+
+	void xtga_Arena_Free(xtga_Arena** obj)
+	{
+		xtga::memory::Arena::Free(*(xtga::memory::Arena**)obj);
+	}
+
+	void xtga_Arena_GetAllocator(xtga_Arena* arena, xtga_Allocator_t* allocator)
+	{
+		auto a = ((xtga::memory::Arena*)arena)->GetAllocator();
+		memcpy(allocator, &a, sizeof(xtga_Allocator_t));
+	}
+
+	void xtga_Arena_Reset(xtga_Arena* arena)
+	{
+		((xtga::memory::Arena*)arena)->Reset();
+	}
+
+	xtga_DecodeContext* xtga_DecodeContext_Alloc()
+	{
+		return (xtga_DecodeContext*)xtga::DecodeContext::Alloc();
+	}
+
+	void xtga_DecodeContext_Free(xtga_DecodeContext** obj)
+	{
+		xtga::DecodeContext::Free(*(xtga::DecodeContext**)obj);
+	}
+
+	addressable xtga_DecodeContext_GetReserved(xtga_DecodeContext* context)
+	{
+		return ((xtga::DecodeContext*)context)->GetReserved();
+	}
+
+	void xtga_DecodeContext_Trim(xtga_DecodeContext* context)
+	{
+		((xtga::DecodeContext*)context)->Trim();
+	}
+
 	xtga_Parameters* xtga_Parameters_BGR24()
 	{
 		auto s = xtga::Parameters::BGR24();
-		auto r = (xtga::Parameters*)malloc(sizeof(xtga::Parameters));
+		auto r = (xtga::Parameters*)xtga::memory::Allocate(sizeof(xtga::Parameters));
 		*r = s;
 		return (xtga_Parameters*)r;
 	}
@@ -39,7 +165,7 @@ extern "C"
 	xtga_Parameters* xtga_Parameters_BGR24_RLE()
 	{
 		auto s = xtga::Parameters::BGR24_RLE();
-		auto r = (xtga::Parameters*)malloc(sizeof(xtga::Parameters));
+		auto r = (xtga::Parameters*)xtga::memory::Allocate(sizeof(xtga::Parameters));
 		*r = s;
 		return (xtga_Parameters*)r;
 	}
@@ -47,7 +173,7 @@ extern "C"
 	xtga_Parameters* xtga_Parameters_BGR24_COLORMAPPED()
 	{
 		auto s = xtga::Parameters::BGR24_COLORMAPPED();
-		auto r = (xtga::Parameters*)malloc(sizeof(xtga::Parameters));
+		auto r = (xtga::Parameters*)xtga::memory::Allocate(sizeof(xtga::Parameters));
 		*r = s;
 		return (xtga_Parameters*)r;
 	}
@@ -55,7 +181,7 @@ extern "C"
 	xtga_Parameters* xtga_Parameters_BGR24_RLE_COLORMAPPED()
 	{
 		auto s = xtga::Parameters::BGR24_RLE_COLORMAPPED();
-		auto r = (xtga::Parameters*)malloc(sizeof(xtga::Parameters));
+		auto r = (xtga::Parameters*)xtga::memory::Allocate(sizeof(xtga::Parameters));
 		*r = s;
 		return (xtga_Parameters*)r;
 	}
@@ -63,7 +189,7 @@ extern "C"
 	xtga_Parameters* xtga_Parameters_BGR16()
 	{
 		auto s = xtga::Parameters::BGR16();
-		auto r = (xtga::Parameters*)malloc(sizeof(xtga::Parameters));
+		auto r = (xtga::Parameters*)xtga::memory::Allocate(sizeof(xtga::Parameters));
 		*r = s;
 		return (xtga_Parameters*)r;
 	}
@@ -71,7 +197,7 @@ extern "C"
 	xtga_Parameters* xtga_Parameters_BGR16_RLE()
 	{
 		auto s = xtga::Parameters::BGR16_RLE();
-		auto r = (xtga::Parameters*)malloc(sizeof(xtga::Parameters));
+		auto r = (xtga::Parameters*)xtga::memory::Allocate(sizeof(xtga::Parameters));
 		*r = s;
 		return (xtga_Parameters*)r;
 	}
@@ -79,7 +205,7 @@ extern "C"
 	xtga_Parameters* xtga_Parameters_BGR16_COLORMAPPED()
 	{
 		auto s = xtga::Parameters::BGR16_COLORMAPPED();
-		auto r = (xtga::Parameters*)malloc(sizeof(xtga::Parameters));
+		auto r = (xtga::Parameters*)xtga::memory::Allocate(sizeof(xtga::Parameters));
 		*r = s;
 		return (xtga_Parameters*)r;
 	}
@@ -87,7 +213,7 @@ extern "C"
 	xtga_Parameters* xtga_Parameters_BGR16_RLE_COLORMAPPED()
 	{
 		auto s = xtga::Parameters::BGR16_RLE_COLORMAPPED();
-		auto r = (xtga::Parameters*)malloc(sizeof(xtga::Parameters));
+		auto r = (xtga::Parameters*)xtga::memory::Allocate(sizeof(xtga::Parameters));
 		*r = s;
 		return (xtga_Parameters*)r;
 	}
@@ -95,7 +221,7 @@ extern "C"
 	xtga_Parameters* xtga_Parameters_BGRA32_STRAIGHT_ALPHA()
 	{
 		auto s = xtga::Parameters::BGRA32_STRAIGHT_ALPHA();
-		auto r = (xtga::Parameters*)malloc(sizeof(xtga::Parameters));
+		auto r = (xtga::Parameters*)xtga::memory::Allocate(sizeof(xtga::Parameters));
 		*r = s;
 		return (xtga_Parameters*)r;
 	}
@@ -103,7 +229,7 @@ extern "C"
 	xtga_Parameters* xtga_Parameters_BGRA32_PREMULTIPLIED_ALPHA()
 	{
 		auto s = xtga::Parameters::BGRA32_PREMULTIPLIED_ALPHA();
-		auto r = (xtga::Parameters*)malloc(sizeof(xtga::Parameters));
+		auto r = (xtga::Parameters*)xtga::memory::Allocate(sizeof(xtga::Parameters));
 		*r = s;
 		return (xtga_Parameters*)r;
 	}
@@ -111,7 +237,7 @@ extern "C"
 	xtga_Parameters* xtga_Parameters_BGRA32_RLE_STRAIGHT_ALPHA()
 	{
 		auto s = xtga::Parameters::BGRA32_RLE_STRAIGHT_ALPHA();
-		auto r = (xtga::Parameters*)malloc(sizeof(xtga::Parameters));
+		auto r = (xtga::Parameters*)xtga::memory::Allocate(sizeof(xtga::Parameters));
 		*r = s;
 		return (xtga_Parameters*)r;
 	}
@@ -119,7 +245,7 @@ extern "C"
 	xtga_Parameters* xtga_Parameters_BGRA32_RLE_PREMULTIPLIED_ALPHA()
 	{
 		auto s = xtga::Parameters::BGRA32_RLE_PREMULTIPLIED_ALPHA();
-		auto r = (xtga::Parameters*)malloc(sizeof(xtga::Parameters));
+		auto r = (xtga::Parameters*)xtga::memory::Allocate(sizeof(xtga::Parameters));
 		*r = s;
 		return (xtga_Parameters*)r;
 	}
@@ -127,7 +253,7 @@ extern "C"
 	xtga_Parameters* xtga_Parameters_BGRA32_COLORMAPPED_STRAIGHT_ALPHA()
 	{
 		auto s = xtga::Parameters::BGRA32_COLORMAPPED_STRAIGHT_ALPHA();
-		auto r = (xtga::Parameters*)malloc(sizeof(xtga::Parameters));
+		auto r = (xtga::Parameters*)xtga::memory::Allocate(sizeof(xtga::Parameters));
 		*r = s;
 		return (xtga_Parameters*)r;
 	}
@@ -135,7 +261,7 @@ extern "C"
 	xtga_Parameters* xtga_Parameters_BGRA32_COLORMAPPED_PREMULTIPLIED_ALPHA()
 	{
 		auto s = xtga::Parameters::BGRA32_COLORMAPPED_PREMULTIPLIED_ALPHA();
-		auto r = (xtga::Parameters*)malloc(sizeof(xtga::Parameters));
+		auto r = (xtga::Parameters*)xtga::memory::Allocate(sizeof(xtga::Parameters));
 		*r = s;
 		return (xtga_Parameters*)r;
 	}
@@ -143,7 +269,7 @@ extern "C"
 	xtga_Parameters* xtga_Parameters_BGRA32_RLE_COLORMAPPED_STRAIGHT_ALPHA()
 	{
 		auto s = xtga::Parameters::BGRA32_RLE_COLORMAPPED_STRAIGHT_ALPHA();
-		auto r = (xtga::Parameters*)malloc(sizeof(xtga::Parameters));
+		auto r = (xtga::Parameters*)xtga::memory::Allocate(sizeof(xtga::Parameters));
 		*r = s;
 		return (xtga_Parameters*)r;
 	}
@@ -151,7 +277,7 @@ extern "C"
 	xtga_Parameters* xtga_Parameters_BGRA32_RLE_COLORMAPPED_PREMULTIPLIED_ALPHA()
 	{
 		auto s = xtga::Parameters::BGRA32_RLE_COLORMAPPED_PREMULTIPLIED_ALPHA();
-		auto r = (xtga::Parameters*)malloc(sizeof(xtga::Parameters));
+		auto r = (xtga::Parameters*)xtga::memory::Allocate(sizeof(xtga::Parameters));
 		*r = s;
 		return (xtga_Parameters*)r;
 	}
@@ -159,7 +285,7 @@ extern "C"
 	xtga_Parameters* xtga_Parameters_I8()
 	{
 		auto s = xtga::Parameters::I8();
-		auto r = (xtga::Parameters*)malloc(sizeof(xtga::Parameters));
+		auto r = (xtga::Parameters*)xtga::memory::Allocate(sizeof(xtga::Parameters));
 		*r = s;
 		return (xtga_Parameters*)r;
 	}
@@ -167,7 +293,7 @@ extern "C"
 	xtga_Parameters* xtga_Parameters_I8_RLE()
 	{
 		auto s = xtga::Parameters::I8_RLE();
-		auto r = (xtga::Parameters*)malloc(sizeof(xtga::Parameters));
+		auto r = (xtga::Parameters*)xtga::memory::Allocate(sizeof(xtga::Parameters));
 		*r = s;
 		return (xtga_Parameters*)r;
 	}
@@ -175,7 +301,7 @@ extern "C"
 	xtga_Parameters* xtga_Parameters_IA16_STRAIGHT_ALPHA()
 	{
 		auto s = xtga::Parameters::IA16_STRAIGHT_ALPHA();
-		auto r = (xtga::Parameters*)malloc(sizeof(xtga::Parameters));
+		auto r = (xtga::Parameters*)xtga::memory::Allocate(sizeof(xtga::Parameters));
 		*r = s;
 		return (xtga_Parameters*)r;
 	}
@@ -183,7 +309,7 @@ extern "C"
 	xtga_Parameters* xtga_Parameters_IA16_PREMULTIPLIED_ALPHA()
 	{
 		auto s = xtga::Parameters::IA16_PREMULTIPLIED_ALPHA();
-		auto r = (xtga::Parameters*)malloc(sizeof(xtga::Parameters));
+		auto r = (xtga::Parameters*)xtga::memory::Allocate(sizeof(xtga::Parameters));
 		*r = s;
 		return (xtga_Parameters*)r;
 	}
@@ -191,7 +317,7 @@ extern "C"
 	xtga_Parameters* xtga_Parameters_IA16_RLE_STRAIGHT_ALPHA()
 	{
 		auto s = xtga::Parameters::IA16_RLE_STRAIGHT_ALPHA();
-		auto r = (xtga::Parameters*)malloc(sizeof(xtga::Parameters));
+		auto r = (xtga::Parameters*)xtga::memory::Allocate(sizeof(xtga::Parameters));
 		*r = s;
 		return (xtga_Parameters*)r;
 	}
@@ -199,7 +325,7 @@ extern "C"
 	xtga_Parameters* xtga_Parameters_IA16_RLE_PREMULTIPLIED_ALPHA()
 	{
 		auto s = xtga::Parameters::IA16_RLE_PREMULTIPLIED_ALPHA();
-		auto r = (xtga::Parameters*)malloc(sizeof(xtga::Parameters));
+		auto r = (xtga::Parameters*)xtga::memory::Allocate(sizeof(xtga::Parameters));
 		*r = s;
 		return (xtga_Parameters*)r;
 	}
@@ -252,6 +378,47 @@ extern "C"
 		((xtga::Parameters*)Parameters)->RunLengthEncode = userle;
 	}
 
+	void xtga_Parameters_set_quantizer(xtga_Parameters* Parameters, xtga_QUANTIZER_e quantizer, uchar refinement)
+	{
+		if (!Parameters)
+			return;
+
+		((xtga::Parameters*)Parameters)->Quantizer = (xtga::flags::QUANTIZER)quantizer;
+		((xtga::Parameters*)Parameters)->QuantizerRefinement = refinement;
+	}
+
+	void xtga_Parameters_set_quantizer_samples(xtga_Parameters* Parameters, uint32 samples)
+	{
+		if (!Parameters)
+			return;
+
+		((xtga::Parameters*)Parameters)->QuantizerSampleSize = samples;
+	}
+
+	void xtga_Parameters_set_palette(xtga_Parameters* Parameters, xtga_SharedPalette* palette)
+	{
+		if (!Parameters)
+			return;
+
+		((xtga::Parameters*)Parameters)->Palette = (xtga::SharedPalette*)palette;
+	}
+
+	void xtga_Parameters_set_origin(xtga_Parameters* Parameters, xtga_IMAGEORIGIN_e origin)
+	{
+		if (!Parameters)
+			return;
+
+		((xtga::Parameters*)Parameters)->Origin = (xtga::flags::IMAGEORIGIN)origin;
+	}
+
+	void xtga_Parameters_set_buffer_mode(xtga_Parameters* Parameters, xtga_BUFFERMODE_e mode)
+	{
+		if (!Parameters)
+			return;
+
+		((xtga::Parameters*)Parameters)->BufferMode = (xtga::flags::BUFFERMODE)mode;
+	}
+
 	xtga_TGAFile* xtga_TGAFile_Alloc_FromFile(char const* filename, xtga_ERRORCODE_e* error)
 	{
 		xtga::ERRORCODE err = xtga::ERRORCODE::NONE;
@@ -294,6 +461,17 @@ extern "C"
 		return ((xtga::TGAFile*)TGAFile)->SaveFile(filename, (xtga::ERRORCODE*)error);
 	}
 
+	xtga_ManagedArray* xtga_TGAFile_SaveToMemory(xtga_TGAFile* TGAFile, xtga_ERRORCODE_e* error)
+	{
+		std::vector<uchar> Buffer;
+		if (!((xtga::TGAFile*)TGAFile)->SaveToMemory(Buffer, (xtga::ERRORCODE*)error))
+			return nullptr;
+
+		auto r = xtga::ManagedArray<uchar>::Alloc(Buffer.size());
+		memcpy(r->rawat(0), Buffer.data(), Buffer.size());
+		return (xtga_ManagedArray*)r;
+	}
+
 	uchar const* xtga_TGAFile_GetImageID(xtga_TGAFile* TGAFile)
 	{
 		return ((xtga::TGAFile*)TGAFile)->GetImageID();
@@ -314,6 +492,26 @@ extern "C"
 		return ((xtga::TGAFile*)TGAFile)->GenerateColorMap(force, (xtga::ERRORCODE*)error);
 	}
 
+	bool xtga_TGAFile_GenerateColorMapQuantized(xtga_TGAFile* TGAFile, xtga_QUANTIZER_e quantizer, uchar refinement, xtga_ERRORCODE_e* error)
+	{
+		return ((xtga::TGAFile*)TGAFile)->GenerateColorMap((xtga::flags::QUANTIZER)quantizer, refinement, (xtga::ERRORCODE*)error);
+	}
+
+	bool xtga_TGAFile_GenerateColorMapSampled(xtga_TGAFile* TGAFile, xtga_QUANTIZER_e quantizer, uchar refinement, uint32 samples, xtga_ERRORCODE_e* error)
+	{
+		return ((xtga::TGAFile*)TGAFile)->GenerateColorMap((xtga::flags::QUANTIZER)quantizer, refinement, samples, (xtga::ERRORCODE*)error);
+	}
+
+	const xtga_ColorMapStats_t* xtga_TGAFile_GetColorMapStats(xtga_TGAFile* TGAFile)
+	{
+		return (const xtga_ColorMapStats_t*)((xtga::TGAFile*)TGAFile)->GetColorMapStats();
+	}
+
+	bool xtga_TGAFile_ApplyPalette(xtga_TGAFile* TGAFile, xtga_SharedPalette* palette, xtga_ERRORCODE_e* error)
+	{
+		return ((xtga::TGAFile*)TGAFile)->ApplyPalette((xtga::SharedPalette*)palette, (xtga::ERRORCODE*)error);
+	}
+
 	void* xtga_TGAFile_GetImageData(xtga_TGAFile* TGAFile)
 	{
 		return ((xtga::TGAFile*)TGAFile)->GetImageData();
@@ -424,16 +622,54 @@ extern "C"
 		((xtga::TGAFile*)TGAFile)->GenerateColorCorrectionTable();
 	}
 
+	bool xtga_TGAFile_TransformColors(xtga_TGAFile* TGAFile, xtga_ColorTransformFunc func, void* userdata, xtga_ERRORCODE_e* error)
+	{
+		if (!func)
+			return ((xtga::TGAFile*)TGAFile)->TransformColors(nullptr, userdata, (xtga::ERRORCODE*)error);
+
+		ColorTransformTrampoline trampoline = { func, userdata };
+		return ((xtga::TGAFile*)TGAFile)->TransformColors(ForwardColorTransform, &trampoline, (xtga::ERRORCODE*)error);
+	}
+
+	bool xtga_TGAFile_TransformChannels(xtga_TGAFile* TGAFile, const uchar* R, const uchar* G, const uchar* B, const uchar* A, xtga_ERRORCODE_e* error)
+	{
+		return ((xtga::TGAFile*)TGAFile)->TransformChannels(R, G, B, A, (xtga::ERRORCODE*)error);
+	}
+
+	bool xtga_TGAFile_ApplyColorCorrectionTable(xtga_TGAFile* TGAFile, xtga_ERRORCODE_e* error)
+	{
+		return ((xtga::TGAFile*)TGAFile)->ApplyColorCorrectionTable((xtga::ERRORCODE*)error);
+	}
+
 	xtga_ManagedArray* xtga_TGAFile_GetImage(xtga_TGAFile* TGAFile, xtga_PIXELFORMATS_e* PixelType, xtga_ALPHATYPE_e* AlphaType, xtga_ERRORCODE_e* error)
 	{
 		return (xtga_ManagedArray*)(((xtga::TGAFile*)TGAFile)->GetImage((xtga::pixelformats::PIXELFORMATS*)PixelType, (xtga::flags::ALPHATYPE*)AlphaType, (xtga::ERRORCODE*)error));
 	}
 
+	xtga_ManagedArray* xtga_TGAFile_GetIndexedImage(xtga_TGAFile* TGAFile, xtga_ManagedArray** Palette, xtga_PIXELFORMATS_e* PaletteType, xtga_ALPHATYPE_e* AlphaType, xtga_ERRORCODE_e* error)
+	{
+		return (xtga_ManagedArray*)(((xtga::TGAFile*)TGAFile)->GetIndexedImage((xtga::ManagedArray<xtga::pixelformats::IPixel>**)Palette,
+			(xtga::pixelformats::PIXELFORMATS*)PaletteType, (xtga::flags::ALPHATYPE*)AlphaType, (xtga::ERRORCODE*)error));
+	}
+
 	xtga_ManagedArray* xtga_TGAFile_GetImageRGBA(xtga_TGAFile* TGAFile, xtga_ALPHATYPE_e* AlphaType, xtga_ERRORCODE_e* error)
 	{
 		return (xtga_ManagedArray*)(((xtga::TGAFile*)TGAFile)->GetImageRGBA((xtga::flags::ALPHATYPE*)AlphaType, (xtga::ERRORCODE*)error));
 	}
 
+	bool xtga_TGAFile_DecodeImageRGBA(xtga_TGAFile* TGAFile, void* out, xtga_DecodeContext* context, xtga_ALPHATYPE_e* AlphaType,
+		xtga_ERRORCODE_e* error)
+	{
+		return ((xtga::TGAFile*)TGAFile)->DecodeImageRGBA((xtga::pixelformats::RGBA8888*)out, (xtga::DecodeContext*)context,
+			(xtga::flags::ALPHATYPE*)AlphaType, (xtga::ERRORCODE*)error);
+	}
+
+	xtga_MipChain* xtga_TGAFile_GenerateMipChain(xtga_TGAFile* TGAFile, xtga_MIPFILTER_e filter, xtga_PIXELFORMATS_e outFormat, xtga_ERRORCODE_e* error)
+	{
+		return (xtga_MipChain*)(((xtga::TGAFile*)TGAFile)->GenerateMipChain((xtga::flags::MIPFILTER)filter,
+			(xtga::pixelformats::PIXELFORMATS)outFormat, (xtga::ERRORCODE*)error));
+	}
+
 	void xtga_TGAFile_UpgradeToTGATwo(xtga_TGAFile* TGAFile, xtga_ERRORCODE_e* error)
 	{
 		((xtga::TGAFile*)TGAFile)->UpgradeToTGATwo((xtga::ERRORCODE*)error);
@@ -445,6 +681,13 @@ extern "C"
 		xtga::ManagedArray<xtga::pixelformats::IPixel>::Free(ptr);
 	}
 
+	void* xtga_ManagedArray_Release(xtga_ManagedArray** obj)
+	{
+		auto ptr = (xtga::ManagedArray<xtga::pixelformats::IPixel>*)(*obj);
+		*obj = nullptr;
+		return xtga::ManagedArray<xtga::pixelformats::IPixel>::Release(ptr);
+	}
+
 	void* xtga_ManagedArray_at(xtga_ManagedArray* marray, addressable index, xtga_ERRORCODE_e* error)
 	{
 		auto ptr = (xtga::ManagedArray<xtga::pixelformats::IPixel>*)marray;
@@ -456,4 +699,102 @@ extern "C"
 	{
 		return ((xtga::ManagedArray<xtga::pixelformats::IPixel>*)marray)->size();
 	}
+
+	xtga_SharedPalette* xtga_SharedPalette_Build(const void* const* buffers, const addressable* lengths, uint32 count, uchar depth,
+		xtga_QUANTIZER_e quantizer, uchar refinement, uint32 samples, xtga_ERRORCODE_e* error)
+	{
+		return (xtga_SharedPalette*)xtga::SharedPalette::Build(buffers, lengths, count, depth, (xtga::flags::QUANTIZER)quantizer, refinement, samples, (xtga::ERRORCODE*)error);
+	}
+
+	xtga_SharedPalette* xtga_SharedPalette_Alloc(const void* colormap, uint16 length, uchar depth, xtga_ERRORCODE_e* error)
+	{
+		return (xtga_SharedPalette*)xtga::SharedPalette::Alloc(colormap, length, depth, (xtga::ERRORCODE*)error);
+	}
+
+	void xtga_SharedPalette_Free(xtga_SharedPalette** obj)
+	{
+		xtga::SharedPalette::Free(*(xtga::SharedPalette**)obj);
+	}
+
+	const void* xtga_SharedPalette_GetColorMap(xtga_SharedPalette* palette)
+	{
+		return ((xtga::SharedPalette*)palette)->GetColorMap();
+	}
+
+	uint16 xtga_SharedPalette_CopyColorMap(xtga_SharedPalette* palette, void* out, uint32* revision)
+	{
+		return ((xtga::SharedPalette*)palette)->CopyColorMap(out, revision);
+	}
+
+	uint16 xtga_SharedPalette_GetLength(xtga_SharedPalette* palette)
+	{
+		return ((xtga::SharedPalette*)palette)->GetLength();
+	}
+
+	uint32 xtga_SharedPalette_GetRevision(xtga_SharedPalette* palette)
+	{
+		return ((xtga::SharedPalette*)palette)->GetRevision();
+	}
+
+	void xtga_SharedPalette_SetUpdateThreshold(xtga_SharedPalette* palette, double threshold)
+	{
+		((xtga::SharedPalette*)palette)->SetUpdateThreshold(threshold);
+	}
+
+	bool xtga_SharedPalette_Update(xtga_SharedPalette* palette, const void* buffer, addressable length, xtga_ERRORCODE_e* error)
+	{
+		return ((xtga::SharedPalette*)palette)->Update(buffer, length, (xtga::ERRORCODE*)error);
+	}
+
+	void xtga_MipChain_Free(xtga_MipChain** obj)
+	{
+		xtga::MipChain::Free(*(xtga::MipChain**)obj);
+	}
+
+	const void* xtga_MipChain_GetData(xtga_MipChain* chain)
+	{
+		return ((xtga::MipChain*)chain)->GetData();
+	}
+
+	addressable xtga_MipChain_GetSize(xtga_MipChain* chain)
+	{
+		return ((xtga::MipChain*)chain)->GetSize();
+	}
+
+	uint16 xtga_MipChain_GetLevelCount(xtga_MipChain* chain)
+	{
+		return ((xtga::MipChain*)chain)->GetLevelCount();
+	}
+
+	const xtga_MipLevel_t* xtga_MipChain_GetLevel(xtga_MipChain* chain, uint16 index, xtga_ERRORCODE_e* error)
+	{
+		return (const xtga_MipLevel_t*)((xtga::MipChain*)chain)->GetLevel(index, (xtga::ERRORCODE*)error);
+	}
+
+	xtga_TGAWriter* xtga_TGAWriter_Open(const char* filename, uint16 width, uint16 height, const xtga_Parameters* config,
+		xtga_IMAGEORIGIN_e origin, xtga_ERRORCODE_e* error)
+	{
+		return (xtga_TGAWriter*)xtga::TGAWriter::Open(filename, width, height, *(xtga::Parameters*)config,
+			(xtga::flags::IMAGEORIGIN)origin, (xtga::ERRORCODE*)error);
+	}
+
+	void xtga_TGAWriter_Free(xtga_TGAWriter** obj)
+	{
+		xtga::TGAWriter::Free(*(xtga::TGAWriter**)obj);
+	}
+
+	bool xtga_TGAWriter_WriteRows(xtga_TGAWriter* writer, const void* rows, uint16 count, xtga_ERRORCODE_e* error)
+	{
+		return ((xtga::TGAWriter*)writer)->WriteRows(rows, count, (xtga::ERRORCODE*)error);
+	}
+
+	uint16 xtga_TGAWriter_GetRowsWritten(xtga_TGAWriter* writer)
+	{
+		return ((xtga::TGAWriter*)writer)->GetRowsWritten();
+	}
+
+	bool xtga_TGAWriter_Close(xtga_TGAWriter* writer, xtga_ERRORCODE_e* error)
+	{
+		return ((xtga::TGAWriter*)writer)->Close((xtga::ERRORCODE*)error);
+	}
 }
\ No newline at end of file